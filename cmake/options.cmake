@@ -52,3 +52,6 @@ ENDIF(NOT WIN32)
 
 # Translations.
 OPTION(ENABLE_NLS "Enable NLS using Qt's built-in localization system." ON)
+
+# Unit tests. (requires Google Test)
+OPTION(BUILD_TESTING "Build unit tests." OFF)
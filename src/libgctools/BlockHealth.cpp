@@ -0,0 +1,226 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * BlockHealth.cpp: Memory card block health analysis.                     *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "BlockHealth.hpp"
+#include "util/cpuflags_x86.h"
+
+// C includes. (C++ namespace)
+#include <cmath>
+#include <cstring>
+
+// SSE2 is always available on amd64.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define BLOCKHEALTH_HAS_SSE2 1
+#endif
+
+namespace BlockHealth {
+
+/**
+ * Check if a buffer is filled with a single byte value.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return True if every byte in buf is the same.
+ */
+bool IsUniform(const uint8_t *buf, size_t siz)
+{
+	if (siz == 0)
+		return true;
+
+	const uint8_t fill = buf[0];
+	size_t i = 0;
+
+#ifdef BLOCKHEALTH_HAS_SSE2
+	if (MCR_CPU_HasSSE2()) {
+		// Check 64 bytes at a time.
+		const __m128i xmm_fill = _mm_set1_epi8((char)fill);
+		for (; i + 64 <= siz; i += 64) {
+			const __m128i *const p = reinterpret_cast<const __m128i*>(&buf[i]);
+			const __m128i eq01 = _mm_and_si128(
+				_mm_cmpeq_epi8(_mm_loadu_si128(p+0), xmm_fill),
+				_mm_cmpeq_epi8(_mm_loadu_si128(p+1), xmm_fill));
+			const __m128i eq23 = _mm_and_si128(
+				_mm_cmpeq_epi8(_mm_loadu_si128(p+2), xmm_fill),
+				_mm_cmpeq_epi8(_mm_loadu_si128(p+3), xmm_fill));
+			if (_mm_movemask_epi8(_mm_and_si128(eq01, eq23)) != 0xFFFF)
+				return false;
+		}
+	}
+#endif /* BLOCKHEALTH_HAS_SSE2 */
+
+	// Check 8 bytes at a time.
+	const uint64_t fill64 = fill * 0x0101010101010101ULL;
+	for (; i + sizeof(uint64_t) <= siz; i += sizeof(uint64_t)) {
+		uint64_t val;
+		memcpy(&val, &buf[i], sizeof(val));
+		if (val != fill64)
+			return false;
+	}
+
+	// Check the remaining bytes.
+	for (; i < siz; i++) {
+		if (buf[i] != fill)
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * Build a byte histogram.
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ * @param hist	[out] Histogram. (256 entries)
+ */
+void Histogram(const uint8_t *buf, size_t siz, uint32_t hist[256])
+{
+	// Use four separate histograms so runs of the same
+	// byte don't stall on the same counter.
+	uint32_t h[4][256];
+	memset(h, 0, sizeof(h));
+
+	size_t i = 0;
+	for (; i + 4 <= siz; i += 4) {
+		h[0][buf[i+0]]++;
+		h[1][buf[i+1]]++;
+		h[2][buf[i+2]]++;
+		h[3][buf[i+3]]++;
+	}
+	for (; i < siz; i++) {
+		h[0][buf[i]]++;
+	}
+
+	// Combine the histograms.
+	for (int j = 0; j < 256; j++) {
+		hist[j] = h[0][j] + h[1][j] + h[2][j] + h[3][j];
+	}
+}
+
+/**
+ * Rotate a 64-bit value left.
+ * @param x Value.
+ * @param r Number of bits.
+ * @return Rotated value.
+ */
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+/**
+ * Calculate a 64-bit hash of a block.
+ * This is used to compare blocks quickly; it is not
+ * a cryptographic hash.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Hash.
+ */
+uint64_t Hash(const uint8_t *buf, size_t siz)
+{
+	// Based on the xxHash64 round function.
+	// Four independent lanes are used so the
+	// multiplies for each 32-byte chunk can overlap.
+	static const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+	static const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+	static const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+
+	uint64_t h[4] = {PRIME1 + PRIME2, PRIME2, 0, (uint64_t)0 - PRIME1};
+	size_t i = 0;
+	for (; i + 32 <= siz; i += 32) {
+		uint64_t v[4];
+		memcpy(v, &buf[i], sizeof(v));
+		h[0] = rotl64(h[0] + v[0] * PRIME2, 31) * PRIME1;
+		h[1] = rotl64(h[1] + v[1] * PRIME2, 31) * PRIME1;
+		h[2] = rotl64(h[2] + v[2] * PRIME2, 31) * PRIME1;
+		h[3] = rotl64(h[3] + v[3] * PRIME2, 31) * PRIME1;
+	}
+
+	// Combine the lanes.
+	uint64_t hash = rotl64(h[0], 1) + rotl64(h[1], 7) +
+			rotl64(h[2], 12) + rotl64(h[3], 18);
+	hash += (uint64_t)siz;
+
+	// Remaining bytes.
+	for (; i < siz; i++) {
+		hash = rotl64(hash ^ (buf[i] * PRIME3), 11) * PRIME1;
+	}
+
+	// Final avalanche.
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+/**
+ * Analyze a block.
+ * Only the content flags are set; BHF_USED and the
+ * checksum flags must be set by the caller.
+ * @param buf	[in] Block data.
+ * @param siz	[in] Block size.
+ * @param info	[out] Block health information.
+ */
+void Analyze(const uint8_t *buf, size_t siz, Info *info)
+{
+	info->clear();
+	if (siz == 0) {
+		// Empty block.
+		info->flags = BHF_UNIFORM | BHF_LOW_ENTROPY;
+		return;
+	}
+
+	if (IsUniform(buf, siz)) {
+		// Block is filled with a single byte.
+		// This is the common case for erased blocks,
+		// so skip the histogram.
+		info->flags = BHF_UNIFORM | BHF_LOW_ENTROPY;
+		info->fillByte = buf[0];
+		info->fillRatio = 255;
+		return;
+	}
+
+	uint32_t hist[256];
+	Histogram(buf, siz, hist);
+
+	// Find the most common byte and calculate the entropy.
+	// H = log2(n) - (1/n) * sum(c * log2(c))
+	uint8_t fillByte = 0;
+	uint32_t fillCount = 0;
+	double sum = 0.0;
+	for (int i = 0; i < 256; i++) {
+		const uint32_t c = hist[i];
+		if (c == 0)
+			continue;
+		if (c > fillCount) {
+			fillByte = (uint8_t)i;
+			fillCount = c;
+		}
+		sum += c * log2((double)c);
+	}
+
+	const double entropy = log2((double)siz) - (sum / siz);
+	int entropy32 = (int)(entropy * 32.0 + 0.5);
+	if (entropy32 < 0)
+		entropy32 = 0;
+	else if (entropy32 > 255)
+		entropy32 = 255;
+
+	info->fillByte = fillByte;
+	info->fillRatio = (uint8_t)(((uint64_t)fillCount * 255) / siz);
+	info->entropy = (uint8_t)entropy32;
+	if (entropy32 < ENTROPY_LOW) {
+		info->flags |= BHF_LOW_ENTROPY;
+	} else if (entropy32 > ENTROPY_HIGH) {
+		info->flags |= BHF_HIGH_ENTROPY;
+	}
+}
+
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * BlockHealth.hpp: Memory card block health analysis.                     *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_BLOCKHEALTH_HPP__
+#define __LIBGCTOOLS_BLOCKHEALTH_HPP__
+
+// C includes.
+#include <stddef.h>
+#include <stdint.h>
+
+namespace BlockHealth {
+
+/**
+ * Block health flags.
+ */
+enum Flags {
+	BHF_UNIFORM		= (1U << 0),	// Block is filled with a single byte value.
+	BHF_LOW_ENTROPY		= (1U << 1),	// Less than 1 bit per byte. (mostly fill)
+	BHF_HIGH_ENTROPY	= (1U << 2),	// More than 7.5 bits per byte. (compressed or random)
+	BHF_UNREADABLE		= (1U << 3),	// Block couldn't be read. (no other analysis flags)
+
+	// The following flags are set by the card,
+	// since they depend on the file system.
+	BHF_USED		= (1U << 4),	// Block is allocated to a file.
+	BHF_CHECKSUM_GOOD	= (1U << 5),	// Block's file has a valid checksum.
+	BHF_CHECKSUM_BAD	= (1U << 6),	// Block's file has an invalid checksum.
+};
+
+/**
+ * Block health information.
+ * This is kept small so a damage map of an
+ * entire card fits in a few kilobytes.
+ */
+struct Info {
+	uint8_t flags;		// BlockHealth::Flags
+	uint8_t fillByte;	// Most common byte.
+	uint8_t entropy;	// Shannon entropy, in units of 1/32 bit per byte. (max 255)
+	uint8_t fillRatio;	// Ratio of fillByte to the block size. (0-255)
+
+	Info() { clear(); }
+
+	void clear(void)
+	{
+		flags = 0;
+		fillByte = 0;
+		entropy = 0;
+		fillRatio = 0;
+	}
+};
+
+// Entropy thresholds, in units of 1/32 bit per byte.
+static const int ENTROPY_LOW = 32;		// 1 bit per byte
+static const int ENTROPY_HIGH = 240;		// 7.5 bits per byte
+
+/**
+ * Check if a buffer is filled with a single byte value.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return True if every byte in buf is the same.
+ */
+bool IsUniform(const uint8_t *buf, size_t siz);
+
+/**
+ * Build a byte histogram.
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ * @param hist	[out] Histogram. (256 entries)
+ */
+void Histogram(const uint8_t *buf, size_t siz, uint32_t hist[256]);
+
+/**
+ * Calculate a 64-bit hash of a block.
+ * This is used to compare blocks quickly; it is not
+ * a cryptographic hash.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Hash.
+ */
+uint64_t Hash(const uint8_t *buf, size_t siz);
+
+/**
+ * Analyze a block.
+ * Only the content flags are set; BHF_USED and the
+ * checksum flags must be set by the caller.
+ * @param buf	[in] Block data.
+ * @param siz	[in] Block size.
+ * @param info	[out] Block health information.
+ */
+void Analyze(const uint8_t *buf, size_t siz, Info *info);
+
+}
+
+#endif /* __LIBGCTOOLS_BLOCKHEALTH_HPP__ */
@@ -6,27 +6,78 @@
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
+#include "config.libgctools.h"
 #include "Checksum.hpp"
+#include "Checksum_p.hpp"
+#include "Crc16.inc.h"
 #include "SonicChaoGarden.inc.h"
 
-#include "util/byteswap.h"
+#include "util/cpuflags_x86.h"
 
 // C includes. (C++ namespace)
 #include <cstdio>
 #include <cstring>
 
 // C++ includes.
-#include <memory>
 #include <string>
 #include <vector>
 using std::string;
-using std::unique_ptr;
 using std::vector;
 
+// SSE2 is always available on amd64.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define CHECKSUM_HAS_SSE2 1
+#endif
+
 namespace Checksum {
 
 /** Algorithms. **/
 
+/**
+ * Update a CRC-16 checksum.
+ * @param crc Current checksum.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @param poly Polynomial.
+ * @return Updated checksum.
+ */
+static inline uint16_t Crc16_update(uint16_t crc, const uint8_t *buf, uint32_t siz, uint16_t poly)
+{
+	if (poly != CRC16_POLY_CCITT) {
+		// No table for this polynomial.
+		// Process one bit at a time.
+		for (; siz != 0; siz--, buf++) {
+			crc ^= (*buf & 0xFF);
+			for (int i = 8; i > 0; i--) {
+				if (crc & 1)
+					crc = ((crc >> 1) ^ poly);
+				else
+					crc >>= 1;
+			}
+		}
+		return crc;
+	}
+
+	// CRC16_POLY_CCITT: Slicing-by-8.
+	const uint16_t (*const T)[256] = Crc16_CCITT_Table;
+	for (; siz >= 8; siz -= 8, buf += 8) {
+		crc ^= (buf[0] | (buf[1] << 8));
+		crc = T[7][crc & 0xFF] ^ T[6][crc >> 8] ^
+		      T[5][buf[2]] ^ T[4][buf[3]] ^
+		      T[3][buf[4]] ^ T[2][buf[5]] ^
+		      T[1][buf[6]] ^ T[0][buf[7]];
+	}
+
+	// Remaining bytes.
+	for (; siz != 0; siz--, buf++) {
+		crc = (crc >> 8) ^ T[0][(crc ^ *buf) & 0xFF];
+	}
+
+	return crc;
+}
+
 /**
  * CRC-16 algorithm.
  * @param buf Data buffer.
@@ -36,75 +87,232 @@ namespace Checksum {
  */
 uint16_t Crc16(const uint8_t *buf, uint32_t siz, uint16_t poly)
 {
-	// TODO: Add optimized version for poly == CRC16_POLY_CCITT.
-	uint16_t crc = 0xFFFF;
+	return ~Crc16_update(0xFFFF, buf, siz, poly);
+}
 
-	for (; siz != 0; siz--, buf++) {
-		crc ^= (*buf & 0xFF);
-		for (int i = 8; i > 0; i--) {
-			if (crc & 1)
-				crc = ((crc >> 1) ^ poly);
-			else
-				crc >>= 1;
+/**
+ * Read a 16-bit word.
+ * Byte loads are used, since buf may not be 16-bit aligned.
+ * @tparam endian Endianness of the data.
+ * @param buf Word data.
+ * @return Word, in host order.
+ */
+template<ChkEndian endian>
+static inline uint16_t ReadWord16(const uint8_t *buf)
+{
+	return (endian == CHKENDIAN_BIG
+		? (uint16_t)((buf[0] << 8) | buf[1])
+		: (uint16_t)((buf[1] << 8) | buf[0]));
+}
+
+/**
+ * Add 16-bit words together. (scalar)
+ * @tparam endian Endianness of the data.
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+template<ChkEndian endian>
+static uint16_t AddWords16_c(const uint8_t *buf, uint32_t words)
+{
+	uint16_t sum = 0;
+
+	// Do four words at a time.
+	for (; words >= 4; words -= 4, buf += 8) {
+		sum += ReadWord16<endian>(&buf[0]);
+		sum += ReadWord16<endian>(&buf[2]);
+		sum += ReadWord16<endian>(&buf[4]);
+		sum += ReadWord16<endian>(&buf[6]);
+	}
+
+	// Remaining words.
+	for (; words != 0; words--, buf += 2) {
+		sum += ReadWord16<endian>(buf);
+	}
+
+	return sum;
+}
+
+#ifdef CHECKSUM_HAS_SSE2
+/**
+ * Add 16-bit words together. (SSE2)
+ * @tparam endian Endianness of the data.
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+template<ChkEndian endian>
+static uint16_t AddWords16_sse2(const uint8_t *buf, uint32_t words)
+{
+	uint16_t sum = 0;
+
+	// Add eight words at a time in 16-bit lanes.
+	// The lanes wrap around, which matches the scalar code,
+	// since the sum is modulo 2^16 anyway.
+	if (words >= 16) {
+		__m128i sum0 = _mm_setzero_si128();
+		__m128i sum1 = _mm_setzero_si128();
+		for (; words >= 16; words -= 16, buf += 32) {
+			const __m128i *const p = reinterpret_cast<const __m128i*>(buf);
+			__m128i a = _mm_loadu_si128(p+0);
+			__m128i b = _mm_loadu_si128(p+1);
+			if (endian == CHKENDIAN_BIG) {
+				// Byteswap the words. (x86 is little-endian)
+				a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+				b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+			}
+			sum0 = _mm_add_epi16(sum0, a);
+			sum1 = _mm_add_epi16(sum1, b);
 		}
+
+		// Horizontal sum.
+		sum0 = _mm_add_epi16(sum0, sum1);
+		sum0 = _mm_add_epi16(sum0, _mm_srli_si128(sum0, 8));
+		sum0 = _mm_add_epi16(sum0, _mm_srli_si128(sum0, 4));
+		sum0 = _mm_add_epi16(sum0, _mm_srli_si128(sum0, 2));
+		sum = (uint16_t)_mm_cvtsi128_si32(sum0);
 	}
 
-	return ~crc;
+	// Remaining words.
+	return sum + AddWords16_c<endian>(buf, words);
 }
+#endif /* CHECKSUM_HAS_SSE2 */
 
 /**
- * AddInvDual16 algorithm.
- * Adds 16-bit words together in a uint16_t.
- * First word is a simple addition.
- * Second word adds (word ^ 0xFFFF).
- * If either word equals 0xFFFF, it's changed to 0.
+ * AddBytes32 algorithm. (scalar)
  * @param buf Data buffer.
  * @param siz Length of data buffer.
- * @param endian Endianness of the data.
  * @return Checksum.
  */
-uint32_t AddInvDual16(const uint16_t *buf, uint32_t siz, ChkEndian endian)
+static uint32_t AddBytes32_c(const uint8_t *buf, uint32_t siz)
 {
-	// We're operating on words, not bytes.
-	// siz is in bytes, so we have to divide it by two.
-	siz /= 2;
+	uint32_t checksum = 0;
 
-	// NOTE: Integer overflow/underflow is expected here.
-	uint16_t chk1 = 0;
-	uint16_t chk2 = (uint16_t)(-(int)siz);
+	// Do four bytes at a time.
+	for (; siz >= 4; siz -= 4, buf += 4) {
+		checksum += buf[0];
+		checksum += buf[1];
+		checksum += buf[2];
+		checksum += buf[3];
+	}
 
-	if (endian != CHKENDIAN_LITTLE) {
-		// Big-endian system. (PowerPC, etc.)
-		// Do four words at a time.
-		// TODO: Optimize byteswapping?
-		for (; siz > 4; siz -= 4, buf += 4) {
-			chk1 += be16_to_cpu(buf[0]);
-			chk1 += be16_to_cpu(buf[1]);
-			chk1 += be16_to_cpu(buf[2]);
-			chk1 += be16_to_cpu(buf[3]);
-		}
+	// Remaining bytes.
+	for (; siz != 0; siz--, buf++)
+		checksum += *buf;
 
-		// Remaining words.
-		for (; siz != 0; siz--, buf++) {
-			chk1 += be16_to_cpu(*buf);
-		}
-	} else {
-		// Little-endian system. (x86, SH-4, etc.)
-		// Do four words at a time.
-		// TODO: Optimize byteswapping?
-		for (; siz > 4; siz -= 4, buf += 4) {
-			chk1 += le16_to_cpu(buf[0]);
-			chk1 += le16_to_cpu(buf[1]);
-			chk1 += le16_to_cpu(buf[2]);
-			chk1 += le16_to_cpu(buf[3]);
-		}
+	return checksum;
+}
 
-		// Remaining words.
-		for (; siz != 0; siz--, buf++) {
-			chk1 += le16_to_cpu(*buf);
+#ifdef CHECKSUM_HAS_SSE2
+/**
+ * AddBytes32 algorithm. (SSE2)
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Checksum.
+ */
+static uint32_t AddBytes32_sse2(const uint8_t *buf, uint32_t siz)
+{
+	uint32_t checksum = 0;
+
+	// Do 64 bytes at a time using psadbw.
+	// The 64-bit sums are truncated to 32 bits at the end,
+	// which matches the scalar overflow behavior.
+	if (siz >= 64) {
+		const __m128i zero = _mm_setzero_si128();
+		__m128i sum = zero;
+		for (; siz >= 64; siz -= 64, buf += 64) {
+			const __m128i *const p = reinterpret_cast<const __m128i*>(buf);
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(p+0), zero));
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(p+1), zero));
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(p+2), zero));
+			sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128(p+3), zero));
 		}
+		sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+		checksum = (uint32_t)_mm_cvtsi128_si32(sum);
 	}
-	
+
+	// Remaining bytes.
+	return checksum + AddBytes32_c(buf, siz);
+}
+#endif /* CHECKSUM_HAS_SSE2 */
+
+/** CPU dispatch. **/
+
+/**
+ * Checksum kernels.
+ * These are selected once, based on the CPU flags.
+ */
+struct ChecksumFuncs {
+	uint16_t (*AddWords16_be)(const uint8_t *buf, uint32_t words);
+	uint16_t (*AddWords16_le)(const uint8_t *buf, uint32_t words);
+	uint32_t (*AddBytes32)(const uint8_t *buf, uint32_t siz);
+};
+
+/**
+ * Select the checksum kernels for this CPU.
+ * @return Checksum kernels.
+ */
+static ChecksumFuncs ResolveChecksumFuncs(void)
+{
+	ChecksumFuncs funcs;
+	funcs.AddWords16_be = AddWords16_c<CHKENDIAN_BIG>;
+	funcs.AddWords16_le = AddWords16_c<CHKENDIAN_LITTLE>;
+	funcs.AddBytes32 = AddBytes32_c;
+
+#ifdef MCR_BUILD_AVX2
+	if (MCR_CPU_HasAVX2()) {
+		funcs.AddWords16_be = AddWords16_be_avx2;
+		funcs.AddWords16_le = AddWords16_le_avx2;
+		funcs.AddBytes32 = AddBytes32_avx2;
+		return funcs;
+	}
+#endif /* MCR_BUILD_AVX2 */
+#ifdef CHECKSUM_HAS_SSE2
+	if (MCR_CPU_HasSSE2()) {
+		funcs.AddWords16_be = AddWords16_sse2<CHKENDIAN_BIG>;
+		funcs.AddWords16_le = AddWords16_sse2<CHKENDIAN_LITTLE>;
+		funcs.AddBytes32 = AddBytes32_sse2;
+	}
+#endif /* CHECKSUM_HAS_SSE2 */
+
+	return funcs;
+}
+
+/**
+ * Get the checksum kernels for this CPU.
+ * @return Checksum kernels.
+ */
+static inline const ChecksumFuncs &Funcs(void)
+{
+	static const ChecksumFuncs funcs = ResolveChecksumFuncs();
+	return funcs;
+}
+
+/**
+ * Add 16-bit words together.
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @param endian Endianness of the data.
+ * @return Sum of all words, modulo 2^16.
+ */
+static inline uint16_t AddWords16(const uint8_t *buf, uint32_t words, ChkEndian endian)
+{
+	return (endian != CHKENDIAN_LITTLE
+		? Funcs().AddWords16_be(buf, words)
+		: Funcs().AddWords16_le(buf, words));
+}
+
+/**
+ * Finish an AddInvDual16 checksum.
+ * @param chk1 Sum of all words.
+ * @param words Number of 16-bit words.
+ * @return Checksum.
+ */
+static inline uint32_t AddInvDual16_final(uint16_t chk1, uint32_t words)
+{
+	// NOTE: Integer overflow/underflow is expected here.
+	uint16_t chk2 = (uint16_t)(-(int)words);
+
 	// sum(word ^ 0xFFFF) = sum(0xFFFF - word) = 0xFFFF * siz - sum(word)
 	// On 16 bits using two's complement, 0xFFFF = -1, so chk2 can be simplified as -siz - chk1.
 	chk2 -= chk1;
@@ -121,6 +329,27 @@ uint32_t AddInvDual16(const uint16_t *buf, uint32_t siz, ChkEndian endian)
 	return ((chk1 << 16) | chk2);
 }
 
+/**
+ * AddInvDual16 algorithm.
+ * Adds 16-bit words together in a uint16_t.
+ * First word is a simple addition.
+ * Second word adds (word ^ 0xFFFF).
+ * If either word equals 0xFFFF, it's changed to 0.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @param endian Endianness of the data.
+ * @return Checksum.
+ */
+uint32_t AddInvDual16(const uint16_t *buf, uint32_t siz, ChkEndian endian)
+{
+	// We're operating on words, not bytes.
+	// siz is in bytes, so we have to divide it by two.
+	siz /= 2;
+
+	const uint16_t chk1 = AddWords16(reinterpret_cast<const uint8_t*>(buf), siz, endian);
+	return AddInvDual16_final(chk1, siz);
+}
+
 /**
  * AddBytes32 algorithm.
  * Adds all bytes together in a uint32_t.
@@ -130,21 +359,26 @@ uint32_t AddInvDual16(const uint16_t *buf, uint32_t siz, ChkEndian endian)
  */
 uint32_t AddBytes32(const uint8_t *buf, uint32_t siz)
 {
-	uint32_t checksum = 0;
-
-	// Do four bytes at a time.
-	for (; siz > 4; siz -= 4, buf += 4) {
-		checksum += buf[0];
-		checksum += buf[1];
-		checksum += buf[2];
-		checksum += buf[3];
-	}
+	return Funcs().AddBytes32(buf, siz);
+}
 
-	// Remaining bytes.
-	for (; siz != 0; siz--, buf++)
-		checksum += *buf;
+// SonicChaoGarden initial value and final XOR.
+static const uint32_t SONICCHAOGARDEN_INIT = 0x6368616F;
+static const uint32_t SONICCHAOGARDEN_XOR = 0x686F6765;
 
-	return checksum;
+/**
+ * Update a SonicChaoGarden checksum.
+ * @param crc Current checksum.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Updated checksum.
+ */
+static inline uint32_t SonicChaoGarden_update(uint32_t crc, const uint8_t *buf, uint32_t siz)
+{
+	for (; siz != 0; siz--, buf++) {
+		crc = SonicChaoGarden_CRC32_Table[*buf ^ (crc & 0xFF)] ^ (crc >> 8);
+	}
+	return crc;
 }
 
 /**
@@ -156,14 +390,33 @@ uint32_t AddBytes32(const uint8_t *buf, uint32_t siz)
 uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz)
 {
 	// Ported from MainMemory's C# SADX/SA2B Chao Garden checksum code.
-	const uint32_t a4 = 0x686F6765;
-	uint32_t v4 = 0x6368616F;
+	return SONICCHAOGARDEN_XOR ^ SonicChaoGarden_update(SONICCHAOGARDEN_INIT, buf, siz);
+}
+
+/**
+ * Update a Dreamcast VMU checksum.
+ * @param crc Current checksum.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Updated checksum.
+ */
+static inline uint16_t DreamcastVMU_update(uint16_t crc, const uint8_t *buf, uint32_t siz)
+{
+	// Slicing-by-8. (MSB-first)
+	const uint16_t (*const T)[256] = DreamcastVMU_Table;
+	for (; siz >= 8; siz -= 8, buf += 8) {
+		crc = T[7][(crc >> 8) ^ buf[0]] ^ T[6][(crc & 0xFF) ^ buf[1]] ^
+		      T[5][buf[2]] ^ T[4][buf[3]] ^
+		      T[3][buf[4]] ^ T[2][buf[5]] ^
+		      T[1][buf[6]] ^ T[0][buf[7]];
+	}
 
+	// Remaining bytes.
 	for (; siz != 0; siz--, buf++) {
-		v4 = SonicChaoGarden_CRC32_Table[*buf ^ (v4 & 0xFF)] ^ (v4 >> 8);
+		crc = (crc << 8) ^ T[0][(crc >> 8) ^ *buf];
 	}
 
-	return (a4 ^ v4);
+	return crc;
 }
 
 /**
@@ -182,26 +435,55 @@ uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz)
  */
 uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr)
 {
-	// TODO: Optimize this?
 	// Reference: http://mc.pp.se/dc/vms/fileheader.html
-	unsigned int n = 0;
-	for (uint32_t i = 0; i < siz; i++) {
-		uint8_t chr = buf[i];
-		if (i == crc_addr || i == (crc_addr + 1)) {
-			// CRC address. Pretend it's 0.
-			chr = 0;
-		}
+	uint16_t crc = 0;
+	if (crc_addr < siz) {
+		// Data before the CRC.
+		crc = DreamcastVMU_update(crc, buf, crc_addr);
+
+		// CRC address. Pretend it's 0.
+		static const uint8_t zero[2] = {0, 0};
+		const uint32_t crc_len = (siz - crc_addr >= 2 ? 2 : 1);
+		crc = DreamcastVMU_update(crc, zero, crc_len);
+
+		buf += (crc_addr + crc_len);
+		siz -= (crc_addr + crc_len);
+	}
 
-		n ^= (chr << 8);
-		for (int c = 0; c < 8; c++) {
-			if (n & 0x8000)
-				n = (n << 1) ^ 4129;
-			else
-				n = (n << 1);
-		}
+	// Data after the CRC.
+	return DreamcastVMU_update(crc, buf, siz);
+}
+
+// Pokémon XD data area: 0x08 to 0x27FD8.
+// Each checksum covers a quarter of the data area.
+static const uint32_t PokemonXD_region_size = 0x9FF4;
+static const uint32_t PokemonXD_checksum_size = (PokemonXD_region_size*4)+8;
+
+/**
+ * Pokémon XD algorithm. (all checksums)
+ * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
+ *
+ * The data area is "encrypted", so it has to be decrypted before
+ * a checksum can be calculated. All four checksums are calculated
+ * while decrypting, so the data is only decrypted once.
+ *
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ * @param pChk	[out] Checksums, decrypted. (indexed by checksum ID)
+ * @return 0 on success; non-zero if the buffer is too small.
+ */
+int PokemonXD_All(const uint8_t *buf, uint32_t siz, PokemonXDChecksums *pChk)
+{
+	if (siz < PokemonXD_checksum_size) {
+		// Incorrect buffer size.
+		memset(pChk, 0, sizeof(*pChk));
+		return -1;
 	}
 
-	return (n & 0xFFFF);
+	PokemonXDState state;
+	PokemonXD_Init(&state);
+	PokemonXD_Update(&state, buf, PokemonXD_checksum_size);
+	return PokemonXD_Final(&state, pChk);
 }
 
 /**
@@ -211,6 +493,9 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr)
  * The data area is "encrypted", so it has to be decrypted before
  * a checksum can be calculated.
  *
+ * NOTE: This decrypts the entire data area. Use PokemonXD_All()
+ * if more than one checksum is needed.
+ *
  * @param buf		[in] Data buffer.
  * @param siz		[in] Length of data buffer.
  * @param crc_addr	[in] CRC address. (Should be 0x10, 0x14, 0x18, 0x1C.)
@@ -219,11 +504,8 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr)
  */
 uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t *pChkExpect)
 {
-	// TODO: There's four 32-bit checksums. We should rework
-	// the checksum system so we don't have to decrypt the
-	// save data four times, once for each checksum.
-	static const uint32_t checksum_size = (0x9FF4*4)+8;
-	if (siz < (0x9FF4*4)+8) {
+	PokemonXDChecksums chk;
+	if (PokemonXD_All(buf, siz, &chk) != 0) {
 		// Incorrect buffer size.
 		if (pChkExpect) {
 			*pChkExpect = 0;
@@ -231,129 +513,660 @@ uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t
 		return ~0U;
 	}
 
-	// All fields are in big-endian.
-	struct PokemonXDHeader {
-		uint32_t magic;		// [0x000] 0x01010100
-		uint32_t save_count;	// [0x004] Number of times the game has been saved.
-		uint16_t enc_keys[4];	// [0x008] Encryption keys
-
-		// The following data is all encrypted.
-		uint32_t checksum[4];	// [0x010] Checksums
-	};
-
-	// Decryption buffer.
-	unique_ptr<uint8_t[]> decbuf(new uint8_t[checksum_size]);
-	memcpy(decbuf.get(), buf, 16);
-
-	// Decrypt the data.
-	PokemonXDHeader *const pHdr = reinterpret_cast<PokemonXDHeader*>(decbuf.get());
-	uint16_t keys[4];
-	keys[0] = be16_to_cpu(pHdr->enc_keys[0]);
-	keys[1] = be16_to_cpu(pHdr->enc_keys[1]);
-	keys[2] = be16_to_cpu(pHdr->enc_keys[2]);
-	keys[3] = be16_to_cpu(pHdr->enc_keys[3]);
-
-	const uint16_t *psrcbuf16 = reinterpret_cast<const uint16_t*>(buf) + 8;
-	uint16_t *pdestbuf16 = reinterpret_cast<uint16_t*>(decbuf.get()) + 8;
-	for (size_t i = 16; i < checksum_size; i += 8) {
-		for (unsigned int j = 0; j < 4; j++, psrcbuf16++, pdestbuf16++) {
-			uint16_t tmp = be16_to_cpu(*psrcbuf16);
-			tmp -= keys[j];
-			*pdestbuf16 = cpu_to_be16(tmp);
+	// We'll use crc_addr as the checksum ID in the header.
+	const unsigned int chkID = (crc_addr >> 2) & 3;
+	if (pChkExpect) {
+		*pChkExpect = chk.expected[chkID];
+	}
+	return chk.actual[chkID];
+}
+
+/** Incremental checksums. **/
+
+/**
+ * Initialize a Pokémon XD incremental state.
+ * @param state	[out] State.
+ */
+void PokemonXD_Init(PokemonXDState *state)
+{
+	memset(state, 0, sizeof(*state));
+	state->region_end = 8 + PokemonXD_region_size;
+}
+
+/**
+ * Advance the Pokémon XD encryption keys.
+ * @param keys Encryption keys.
+ */
+static inline void PokemonXD_advanceKeys(uint16_t keys[4])
+{
+	const uint16_t a = keys[0] + 0x43;
+	const uint16_t b = keys[1] + 0x29;
+	const uint16_t c = keys[2] + 0x17;
+	const uint16_t d = keys[3] + 0x13;
+
+	keys[0] = (a & 0xf) | ((b << 4) & 0xf0) | ((c << 8) & 0xf00) | ((d << 12) & 0xf000);
+	keys[1] = ((a >> 4) & 0xf) | (b & 0xf0) | ((c << 4) & 0xf00) | ((d << 8) & 0xf000);
+	keys[2] = (c & 0xf00) | ((b & 0xf00) >> 4) | ((a & 0xf00) >> 8) | ((d << 4) & 0xf000);
+	keys[3] = ((a >> 12) & 0xf) | ((b >> 8) & 0xf0) | ((c >> 4) & 0xf00) | (d & 0xf000);
+}
+
+/**
+ * Process a single word of Pokémon XD data.
+ * @param state State.
+ * @param word Word. (big-endian value, in host order)
+ */
+static inline void PokemonXD_word(PokemonXDState *state, uint16_t word)
+{
+	// Header: (all fields are in big-endian)
+	// [0x000] uint32_t magic;	// 0x01010100
+	// [0x004] uint32_t save_count;	// Number of times the game has been saved.
+	// [0x008] uint16_t enc_keys[4];	// Encryption keys
+	// The following data is all encrypted.
+	// [0x010] uint32_t checksum[4];	// Checksums
+	const uint32_t pos = state->pos;
+	state->pos += 2;
+	if (pos < 8 || pos >= PokemonXD_checksum_size) {
+		// Not checksummed.
+		return;
+	} else if (pos < 16) {
+		// The encryption keys aren't encrypted, but they're
+		// part of the first region.
+		state->keys[(pos - 8) / 2] = word;
+		state->sum[0] += word;
+		return;
+	}
+
+	const unsigned int j = ((pos - 16) / 2) & 3;
+	const uint16_t dec = word - state->keys[j];
+	if (pos < 0x20) {
+		// Checksum word.
+		// These are zeroed out when calculating the checksums.
+		state->chkWords[(pos - 16) / 2] = dec;
+	} else {
+		if (pos >= state->region_end) {
+			state->region++;
+			state->region_end += PokemonXD_region_size;
 		}
+		state->sum[state->region] += dec;
+	}
 
-		// Advance the keys.
-		const uint16_t a = keys[0] + 0x43;
-		const uint16_t b = keys[1] + 0x29;
-		const uint16_t c = keys[2] + 0x17;
-		const uint16_t d = keys[3] + 0x13;
+	if (j == 3) {
+		// End of a group of 4 words.
+		PokemonXD_advanceKeys(state->keys);
+	}
+}
 
-		keys[0] = (a & 0xf) | ((b << 4) & 0xf0) | ((c << 8) & 0xf00) | ((d << 12) & 0xf000);
-		keys[1] = ((a >> 4) & 0xf) | (b & 0xf0) | ((c << 4) & 0xf00) | ((d << 8) & 0xf000);
-		keys[2] = (c & 0xf00) | ((b & 0xf00) >> 4) | ((a & 0xf00) >> 8) | ((d << 4) & 0xf000);
-		keys[3] = ((a >> 12) & 0xf) | ((b >> 8) & 0xf0) | ((c >> 4) & 0xf00) | (d & 0xf000);
+/**
+ * Add data to a Pokémon XD incremental state.
+ * Data past the end of the checksummed area is ignored.
+ * @param state	[in/out] State.
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ */
+void PokemonXD_Update(PokemonXDState *state, const uint8_t *buf, uint32_t siz)
+{
+	if (siz == 0)
+		return;
+
+	if (state->pos & 1) {
+		// Finish the split word.
+		state->pos--;
+		PokemonXD_word(state, (state->pending << 8) | buf[0]);
+		buf++;
+		siz--;
+	}
+
+	while (siz >= 2) {
+		const uint32_t pos = state->pos;
+		if (pos >= PokemonXD_checksum_size) {
+			// End of the checksummed area.
+			state->pos += (siz & ~1U);
+			buf += (siz & ~1U);
+			siz &= 1;
+			break;
+		}
+
+		if (pos < 0x20 || (pos & 7) != 0 || siz < 8 ||
+		    pos + 8 > PokemonXD_checksum_size)
+		{
+			// Header, or not at the start of a group.
+			PokemonXD_word(state, (buf[0] << 8) | buf[1]);
+			buf += 2;
+			siz -= 2;
+			continue;
+		}
+
+		// Decrypt whole groups of 4 words and add each word to its region.
+		// NOTE: region_size is not a multiple of 8, so a region
+		// boundary may be in the middle of a group of 4 words.
+		uint32_t groups = siz / 8;
+		const uint32_t maxGroups = (PokemonXD_checksum_size - pos) / 8;
+		if (groups > maxGroups)
+			groups = maxGroups;
+
+		// NOTE: The state is copied to local variables, since
+		// buf may alias it as far as the compiler is concerned.
+		uint16_t keys[4];
+		uint32_t sum[4];
+		memcpy(keys, state->keys, sizeof(keys));
+		memcpy(sum, state->sum, sizeof(sum));
+		unsigned int region = state->region;
+		uint32_t region_end = state->region_end;
+
+		uint32_t i = pos;
+		for (; groups != 0; groups--, i += 8, buf += 8) {
+			for (unsigned int j = 0; j < 4; j++) {
+				const uint16_t dec = ((buf[j*2] << 8) | buf[j*2+1]) - keys[j];
+				if (i + (j * 2) >= region_end) {
+					region++;
+					region_end += PokemonXD_region_size;
+				}
+				sum[region] += dec;
+			}
+			PokemonXD_advanceKeys(keys);
+		}
+
+		memcpy(state->keys, keys, sizeof(keys));
+		memcpy(state->sum, sum, sizeof(sum));
+		state->region = region;
+		state->region_end = region_end;
+		siz -= (i - pos);
+		state->pos = i;
+	}
+
+	if (siz != 0) {
+		// Save the first byte of the split word.
+		state->pending = buf[0];
+		state->pos++;
+	}
+}
+
+/**
+ * Get the Pokémon XD checksums from an incremental state.
+ * @param state	[in] State.
+ * @param pChk	[out] Checksums, decrypted. (indexed by checksum ID)
+ * @return 0 on success; non-zero if not enough data was processed.
+ */
+int PokemonXD_Final(const PokemonXDState *state, PokemonXDChecksums *pChk)
+{
+	if (state->pos < PokemonXD_checksum_size) {
+		// Not enough data.
+		memset(pChk, 0, sizeof(*pChk));
+		return -1;
 	}
 
-	// Get the expected checksum.
 	// NOTE: Checksum is stored weirdly:
 	// - ID is reversed.
 	// - Checksum is stored wordswapped.
-	// We'll use crc_addr as the checksum ID in the header,
-	// then do a reverse when checking the actual data area.
-	const unsigned int chkID = (crc_addr >> 2) & 3;
-	uint32_t chk_expect = be32_to_cpu(pHdr->checksum[chkID]);
-	chk_expect = (chk_expect << 16) | (chk_expect >> 16);
-	if (pChkExpect) {
-		*pChkExpect = chk_expect;
+	for (unsigned int chkID = 0; chkID < 4; chkID++) {
+		pChk->expected[chkID] = ((uint32_t)state->chkWords[(chkID*2)+1] << 16) | state->chkWords[chkID*2];
+		pChk->actual[chkID] = state->sum[chkID ^ 3];
 	}
+	return 0;
+}
 
-	// Calculate the actual checksum.
-	// NOTE: Checksum values should be zeroed out here.
-	pHdr->checksum[0] = 0;
-	pHdr->checksum[1] = 0;
-	pHdr->checksum[2] = 0;
-	pHdr->checksum[3] = 0;
+/** Checksum kernels. **/
 
-	// Calculate only the specified checksum.
-	uint32_t chk_actual = 0;
-	psrcbuf16 = reinterpret_cast<const uint16_t*>(&decbuf[0x08]);
-	psrcbuf16 += ((chkID ^ 3) * (0x9FF4/2));
-	for (size_t i = 0; i < 0x9FF4; i += 2, psrcbuf16++) {
-		chk_actual += (uint32_t)be16_to_cpu(*psrcbuf16);
+/**
+ * Read a 16-bit expected checksum.
+ * @param data Expected checksum data.
+ * @return Expected checksum.
+ */
+template<ChkEndian endian>
+static inline uint32_t ReadExpected16(const uint8_t *data)
+{
+	if (endian != CHKENDIAN_LITTLE) {
+		// Big-endian.
+		return (data[0] << 8) | data[1];
+	} else {
+		// Little-endian.
+		return (data[1] << 8) | data[0];
 	}
-	return chk_actual;
 }
 
-/** General functions. **/
+/**
+ * Read a 32-bit expected checksum.
+ * @param data Expected checksum data.
+ * @return Expected checksum.
+ */
+template<ChkEndian endian>
+static inline uint32_t ReadExpected32(const uint8_t *data)
+{
+	if (endian != CHKENDIAN_LITTLE) {
+		// Big-endian.
+		return ((uint32_t)data[0] << 24) | (data[1] << 16) |
+		       (data[2] << 8) | data[3];
+	} else {
+		// Little-endian.
+		return ((uint32_t)data[3] << 24) | (data[2] << 16) |
+		       (data[1] << 8) | data[0];
+	}
+}
 
 /**
- * Get the checksum for a block of data.
- * @param algorithm Checksum algorithm.
+ * Checksum kernel implementation.
+ * Specialized for each algorithm below.
+ *
+ * The unspecialized kernel is used for unknown
+ * and unimplemented algorithms.
+ */
+template<ChkAlgorithm algorithm, ChkEndian endian>
+struct Kernel {
+	static const uint32_t expectedSize = 0;
+	static void init(ChecksumState *state, uint32_t param)
+		{ ((void)state); ((void)param); }
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+		{ ((void)state); ((void)buf); ((void)siz); }
+	static uint32_t final(const ChecksumState *state)
+		{ ((void)state); return 0; }
+	static uint32_t readExpected(const uint8_t *data)
+		{ ((void)data); return 0; }
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+		{ ((void)buf); ((void)siz); ((void)param); return 0; }
+};
+
+// CRC-16
+template<ChkEndian endian>
+struct Kernel<CHKALG_CRC16, endian> {
+	static const uint32_t expectedSize = 2;
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		state->poly = (param != 0 ? (uint16_t)(param & 0xFFFF) : CRC16_POLY_CCITT);
+		state->value = 0xFFFF;
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		state->value = Crc16_update((uint16_t)state->value, buf, siz, state->poly);
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		return (uint16_t)~state->value;
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		return ReadExpected16<endian>(data);
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		if (param == 0)
+			param = CRC16_POLY_CCITT;
+		return Crc16(buf, siz, (uint16_t)(param & 0xFFFF));
+	}
+};
+
+// CRC-32
+// TODO: Implement CRC32 once I encounter a file that uses it.
+template<ChkEndian endian>
+struct Kernel<CHKALG_CRC32, endian> : public Kernel<CHKALG_NONE, endian> {
+	static const uint32_t expectedSize = 4;
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		return ReadExpected32<endian>(data);
+	}
+};
+
+// AddInvDual16
+template<ChkEndian endian>
+struct Kernel<CHKALG_ADDINVDUAL16, endian> {
+	static const uint32_t expectedSize = 4;
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		((void)state);
+		((void)param);
+	}
+
+	/**
+	 * Add 16-bit words together.
+	 * NOTE: buf may be at an odd address, e.g. after a split word.
+	 * @param buf Data buffer.
+	 * @param words Number of 16-bit words.
+	 * @return Sum of all words, modulo 2^16.
+	 */
+	static inline uint16_t addWords(const uint8_t *buf, uint32_t words)
+	{
+		return (endian != CHKENDIAN_LITTLE
+			? Funcs().AddWords16_be(buf, words)
+			: Funcs().AddWords16_le(buf, words));
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		uint16_t sum = (uint16_t)state->value;
+		if (state->count & 1) {
+			// Finish the split word.
+			sum += (endian != CHKENDIAN_LITTLE
+				? (state->pending << 8) | buf[0]
+				: (buf[0] << 8) | state->pending);
+			buf++;
+			siz--;
+		}
+		sum += addWords(buf, siz / 2);
+		if (siz & 1) {
+			// Save the first byte of the split word.
+			state->pending = buf[siz - 1];
+		}
+		state->value = sum;
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		// A trailing odd byte is ignored.
+		return AddInvDual16_final((uint16_t)state->value, state->count / 2);
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		return ReadExpected32<endian>(data);
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		((void)param);
+		return AddInvDual16_final(addWords(buf, siz / 2), siz / 2);
+	}
+};
+
+// AddBytes32
+template<ChkEndian endian>
+struct Kernel<CHKALG_ADDBYTES32, endian> {
+	static const uint32_t expectedSize = 4;
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		((void)state);
+		((void)param);
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		state->value += Funcs().AddBytes32(buf, siz);
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		return state->value;
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		return ReadExpected32<endian>(data);
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		((void)param);
+		return Funcs().AddBytes32(buf, siz);
+	}
+};
+
+// SonicChaoGarden
+template<ChkEndian endian>
+struct Kernel<CHKALG_SONICCHAOGARDEN, endian> {
+	static const uint32_t expectedSize = sizeof(ChaoGardenChecksumData);
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		((void)param);
+		state->value = SONICCHAOGARDEN_INIT;
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		state->value = SonicChaoGarden_update(state->value, buf, siz);
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		return SONICCHAOGARDEN_XOR ^ state->value;
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		ChaoGardenChecksumData chaoChk;
+		memcpy(&chaoChk, data, sizeof(chaoChk));
+		if (endian != CHKENDIAN_LITTLE) {
+			// Big-endian.
+			return ((uint32_t)chaoChk.checksum_3 << 24) |
+			       (chaoChk.checksum_2 << 16) |
+			       (chaoChk.checksum_1 << 8) |
+			       (chaoChk.checksum_0);
+		} else {
+			// Little-endian.
+			// TODO: Is this correct?
+			return ((uint32_t)chaoChk.checksum_0 << 24) |
+			       (chaoChk.checksum_1 << 16) |
+			       (chaoChk.checksum_2 << 8) |
+			       (chaoChk.checksum_3);
+		}
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		((void)param);
+		return SonicChaoGarden(buf, siz);
+	}
+};
+
+// Dreamcast VMU
+template<ChkEndian endian>
+struct Kernel<CHKALG_DREAMCASTVMU, endian> {
+	static const uint32_t expectedSize = 2;
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		((void)state);
+		((void)param);
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		state->value = DreamcastVMU_update((uint16_t)state->value, buf, siz);
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		return state->value;
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		return ReadExpected16<endian>(data);
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		// If param is 0, assume a default CRC address of 0x46.
+		// (NOTE: Headers in game files are at 0x200,
+		//  but the CRC field is unused for game files.)
+		if (param == 0)
+			param = 0x46;
+		return DreamcastVMU(buf, siz, param);
+	}
+};
+
+// Pokémon XD
+// NOTE: The expected checksums are stored in the encrypted
+// data area, so they're retrieved using PokemonXD_Final().
+template<ChkEndian endian>
+struct Kernel<CHKALG_POKEMONXD, endian> {
+	static const uint32_t expectedSize = 0;
+
+	static void init(ChecksumState *state, uint32_t param)
+	{
+		((void)param);
+		PokemonXD_Init(&state->xd);
+	}
+
+	static void update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+	{
+		PokemonXD_Update(&state->xd, buf, siz);
+	}
+
+	static uint32_t final(const ChecksumState *state)
+	{
+		PokemonXDChecksums chk;
+		if (PokemonXD_Final(&state->xd, &chk) != 0) {
+			// Not enough data.
+			return ~0U;
+		}
+		return chk.actual[0];
+	}
+
+	static uint32_t readExpected(const uint8_t *data)
+	{
+		((void)data);
+		return 0;
+	}
+
+	static uint32_t exec(const uint8_t *buf, uint32_t siz, uint32_t param)
+	{
+		((void)param);
+		// NOTE: Expected checksum is discarded.
+		return PokemonXD(buf, siz, 0, nullptr);
+	}
+};
+
+/**
+ * Add data to an incremental checksum state.
+ * Common wrapper for all kernels.
+ * @param state Checksum state.
  * @param buf Data buffer.
  * @param siz Length of data buffer.
+ */
+template<ChkAlgorithm algorithm, ChkEndian endian>
+static void KernelUpdate(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+{
+	if (siz == 0)
+		return;
+	Kernel<algorithm, endian>::update(state, buf, siz);
+	state->count += siz;
+}
+
+#define CHECKSUM_KERNEL(algorithm, endian) { \
+	algorithm, endian, \
+	Kernel<algorithm, endian>::expectedSize, \
+	Kernel<algorithm, endian>::init, \
+	KernelUpdate<algorithm, endian>, \
+	Kernel<algorithm, endian>::final, \
+	Kernel<algorithm, endian>::readExpected, \
+	Kernel<algorithm, endian>::exec, \
+}
+
+#define CHECKSUM_KERNELS(algorithm) { \
+	CHECKSUM_KERNEL(algorithm, CHKENDIAN_BIG), \
+	CHECKSUM_KERNEL(algorithm, CHKENDIAN_LITTLE), \
+}
+
+// Checksum kernels, indexed by algorithm and endianness.
+static const ChecksumKernel ChecksumKernels[CHKALG_MAX][2] = {
+	CHECKSUM_KERNELS(CHKALG_NONE),
+	CHECKSUM_KERNELS(CHKALG_CRC16),
+	CHECKSUM_KERNELS(CHKALG_CRC32),
+	CHECKSUM_KERNELS(CHKALG_ADDINVDUAL16),
+	CHECKSUM_KERNELS(CHKALG_ADDBYTES32),
+	CHECKSUM_KERNELS(CHKALG_SONICCHAOGARDEN),
+	CHECKSUM_KERNELS(CHKALG_DREAMCASTVMU),
+	CHECKSUM_KERNELS(CHKALG_POKEMONXD),
+};
+
+/**
+ * Get the checksum kernel for an algorithm.
+ * @param algorithm Checksum algorithm.
  * @param endian Endianness of the data.
- * @param param Algorithm parameter, e.g. polynomial or sum.
- * @return Checksum.
+ * @return Checksum kernel. (If unknown, returns the CHKALG_NONE kernel.)
  */
-uint32_t Exec(ChkAlgorithm algorithm, const void *buf, uint32_t siz, ChkEndian endian, uint32_t param)
+const ChecksumKernel *GetKernel(ChkAlgorithm algorithm, ChkEndian endian)
 {
-	switch (algorithm) {
-		case CHKALG_CRC16:
-			if (param == 0)
-				param = CRC16_POLY_CCITT;
-			return Crc16(static_cast<const uint8_t*>(buf),
-				     siz, (uint16_t)(param & 0xFFFF));
+	if ((unsigned int)algorithm >= CHKALG_MAX) {
+		// Unknown algorithm.
+		algorithm = CHKALG_NONE;
+	}
+	return &ChecksumKernels[algorithm][endian == CHKENDIAN_LITTLE ? 1 : 0];
+}
 
-		case CHKALG_CRC32:
-			// TODO: Implement CRC32 once I encounter a file that uses it.
-			break;
+/**
+ * Bind a checksum definition to its checksum kernel.
+ * This should be done once, after the checksum definition is loaded.
+ * @param checksumDef Checksum definition.
+ */
+void BindKernel(ChecksumDef *checksumDef)
+{
+	checksumDef->kernel = GetKernel(checksumDef->algorithm, checksumDef->endian);
+}
 
-		case CHKALG_ADDINVDUAL16:
-			return AddInvDual16(static_cast<const uint16_t*>(buf), siz, endian);
+/**
+ * Initialize an incremental checksum state.
+ * @param state Checksum state.
+ * @param kernel Checksum kernel.
+ * @param param Algorithm parameter, e.g. polynomial or sum.
+ */
+void Init(ChecksumState *state, const ChecksumKernel *kernel, uint32_t param)
+{
+	state->kernel = kernel;
+	state->algorithm = kernel->algorithm;
+	state->endian = kernel->endian;
+	state->poly = 0;
+	state->pending = 0;
+	state->value = 0;
+	state->count = 0;
+	kernel->init(state, param);
+}
 
-		case CHKALG_ADDBYTES32:
-			return AddBytes32(static_cast<const uint8_t*>(buf), siz);
+/**
+ * Initialize an incremental checksum state.
+ * @param state Checksum state.
+ * @param algorithm Checksum algorithm.
+ * @param endian Endianness of the data.
+ * @param param Algorithm parameter, e.g. polynomial or sum.
+ */
+void Init(ChecksumState *state, ChkAlgorithm algorithm, ChkEndian endian, uint32_t param)
+{
+	Init(state, GetKernel(algorithm, endian), param);
+}
 
-		case CHKALG_SONICCHAOGARDEN:
-			return SonicChaoGarden(static_cast<const uint8_t*>(buf), siz);
+/**
+ * Add data to an incremental checksum state.
+ * @param state Checksum state.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ */
+void Update(ChecksumState *state, const uint8_t *buf, uint32_t siz)
+{
+	state->kernel->update(state, buf, siz);
+}
 
-		case CHKALG_DREAMCASTVMU:
-			// If param is 0, assume a default CRC address of 0x46.
-			// (NOTE: Headers in game files are at 0x200,
-			//  but the CRC field is unused for game files.)
-			if (param == 0)
-				param = 0x46;
-			return DreamcastVMU(static_cast<const uint8_t*>(buf), siz, param);
+/**
+ * Get the checksum from an incremental checksum state.
+ * The state is not modified, so more data can be added later.
+ * @param state Checksum state.
+ * @return Checksum. (Pokémon XD: checksum ID 0)
+ */
+uint32_t Final(const ChecksumState *state)
+{
+	return state->kernel->final(state);
+}
 
-		case CHKALG_POKEMONXD:
-			// NOTE: Expected checksum is discarded.
-			return PokemonXD(static_cast<const uint8_t*>(buf), siz, 0, nullptr);
-		default:
-			break;
-	}
+/** General functions. **/
 
-	// Unknown algorithm.
-	return 0;
+/**
+ * Get the checksum for a block of data.
+ * @param algorithm Checksum algorithm.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @param endian Endianness of the data.
+ * @param param Algorithm parameter, e.g. polynomial or sum.
+ * @return Checksum.
+ */
+uint32_t Exec(ChkAlgorithm algorithm, const void *buf, uint32_t siz, ChkEndian endian, uint32_t param)
+{
+	return GetKernel(algorithm, endian)->exec(static_cast<const uint8_t*>(buf), siz, param);
 }
 
 /**
@@ -51,6 +51,8 @@ enum ChkEndian {
 	CHKENDIAN_LITTLE = 1,	// Little-endian (x86, SH-4, etc.)
 };
 
+struct ChecksumKernel;
+
 // Checksum definition struct.
 struct ChecksumDef {
 	ChkAlgorithm algorithm;
@@ -59,6 +61,7 @@ struct ChecksumDef {
 	uint32_t start;		// Checksummed area: start.
 	uint32_t length;	// Checksummed area: length.
 	ChkEndian endian;	// Endianness.
+	const ChecksumKernel *kernel;	// Checksum kernel. (set by BindKernel())
 
 	ChecksumDef() { clear(); }
 
@@ -70,6 +73,7 @@ struct ChecksumDef {
 		start = 0;
 		length = 0;
 		endian = CHKENDIAN_BIG;
+		kernel = nullptr;
 	}
 };
 
@@ -162,6 +166,30 @@ uint32_t SonicChaoGarden(const uint8_t *buf, uint32_t siz);
 */
 uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr = -1);
 
+/**
+ * Pokémon XD checksums.
+ * Indexed by checksum ID. (crc_addr 0x10, 0x14, 0x18, 0x1C)
+ */
+struct PokemonXDChecksums {
+	uint32_t expected[4];
+	uint32_t actual[4];
+};
+
+/**
+ * Pokémon XD algorithm. (all checksums)
+ * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
+ *
+ * The data area is "encrypted", so it has to be decrypted before
+ * a checksum can be calculated. All four checksums are calculated
+ * while decrypting, so the data is only decrypted once.
+ *
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ * @param pChk	[out] Checksums, decrypted. (indexed by checksum ID)
+ * @return 0 on success; non-zero if the buffer is too small.
+ */
+int PokemonXD_All(const uint8_t *buf, uint32_t siz, PokemonXDChecksums *pChk);
+
 /**
  * Pokémon XD algorithm.
  * Reference: https://github.com/TuxSH/PkmGCTools/blob/master/LibPkmGC/src/LibPkmGC/XD/SaveEditing/SaveSlot.cpp
@@ -169,6 +197,9 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr = -1);
  * The data area is "encrypted", so it has to be decrypted before
  * a checksum can be calculated.
  *
+ * NOTE: This decrypts the entire data area. Use PokemonXD_All()
+ * if more than one checksum is needed.
+ *
  * @param buf		[in] Data buffer.
  * @param siz		[in] Length of data buffer.
  * @param crc_addr	[in] CRC address. (Should be 0x10, 0x14, 0x18, 0x1C.)
@@ -177,6 +208,182 @@ uint16_t DreamcastVMU(const uint8_t *buf, uint32_t siz, uint32_t crc_addr = -1);
  */
 uint32_t PokemonXD(const uint8_t *buf, uint32_t siz, uint32_t crc_addr, uint32_t *pChkExpect);
 
+/** Incremental checksums. **/
+
+/**
+ * Pokémon XD incremental state.
+ * Data can be split at any byte boundary.
+ */
+struct PokemonXDState {
+	uint16_t keys[4];	// Current encryption keys.
+	uint16_t chkWords[8];	// Decrypted checksum words.
+	uint32_t sum[4];	// Region sums.
+	uint32_t pos;		// Number of bytes processed.
+	uint32_t region_end;	// End of the current region.
+	unsigned int region;	// Current region.
+	uint8_t pending;	// High byte of a split word.
+};
+
+/**
+ * Initialize a Pokémon XD incremental state.
+ * @param state	[out] State.
+ */
+void PokemonXD_Init(PokemonXDState *state);
+
+/**
+ * Add data to a Pokémon XD incremental state.
+ * Data past the end of the checksummed area is ignored.
+ * @param state	[in/out] State.
+ * @param buf	[in] Data buffer.
+ * @param siz	[in] Length of data buffer.
+ */
+void PokemonXD_Update(PokemonXDState *state, const uint8_t *buf, uint32_t siz);
+
+/**
+ * Get the Pokémon XD checksums from an incremental state.
+ * @param state	[in] State.
+ * @param pChk	[out] Checksums, decrypted. (indexed by checksum ID)
+ * @return 0 on success; non-zero if not enough data was processed.
+ */
+int PokemonXD_Final(const PokemonXDState *state, PokemonXDChecksums *pChk);
+
+/**
+ * Incremental checksum state.
+ * Data can be split at any byte boundary.
+ *
+ * NOTE: Fields stored within the checksummed area, e.g. the
+ * Dreamcast VMU CRC, are not excluded. The caller must pass
+ * zeroes for those bytes.
+ */
+struct ChecksumState {
+	const ChecksumKernel *kernel;	// Checksum kernel.
+	ChkAlgorithm algorithm;
+	ChkEndian endian;
+	uint16_t poly;		// CRC-16 polynomial.
+	uint8_t pending;	// First byte of a split word. (AddInvDual16)
+	uint32_t value;		// Current checksum value.
+	uint32_t count;		// Number of bytes processed.
+	PokemonXDState xd;	// Pokémon XD state.
+};
+
+/**
+ * Initialize an incremental checksum state.
+ * @param state Checksum state.
+ * @param algorithm Checksum algorithm.
+ * @param endian Endianness of the data.
+ * @param param Algorithm parameter, e.g. polynomial or sum.
+ */
+void Init(ChecksumState *state, ChkAlgorithm algorithm, ChkEndian endian, uint32_t param = 0);
+
+/**
+ * Initialize an incremental checksum state.
+ * @param state Checksum state.
+ * @param kernel Checksum kernel.
+ * @param param Algorithm parameter, e.g. polynomial or sum.
+ */
+void Init(ChecksumState *state, const ChecksumKernel *kernel, uint32_t param = 0);
+
+/**
+ * Add data to an incremental checksum state.
+ * @param state Checksum state.
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ */
+void Update(ChecksumState *state, const uint8_t *buf, uint32_t siz);
+
+/**
+ * Get the checksum from an incremental checksum state.
+ * The state is not modified, so more data can be added later.
+ * @param state Checksum state.
+ * @return Checksum. (Pokémon XD: checksum ID 0)
+ */
+uint32_t Final(const ChecksumState *state);
+
+/** Checksum kernels. **/
+
+/**
+ * Checksum kernel.
+ * Each kernel is specialized for one algorithm and endianness
+ * at compile time, so calculating a checksum doesn't need to
+ * check the algorithm or endianness.
+ */
+struct ChecksumKernel {
+	ChkAlgorithm algorithm;
+	ChkEndian endian;
+	uint32_t expectedSize;	// Size of the expected checksum, in bytes. (0 if not stored)
+
+	/**
+	 * Initialize an incremental checksum state.
+	 * NOTE: Use Init() instead of calling this directly.
+	 * @param state Checksum state.
+	 * @param param Algorithm parameter, e.g. polynomial or sum.
+	 */
+	void (*init)(ChecksumState *state, uint32_t param);
+
+	/**
+	 * Add data to an incremental checksum state.
+	 * @param state Checksum state.
+	 * @param buf Data buffer.
+	 * @param siz Length of data buffer.
+	 */
+	void (*update)(ChecksumState *state, const uint8_t *buf, uint32_t siz);
+
+	/**
+	 * Get the checksum from an incremental checksum state.
+	 * @param state Checksum state.
+	 * @return Checksum.
+	 */
+	uint32_t (*final)(const ChecksumState *state);
+
+	/**
+	 * Read the expected checksum.
+	 * @param data Expected checksum data. (expectedSize bytes)
+	 * @return Expected checksum.
+	 */
+	uint32_t (*readExpected)(const uint8_t *data);
+
+	/**
+	 * Get the checksum for a block of data.
+	 * @param buf Data buffer.
+	 * @param siz Length of data buffer.
+	 * @param param Algorithm parameter, e.g. polynomial or sum.
+	 * @return Checksum.
+	 */
+	uint32_t (*exec)(const uint8_t *buf, uint32_t siz, uint32_t param);
+};
+
+/**
+ * Get the checksum kernel for an algorithm.
+ * @param algorithm Checksum algorithm.
+ * @param endian Endianness of the data.
+ * @return Checksum kernel. (If unknown, returns the CHKALG_NONE kernel.)
+ */
+const ChecksumKernel *GetKernel(ChkAlgorithm algorithm, ChkEndian endian);
+
+/**
+ * Bind a checksum definition to its checksum kernel.
+ * This should be done once, after the checksum definition is loaded.
+ * @param checksumDef Checksum definition.
+ */
+void BindKernel(ChecksumDef *checksumDef);
+
+/**
+ * Get the checksum kernel for a checksum definition.
+ * If the checksum definition isn't bound, the kernel is looked up.
+ * @param checksumDef Checksum definition.
+ * @return Checksum kernel.
+ */
+static inline const ChecksumKernel *DefKernel(const ChecksumDef &checksumDef)
+{
+	const ChecksumKernel *const kernel = checksumDef.kernel;
+	if (kernel && kernel->algorithm == checksumDef.algorithm &&
+	    kernel->endian == checksumDef.endian)
+	{
+		return kernel;
+	}
+	return GetKernel(checksumDef.algorithm, checksumDef.endian);
+}
+
 /** General functions. **/
 
 /**
@@ -0,0 +1,384 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumPlan.cpp: Fused checksum calculation over file data.            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ChecksumPlan.hpp"
+
+// C includes. (C++ namespace)
+#include <cstddef>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+namespace Checksum {
+
+ChecksumPlan::ChecksumPlan()
+{ }
+
+/**
+ * Add a masked range to an operation.
+ * @param op Operation.
+ * @param start Start of the masked range. (absolute)
+ * @param len Length of the masked range.
+ */
+void ChecksumPlan::addMask(Op &op, uint32_t start, uint32_t len)
+{
+	// Only the part within the checksummed area matters.
+	const uint32_t end = std::min(start + len, op.end);
+	start = std::max(start, op.start);
+	if (start >= end || op.maskCount >= MAX_MASKS)
+		return;
+
+	// Insert the mask, sorted by start.
+	int i = op.maskCount;
+	for (; i > 0 && op.masks[i-1].start > start; i--) {
+		op.masks[i] = op.masks[i-1];
+	}
+	op.masks[i].start = start;
+	op.masks[i].end = end;
+	op.maskCount++;
+}
+
+/**
+ * Compile a checksum plan.
+ * Invalid checksum definitions and checksum definitions
+ * that don't fit in the data are skipped.
+ * @param checksumDefs Checksum definitions.
+ * @param dataSize Size of the file data.
+ */
+void ChecksumPlan::compile(const vector<ChecksumDef> &checksumDefs, uint32_t dataSize)
+{
+	m_ops.clear();
+	m_ops.reserve(checksumDefs.size());
+
+	for (auto iter = checksumDefs.cbegin(); iter != checksumDefs.cend(); ++iter) {
+		const ChecksumDef &checksumDef = *iter;
+
+		if (checksumDef.algorithm == CHKALG_NONE ||
+		    checksumDef.algorithm >= CHKALG_MAX ||
+		    checksumDef.length == 0)
+		{
+			// No algorithm or invalid algorithm set,
+			// or the checksum data has no length.
+			continue;
+		}
+
+		// Make sure the checksum definition is in range.
+		if (dataSize < checksumDef.address ||
+		    (uint64_t)dataSize < (uint64_t)checksumDef.start + checksumDef.length)
+		{
+			// File is too small...
+			// TODO: Also check the size of the checksum itself.
+			continue;
+		}
+
+		// Use the kernel bound by the database loader, if available.
+		const ChecksumKernel *const kernel = DefKernel(checksumDef);
+
+		Op op;
+		op.def = checksumDef;
+		op.start = checksumDef.start;
+		op.end = checksumDef.start + checksumDef.length;
+		op.src = -1;
+		op.dirty = true;
+		op.maskCount = 0;
+		op.expAddr = checksumDef.address;
+		op.expLen = kernel->expectedSize;
+		memset(op.expected, 0, sizeof(op.expected));
+
+		switch (checksumDef.algorithm) {
+			case CHKALG_DREAMCASTVMU: {
+				// The CRC is stored within the header.
+				// If param is 0, assume a default CRC address of 0x46.
+				const uint32_t crc_addr = (checksumDef.param != 0 ? checksumDef.param : 0x46);
+				if (crc_addr < checksumDef.length) {
+					addMask(op, op.start + crc_addr, 2);
+				}
+				break;
+			}
+
+			case CHKALG_SONICCHAOGARDEN:
+				// Clear some fields that must be 0 when calculating the checksum.
+				addMask(op, op.expAddr + offsetof(ChaoGardenChecksumData, checksum_3), 1);
+				addMask(op, op.expAddr + offsetof(ChaoGardenChecksumData, checksum_2), 1);
+				addMask(op, op.expAddr + offsetof(ChaoGardenChecksumData, checksum_1), 1);
+				addMask(op, op.expAddr + offsetof(ChaoGardenChecksumData, checksum_0), 1);
+				addMask(op, op.expAddr + offsetof(ChaoGardenChecksumData, random_3), 1);
+				break;
+
+			case CHKALG_POKEMONXD:
+				// All four checksums are calculated at once,
+				// so share the state with other checksum
+				// definitions that use the same area.
+				for (int i = 0; i < (int)m_ops.size(); i++) {
+					const Op &other = m_ops[i];
+					if (other.def.algorithm == CHKALG_POKEMONXD && other.src < 0 &&
+					    other.start == op.start && other.end == op.end)
+					{
+						op.src = i;
+						break;
+					}
+				}
+				break;
+
+			default:
+				break;
+		}
+
+		// Don't read past the end of the file data.
+		if (op.expAddr + op.expLen > dataSize) {
+			op.expLen = dataSize - op.expAddr;
+		}
+
+		Init(&op.state, kernel, checksumDef.param);
+		m_ops.push_back(op);
+	}
+}
+
+/**
+ * Does the plan have any dirty checksums?
+ * @return True if any checksums need to be recalculated.
+ */
+bool ChecksumPlan::isDirty(void) const
+{
+	for (auto iter = m_ops.cbegin(); iter != m_ops.cend(); ++iter) {
+		if (iter->dirty)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Get the start of the file data needed by the dirty checksums.
+ * Data before this offset doesn't need to be read.
+ * @return Start of the file data needed by the plan.
+ */
+uint32_t ChecksumPlan::dataStart(void) const
+{
+	uint32_t start = ~0U;
+	for (auto iter = m_ops.cbegin(); iter != m_ops.cend(); ++iter) {
+		if (!iter->dirty)
+			continue;
+		start = std::min(start, iter->start);
+		if (iter->expLen != 0) {
+			start = std::min(start, iter->expAddr);
+		}
+	}
+	return (start != ~0U ? start : 0);
+}
+
+/**
+ * Get the end of the file data needed by the dirty checksums.
+ * Data past this offset doesn't need to be read.
+ * @return End of the file data needed by the plan.
+ */
+uint32_t ChecksumPlan::dataEnd(void) const
+{
+	uint32_t end = 0;
+	for (auto iter = m_ops.cbegin(); iter != m_ops.cend(); ++iter) {
+		if (!iter->dirty)
+			continue;
+		end = std::max(end, iter->end);
+		end = std::max(end, iter->expAddr + iter->expLen);
+	}
+	return end;
+}
+
+/**
+ * Process a span of file data.
+ * Only dirty checksums are updated.
+ * Spans must be passed in order, with no gaps,
+ * starting at or before dataStart().
+ * @param offset Offset of the span in the file data.
+ * @param buf Span data.
+ * @param siz Length of the span.
+ */
+void ChecksumPlan::update(uint32_t offset, const uint8_t *buf, uint32_t siz)
+{
+	// Masked ranges are at most 2 bytes.
+	static const uint8_t zero[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+	const uint32_t spanEnd = offset + siz;
+
+	for (auto iter = m_ops.begin(); iter != m_ops.end(); ++iter) {
+		Op &op = *iter;
+		if (!op.dirty)
+			continue;
+
+		// Save the expected checksum data.
+		if (op.expLen != 0) {
+			const uint32_t a = std::max(op.expAddr, offset);
+			const uint32_t b = std::min(op.expAddr + op.expLen, spanEnd);
+			if (a < b) {
+				memcpy(&op.expected[a - op.expAddr], &buf[a - offset], b - a);
+			}
+		}
+
+		if (op.src >= 0) {
+			// State is shared with another operation.
+			continue;
+		}
+
+		// Intersect the span with the checksummed area.
+		const uint32_t a = std::max(op.start, offset);
+		const uint32_t b = std::min(op.end, spanEnd);
+		if (a >= b)
+			continue;
+
+		// Masked ranges are processed as zeroes.
+		const ChecksumKernel *const kernel = op.state.kernel;
+		uint32_t pos = a;
+		for (int i = 0; i < op.maskCount; i++) {
+			const uint32_t ms = std::max(op.masks[i].start, pos);
+			const uint32_t me = std::min(op.masks[i].end, b);
+			if (ms >= me)
+				continue;
+			kernel->update(&op.state, &buf[pos - offset], ms - pos);
+			kernel->update(&op.state, zero, me - ms);
+			pos = me;
+		}
+		kernel->update(&op.state, &buf[pos - offset], b - pos);
+	}
+}
+
+/**
+ * Get the difference between the AddInvDual16 word sums of two buffers.
+ * @param start Start of the checksummed area. (absolute)
+ * @param wordEnd End of the last whole word in the checksummed area. (absolute)
+ * @param endian Endianness of the data.
+ * @param offset Offset of the buffers. (absolute)
+ * @param oldData Old data.
+ * @param newData New data.
+ * @param siz Length of the buffers.
+ * @return Difference between the word sums, modulo 2^16.
+ */
+static uint16_t AddInvDual16_delta(uint32_t start, uint32_t wordEnd, ChkEndian endian,
+	uint32_t offset, const uint8_t *oldData, const uint8_t *newData, uint32_t siz)
+{
+	// Bytes at even offsets from the start are the
+	// high bytes of big-endian words, and vice-versa.
+	const uint32_t hiParity = (endian != CHKENDIAN_LITTLE ? 0 : 1);
+	const uint32_t end = std::min(offset + siz, wordEnd);
+	uint32_t hi = 0, lo = 0;
+	for (uint32_t pos = offset; pos < end; pos++) {
+		const uint32_t diff = (uint32_t)newData[pos - offset] - oldData[pos - offset];
+		if (((pos - start) & 1) == hiParity) {
+			hi += diff;
+		} else {
+			lo += diff;
+		}
+	}
+	return (uint16_t)((hi << 8) + lo);
+}
+
+/**
+ * The file data was modified.
+ * Additive checksums are adjusted using the old and new
+ * data. Other checksums that cover the modified data
+ * are reset and marked as dirty.
+ * @param offset Offset of the modified data.
+ * @param oldData Old data.
+ * @param newData New data.
+ * @param siz Length of the modified data.
+ */
+void ChecksumPlan::modify(uint32_t offset, const uint8_t *oldData, const uint8_t *newData, uint32_t siz)
+{
+	const uint32_t spanEnd = offset + siz;
+
+	for (int i = 0; i < (int)m_ops.size(); i++) {
+		Op &op = m_ops[i];
+
+		// Update the expected checksum data.
+		if (op.expLen != 0) {
+			const uint32_t a = std::max(op.expAddr, offset);
+			const uint32_t b = std::min(op.expAddr + op.expLen, spanEnd);
+			if (a < b) {
+				memcpy(&op.expected[a - op.expAddr], &newData[a - offset], b - a);
+			}
+		}
+
+		// Intersect the modified data with the checksummed area.
+		const uint32_t a = std::max(op.start, offset);
+		const uint32_t b = std::min(op.end, spanEnd);
+		if (a >= b)
+			continue;
+
+		// NOTE: Additive checksums don't have masked ranges.
+		Op &srcOp = (op.src >= 0 ? m_ops[op.src] : op);
+		ChecksumState &state = srcOp.state;
+		switch (op.def.algorithm) {
+			case CHKALG_ADDBYTES32:
+				state.value += AddBytes32(&newData[a - offset], b - a);
+				state.value -= AddBytes32(&oldData[a - offset], b - a);
+				break;
+
+			case CHKALG_ADDINVDUAL16: {
+				// A trailing odd byte is ignored.
+				const uint32_t wordEnd = op.start + ((op.end - op.start) & ~1U);
+				state.value = (uint16_t)(state.value +
+					AddInvDual16_delta(op.start, wordEnd, op.def.endian,
+						a, &oldData[a - offset], &newData[a - offset], b - a));
+				break;
+			}
+
+			default:
+				// Not additive. Recalculate the checksum.
+				if (!srcOp.dirty) {
+					Init(&state, state.kernel, srcOp.def.param);
+					srcOp.dirty = true;
+				}
+				break;
+		}
+	}
+}
+
+/**
+ * Get the checksum values.
+ * There is one value for each checksum definition
+ * that wasn't skipped by compile().
+ * @return Checksum values.
+ */
+vector<ChecksumValue> ChecksumPlan::finish(void)
+{
+	vector<ChecksumValue> checksumValues;
+	checksumValues.reserve(m_ops.size());
+
+	for (auto iter = m_ops.cbegin(); iter != m_ops.cend(); ++iter) {
+		const Op &op = *iter;
+		ChecksumValue checksumValue;
+
+		if (op.def.algorithm == CHKALG_POKEMONXD) {
+			// Pokémon XD has a more complicated checksum.
+			const ChecksumState &state = (op.src >= 0 ? m_ops[op.src].state : op.state);
+			PokemonXDChecksums xdChk;
+			if (PokemonXD_Final(&state.xd, &xdChk) != 0) {
+				// Incorrect buffer size.
+				checksumValue.expected = 0;
+				checksumValue.actual = ~0U;
+			} else {
+				const unsigned int chkID = (op.def.address >> 2) & 3;
+				checksumValue.expected = xdChk.expected[chkID];
+				checksumValue.actual = xdChk.actual[chkID];
+			}
+		} else {
+			const ChecksumKernel *const kernel = op.state.kernel;
+			checksumValue.expected = kernel->readExpected(op.expected);
+			checksumValue.actual = kernel->final(&op.state);
+		}
+
+		checksumValues.push_back(checksumValue);
+	}
+
+	for (auto iter = m_ops.begin(); iter != m_ops.end(); ++iter) {
+		iter->dirty = false;
+	}
+	return checksumValues;
+}
+
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * ChecksumPlan.hpp: Fused checksum calculation over file data.            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_CHECKSUMPLAN_HPP__
+#define __LIBGCTOOLS_CHECKSUMPLAN_HPP__
+
+#include "Checksum.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
+namespace Checksum {
+
+/**
+ * Checksum plan.
+ *
+ * A plan is compiled from a file's checksum definitions.
+ * File data is then passed to the plan in order, one span
+ * at a time (usually one block), and every checksum is
+ * updated from the same span while it's in the cache.
+ *
+ * Fields that must be zero when calculating a checksum,
+ * e.g. the Chao Garden checksum bytes and the Dreamcast VMU
+ * CRC, are masked out by the plan, so the file data is
+ * never modified.
+ *
+ * The plan can be kept after finish(). If the file data is
+ * modified, modify() adjusts additive checksums using the
+ * old and new data. Other checksums that cover the modified
+ * data are marked as dirty, and only those checksums are
+ * recalculated by the next pass over the file data.
+ */
+class ChecksumPlan
+{
+	public:
+		ChecksumPlan();
+
+	public:
+		/**
+		 * Compile a checksum plan.
+		 * Invalid checksum definitions and checksum definitions
+		 * that don't fit in the data are skipped.
+		 * @param checksumDefs Checksum definitions.
+		 * @param dataSize Size of the file data.
+		 */
+		void compile(const std::vector<ChecksumDef> &checksumDefs, uint32_t dataSize);
+
+		/**
+		 * Clear the plan.
+		 */
+		inline void clear(void)
+		{
+			m_ops.clear();
+		}
+
+		/**
+		 * Does the plan have any checksums?
+		 * @return True if the plan is empty; false if not.
+		 */
+		inline bool isEmpty(void) const
+		{
+			return m_ops.empty();
+		}
+
+		/**
+		 * Does the plan have any dirty checksums?
+		 * @return True if any checksums need to be recalculated.
+		 */
+		bool isDirty(void) const;
+
+		/**
+		 * Get the start of the file data needed by the dirty checksums.
+		 * Data before this offset doesn't need to be read.
+		 * @return Start of the file data needed by the plan.
+		 */
+		uint32_t dataStart(void) const;
+
+		/**
+		 * Get the end of the file data needed by the dirty checksums.
+		 * Data past this offset doesn't need to be read.
+		 * @return End of the file data needed by the plan.
+		 */
+		uint32_t dataEnd(void) const;
+
+		/**
+		 * Process a span of file data.
+		 * Only dirty checksums are updated.
+		 * Spans must be passed in order, with no gaps,
+		 * starting at or before dataStart().
+		 * @param offset Offset of the span in the file data.
+		 * @param buf Span data.
+		 * @param siz Length of the span.
+		 */
+		void update(uint32_t offset, const uint8_t *buf, uint32_t siz);
+
+		/**
+		 * The file data was modified.
+		 * Additive checksums are adjusted using the old and new
+		 * data. Other checksums that cover the modified data
+		 * are reset and marked as dirty.
+		 * @param offset Offset of the modified data.
+		 * @param oldData Old data.
+		 * @param newData New data.
+		 * @param siz Length of the modified data.
+		 */
+		void modify(uint32_t offset, const uint8_t *oldData, const uint8_t *newData, uint32_t siz);
+
+		/**
+		 * Get the checksum values.
+		 * There is one value for each checksum definition
+		 * that wasn't skipped by compile().
+		 * All checksums are marked as clean.
+		 * @return Checksum values.
+		 */
+		std::vector<ChecksumValue> finish(void);
+
+	private:
+		// Masked range. (absolute offsets)
+		struct Mask {
+			uint32_t start;
+			uint32_t end;
+		};
+
+		// Maximum number of masked ranges per checksum.
+		// (Chao Garden: 5 bytes)
+		static const int MAX_MASKS = 5;
+
+		// Checksum operation.
+		struct Op {
+			ChecksumDef def;
+			uint32_t start;		// Checksummed area: start. (absolute)
+			uint32_t end;		// Checksummed area: end. (absolute)
+			int src;		// Op with the shared state, or -1. (Pokémon XD)
+			bool dirty;		// Checksum needs to be recalculated.
+			int maskCount;
+			Mask masks[MAX_MASKS];	// Masked ranges, sorted by start.
+			uint32_t expAddr;	// Expected checksum address.
+			uint32_t expLen;	// Expected checksum length.
+			uint8_t expected[8];	// Expected checksum data.
+			ChecksumState state;
+		};
+
+		/**
+		 * Add a masked range to an operation.
+		 * @param op Operation.
+		 * @param start Start of the masked range. (absolute)
+		 * @param len Length of the masked range.
+		 */
+		static void addMask(Op &op, uint32_t start, uint32_t len);
+
+	private:
+		std::vector<Op> m_ops;
+};
+
+}
+
+#endif /* __LIBGCTOOLS_CHECKSUMPLAN_HPP__ */
@@ -0,0 +1,132 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_avx2.cpp: Checksum algorithm class. (AVX2-optimized)           *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "Checksum.hpp"
+#include "Checksum_p.hpp"
+
+// AVX2 intrinsics.
+// NOTE: This file must be compiled with AVX2 enabled.
+#include <immintrin.h>
+
+namespace Checksum {
+
+/**
+ * Add 16-bit words together. (AVX2)
+ * @tparam endian Endianness of the data.
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+template<ChkEndian endian>
+static inline uint16_t AddWords16_avx2(const uint8_t *buf, uint32_t words)
+{
+	uint16_t sum = 0;
+
+	// Add 16 words at a time in 16-bit lanes.
+	// The lanes wrap around, which matches the scalar code,
+	// since the sum is modulo 2^16 anyway.
+	if (words >= 32) {
+		// Byteswap shuffle mask. (x86 is little-endian)
+		const __m256i bswap = _mm256_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+
+		__m256i sum0 = _mm256_setzero_si256();
+		__m256i sum1 = _mm256_setzero_si256();
+		for (; words >= 32; words -= 32, buf += 64) {
+			const __m256i *const p = reinterpret_cast<const __m256i*>(buf);
+			__m256i a = _mm256_loadu_si256(p+0);
+			__m256i b = _mm256_loadu_si256(p+1);
+			if (endian == CHKENDIAN_BIG) {
+				a = _mm256_shuffle_epi8(a, bswap);
+				b = _mm256_shuffle_epi8(b, bswap);
+			}
+			sum0 = _mm256_add_epi16(sum0, a);
+			sum1 = _mm256_add_epi16(sum1, b);
+		}
+
+		// Horizontal sum.
+		sum0 = _mm256_add_epi16(sum0, sum1);
+		__m128i sum128 = _mm_add_epi16(_mm256_castsi256_si128(sum0),
+					       _mm256_extracti128_si256(sum0, 1));
+		sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 8));
+		sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 4));
+		sum128 = _mm_add_epi16(sum128, _mm_srli_si128(sum128, 2));
+		sum = (uint16_t)_mm_cvtsi128_si32(sum128);
+	}
+
+	// Remaining words.
+	// NOTE: Byte loads are used, since buf may not be 16-bit aligned.
+	for (; words != 0; words--, buf += 2) {
+		sum += (endian == CHKENDIAN_BIG
+			? (uint16_t)((buf[0] << 8) | buf[1])
+			: (uint16_t)((buf[1] << 8) | buf[0]));
+	}
+
+	return sum;
+}
+
+/**
+ * Add big-endian 16-bit words together. (AVX2)
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+uint16_t AddWords16_be_avx2(const uint8_t *buf, uint32_t words)
+{
+	return AddWords16_avx2<CHKENDIAN_BIG>(buf, words);
+}
+
+/**
+ * Add little-endian 16-bit words together. (AVX2)
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+uint16_t AddWords16_le_avx2(const uint8_t *buf, uint32_t words)
+{
+	return AddWords16_avx2<CHKENDIAN_LITTLE>(buf, words);
+}
+
+/**
+ * AddBytes32 algorithm. (AVX2)
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Checksum.
+ */
+uint32_t AddBytes32_avx2(const uint8_t *buf, uint32_t siz)
+{
+	uint32_t checksum = 0;
+
+	// Do 128 bytes at a time using vpsadbw.
+	// The 64-bit sums are truncated to 32 bits at the end,
+	// which matches the scalar overflow behavior.
+	if (siz >= 128) {
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i sum = zero;
+		for (; siz >= 128; siz -= 128, buf += 128) {
+			const __m256i *const p = reinterpret_cast<const __m256i*>(buf);
+			sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(p+0), zero));
+			sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(p+1), zero));
+			sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(p+2), zero));
+			sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_loadu_si256(p+3), zero));
+		}
+		__m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum),
+					       _mm256_extracti128_si256(sum, 1));
+		sum128 = _mm_add_epi64(sum128, _mm_unpackhi_epi64(sum128, sum128));
+		checksum = (uint32_t)_mm_cvtsi128_si32(sum128);
+	}
+
+	// Remaining bytes.
+	for (; siz != 0; siz--, buf++)
+		checksum += *buf;
+
+	return checksum;
+}
+
+}
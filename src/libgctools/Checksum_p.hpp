@@ -0,0 +1,50 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * Checksum_p.hpp: Checksum algorithm class. (Private functions)           *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_CHECKSUM_P_HPP__
+#define __LIBGCTOOLS_CHECKSUM_P_HPP__
+
+#include "config.libgctools.h"
+
+// C includes.
+#include <stdint.h>
+
+namespace Checksum {
+
+#ifdef MCR_BUILD_AVX2
+/** AVX2-optimized kernels. (Checksum_avx2.cpp) **/
+// NOTE: Only call these if MCR_CPU_HasAVX2() is true.
+
+/**
+ * Add big-endian 16-bit words together. (AVX2)
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+uint16_t AddWords16_be_avx2(const uint8_t *buf, uint32_t words);
+
+/**
+ * Add little-endian 16-bit words together. (AVX2)
+ * @param buf Data buffer. (may be unaligned)
+ * @param words Number of 16-bit words.
+ * @return Sum of all words, modulo 2^16.
+ */
+uint16_t AddWords16_le_avx2(const uint8_t *buf, uint32_t words);
+
+/**
+ * AddBytes32 algorithm. (AVX2)
+ * @param buf Data buffer.
+ * @param siz Length of data buffer.
+ * @return Checksum.
+ */
+uint32_t AddBytes32_avx2(const uint8_t *buf, uint32_t siz);
+#endif /* MCR_BUILD_AVX2 */
+
+}
+
+#endif /* __LIBGCTOOLS_CHECKSUM_P_HPP__ */
@@ -7,12 +7,19 @@
  * SPDX-License-Identifier: GPL-2.0-or-later                               *
  ***************************************************************************/
 
+#include "config.libgctools.h"
 #include "GcImageLoader.hpp"
 #include "GcImage_p.hpp"
 
 // Byteswapping macros.
 #include "util/byteswap.h"
 
+// CPU flags.
+#include "util/cpuflags_x86.h"
+#ifdef MCR_BUILD_SSSE3
+# include "GcImageLoader_ssse3.hpp"
+#endif /* MCR_BUILD_SSSE3 */
+
 // C includes. (C++ namespace)
 #include <cstring>
 
@@ -52,6 +59,30 @@ static inline uint32_t RGB5A3_to_ARGB32(uint16_t px16)
 	return px32;
 }
 
+/**
+ * Convert RGB5A3 pixels to ARGB32.
+ * @param dst	[out] ARGB32 pixels.
+ * @param src	[in] RGB5A3 pixels. (big-endian)
+ * @param count	[in] Number of pixels.
+ */
+static inline void RGB5A3_to_ARGB32(uint32_t *dst, const uint16_t *src, int count)
+{
+#ifdef MCR_BUILD_SSSE3
+	if (MCR_CPU_HasSSSE3()) {
+		// Convert 8 pixels at a time.
+		const int count8 = (count & ~7);
+		GcImageLoader_SSSE3::RGB5A3_to_ARGB32(dst, src, count8);
+		dst += count8;
+		src += count8;
+		count -= count8;
+	}
+#endif /* MCR_BUILD_SSSE3 */
+
+	for (; count > 0; count--, dst++, src++) {
+		*dst = RGB5A3_to_ARGB32(be16_to_cpu(*src));
+	}
+}
+
 /**
  * Blit an ARGB32 tile to an ARGB32 linear image buffer.
  * @param pixel		[in] Pixel type.
@@ -111,11 +142,8 @@ GcImage *GcImageLoader::fromCI8(int w, int h,
 	d->init(w, h, GcImage::PXFMT_CI8);
 
 	// Convert the palette.
-	// TODO: Optimize using pointers instead of indexes?
 	d->palette.resize(256);
-	for (int i = 0; i < 256; i++) {
-		d->palette[i] = RGB5A3_to_ARGB32(be16_to_cpu(pal_buf[i]));
-	}
+	RGB5A3_to_ARGB32(d->palette.data(), pal_buf, 256);
 
 	// Tile pointer.
 	const uint8_t *tileBuf = img_buf;
@@ -167,11 +195,9 @@ GcImage *GcImageLoader::fromRGB5A3(int w, int h, const uint16_t *img_buf, int im
 
 	for (int y = 0; y < tilesY; y++) {
 		for (int x = 0; x < tilesX; x++) {
-			// Convert each tile to ARGB32 manually.
-			// TODO: Optimize using pointers instead of indexes?
-			for (int i = 0; i < 4*4; i++, img_buf++) {
-				tileBuf[i] = RGB5A3_to_ARGB32(be16_to_cpu(*img_buf));
-			}
+			// Convert the tile to ARGB32.
+			RGB5A3_to_ARGB32(tileBuf, img_buf, 4*4);
+			img_buf += 4*4;
 
 			// Blit the tile to the main image buffer.
 			BlitTile<uint32_t, 4, 4>((uint32_t*)d->imageData, w, tileBuf, x, y);
@@ -0,0 +1,81 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * GcImageLoader_ssse3.cpp: GameCube image loader. (SSSE3-optimized)       *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcImageLoader_ssse3.hpp"
+
+// SSSE3 intrinsics.
+// NOTE: This file must be compiled with SSSE3 enabled.
+#include <tmmintrin.h>
+
+namespace GcImageLoader_SSSE3 {
+
+/**
+ * Convert four RGB5A3 pixels to ARGB32.
+ * @param px RGB5A3 pixels. (host-endian, zero-extended to 32-bit)
+ * @return ARGB32 pixels.
+ */
+static inline __m128i RGB5A3_to_ARGB32_x4(__m128i px)
+{
+	// RGB555: xRRRRRGG GGGBBBBB
+	// ARGB32: AAAAAAAA RRRRRRRR GGGGGGGG BBBBBBBB
+	const __m128i b555 = _mm_or_si128(
+		_mm_and_si128(_mm_slli_epi32(px, 3), _mm_set1_epi32(0x0000F8)),
+		_mm_and_si128(_mm_srli_epi32(px, 2), _mm_set1_epi32(0x000007)));
+	const __m128i g555 = _mm_or_si128(
+		_mm_and_si128(_mm_slli_epi32(px, 6), _mm_set1_epi32(0x00F800)),
+		_mm_and_si128(_mm_slli_epi32(px, 1), _mm_set1_epi32(0x000700)));
+	const __m128i r555 = _mm_or_si128(
+		_mm_and_si128(_mm_slli_epi32(px, 9), _mm_set1_epi32(0xF80000)),
+		_mm_and_si128(_mm_slli_epi32(px, 4), _mm_set1_epi32(0x070000)));
+	const __m128i px555 = _mm_or_si128(_mm_or_si128(b555, g555),
+		_mm_or_si128(r555, _mm_set1_epi32((int)0xFF000000U)));
+
+	// RGB4A3
+	__m128i px4a3 = _mm_or_si128(
+		_mm_and_si128(px, _mm_set1_epi32(0x000F)),
+		_mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0x00F0)), 4));
+	px4a3 = _mm_or_si128(px4a3,
+		_mm_slli_epi32(_mm_and_si128(px, _mm_set1_epi32(0x0F00)), 8));
+	px4a3 = _mm_or_si128(px4a3, _mm_slli_epi32(px4a3, 4));	// Copy to the top nybble.
+
+	// Calculate the alpha channel.
+	__m128i a = _mm_and_si128(_mm_srli_epi32(px, 7), _mm_set1_epi32(0xE0));
+	a = _mm_or_si128(a, _mm_srli_epi32(a, 3));
+	a = _mm_or_si128(a, _mm_srli_epi32(a, 3));
+	px4a3 = _mm_or_si128(px4a3, _mm_slli_epi32(a, 24));
+
+	// Select RGB555 if bit 15 is set.
+	const __m128i mask = _mm_srai_epi32(_mm_slli_epi32(px, 16), 31);
+	return _mm_or_si128(_mm_and_si128(mask, px555), _mm_andnot_si128(mask, px4a3));
+}
+
+/**
+ * Convert RGB5A3 pixels to ARGB32.
+ * NOTE: Only call this if MCR_CPU_HasSSSE3() is true.
+ * @param dst	[out] ARGB32 pixels.
+ * @param src	[in] RGB5A3 pixels. (big-endian)
+ * @param count	[in] Number of pixels. (must be a multiple of 8)
+ */
+void RGB5A3_to_ARGB32(uint32_t *dst, const uint16_t *src, int count)
+{
+	// Byteswap and zero-extend the pixels to 32-bit in one shuffle.
+	const __m128i shuf_lo = _mm_setr_epi8(1, 0, -1, -1, 3, 2, -1, -1,
+					      5, 4, -1, -1, 7, 6, -1, -1);
+	const __m128i shuf_hi = _mm_setr_epi8(9, 8, -1, -1, 11, 10, -1, -1,
+					      13, 12, -1, -1, 15, 14, -1, -1);
+
+	for (; count >= 8; count -= 8, src += 8, dst += 8) {
+		const __m128i px16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst+0),
+			RGB5A3_to_ARGB32_x4(_mm_shuffle_epi8(px16, shuf_lo)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst+4),
+			RGB5A3_to_ARGB32_x4(_mm_shuffle_epi8(px16, shuf_hi)));
+	}
+}
+
+}
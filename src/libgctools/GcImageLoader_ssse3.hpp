@@ -0,0 +1,28 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * GcImageLoader_ssse3.hpp: GameCube image loader. (SSSE3-optimized)       *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_GCIMAGELOADER_SSSE3_HPP__
+#define __LIBGCTOOLS_GCIMAGELOADER_SSSE3_HPP__
+
+// C includes.
+#include <stdint.h>
+
+namespace GcImageLoader_SSSE3 {
+
+/**
+ * Convert RGB5A3 pixels to ARGB32.
+ * NOTE: Only call this if MCR_CPU_HasSSSE3() is true.
+ * @param dst	[out] ARGB32 pixels.
+ * @param src	[in] RGB5A3 pixels. (big-endian)
+ * @param count	[in] Number of pixels. (must be a multiple of 8)
+ */
+void RGB5A3_to_ARGB32(uint32_t *dst, const uint16_t *src, int count);
+
+}
+
+#endif /* __LIBGCTOOLS_GCIMAGELOADER_SSSE3_HPP__ */
@@ -69,6 +69,17 @@ extern "C" {
 #define CARD_FILENAMELEN	32	/* Filename length. */
 #define CARD_MAXFILES		127	/* Maximum number of files. */
 
+/**
+ * Memory card size limits.
+ * Official cards have up to 2048 blocks, but larger images
+ * are used by homebrew and emulators. Block numbers are 16-bit,
+ * and 0xFFFF is the end-of-chain marker in the FAT.
+ * The FAT is a single block, so only the first CARD_FATBLOCKS
+ * blocks can be allocated to files.
+ */
+#define CARD_MAXBLOCKS		0xFFFF			/* Maximum number of blocks. */
+#define CARD_FATBLOCKS		(CARD_SYSAREA + 0xFFB)	/* Blocks addressable by the FAT. */
+
 /**
  * Memory card header.
  * Reference for first 32 bytes: Dolphin
@@ -0,0 +1,244 @@
+/***************************************************************************
+ * GameCube Tools Library. [tests]                                         *
+ * ChecksumPlanTest.cpp: Checksum plan tests.                              *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "ChecksumPlan.hpp"
+using namespace Checksum;
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+using std::vector;
+
+namespace LibGcTools { namespace Tests {
+
+class ChecksumPlanTest : public ::testing::Test
+{
+	protected:
+		ChecksumPlanTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Pass the file data to a plan, one block at a time.
+		 * Spans before dataStart() and after dataEnd() are skipped.
+		 * @param plan Checksum plan.
+		 * @param buf File data.
+		 */
+		static void runPlan(ChecksumPlan &plan, const vector<uint8_t> &buf);
+
+		/**
+		 * Calculate checksums with a new plan.
+		 * @param buf File data.
+		 * @return Checksum values.
+		 */
+		vector<ChecksumValue> freshPlan(const vector<uint8_t> &buf) const;
+
+		// File data size. (3 blocks, plus an odd tail)
+		static const uint32_t DATA_SIZE = (8192 * 3) + 5;
+		// Span size used by runPlan().
+		static const uint32_t SPAN_SIZE = 8192;
+
+	public:
+		vector<ChecksumDef> checksumDefs;
+		vector<uint8_t> data;
+};
+
+void ChecksumPlanTest::SetUp(void)
+{
+	// xorshift32, so the data is the same on every run.
+	data.resize(DATA_SIZE);
+	uint32_t x = 0x6D637263;
+	for (size_t i = 0; i < data.size(); i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = (uint8_t)(x >> 24);
+	}
+
+	// Checksum areas start and end at odd offsets,
+	// and cross span boundaries.
+	ChecksumDef def;
+	def.algorithm = CHKALG_ADDINVDUAL16;
+	def.address = 0;
+	def.start = 5;
+	def.length = 8192 * 2 + 3;
+	def.endian = CHKENDIAN_BIG;
+	checksumDefs.push_back(def);
+
+	def.endian = CHKENDIAN_LITTLE;
+	def.address = 4;
+	def.start = 8191;
+	def.length = DATA_SIZE - 8191;
+	checksumDefs.push_back(def);
+
+	def.clear();
+	def.algorithm = CHKALG_ADDBYTES32;
+	def.address = 8;
+	def.start = 13;
+	def.length = 8192 + 7;
+	checksumDefs.push_back(def);
+
+	def.clear();
+	def.algorithm = CHKALG_CRC16;
+	def.address = 12;
+	def.start = 8192 * 2 - 1;
+	def.length = 8192 + 2;
+	checksumDefs.push_back(def);
+}
+
+/**
+ * Pass the file data to a plan, one block at a time.
+ * Spans before dataStart() and after dataEnd() are skipped.
+ * @param plan Checksum plan.
+ * @param buf File data.
+ */
+void ChecksumPlanTest::runPlan(ChecksumPlan &plan, const vector<uint8_t> &buf)
+{
+	const uint32_t start = plan.dataStart();
+	const uint32_t end = plan.dataEnd();
+	for (uint32_t offset = 0; offset < end; offset += SPAN_SIZE) {
+		const uint32_t siz = std::min((uint32_t)SPAN_SIZE, (uint32_t)buf.size() - offset);
+		if (offset + siz <= start)
+			continue;
+		plan.update(offset, &buf[offset], siz);
+	}
+}
+
+/**
+ * Calculate checksums with a new plan.
+ * @param buf File data.
+ * @return Checksum values.
+ */
+vector<ChecksumValue> ChecksumPlanTest::freshPlan(const vector<uint8_t> &buf) const
+{
+	ChecksumPlan plan;
+	plan.compile(checksumDefs, (uint32_t)buf.size());
+	runPlan(plan, buf);
+	return plan.finish();
+}
+
+/**
+ * Checksums calculated by the plan match Exec().
+ */
+TEST_F(ChecksumPlanTest, matchesExec)
+{
+	const vector<ChecksumValue> values = freshPlan(data);
+	ASSERT_EQ(checksumDefs.size(), values.size());
+
+	for (size_t i = 0; i < checksumDefs.size(); i++) {
+		const ChecksumDef &def = checksumDefs[i];
+		EXPECT_EQ(Exec(def.algorithm, &data[def.start], def.length, def.endian, def.param),
+			  values[i].actual) << "checksum " << i;
+	}
+}
+
+/**
+ * modify() adjusts additive checksums without another pass
+ * over the file data, and marks the CRC as dirty.
+ * Modified ranges start at odd offsets and cross span boundaries.
+ */
+TEST_F(ChecksumPlanTest, modifyAdditive)
+{
+	ChecksumPlan plan;
+	plan.compile(checksumDefs, DATA_SIZE);
+	runPlan(plan, data);
+	plan.finish();
+	EXPECT_FALSE(plan.isDirty());
+
+	// Modify data outside of the CRC area.
+	// Includes the expected checksum fields.
+	vector<uint8_t> newData = data;
+	static const uint32_t mods1[][2] = {
+		{1, 6}, {8189, 7}, {8192 + 4097, 1}, {8192 * 2 - 9, 3},
+	};
+	for (size_t i = 0; i < sizeof(mods1)/sizeof(mods1[0]); i++) {
+		const uint32_t offset = mods1[i][0];
+		const uint32_t siz = mods1[i][1];
+		vector<uint8_t> oldData(&newData[offset], &newData[offset + siz]);
+		for (uint32_t j = 0; j < siz; j++) {
+			newData[offset + j] ^= (uint8_t)(0x5A + (i * 16) + j);
+		}
+		plan.modify(offset, oldData.data(), &newData[offset], siz);
+	}
+
+	// Additive checksums don't need another pass.
+	EXPECT_FALSE(plan.isDirty());
+	vector<ChecksumValue> values = plan.finish();
+	vector<ChecksumValue> expected = freshPlan(newData);
+	ASSERT_EQ(expected.size(), values.size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		EXPECT_EQ(expected[i].expected, values[i].expected) << "checksum " << i;
+		EXPECT_EQ(expected[i].actual, values[i].actual) << "checksum " << i;
+	}
+
+	// Modify data in the CRC area.
+	const uint32_t offset = 8192 * 2 + 1;
+	const uint8_t oldByte = newData[offset];
+	newData[offset] ^= 0xFF;
+	plan.modify(offset, &oldByte, &newData[offset], 1);
+	EXPECT_TRUE(plan.isDirty());
+
+	// Only the CRC area and its expected checksum need to be read.
+	const ChecksumDef &crcDef = checksumDefs[3];
+	EXPECT_EQ(std::min(crcDef.address, crcDef.start), plan.dataStart());
+	EXPECT_EQ(crcDef.start + crcDef.length, plan.dataEnd());
+
+	runPlan(plan, newData);
+	values = plan.finish();
+	EXPECT_FALSE(plan.isDirty());
+	expected = freshPlan(newData);
+	ASSERT_EQ(expected.size(), values.size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		EXPECT_EQ(expected[i].expected, values[i].expected) << "checksum " << i;
+		EXPECT_EQ(expected[i].actual, values[i].actual) << "checksum " << i;
+	}
+}
+
+/**
+ * modify() on every single byte of an AddInvDual16 area,
+ * in both byte orders.
+ */
+TEST_F(ChecksumPlanTest, modifyEveryByte)
+{
+	checksumDefs.resize(2);
+	for (size_t i = 0; i < checksumDefs.size(); i++) {
+		checksumDefs[i].start = 3;
+		checksumDefs[i].length = 41;
+		checksumDefs[i].address = 64 + (i * 4);
+	}
+
+	ChecksumPlan plan;
+	plan.compile(checksumDefs, DATA_SIZE);
+	runPlan(plan, data);
+	plan.finish();
+
+	vector<uint8_t> newData = data;
+	for (uint32_t offset = 0; offset < 48; offset++) {
+		const uint8_t oldByte = newData[offset];
+		newData[offset] += 0x81;
+		plan.modify(offset, &oldByte, &newData[offset], 1);
+		EXPECT_FALSE(plan.isDirty());
+
+		const vector<ChecksumValue> values = plan.finish();
+		ASSERT_EQ(checksumDefs.size(), values.size());
+		for (size_t i = 0; i < checksumDefs.size(); i++) {
+			const ChecksumDef &def = checksumDefs[i];
+			EXPECT_EQ(Exec(def.algorithm, &newData[def.start], def.length, def.endian),
+				  values[i].actual) << "checksum " << i << ", offset == " << offset;
+		}
+	}
+}
+
+} }
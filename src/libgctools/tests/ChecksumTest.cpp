@@ -0,0 +1,261 @@
+/***************************************************************************
+ * GameCube Tools Library. [tests]                                         *
+ * ChecksumTest.cpp: Checksum algorithm tests.                             *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "Checksum.hpp"
+using namespace Checksum;
+
+// C includes.
+#include <stdint.h>
+#include <string.h>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibGcTools { namespace Tests {
+
+/**
+ * Checksum algorithm tests.
+ *
+ * The optimized kernels (slicing-by-8, SSE2, AVX2) are selected
+ * at runtime, so they're compared against simple byte-at-a-time
+ * reference implementations. Each buffer is tested at several
+ * alignments and sizes, so both the vectorized loops and the
+ * scalar tails are covered.
+ */
+class ChecksumTest : public ::testing::Test
+{
+	protected:
+		ChecksumTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/** Reference implementations. **/
+
+		static uint32_t RefAddInvDual16(const uint8_t *buf, uint32_t siz, ChkEndian endian);
+		static uint32_t RefAddBytes32(const uint8_t *buf, uint32_t siz);
+		static uint16_t RefCrc16(const uint8_t *buf, uint32_t siz, uint16_t poly);
+		static uint16_t RefDreamcastVMU(const uint8_t *buf, uint32_t siz);
+
+		// Buffer sizes to test.
+		static const uint32_t sizes[];
+		// Maximum alignment offset to test.
+		static const uint32_t MAX_OFFSET = 33;
+
+	public:
+		// Test data. (pseudo-random)
+		vector<uint8_t> data;
+};
+
+const uint32_t ChecksumTest::sizes[] = {
+	0, 1, 2, 3, 7, 8, 15, 16, 31, 32, 33, 63, 64, 65,
+	127, 128, 129, 255, 0x1FC, 0x1FFC, 8192, 8193
+};
+
+void ChecksumTest::SetUp(void)
+{
+	// xorshift32, so the data is the same on every run.
+	data.resize(16384);
+	uint32_t x = 0x6D637263;
+	for (size_t i = 0; i < data.size(); i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		data[i] = (uint8_t)(x >> 24);
+	}
+}
+
+/**
+ * AddInvDual16. (reference)
+ */
+uint32_t ChecksumTest::RefAddInvDual16(const uint8_t *buf, uint32_t siz, ChkEndian endian)
+{
+	uint16_t chk1 = 0, chk2 = 0;
+	for (uint32_t i = 0; i + 1 < siz; i += 2) {
+		const uint16_t word = (endian == CHKENDIAN_BIG
+			? (uint16_t)((buf[i] << 8) | buf[i+1])
+			: (uint16_t)((buf[i+1] << 8) | buf[i]));
+		chk1 += word;
+		chk2 += (word ^ 0xFFFF);
+	}
+	if (chk1 == 0xFFFF)
+		chk1 = 0;
+	if (chk2 == 0xFFFF)
+		chk2 = 0;
+	return ((uint32_t)chk1 << 16) | chk2;
+}
+
+/**
+ * AddBytes32. (reference)
+ */
+uint32_t ChecksumTest::RefAddBytes32(const uint8_t *buf, uint32_t siz)
+{
+	uint32_t sum = 0;
+	for (uint32_t i = 0; i < siz; i++) {
+		sum += buf[i];
+	}
+	return sum;
+}
+
+/**
+ * CRC-16, one bit at a time. (reference)
+ */
+uint16_t ChecksumTest::RefCrc16(const uint8_t *buf, uint32_t siz, uint16_t poly)
+{
+	uint16_t crc = 0xFFFF;
+	for (uint32_t i = 0; i < siz; i++) {
+		crc ^= buf[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+		}
+	}
+	return ~crc;
+}
+
+/**
+ * Dreamcast VMU, one bit at a time, without a CRC address. (reference)
+ * Reference: http://mc.pp.se/dc/vms/fileheader.html
+ */
+uint16_t ChecksumTest::RefDreamcastVMU(const uint8_t *buf, uint32_t siz)
+{
+	uint16_t crc = 0;
+	for (uint32_t i = 0; i < siz; i++) {
+		crc ^= (buf[i] << 8);
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+/**
+ * AddInvDual16 at every alignment, in both byte orders.
+ * Odd offsets used to cast an unaligned pointer to uint16_t*.
+ */
+TEST_F(ChecksumTest, AddInvDual16)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const uint32_t siz = sizes[s];
+		for (uint32_t offset = 0; offset <= MAX_OFFSET; offset++) {
+			const uint8_t *const buf = &data[offset];
+			EXPECT_EQ(RefAddInvDual16(buf, siz, CHKENDIAN_BIG),
+				  Exec(CHKALG_ADDINVDUAL16, buf, siz, CHKENDIAN_BIG))
+				<< "siz == " << siz << ", offset == " << offset;
+			EXPECT_EQ(RefAddInvDual16(buf, siz, CHKENDIAN_LITTLE),
+				  Exec(CHKALG_ADDINVDUAL16, buf, siz, CHKENDIAN_LITTLE))
+				<< "siz == " << siz << ", offset == " << offset;
+		}
+
+		// Public function. (aligned buffer)
+		vector<uint16_t> aligned((siz + 1) / 2);
+		if (siz > 0) {
+			memcpy(aligned.data(), data.data(), siz);
+		}
+		EXPECT_EQ(RefAddInvDual16(data.data(), siz, CHKENDIAN_BIG),
+			  AddInvDual16(aligned.data(), siz, CHKENDIAN_BIG))
+			<< "siz == " << siz;
+	}
+}
+
+/**
+ * AddBytes32 at every alignment.
+ */
+TEST_F(ChecksumTest, AddBytes32)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const uint32_t siz = sizes[s];
+		for (uint32_t offset = 0; offset <= MAX_OFFSET; offset++) {
+			const uint8_t *const buf = &data[offset];
+			EXPECT_EQ(RefAddBytes32(buf, siz), AddBytes32(buf, siz))
+				<< "siz == " << siz << ", offset == " << offset;
+		}
+	}
+}
+
+/**
+ * CRC-16 with the slicing-by-8 table and the bitwise fallback.
+ */
+TEST_F(ChecksumTest, Crc16)
+{
+	static const uint16_t polys[] = {CRC16_POLY_CCITT, 0xA001};
+	for (size_t p = 0; p < sizeof(polys)/sizeof(polys[0]); p++) {
+		for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+			const uint32_t siz = sizes[s];
+			for (uint32_t offset = 0; offset < 8; offset++) {
+				const uint8_t *const buf = &data[offset];
+				EXPECT_EQ(RefCrc16(buf, siz, polys[p]), Crc16(buf, siz, polys[p]))
+					<< "poly == " << polys[p] << ", siz == " << siz
+					<< ", offset == " << offset;
+			}
+		}
+	}
+}
+
+/**
+ * Dreamcast VMU with the slicing-by-8 table.
+ */
+TEST_F(ChecksumTest, DreamcastVMU)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const uint32_t siz = sizes[s];
+		for (uint32_t offset = 0; offset < 8; offset++) {
+			const uint8_t *const buf = &data[offset];
+			EXPECT_EQ(RefDreamcastVMU(buf, siz), DreamcastVMU(buf, siz))
+				<< "siz == " << siz << ", offset == " << offset;
+		}
+	}
+
+	// The CRC field is processed as zeroes.
+	vector<uint8_t> header(data.begin(), data.begin() + 0x80);
+	const uint16_t crc = DreamcastVMU(header.data(), (uint32_t)header.size(), 0x46);
+	header[0x46] = 0;
+	header[0x47] = 0;
+	EXPECT_EQ(RefDreamcastVMU(header.data(), (uint32_t)header.size()), crc);
+}
+
+/**
+ * Incremental checksums split at every byte boundary
+ * match the one-shot checksums.
+ * Splitting at odd boundaries leaves AddInvDual16
+ * with an odd buffer address for the next update.
+ */
+TEST_F(ChecksumTest, incrementalSplit)
+{
+	static const ChkAlgorithm algorithms[] = {
+		CHKALG_CRC16, CHKALG_ADDINVDUAL16, CHKALG_ADDBYTES32,
+		CHKALG_SONICCHAOGARDEN, CHKALG_DREAMCASTVMU,
+	};
+	static const ChkEndian endians[] = {CHKENDIAN_BIG, CHKENDIAN_LITTLE};
+	static const uint32_t siz = 301;
+
+	for (size_t a = 0; a < sizeof(algorithms)/sizeof(algorithms[0]); a++) {
+		for (size_t e = 0; e < sizeof(endians)/sizeof(endians[0]); e++) {
+			const ChkAlgorithm algorithm = algorithms[a];
+			const ChkEndian endian = endians[e];
+			// NOTE: DreamcastVMU's param is the CRC address.
+			const uint32_t param = (algorithm == CHKALG_DREAMCASTVMU ? ~0U : 0);
+			const uint32_t expected = Exec(algorithm, data.data(), siz, endian, param);
+
+			for (uint32_t split = 0; split <= siz; split++) {
+				ChecksumState state;
+				Init(&state, algorithm, endian, param);
+				Update(&state, &data[0], split);
+				Update(&state, &data[split], siz - split);
+				EXPECT_EQ(expected, Final(&state))
+					<< "algorithm == " << ChkAlgorithmToString(algorithm)
+					<< ", endian == " << endian << ", split == " << split;
+			}
+		}
+	}
+}
+
+} }
@@ -9,6 +9,8 @@
 #ifndef __LIBGCTOOLS_BITSTUFF_H__
 #define __LIBGCTOOLS_BITSTUFF_H__
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -64,6 +66,47 @@ static inline unsigned int popcount(unsigned int x)
 #endif
 }
 
+/**
+ * 64-bit population count function.
+ * @param x Value.
+ * @return Population count.
+ */
+static inline unsigned int popcount64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(x);
+#else
+	return popcount((unsigned int)x) + popcount((unsigned int)(x >> 32));
+#endif
+}
+
+/**
+ * Count trailing zeroes in a 64-bit value.
+ * @param x Value. (must be non-zero)
+ * @return Index of the lowest set bit.
+ */
+static inline unsigned int ctz64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return index;
+#else
+	unsigned int ret = 0;
+	if (!(x & 0xFFFFFFFFU)) {
+		x >>= 32;
+		ret = 32;
+	}
+	while (!(x & 1)) {
+		x >>= 1;
+		ret++;
+	}
+	return ret;
+#endif
+}
+
 /**
  * Check if a value is a power of 2. (also must be non-zero)
  * @param x Value.
@@ -0,0 +1,147 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * cpuflags_x86.c: x86 CPU flags detection.                                *
+ *                                                                         *
+ * Copyright (c) 2017-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "cpuflags_x86.h"
+
+/* C includes. */
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#elif defined(__GNUC__)
+# include <cpuid.h>
+#endif
+
+/* CPU flags. */
+uint32_t MCR_CPU_Flags = 0;
+int MCR_CPU_Flags_Init = 0;
+
+/* CPUID function 1: Processor Info and Feature Bits */
+#define CPUID_1_EDX_SSE2		(1U << 26)
+#define CPUID_1_ECX_SSSE3		(1U << 9)
+#define CPUID_1_ECX_OSXSAVE		(1U << 27)
+#define CPUID_1_ECX_AVX			(1U << 28)
+
+/* CPUID function 7, subfunction 0: Extended Features */
+#define CPUID_7_EBX_AVX2		(1U << 5)
+
+/* XCR0: SSE and AVX register state is enabled by the OS. */
+#define XCR0_SSE_AVX			(0x6U)
+
+/**
+ * Run the CPUID instruction.
+ * @param leaf		[in] Function.
+ * @param subleaf	[in] Subfunction.
+ * @param regs		[out] eax, ebx, ecx, edx
+ */
+static inline void mcr_cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	regs[0] = (uint32_t)r[0];
+	regs[1] = (uint32_t)r[1];
+	regs[2] = (uint32_t)r[2];
+	regs[3] = (uint32_t)r[3];
+#elif defined(__GNUC__)
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#else
+# error Unsupported compiler for CPUID.
+#endif
+}
+
+/**
+ * Get the maximum supported CPUID function.
+ * @return Maximum CPUID function, or 0 if CPUID isn't supported.
+ */
+static inline uint32_t mcr_cpuid_max(void)
+{
+#if defined(__GNUC__) && !defined(_MSC_VER)
+	/* Checks if CPUID is supported on i386. */
+	return __get_cpuid_max(0, NULL);
+#else
+	uint32_t regs[4];
+	mcr_cpuid(0, 0, regs);
+	return regs[0];
+#endif
+}
+
+/**
+ * Read an extended control register.
+ * @param idx Register index.
+ * @return Register value.
+ */
+static inline uint64_t mcr_xgetbv(uint32_t idx)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(idx);
+#else
+	/* NOTE: Using the opcode, since older assemblers don't support xgetbv. */
+	uint32_t eax, edx;
+	__asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (idx));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+/**
+ * Initialize the CPU flags.
+ *
+ * The MCRECOVER_CPU environment variable can be used to limit
+ * the instruction sets used for testing:
+ * - "scalar" or "none": No SIMD.
+ * - "sse2": SSE2 only.
+ * - "ssse3": SSE2 and SSSE3.
+ * - "avx2": All supported instruction sets. (default)
+ *
+ * NOTE: This is called automatically by the MCR_CPU_Has*() functions.
+ */
+void MCR_CPU_InitCPUFlags(void)
+{
+	uint32_t flags = 0;
+	uint32_t regs[4];	/* eax, ebx, ecx, edx */
+	const char *env;
+
+	const uint32_t max_leaf = mcr_cpuid_max();
+	if (max_leaf >= 1) {
+		mcr_cpuid(1, 0, regs);
+		if (regs[3] & CPUID_1_EDX_SSE2) {
+			flags |= MCR_CPUFLAG_X86_SSE2;
+		}
+		if (regs[2] & CPUID_1_ECX_SSSE3) {
+			flags |= MCR_CPUFLAG_X86_SSSE3;
+		}
+
+		/* AVX2 requires the OS to save the YMM registers. */
+		if ((regs[2] & (CPUID_1_ECX_OSXSAVE | CPUID_1_ECX_AVX)) ==
+		    (CPUID_1_ECX_OSXSAVE | CPUID_1_ECX_AVX) &&
+		    (mcr_xgetbv(0) & XCR0_SSE_AVX) == XCR0_SSE_AVX &&
+		    max_leaf >= 7)
+		{
+			mcr_cpuid(7, 0, regs);
+			if (regs[1] & CPUID_7_EBX_AVX2) {
+				flags |= MCR_CPUFLAG_X86_AVX2;
+			}
+		}
+	}
+
+	/* Check for an override. */
+	env = getenv("MCRECOVER_CPU");
+	if (env) {
+		if (!strcmp(env, "scalar") || !strcmp(env, "none")) {
+			flags = 0;
+		} else if (!strcmp(env, "sse2")) {
+			flags &= MCR_CPUFLAG_X86_SSE2;
+		} else if (!strcmp(env, "ssse3")) {
+			flags &= (MCR_CPUFLAG_X86_SSE2 | MCR_CPUFLAG_X86_SSSE3);
+		}
+	}
+
+	MCR_CPU_Flags = flags;
+	MCR_CPU_Flags_Init = 1;
+}
@@ -0,0 +1,110 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * cpuflags_x86.h: x86 CPU flags detection.                                *
+ *                                                                         *
+ * Copyright (c) 2017-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__
+#define __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__
+
+#include <stdint.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(__amd64__) || \
+    defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64)
+# define MCR_CPU_X86 1
+#endif
+
+#ifdef _MSC_VER
+#  ifndef inline
+#    define inline __inline
+#  endif /* !inline */
+#endif /* _MSC_VER */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* CPU flags. */
+#define MCR_CPUFLAG_X86_SSE2		((uint32_t)(1U << 0))
+#define MCR_CPUFLAG_X86_SSSE3		((uint32_t)(1U << 1))
+#define MCR_CPUFLAG_X86_AVX2		((uint32_t)(1U << 2))
+
+#ifdef MCR_CPU_X86
+
+/* CPU flags. Don't access directly; use the MCR_CPU_Has*() functions. */
+extern uint32_t MCR_CPU_Flags;
+extern int MCR_CPU_Flags_Init;
+
+/**
+ * Initialize the CPU flags.
+ *
+ * The MCRECOVER_CPU environment variable can be used to limit
+ * the instruction sets used for testing:
+ * - "scalar" or "none": No SIMD.
+ * - "sse2": SSE2 only.
+ * - "ssse3": SSE2 and SSSE3.
+ * - "avx2": All supported instruction sets. (default)
+ *
+ * NOTE: This is called automatically by the MCR_CPU_Has*() functions.
+ */
+void MCR_CPU_InitCPUFlags(void);
+
+/**
+ * Get the CPU flags.
+ * @return CPU flags.
+ */
+static inline uint32_t MCR_CPU_GetFlags(void)
+{
+	if (!MCR_CPU_Flags_Init) {
+		MCR_CPU_InitCPUFlags();
+	}
+	return MCR_CPU_Flags;
+}
+
+#else /* !MCR_CPU_X86 */
+
+/**
+ * Get the CPU flags.
+ * @return CPU flags. (always 0 on non-x86)
+ */
+static inline uint32_t MCR_CPU_GetFlags(void)
+{
+	return 0;
+}
+
+#endif /* MCR_CPU_X86 */
+
+/**
+ * Check if the CPU supports SSE2.
+ * @return Non-zero if SSE2 is supported; 0 if not.
+ */
+static inline int MCR_CPU_HasSSE2(void)
+{
+	return !!(MCR_CPU_GetFlags() & MCR_CPUFLAG_X86_SSE2);
+}
+
+/**
+ * Check if the CPU supports SSSE3.
+ * @return Non-zero if SSSE3 is supported; 0 if not.
+ */
+static inline int MCR_CPU_HasSSSE3(void)
+{
+	return !!(MCR_CPU_GetFlags() & MCR_CPUFLAG_X86_SSSE3);
+}
+
+/**
+ * Check if the CPU supports AVX2.
+ * @return Non-zero if AVX2 is supported; 0 if not.
+ */
+static inline int MCR_CPU_HasAVX2(void)
+{
+	return !!(MCR_CPU_GetFlags() & MCR_CPUFLAG_X86_AVX2);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LIBGCTOOLS_UTIL_CPUFLAGS_X86_H__ */
@@ -0,0 +1,181 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * BlockMap.cpp: Block allocation map.                                     *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "BlockMap.hpp"
+#include "util/bitstuff.h"
+
+BlockMap::BlockMap()
+	: m_size(0)
+{ }
+
+/**
+ * Create an empty block map.
+ * @param blockCount Number of blocks.
+ */
+BlockMap::BlockMap(int blockCount)
+	: m_size(0)
+{
+	reset(blockCount);
+}
+
+/**
+ * Reset the block map.
+ * All blocks will be marked as free.
+ * @param blockCount Number of blocks.
+ */
+void BlockMap::reset(int blockCount)
+{
+	if (blockCount < 0)
+		blockCount = 0;
+	m_size = blockCount;
+
+	const int words = (blockCount + 63) / 64;
+	m_used = QVector<uint64_t>(words, 0);
+	m_collision = QVector<uint64_t>(words, 0);
+}
+
+/**
+ * Mark a block as used.
+ * If the block is already used, it's marked as a collision.
+ * @param block Block number.
+ */
+void BlockMap::markUsed(int block)
+{
+	if (block < 0 || block >= m_size)
+		return;
+
+	const uint64_t bit = (1ULL << (block & 63));
+	uint64_t &used = m_used[block >> 6];
+	if (used & bit) {
+		// Block is already used.
+		m_collision[block >> 6] |= bit;
+	} else {
+		used |= bit;
+	}
+}
+
+/**
+ * Mark a range of blocks as used.
+ * @param first First block number.
+ * @param count Number of blocks.
+ */
+void BlockMap::markUsed(int first, int count)
+{
+	for (int i = 0; i < count; i++) {
+		markUsed(first + i);
+	}
+}
+
+/**
+ * Mark a block as free.
+ * This also clears the collision state.
+ * @param block Block number.
+ */
+void BlockMap::markFree(int block)
+{
+	if (block < 0 || block >= m_size)
+		return;
+
+	const uint64_t mask = ~(1ULL << (block & 63));
+	m_used[block >> 6] &= mask;
+	m_collision[block >> 6] &= mask;
+}
+
+/** Queries **/
+
+/**
+ * Get the number of used blocks.
+ * @return Number of used blocks.
+ */
+int BlockMap::usedCount(void) const
+{
+	int count = 0;
+	foreach (uint64_t word, m_used) {
+		count += popcount64(word);
+	}
+	return count;
+}
+
+/**
+ * Get the number of blocks used by more than one file.
+ * @return Number of collisions.
+ */
+int BlockMap::collisionCount(void) const
+{
+	int count = 0;
+	foreach (uint64_t word, m_collision) {
+		count += popcount64(word);
+	}
+	return count;
+}
+
+/**
+ * Find the next block with a given state.
+ * @param start First block to check.
+ * @param used True to find a used block; false to find a free block.
+ * @return Block number, or -1 if none.
+ */
+int BlockMap::findNext(int start, bool used) const
+{
+	if (start < 0)
+		start = 0;
+	if (start >= m_size)
+		return -1;
+
+	const uint64_t *const words = m_used.constData();
+	const int wordCount = m_used.size();
+	const uint64_t invert = (used ? 0 : ~0ULL);
+
+	// Mask off the bits before start in the first word.
+	int w = (start >> 6);
+	uint64_t word = (words[w] ^ invert) & (~0ULL << (start & 63));
+	while (!word) {
+		if (++w >= wordCount)
+			return -1;
+		word = words[w] ^ invert;
+	}
+
+	// NOTE: Free bits past the end of the map are
+	// set in the inverted word, so check the size.
+	const int block = (w << 6) + (int)ctz64(word);
+	return (block < m_size ? block : -1);
+}
+
+/**
+ * Find the next free block.
+ * @param start First block to check.
+ * @return Next free block at or after start, or -1 if none.
+ */
+int BlockMap::nextFree(int start) const
+{
+	return findNext(start, false);
+}
+
+/**
+ * Find the next used block.
+ * @param start First block to check.
+ * @return Next used block at or after start, or -1 if none.
+ */
+int BlockMap::nextUsed(int start) const
+{
+	return findNext(start, true);
+}
+
+/**
+ * Get the length of a run of free blocks.
+ * @param start First block of the run.
+ * @return Number of consecutive free blocks starting at start.
+ */
+int BlockMap::freeRunLength(int start) const
+{
+	if (start < 0 || start >= m_size || isUsed(start))
+		return 0;
+
+	const int next = nextUsed(start);
+	return (next >= 0 ? next : m_size) - start;
+}
@@ -0,0 +1,160 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * BlockMap.hpp: Block allocation map.                                     *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_BLOCKMAP_HPP__
+#define __LIBMEMCARD_BLOCKMAP_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QVector>
+
+/**
+ * Block allocation map.
+ *
+ * Tracks which blocks are used, and which blocks are used
+ * by more than one file. (collisions, e.g. "lost" files that
+ * overlap regular files)
+ *
+ * The bitsets are implicitly shared, so copying a BlockMap
+ * is cheap; the bitsets are only copied if modified.
+ */
+class BlockMap
+{
+	public:
+		BlockMap();
+
+		/**
+		 * Create an empty block map.
+		 * @param blockCount Number of blocks.
+		 */
+		explicit BlockMap(int blockCount);
+
+	public:
+		/**
+		 * Reset the block map.
+		 * All blocks will be marked as free.
+		 * @param blockCount Number of blocks.
+		 */
+		void reset(int blockCount);
+
+		/**
+		 * Get the number of blocks.
+		 * @return Number of blocks.
+		 */
+		inline int size(void) const
+		{
+			return m_size;
+		}
+
+		/**
+		 * Is a block used?
+		 * @param block Block number.
+		 * @return True if used; false if free or out of range.
+		 */
+		inline bool isUsed(int block) const
+		{
+			if (block < 0 || block >= m_size)
+				return false;
+			return !!(m_used[block >> 6] & (1ULL << (block & 63)));
+		}
+
+		/**
+		 * Is a block used by more than one file?
+		 * @param block Block number.
+		 * @return True if used by more than one file; false if not.
+		 */
+		inline bool isCollision(int block) const
+		{
+			if (block < 0 || block >= m_size)
+				return false;
+			return !!(m_collision[block >> 6] & (1ULL << (block & 63)));
+		}
+
+		/**
+		 * Mark a block as used.
+		 * If the block is already used, it's marked as a collision.
+		 * @param block Block number.
+		 */
+		void markUsed(int block);
+
+		/**
+		 * Mark a range of blocks as used.
+		 * @param first First block number.
+		 * @param count Number of blocks.
+		 */
+		void markUsed(int first, int count);
+
+		/**
+		 * Mark a block as free.
+		 * This also clears the collision state.
+		 * @param block Block number.
+		 */
+		void markFree(int block);
+
+	public:
+		/** Queries **/
+
+		/**
+		 * Get the number of used blocks.
+		 * @return Number of used blocks.
+		 */
+		int usedCount(void) const;
+
+		/**
+		 * Get the number of free blocks.
+		 * @return Number of free blocks.
+		 */
+		inline int freeCount(void) const
+		{
+			return m_size - usedCount();
+		}
+
+		/**
+		 * Get the number of blocks used by more than one file.
+		 * @return Number of collisions.
+		 */
+		int collisionCount(void) const;
+
+		/**
+		 * Find the next free block.
+		 * @param start First block to check.
+		 * @return Next free block at or after start, or -1 if none.
+		 */
+		int nextFree(int start) const;
+
+		/**
+		 * Find the next used block.
+		 * @param start First block to check.
+		 * @return Next used block at or after start, or -1 if none.
+		 */
+		int nextUsed(int start) const;
+
+		/**
+		 * Get the length of a run of free blocks.
+		 * @param start First block of the run.
+		 * @return Number of consecutive free blocks starting at start.
+		 */
+		int freeRunLength(int start) const;
+
+	private:
+		int m_size;
+		QVector<uint64_t> m_used;
+		QVector<uint64_t> m_collision;
+
+		/**
+		 * Find the next block with a given state.
+		 * @param start First block to check.
+		 * @param used True to find a used block; false to find a free block.
+		 * @return Block number, or -1 if none.
+		 */
+		int findNext(int start, bool used) const;
+};
+
+#endif /* __LIBMEMCARD_BLOCKMAP_HPP__ */
@@ -9,8 +9,10 @@
 #include "Card.hpp"
 #include "Card_p.hpp"
 #include "File.hpp"
+#include "CompressedFile.hpp"
 
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <cassert>
@@ -18,8 +20,19 @@
 // C++ includes.
 #include <limits>
 
+// fsync() / _commit()
+#ifdef _WIN32
+# include <io.h>
+#else /* !_WIN32 */
+# include <unistd.h>
+#endif /* _WIN32 */
+
 // Qt includes.
+#include <QtCore/QBuffer>
 #include <QtCore/QFile>
+#include <QtCore/QFileDevice>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 #include <QtCore/QVector>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
@@ -44,6 +57,7 @@ CardPrivate::CardPrivate(Card *q, uint32_t blockSize,
 	, totalPhysBlocks(0)
 	, totalUserBlocks(0)
 	, freeBlocks(0)
+	, txnDepth(0)
 {
 	assert(isPow2(blockSize));
 	assert(blockSize > 0);
@@ -67,6 +81,9 @@ CardPrivate::CardPrivate(Card *q, uint32_t blockSize,
 
 CardPrivate::~CardPrivate()
 {
+	// Make sure the block health task isn't using the card.
+	cancelBlockHealthJob();
+
 	// Clear the File list.
 	qDeleteAll(lstFiles);
 	lstFiles.clear();
@@ -81,6 +98,8 @@ CardPrivate::~CardPrivate()
  * Open a Memory Card image.
  * totalPhysBlocks is initialized after the file is opened.
  * totalUserBlocks and freeBlocks must be initialized by the subclass.
+ * gzip/zip-compressed images are opened using CompressedFile
+ * if openMode is read-only.
  * @param filename Memory Card image filename.
  * @param openMode File open mode.
  * @return 0 on success; non-zero on error. (also check errorString)
@@ -102,8 +121,15 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
 	}
 
 	// Open the file.
+	// Compressed images are read-only, so they're only
+	// checked for if the card is being opened read-only.
 	Q_Q(Card);
-	QFile *tmp_file = new QFile(filename, q);
+	QIODevice *tmp_file;
+	if (!(openMode & QIODevice::WriteOnly) && CompressedFile::isCompressed(filename)) {
+		tmp_file = new CompressedFile(filename, q);
+	} else {
+		tmp_file = new QFile(filename, q);
+	}
 	if (!tmp_file->open(openMode)) {
 		// Error opening the file.
 		// NOTE: Qt doesn't return the raw error number.
@@ -113,12 +139,72 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
 		delete tmp_file;
 		return -1;
 	}
-	this->file = tmp_file;
 	this->filename = filename;
+	initDevice(tmp_file, openMode);
+
+	// Card is open.
+	return 0;
+}
+
+/**
+ * Open a Memory Card image from memory.
+ * totalPhysBlocks is initialized after the buffer is opened.
+ * totalUserBlocks and freeBlocks must be initialized by the subclass.
+ *
+ * The image data is implicitly shared with the caller, so opening
+ * the card doesn't copy it. If the card is written to, the data is
+ * detached first (copy-on-write); the caller's buffer is never modified.
+ * Use QByteArray::fromRawData() to open a caller-owned buffer without
+ * copying it. (The buffer must outlive the Card.)
+ *
+ * @param data Memory Card image data.
+ * @param openMode Buffer open mode.
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int CardPrivate::open(const QByteArray &data, QIODevice::OpenModeFlag openMode)
+{
+	if (file) {
+		// File is already open.
+		// TODO: Don't allow this, or clear all variables?
+		close();
+	}
+
+	Q_Q(Card);
+	QBuffer *const tmp_buffer = new QBuffer(q);
+	tmp_buffer->setData(data);
+	if (!tmp_buffer->open(openMode)) {
+		// Error opening the buffer.
+		// TODO: Translate the error message.
+		this->errorString = tmp_buffer->errorString();
+		delete tmp_buffer;
+		return -1;
+	}
+	this->filename.clear();
+	initDevice(tmp_buffer, openMode);
+
+	// Card is open.
+	return 0;
+}
+
+/**
+ * Initialize the card size information from an opened device.
+ * Called by open() after the device has been opened.
+ * @param device Opened device. (CardPrivate takes ownership.)
+ * @param openMode Device open mode.
+ */
+void CardPrivate::initDevice(QIODevice *device, QIODevice::OpenModeFlag openMode)
+{
+	this->file = device;
 
 	// Save the readOnly flag.
 	this->readOnly = !(openMode & QIODevice::WriteOnly);
 
+	// Only files and in-memory images can be reopened as writable.
+	// Compressed images are always read-only.
+	if (!qobject_cast<QFile*>(device) && !qobject_cast<QBuffer*>(device)) {
+		this->canMakeWritable = false;
+	}
+
 	// TODO: If formatting the card, skip all of this.
 
 	// Get the filesize.
@@ -142,9 +228,6 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
 		// Size is not a power of 2.
 		this->errors |= Card::MCE_SZ_NON_POW2;
 	}
-
-	// Card is open.
-	return 0;
 }
 
 /**
@@ -158,6 +241,9 @@ void CardPrivate::close(void)
 		return;
 	}
 
+	// Make sure the block health task isn't using the card.
+	cancelBlockHealthJob();
+
 	file->close();
 	delete file;
 	file = nullptr;
@@ -165,6 +251,10 @@ void CardPrivate::close(void)
 	// Clear the cached values.
 	filename.clear();
 	filesize = 0;
+	blockHealth.clear();
+	txnDepth = 0;
+	txnBlocks.clear();
+	blockMap.reset(0);
 	totalPhysBlocks = 0;
 	totalUserBlocks = 0;
 	freeBlocks = 0;
@@ -180,18 +270,12 @@ void CardPrivate::close(void)
  */
 void CardPrivate::findMostCommonByte(const uint8_t *buf, size_t siz, uint8_t *most_byte, int *count)
 {
-	int bytes[256];
-	memset(bytes, 0, sizeof(bytes));
-
-	// Check the buffer.
-	// TODO: Loop unrolling optimization; decrement optimization?
-	for (size_t i = 0; i < siz; i++, buf++) {
-		++bytes[*buf];
-	}
+	uint32_t bytes[256];
+	BlockHealth::Histogram(buf, siz, bytes);
 
 	// Find the most common byte.
 	uint8_t tmpbyte = 255;
-	int tmpcnt = bytes[255];
+	uint32_t tmpcnt = bytes[255];
 	for (int i = 254; i >= 0; i--) {
 		if (bytes[i] > tmpcnt) {
 			tmpbyte = (uint8_t)i;
@@ -203,8 +287,125 @@ void CardPrivate::findMostCommonByte(const uint8_t *buf, size_t siz, uint8_t *mo
 		*most_byte = tmpbyte;
 	}
 	if (count) {
-		*count = tmpcnt;
+		*count = (int)tmpcnt;
+	}
+}
+
+/** Block health **/
+
+/**
+ * Thread pool task for CardPrivate::startBlockHealthJob().
+ * Reads and analyzes every block on the card.
+ */
+class BlockHealthTask : public QRunnable
+{
+	public:
+		explicit BlockHealthTask(const QSharedPointer<BlockHealthJob> &job)
+			: job(job) { }
+
+		void run(void) final
+		{
+			{
+				QMutexLocker locker(&job->mutex);
+				if (job->cancelled.load())
+					return;
+				job->running = true;
+			}
+
+			Card *const card = job->card;
+			const int blockSize = card->blockSize();
+			const int totalPhysBlocks = card->totalPhysBlocks();
+			QVector<BlockHealth::Info> health(totalPhysBlocks);
+			QByteArray buf(blockSize, 0);
+			bool ok = true;
+			for (int i = 0; i < totalPhysBlocks; i++) {
+				if (job->cancelled.load()) {
+					ok = false;
+					break;
+				}
+
+				int ret = card->readBlock(buf.data(), blockSize, (uint16_t)i);
+				if (ret != blockSize) {
+					// Read error.
+					// Mark the block as unreadable and keep going.
+					health[i].flags = BlockHealth::BHF_UNREADABLE;
+					continue;
+				}
+				BlockHealth::Analyze(reinterpret_cast<const uint8_t*>(buf.constData()),
+						     blockSize, &health[i]);
+			}
+
+			QMutexLocker locker(&job->mutex);
+			job->running = false;
+			if (ok && !job->cancelled.load()) {
+				// Notify the Card on its own thread.
+				// NOTE: The Card waits for this task before
+				// it's closed, so job->card is still valid here.
+				job->health = health;
+				job->finished = true;
+				QMetaObject::invokeMethod(card, "blockHealthJob_finished_slot",
+							  Qt::QueuedConnection);
+			}
+			job->stopped.wakeAll();
+		}
+
+	private:
+		const QSharedPointer<BlockHealthJob> job;
+		Q_DISABLE_COPY(BlockHealthTask)
+};
+
+/**
+ * Analyze the card's blocks in the background.
+ * Card::blockHealthChanged() is emitted when the job finishes.
+ * Does nothing if the job is already running.
+ */
+void CardPrivate::startBlockHealthJob(void)
+{
+	if (!file || blockHealthJob)
+		return;
+
+	Q_Q(Card);
+	blockHealthJob = QSharedPointer<BlockHealthJob>(new BlockHealthJob(q));
+	QThreadPool::globalInstance()->start(new BlockHealthTask(blockHealthJob));
+}
+
+/**
+ * Cancel the background block health job, if any.
+ * This waits for the task to stop reading the card.
+ */
+void CardPrivate::cancelBlockHealthJob(void)
+{
+	if (!blockHealthJob)
+		return;
+
+	QMutexLocker locker(&blockHealthJob->mutex);
+	blockHealthJob->cancelled.store(1);
+	while (blockHealthJob->running) {
+		blockHealthJob->stopped.wait(&blockHealthJob->mutex);
+	}
+	locker.unlock();
+	blockHealthJob.clear();
+}
+
+/**
+ * Save the results of the background block health job.
+ * @return True if the job has finished; false if not.
+ */
+bool CardPrivate::collectBlockHealthJob(void)
+{
+	if (!blockHealthJob)
+		return false;
+
+	QMutexLocker locker(&blockHealthJob->mutex);
+	if (!blockHealthJob->finished) {
+		// Still running.
+		return false;
 	}
+
+	blockHealth = blockHealthJob->health;
+	locker.unlock();
+	blockHealthJob.clear();
+	return true;
 }
 
 /** Card **/
@@ -301,6 +502,23 @@ int Card::setReadOnly(bool readOnly)
 	// Open mode.
 	const QIODevice::OpenMode openMode = (readOnly ? QIODevice::ReadOnly : QIODevice::ReadWrite);
 
+	QBuffer *const buffer = qobject_cast<QBuffer*>(d->file);
+	if (buffer) {
+		// In-memory image. Reopen the buffer with the new mode.
+		// NOTE: QBuffer detaches the data on the first write.
+		buffer->close();
+		if (!buffer->open(openMode)) {
+			d->errorString = buffer->errorString();
+			buffer->open(d->readOnly ? QIODevice::ReadOnly : QIODevice::ReadWrite);
+			return -EIO;
+		}
+		d->readOnly = readOnly;
+		return 0;
+	} else if (!qobject_cast<QFile*>(d->file)) {
+		// Compressed images cannot be reopened.
+		return -EROFS;
+	}
+
 	// Attempt to open the file using a new QFile.
 	// FIXME: Do we need to close the first QFile due to sharing?
 	// Open the file.
@@ -317,11 +535,14 @@ int Card::setReadOnly(bool readOnly)
 	}
 
 	// TODO: Validate that this file is the same as the one we had before.
-	// TODO: Atomic swap of d->file and tmp_file.
-	std::swap(d->file, tmp_file);
+	// NOTE: Checksums may be calculated in the background,
+	// so the file is swapped while holding ioMutex.
+	QMutexLocker locker(&d->ioMutex);
+	QIODevice *old_file = d->file;
+	d->file = tmp_file;
 	d->readOnly = readOnly;
-	tmp_file->close();
-	delete tmp_file;
+	old_file->close();
+	delete old_file;
 	return 0;
 }
 
@@ -339,7 +560,7 @@ bool Card::canMakeWritable(void) const
 
 /**
  * Get the memory card filename.
- * @return Memory card filename, or empty string if not open.
+ * @return Memory card filename, or empty string if not open or in memory.
  */
 QString Card::filename(void) const
 {
@@ -347,6 +568,29 @@ QString Card::filename(void) const
 	return d->filename;
 }
 
+/**
+ * Is this card image stored in memory?
+ * @return True if the card was opened from memory; false if not.
+ */
+bool Card::isInMemory(void) const
+{
+	Q_D(const Card);
+	return (qobject_cast<QBuffer*>(d->file) != nullptr);
+}
+
+/**
+ * Get the card image data for an in-memory card.
+ * This includes any changes that have been written to the card.
+ * The data is implicitly shared, so this doesn't copy the image.
+ * @return Card image data, or empty QByteArray if not in memory.
+ */
+QByteArray Card::imageData(void) const
+{
+	Q_D(const Card);
+	const QBuffer *const buffer = qobject_cast<const QBuffer*>(d->file);
+	return (buffer ? buffer->data() : QByteArray());
+}
+
 /**
  * Get the size of the memory card image, in bytes.
  * This is the full size of the memory card image.
@@ -434,6 +678,20 @@ int Card::freeBlocks(void) const
 	return d->freeBlocks;
 }
 
+/**
+ * Get the block allocation map.
+ * NOTE: This is only valid for regular files, not "lost" files.
+ * The map is implicitly shared, so this doesn't copy the bitsets.
+ * @return Block allocation map.
+ */
+BlockMap Card::blockMap(void) const
+{
+	if (!isOpen())
+		return BlockMap();
+	Q_D(const Card);
+	return d->blockMap;
+}
+
 /**
  * Get the text encoding used for filenames and descriptions.
  * @return Text encoding.
@@ -621,6 +879,17 @@ int Card::readBlock(void *buf, int siz, uint16_t blockIdx)
 		return 0;
 
 	// Read the specified block.
+	// NOTE: Blocks may be read from other threads,
+	// e.g. checksums and the GcnCard load thread.
+	QMutexLocker locker(&d->ioMutex);
+	if (d->txnDepth > 0) {
+		// Check for a buffered block.
+		auto iter = d->txnBlocks.constFind(blockIdx);
+		if (iter != d->txnBlocks.cend()) {
+			memcpy(buf, iter->constData(), d->blockSize);
+			return d->blockSize;
+		}
+	}
 	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
 	if (!d->file->seek(pos))
 		return -EIO;	// TODO: Proper error code?
@@ -649,16 +918,332 @@ int Card::writeBlock(const void *buf, int siz, uint16_t blockIdx)
 	if (d->readOnly)
 		return -EROFS;
 
+	// The damage map is no longer accurate.
+	d->cancelBlockHealthJob();
+	d->blockHealth.clear();
+
+	if (d->txnDepth > 0) {
+		// Buffer the block until commit().
+		QMutexLocker locker(&d->ioMutex);
+		d->txnBlocks.insert(blockIdx,
+			QByteArray(static_cast<const char*>(buf), d->blockSize));
+		return d->blockSize;
+	}
+
 	// Write the specified block.
-	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
-	if (!d->file->seek(pos))
-		return -EIO;    // TODO: Proper error code?
-	// TODO: Check for errors?
-	int ret = (int)d->file->write((char*)buf, d->blockSize);
-	return (ret >= 0 ? ret : -EIO);
+	int ret = d->writeBlocks(blockIdx, static_cast<const char*>(buf), 1);
+	return (ret == 0 ? (int)d->blockSize : ret);
+}
+
+// TODO: Add a readBlocks() function?
+
+/** Write transactions **/
+
+/**
+ * Is a block part of the file system metadata?
+ * System blocks are written after data blocks when a
+ * transaction is committed, and the device is flushed
+ * in between, so an interrupted commit doesn't leave
+ * the tables pointing to unwritten data.
+ * @param blockIdx Block index.
+ * @return True if this is a system block; false if not.
+ */
+bool CardPrivate::isSystemBlock(int blockIdx) const
+{
+	Q_UNUSED(blockIdx)
+	return false;
+}
+
+/**
+ * Write consecutive blocks to the device.
+ * @param blockIdx First block index.
+ * @param buf Block data.
+ * @param count Number of blocks.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CardPrivate::writeBlocks(int blockIdx, const char *buf, int count)
+{
+	const qint64 len = (qint64)count * blockSize;
+	QMutexLocker locker(&ioMutex);
+	const qint64 pos = ((qint64)blockIdx * blockSize) + headerSize;
+	if (!file->seek(pos))
+		return -EIO;	// TODO: Proper error code?
+	qint64 ret = file->write(buf, len);
+	return (ret == len ? 0 : -EIO);
+}
+
+/**
+ * Write buffered transaction blocks to the device.
+ * Adjacent blocks are merged into a single write.
+ * @param blocks Buffered blocks.
+ * @param system If true, write system blocks; otherwise, write data blocks.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CardPrivate::commitBlocks(const QMap<uint16_t, QByteArray> &blocks, bool system)
+{
+	QByteArray run;
+	int runStart = -1;
+	int runCount = 0;
+
+	// NOTE: QMap is sorted by key, so blocks are written in order.
+	for (auto iter = blocks.cbegin(); iter != blocks.cend(); ++iter) {
+		const int blockIdx = iter.key();
+		if (isSystemBlock(blockIdx) != system)
+			continue;
+
+		if (runCount > 0 && blockIdx != runStart + runCount) {
+			// Not adjacent. Write the current run.
+			int ret = writeBlocks(runStart, run.constData(), runCount);
+			if (ret != 0)
+				return ret;
+			run.clear();
+			runCount = 0;
+		}
+
+		if (runCount == 0)
+			runStart = blockIdx;
+		run += iter.value();
+		runCount++;
+	}
+
+	if (runCount > 0) {
+		// Write the last run.
+		return writeBlocks(runStart, run.constData(), runCount);
+	}
+	return 0;
+}
+
+/**
+ * Flush the device to stable storage.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CardPrivate::syncDevice(void)
+{
+	QFileDevice *const fileDevice = qobject_cast<QFileDevice*>(file);
+	if (!fileDevice) {
+		// Not a file. (QBuffer)
+		return 0;
+	}
+
+	QMutexLocker locker(&ioMutex);
+	if (!fileDevice->flush())
+		return -EIO;
+
+	const int fd = fileDevice->handle();
+	if (fd < 0)
+		return 0;
+#ifdef _WIN32
+	return (_commit(fd) == 0 ? 0 : -errno);
+#else /* !_WIN32 */
+	return (fsync(fd) == 0 ? 0 : -errno);
+#endif /* _WIN32 */
+}
+
+/**
+ * Begin a write transaction.
+ * Blocks written with writeBlock() are buffered until
+ * commit() is called, and readBlock() returns the
+ * buffered data. Transactions can be nested; only the
+ * outermost commit() writes to the device.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Card::beginTransaction(void)
+{
+	Q_D(Card);
+	if (!isOpen())
+		return -EBADF;
+	else if (d->readOnly)
+		return -EROFS;
+
+	// NOTE: readBlock() checks txnDepth from other threads.
+	QMutexLocker locker(&d->ioMutex);
+	d->txnDepth++;
+	return 0;
+}
+
+/**
+ * Commit the current write transaction.
+ *
+ * Data blocks are written first, then system blocks
+ * (header, directory, block tables), with adjacent
+ * blocks merged into a single write. The device is
+ * flushed to stable storage after each of these steps,
+ * so the system blocks are never written before the
+ * data blocks they refer to are on disk.
+ *
+ * If an error occurs, the transaction is left open with
+ * all of its buffered blocks. The caller can retry with
+ * commit() or discard the blocks with rollback().
+ *
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int Card::commit(void)
+{
+	Q_D(Card);
+	if (!isOpen())
+		return -EBADF;
+
+	// NOTE: readBlock() checks txnDepth and txnBlocks from
+	// other threads, so they're only accessed with ioMutex held.
+	QMutexLocker locker(&d->ioMutex);
+	if (d->txnDepth <= 0)
+		return -EINVAL;
+	else if (d->txnDepth > 1) {
+		// Nested transaction.
+		// The outermost commit() will write the blocks.
+		d->txnDepth--;
+		return 0;
+	}
+
+	// NOTE: txnBlocks is implicitly shared, so this doesn't
+	// copy the blocks. readBlock() still sees the buffered
+	// blocks until they're cleared below, which is fine,
+	// since they match what's being written.
+	const QMap<uint16_t, QByteArray> blocks = d->txnBlocks;
+	if (blocks.isEmpty()) {
+		// Nothing to write.
+		d->txnDepth--;
+		return 0;
+	}
+	locker.unlock();
+
+	// Write data blocks first, then system blocks.
+	// The device is flushed after each step, so the system
+	// blocks can't reach the disk before the data blocks.
+	int ret = d->commitBlocks(blocks, false);
+	if (ret == 0) {
+		ret = d->syncDevice();
+	}
+	if (ret == 0) {
+		ret = d->commitBlocks(blocks, true);
+	}
+	if (ret == 0) {
+		ret = d->syncDevice();
+	}
+	if (ret != 0) {
+		// Error writing the blocks.
+		// Leave the transaction open so the caller
+		// can retry or roll back.
+		return ret;
+	}
+
+	// Clear the buffered blocks.
+	locker.relock();
+	d->txnDepth--;
+	d->txnBlocks.clear();
+	return 0;
+}
+
+/**
+ * Discard the current write transaction.
+ * This discards all buffered blocks, including
+ * blocks from enclosing transactions.
+ */
+void Card::rollback(void)
+{
+	Q_D(Card);
+	QMutexLocker locker(&d->ioMutex);
+	d->txnDepth = 0;
+	d->txnBlocks.clear();
+}
+
+/**
+ * Is a write transaction active?
+ * @return True if a write transaction is active; false if not.
+ */
+bool Card::inTransaction(void) const
+{
+	Q_D(const Card);
+	return (d->txnDepth > 0);
+}
+
+/** Block health **/
+
+/**
+ * Get the block health of every block on the card.
+ *
+ * Each block gets a histogram, entropy, and uniform-fill check.
+ * Blocks that can't be read are marked as unreadable.
+ * Blocks allocated to files are marked as used, along with
+ * the file's checksum status, if known.
+ *
+ * The blocks are analyzed in the background the first time,
+ * and the damage map is cached until the card is written to.
+ * blockHealthChanged() is emitted once the analysis is done.
+ *
+ * @return Damage map, indexed by physical block number;
+ * empty if the blocks haven't been analyzed yet.
+ */
+QVector<BlockHealth::Info> Card::blockHealth(void)
+{
+	if (!isOpen())
+		return QVector<BlockHealth::Info>();
+
+	Q_D(Card);
+	if (d->blockHealth.isEmpty()) {
+		// Analyze the block contents in the background.
+		d->startBlockHealthJob();
+		return QVector<BlockHealth::Info>();
+	}
+
+	// Update the file system information.
+	// This is done every time, since the file list
+	// and checksum definitions may have changed.
+	QVector<BlockHealth::Info> health = d->blockHealth;
+	static const uint8_t fsFlags = BlockHealth::BHF_USED |
+		BlockHealth::BHF_CHECKSUM_GOOD | BlockHealth::BHF_CHECKSUM_BAD;
+	for (int i = 0; i < health.size(); i++) {
+		health[i].flags &= ~fsFlags;
+	}
+
+	foreach (const File *file, d->lstFiles) {
+		if (file->isLostFile()) {
+			// Lost files aren't allocated.
+			continue;
+		}
+
+		uint8_t flags = BlockHealth::BHF_USED;
+		switch (file->checksumStatus()) {
+			case Checksum::CHKST_GOOD:
+				flags |= BlockHealth::BHF_CHECKSUM_GOOD;
+				break;
+			case Checksum::CHKST_INVALID:
+				flags |= BlockHealth::BHF_CHECKSUM_BAD;
+				break;
+			default:
+				break;
+		}
+
+		foreach (uint16_t block, file->fatEntries()) {
+			if (block < health.size()) {
+				health[block].flags |= flags;
+			}
+		}
+	}
+
+	return health;
 }
 
-// TODO: Add readBlocks() and writeBlocks() functions?
+/**
+ * Is the block health being analyzed in the background?
+ * @return True if the analysis is running; false if not.
+ */
+bool Card::isBlockHealthPending(void) const
+{
+	Q_D(const Card);
+	return !d->blockHealthJob.isNull();
+}
+
+/**
+ * The background block health job has finished.
+ */
+void Card::blockHealthJob_finished_slot(void)
+{
+	Q_D(Card);
+	if (d->collectBlockHealthJob()) {
+		emit blockHealthChanged();
+	}
+}
 
 /** File management **/
 
@@ -13,12 +13,19 @@
 #include <stdint.h>
 
 // Qt includes and classes.
+#include <QtCore/QByteArray>
 #include <QtCore/QDateTime>
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QTextCodec>
+#include <QtCore/QVector>
 #include <QtGui/QColor>
 
+// Block health analysis.
+#include "BlockHealth.hpp"
+// Block allocation map.
+#include "BlockMap.hpp"
+
 class File;
 
 class CardPrivate;
@@ -134,10 +141,24 @@ class Card : public QObject
 
 		/**
 		 * Get the memory card filename.
-		 * @return Memory card filename, or empty string if not open.
+		 * @return Memory card filename, or empty string if not open or in memory.
 		 */
 		QString filename(void) const;
 
+		/**
+		 * Is this card image stored in memory?
+		 * @return True if the card was opened from memory; false if not.
+		 */
+		bool isInMemory(void) const;
+
+		/**
+		 * Get the card image data for an in-memory card.
+		 * This includes any changes that have been written to the card.
+		 * The data is implicitly shared, so this doesn't copy the image.
+		 * @return Card image data, or empty QByteArray if not in memory.
+		 */
+		QByteArray imageData(void) const;
+
 		/**
 		 * Get the size of the memory card image, in bytes.
 		 * This is the full size of the memory card image.
@@ -183,6 +204,14 @@ class Card : public QObject
 		 */
 		int freeBlocks(void) const;
 
+		/**
+		 * Get the block allocation map.
+		 * NOTE: This is only valid for regular files, not "lost" files.
+		 * The map is implicitly shared, so this doesn't copy the bitsets.
+		 * @return Block allocation map.
+		 */
+		BlockMap blockMap(void) const;
+
 		/**
 		 * Text encoding enumeration.
 		 */
@@ -316,6 +345,88 @@ class Card : public QObject
 		 */
 		int writeBlock(const void *buf, int siz, uint16_t blockIdx);
 
+		/** Write transactions **/
+
+		/**
+		 * Begin a write transaction.
+		 * Blocks written with writeBlock() are buffered until
+		 * commit() is called, and readBlock() returns the
+		 * buffered data. Transactions can be nested; only the
+		 * outermost commit() writes to the device.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int beginTransaction(void);
+
+		/**
+		 * Commit the current write transaction.
+		 *
+		 * Data blocks are written first, then system blocks
+		 * (header, directory, block tables), with adjacent
+		 * blocks merged into a single write. The device is
+		 * flushed to stable storage after each of these steps,
+		 * so the system blocks are never written before the
+		 * data blocks they refer to are on disk.
+		 *
+		 * If an error occurs, the transaction is left open with
+		 * all of its buffered blocks. The caller can retry with
+		 * commit() or discard the blocks with rollback().
+		 *
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int commit(void);
+
+		/**
+		 * Discard the current write transaction.
+		 * This discards all buffered blocks, including
+		 * blocks from enclosing transactions.
+		 */
+		void rollback(void);
+
+		/**
+		 * Is a write transaction active?
+		 * @return True if a write transaction is active; false if not.
+		 */
+		bool inTransaction(void) const;
+
+		/** Block health **/
+
+		/**
+		 * Get the block health of every block on the card.
+		 *
+		 * Each block gets a histogram, entropy, and uniform-fill check.
+		 * Blocks that can't be read are marked as unreadable.
+		 * Blocks allocated to files are marked as used, along with
+		 * the file's checksum status, if known.
+		 *
+		 * The blocks are analyzed in the background the first time,
+		 * and the damage map is cached until the card is written to.
+		 * blockHealthChanged() is emitted once the analysis is done.
+		 *
+		 * @return Damage map, indexed by physical block number;
+		 * empty if the blocks haven't been analyzed yet.
+		 */
+		QVector<BlockHealth::Info> blockHealth(void);
+
+		/**
+		 * Is the block health being analyzed in the background?
+		 * @return True if the analysis is running; false if not.
+		 */
+		bool isBlockHealthPending(void) const;
+
+	signals:
+		/**
+		 * The block health has changed.
+		 * This is also emitted when a file's checksum status changes.
+		 * Call blockHealth() to get the new damage map.
+		 */
+		void blockHealthChanged(void);
+
+	private slots:
+		/**
+		 * The background block health job has finished.
+		 */
+		void blockHealthJob_finished_slot(void);
+
 		/** File management **/
 	signals:
 		/**
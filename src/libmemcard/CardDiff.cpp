@@ -0,0 +1,167 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * CardDiff.cpp: Compare two memory card images.                           *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "CardDiff.hpp"
+#include "Card.hpp"
+#include "File.hpp"
+
+// libgctools
+#include "BlockHealth.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+
+// Qt includes.
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+
+CardDiff::CardDiff()
+	: m_unchangedFiles(0)
+{ }
+
+/**
+ * Hash all blocks of a card.
+ * @param card Card.
+ * @return Block hashes, or empty QVector on error.
+ */
+QVector<uint64_t> CardDiff::hashBlocks(Card *card)
+{
+	const int blockSize = card->blockSize();
+	const int blockCount = card->totalPhysBlocks();
+
+	QVector<uint64_t> hashes(blockCount);
+	std::vector<uint8_t> block(blockSize);
+	for (int i = 0; i < blockCount; i++) {
+		if (card->readBlock(block.data(), blockSize, i) != blockSize)
+			return QVector<uint64_t>();
+		hashes[i] = BlockHealth::Hash(block.data(), blockSize);
+	}
+	return hashes;
+}
+
+/**
+ * Get the key used to match files between cards.
+ * @param file File.
+ * @return Key.
+ */
+static inline QString fileKey(const File *file)
+{
+	return file->gameID() + QChar(L'/') + file->filename();
+}
+
+/**
+ * Compare two cards.
+ * Both cards must have the same block size.
+ * @param cardA Original card.
+ * @param cardB New card.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int CardDiff::compare(Card *cardA, Card *cardB)
+{
+	m_files.clear();
+	m_changedBlocks.reset(0);
+	m_unchangedFiles = 0;
+
+	if (!cardA || !cardB || !cardA->isOpen() || !cardB->isOpen())
+		return -EINVAL;
+	if (cardA->blockSize() != cardB->blockSize())
+		return -EINVAL;
+
+	// Hash the blocks in both cards.
+	const QVector<uint64_t> hashesA = hashBlocks(cardA);
+	const QVector<uint64_t> hashesB = hashBlocks(cardB);
+	if (hashesA.isEmpty() || hashesB.isEmpty())
+		return -EIO;
+
+	// Physical block differences.
+	const int minBlocks = std::min(hashesA.size(), hashesB.size());
+	const int maxBlocks = std::max(hashesA.size(), hashesB.size());
+	m_changedBlocks.reset(maxBlocks);
+	for (int i = 0; i < minBlocks; i++) {
+		if (hashesA.at(i) != hashesB.at(i)) {
+			m_changedBlocks.markUsed(i);
+		}
+	}
+	m_changedBlocks.markUsed(minBlocks, maxBlocks - minBlocks);
+
+	// Index the files in card B.
+	const QVector<File*> filesA = cardA->getFiles(Card::FTYPE_NORMAL);
+	const QVector<File*> filesB = cardB->getFiles(Card::FTYPE_NORMAL);
+	QHash<QString, File*> indexB;
+	indexB.reserve(filesB.size());
+	foreach (File *fileB, filesB) {
+		indexB.insert(fileKey(fileB), fileB);
+	}
+
+	// Compare the files in card A to card B.
+	foreach (File *fileA, filesA) {
+		const QString key = fileKey(fileA);
+		File *const fileB = indexB.take(key);
+
+		FileDiff diff;
+		diff.gameID = fileA->gameID();
+		diff.filename = fileA->filename();
+		diff.fileA = fileA;
+		diff.fileB = fileB;
+		diff.moved = false;
+		diff.mtimeChanged = false;
+
+		if (!fileB) {
+			// File was removed.
+			diff.type = DIFF_REMOVED;
+			m_files.append(diff);
+			continue;
+		}
+
+		// Compare the FAT chains.
+		const QVector<uint16_t> fatA = fileA->fatEntries();
+		const QVector<uint16_t> fatB = fileB->fatEntries();
+		diff.moved = (fatA != fatB);
+		const int count = std::max(fatA.size(), fatB.size());
+		for (int i = 0; i < count; i++) {
+			if (i >= fatA.size() || i >= fatB.size() ||
+			    fatA.at(i) >= hashesA.size() || fatB.at(i) >= hashesB.size() ||
+			    hashesA.at(fatA.at(i)) != hashesB.at(fatB.at(i)))
+			{
+				diff.changedBlocks.append(i);
+			}
+		}
+		diff.mtimeChanged = (fileA->mtime() != fileB->mtime());
+
+		if (diff.changedBlocks.isEmpty() && !diff.mtimeChanged) {
+			// File is unchanged.
+			m_unchangedFiles++;
+			continue;
+		}
+
+		diff.type = DIFF_MODIFIED;
+		m_files.append(diff);
+	}
+
+	// Files remaining in card B were added.
+	foreach (File *fileB, filesB) {
+		if (!indexB.contains(fileKey(fileB)))
+			continue;
+
+		FileDiff diff;
+		diff.type = DIFF_ADDED;
+		diff.gameID = fileB->gameID();
+		diff.filename = fileB->filename();
+		diff.fileA = nullptr;
+		diff.fileB = fileB;
+		diff.moved = false;
+		diff.mtimeChanged = false;
+		m_files.append(diff);
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * CardDiff.hpp: Compare two memory card images.                           *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_CARDDIFF_HPP__
+#define __LIBMEMCARD_CARDDIFF_HPP__
+
+#include "BlockMap.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class Card;
+class File;
+
+/**
+ * Compare two memory card images.
+ *
+ * Each block in both images is hashed, and the files in
+ * both images are matched by game ID and filename. A file's
+ * contents are compared using the hashes of the blocks in
+ * its FAT chain, so files that were moved are not reported
+ * as modified unless their data changed.
+ *
+ * NOTE: Only normal files are compared; lost files are ignored.
+ */
+class CardDiff
+{
+	public:
+		CardDiff();
+
+	public:
+		/**
+		 * File difference type.
+		 */
+		enum DiffType {
+			DIFF_ADDED,	// File is only in card B.
+			DIFF_REMOVED,	// File is only in card A.
+			DIFF_MODIFIED,	// File data or timestamp changed.
+		};
+
+		/**
+		 * File difference.
+		 * File pointers are owned by the cards, and are only
+		 * valid while the cards are open.
+		 */
+		struct FileDiff {
+			DiffType type;
+			QString gameID;
+			QString filename;
+			File *fileA;			// nullptr if added
+			File *fileB;			// nullptr if removed
+			QVector<int> changedBlocks;	// File-relative blocks that changed. (modified only)
+			bool moved;			// File is stored in different physical blocks.
+			bool mtimeChanged;		// Last modified time changed.
+		};
+
+		/**
+		 * Compare two cards.
+		 * Both cards must have the same block size.
+		 * @param cardA Original card.
+		 * @param cardB New card.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int compare(Card *cardA, Card *cardB);
+
+		/**
+		 * Get the file differences.
+		 * Unchanged files are not included.
+		 * @return File differences.
+		 */
+		inline QVector<FileDiff> files(void) const
+		{
+			return m_files;
+		}
+
+		/**
+		 * Get the physical blocks that differ between the cards.
+		 * Blocks that are only present in the larger card
+		 * are marked as changed.
+		 * @return Block map. (used == changed)
+		 */
+		inline BlockMap changedBlocks(void) const
+		{
+			return m_changedBlocks;
+		}
+
+		/**
+		 * Get the number of files that are in both cards and unchanged.
+		 * @return Number of unchanged files.
+		 */
+		inline int unchangedFileCount(void) const
+		{
+			return m_unchangedFiles;
+		}
+
+	private:
+		/**
+		 * Hash all blocks of a card.
+		 * @param card Card.
+		 * @return Block hashes, or empty QVector on error.
+		 */
+		static QVector<uint64_t> hashBlocks(Card *card);
+
+	private:
+		QVector<FileDiff> m_files;
+		BlockMap m_changedBlocks;
+		int m_unchangedFiles;
+};
+
+#endif /* __LIBMEMCARD_CARDDIFF_HPP__ */
@@ -12,14 +12,47 @@
 #include "Card.hpp"
 
 // Qt includes.
-#include <QtCore/QFile>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QIODevice>
 #include <QtCore/QFlags>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
 #include <QtGui/QPixmap>
 
 class File;
 
+/**
+ * Background block health analysis job.
+ * Shared by a Card and its analysis task.
+ */
+struct BlockHealthJob
+{
+	explicit BlockHealthJob(Card *card)
+		: card(card)
+		, running(false)
+		, finished(false) { }
+
+	// Set before the task is started.
+	Card *const card;
+
+	// Set if the Card no longer needs the results.
+	QAtomicInt cancelled;
+
+	// Protected by mutex.
+	QMutex mutex;
+	QWaitCondition stopped;	// Signaled when the task stops running.
+	bool running;
+	bool finished;
+	QVector<BlockHealth::Info> health;
+
+	private:
+		Q_DISABLE_COPY(BlockHealthJob)
+};
+
 class CardPrivate
 {
 	public:
@@ -55,10 +88,11 @@ class CardPrivate
 
 		// File information.
 		QString filename;
-		QFile *file;
+		QIODevice *file;	// QFile, CompressedFile, or QBuffer
+		QMutex ioMutex;		// Serializes block I/O on file.
 		quint64 filesize;
 		bool readOnly;
-		bool canMakeWritable;	// subclass should set this
+		bool canMakeWritable;	// subclass should set this (cleared for compressed images)
 
 		// Card properties.
 		Card::Encoding encoding;
@@ -104,7 +138,80 @@ class CardPrivate
 		// Files.
 		QVector<File*> lstFiles;
 
-		// TODO: Move usedBlockMap here?
+		// Block health. (damage map)
+		// Built in the background by startBlockHealthJob(); cleared on write.
+		QVector<BlockHealth::Info> blockHealth;
+		QSharedPointer<BlockHealthJob> blockHealthJob;
+
+		/**
+		 * Analyze the card's blocks in the background.
+		 * Card::blockHealthChanged() is emitted when the job finishes.
+		 * Does nothing if the job is already running.
+		 */
+		void startBlockHealthJob(void);
+
+		/**
+		 * Cancel the background block health job, if any.
+		 * This waits for the task to stop reading the card.
+		 */
+		void cancelBlockHealthJob(void);
+
+		/**
+		 * Save the results of the background block health job.
+		 * @return True if the job has finished; false if not.
+		 */
+		bool collectBlockHealthJob(void);
+
+		/** Write transactions **/
+
+		// Transaction nesting depth. (0 == no transaction)
+		int txnDepth;
+		// Buffered blocks, keyed by block index.
+		// Protected by ioMutex.
+		QMap<uint16_t, QByteArray> txnBlocks;
+
+		/**
+		 * Is a block part of the file system metadata?
+		 * System blocks are written after data blocks when a
+		 * transaction is committed, and the device is flushed
+		 * in between, so an interrupted commit doesn't leave
+		 * the tables pointing to unwritten data.
+		 * @param blockIdx Block index.
+		 * @return True if this is a system block; false if not.
+		 */
+		virtual bool isSystemBlock(int blockIdx) const;
+
+		/**
+		 * Write consecutive blocks to the device.
+		 * @param blockIdx First block index.
+		 * @param buf Block data.
+		 * @param count Number of blocks.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int writeBlocks(int blockIdx, const char *buf, int count);
+
+		/**
+		 * Write buffered transaction blocks to the device.
+		 * Adjacent blocks are merged into a single write.
+		 * @param blocks Buffered blocks.
+		 * @param system If true, write system blocks; otherwise, write data blocks.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int commitBlocks(const QMap<uint16_t, QByteArray> &blocks, bool system);
+
+		/**
+		 * Flush the device to stable storage.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int syncDevice(void);
+
+		/**
+		 * Block allocation map.
+		 * NOTE: This is only valid for regular files, not "lost" files.
+		 * Blocks used by more than one file are marked as collisions.
+		 * Must be maintained by the subclass.
+		 */
+		BlockMap blockMap;
 
 		/**
 		 * Check if a number is a power of 2.
@@ -123,6 +230,8 @@ class CardPrivate
 		 * Open a Memory Card image.
 		 * totalPhysBlocks is initialized after the file is opened.
 		 * totalUserBlocks and freeBlocks must be initialized by the subclass.
+		 * gzip/zip-compressed images are opened using CompressedFile
+		 * if openMode is read-only.
 		 * @param filename Memory Card image filename.
 		 * @param openMode File open mode.
 		 * @return 0 on success; non-zero on error. (also check errorString)
@@ -130,6 +239,34 @@ class CardPrivate
 		 */
 		int open(const QString &filename, QIODevice::OpenModeFlag openMode);
 
+		/**
+		 * Open a Memory Card image from memory.
+		 * totalPhysBlocks is initialized after the buffer is opened.
+		 * totalUserBlocks and freeBlocks must be initialized by the subclass.
+		 *
+		 * The image data is implicitly shared with the caller, so opening
+		 * the card doesn't copy it. If the card is written to, the data is
+		 * detached first (copy-on-write); the caller's buffer is never modified.
+		 * Use QByteArray::fromRawData() to open a caller-owned buffer without
+		 * copying it. (The buffer must outlive the Card.)
+		 *
+		 * @param data Memory Card image data.
+		 * @param openMode Buffer open mode.
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int open(const QByteArray &data, QIODevice::OpenModeFlag openMode);
+
+	private:
+		/**
+		 * Initialize the card size information from an opened device.
+		 * Called by open() after the device has been opened.
+		 * @param device Opened device. (CardPrivate takes ownership.)
+		 * @param openMode Device open mode.
+		 */
+		void initDevice(QIODevice *device, QIODevice::OpenModeFlag openMode);
+
+	public:
+
 		/**
 		 * Close the currently-opened Memory Card image.
 		 * This will clear all cached file information.
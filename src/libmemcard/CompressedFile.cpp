@@ -0,0 +1,1034 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * CompressedFile.cpp: Random-access reader for gzip/zip card images.      *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+/**
+ * Random access is implemented using a checkpoint index,
+ * based on zran.c from the zlib examples:
+ * - The compressed stream is decompressed once to build the index.
+ *   Every SPAN bytes of uncompressed data, the inflate state
+ *   (bit offset and 32 KB dictionary) is saved.
+ * - Reads decompress the span starting at the closest preceding
+ *   checkpoint. The most recently used span is cached, so reading
+ *   blocks in any order within a span only decompresses it once.
+ * - The index is cached next to the compressed image so
+ *   subsequent opens don't have to decompress everything.
+ */
+
+#include "CompressedFile.hpp"
+#include "util/byteswap.h"
+
+// zlib
+#include <zlib.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+#include <QtCore/QVector>
+
+/** CompressedFilePrivate **/
+
+class CompressedFilePrivate
+{
+	public:
+		CompressedFilePrivate(CompressedFile *q, const QString &filename);
+		~CompressedFilePrivate();
+
+	protected:
+		CompressedFile *const q_ptr;
+		Q_DECLARE_PUBLIC(CompressedFile)
+	private:
+		Q_DISABLE_COPY(CompressedFilePrivate)
+
+	public:
+		// Distance between checkpoints, in uncompressed bytes.
+		static const qint64 SPAN = 262144;
+		// Size of the deflate dictionary.
+		static const int WINSIZE = 32768;
+		// Input buffer size.
+		static const int CHUNK = 16384;
+
+		// Index cache file magic and version.
+		static const quint32 INDEX_MAGIC = 0x495A434D;	// "MCZI"
+		static const quint32 INDEX_VERSION = 1;
+
+		enum class Format {
+			Unknown,
+			Gzip,		// gzip stream
+			ZipStored,	// zip member, no compression
+			ZipDeflate,	// zip member, deflate compression
+		};
+
+		QString filename;
+		QFile *file;	// Compressed file.
+		Format format;
+
+		qint64 dataOffset;	// Start of compressed data in the file.
+		qint64 dataSize;	// Size of compressed data.
+		qint64 uncompressedSize;
+
+		// Checkpoint.
+		struct AccessPoint {
+			qint64 out;		// Uncompressed offset.
+			qint64 in;		// Compressed offset. (absolute)
+			int bits;		// Number of bits from the byte at in-1. (0-7)
+			QByteArray window;	// Dictionary. (empty for the first checkpoint)
+		};
+		QVector<AccessPoint> index;
+
+		// Current inflate stream.
+		z_stream strm;
+		bool strmActive;
+		bool strmEnd;		// Z_STREAM_END was reached.
+		qint64 inPos;		// Absolute offset of the next input byte.
+		uint8_t inbuf[CHUNK];
+
+		// Decompressed span cache.
+		QByteArray spanCache;
+		int spanIdx;		// Checkpoint index of spanCache. (-1 if empty)
+
+		// Current read position.
+		qint64 pos;
+
+		/**
+		 * Detect the compression format from the file header.
+		 * @param hdr Header data. (at least 4 bytes)
+		 * @param len Length of hdr.
+		 * @return Format.
+		 */
+		static Format detectFormat(const uint8_t *hdr, qint64 len);
+
+		/**
+		 * Locate the first usable zip member.
+		 * Sets dataOffset, dataSize, uncompressedSize, and format.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int parseZip(void);
+
+		/**
+		 * Open the compressed file and locate the compressed data.
+		 * Sets file, format, dataOffset, dataSize, and uncompressedSize.
+		 * The seek index is not loaded.
+		 *
+		 * NOTE: For gzip, uncompressedSize is taken from the
+		 * ISIZE trailer, which is the size modulo 2^32.
+		 * buildIndex() and loadIndex() set the actual size.
+		 *
+		 * @return 0 on success; non-zero on error.
+		 */
+		int openSource(void);
+
+		/**
+		 * Close the compressed file.
+		 */
+		void closeSource(void);
+
+		/**
+		 * Load the seek index from the cache file.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int loadIndex(void);
+
+		/**
+		 * Save the seek index to the cache file.
+		 * Failure is not fatal; the index will be rebuilt next time.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int saveIndex(void) const;
+
+		/**
+		 * Build the seek index by decompressing the entire stream.
+		 * Sets uncompressedSize.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int buildIndex(void);
+
+		/**
+		 * Reset the inflate stream to a checkpoint.
+		 * @param pt Checkpoint.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int resetStream(const AccessPoint &pt);
+
+		/**
+		 * Start an inflate stream at the beginning of the compressed data.
+		 * This doesn't require the seek index.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int startStream(void);
+
+		/**
+		 * End the current inflate stream.
+		 */
+		void endStream(void);
+
+		/**
+		 * Decompress data from the current inflate stream.
+		 * @param out Output buffer.
+		 * @param len Number of bytes to decompress.
+		 * @return Number of bytes decompressed, or -1 on error.
+		 */
+		qint64 inflateTo(uint8_t *out, qint64 len);
+
+		/**
+		 * Load a span into the span cache.
+		 * @param idx Checkpoint index.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int loadSpan(int idx);
+
+		/**
+		 * Read uncompressed data from the current position.
+		 * @param data Output buffer.
+		 * @param maxlen Maximum number of bytes to read.
+		 * @return Number of bytes read, or -1 on error.
+		 */
+		qint64 read(char *data, qint64 maxlen);
+
+		/**
+		 * Get the source file's timestamp for index validation.
+		 * @return Timestamp, in milliseconds since the Unix epoch.
+		 */
+		qint64 sourceMTime(void) const;
+};
+
+CompressedFilePrivate::CompressedFilePrivate(CompressedFile *q, const QString &filename)
+	: q_ptr(q)
+	, filename(filename)
+	, file(nullptr)
+	, format(Format::Unknown)
+	, dataOffset(0)
+	, dataSize(0)
+	, uncompressedSize(0)
+	, strmActive(false)
+	, strmEnd(false)
+	, inPos(0)
+	, spanIdx(-1)
+	, pos(0)
+{
+	memset(&strm, 0, sizeof(strm));
+}
+
+CompressedFilePrivate::~CompressedFilePrivate()
+{
+	endStream();
+	delete file;
+}
+
+/**
+ * Detect the compression format from the file header.
+ * @param hdr Header data. (at least 4 bytes)
+ * @param len Length of hdr.
+ * @return Format.
+ */
+CompressedFilePrivate::Format CompressedFilePrivate::detectFormat(const uint8_t *hdr, qint64 len)
+{
+	if (len < 4)
+		return Format::Unknown;
+
+	if (hdr[0] == 0x1F && hdr[1] == 0x8B && hdr[2] == 8) {
+		// gzip, deflate compression.
+		return Format::Gzip;
+	} else if (hdr[0] == 'P' && hdr[1] == 'K' && hdr[2] == 3 && hdr[3] == 4) {
+		// zip local file header.
+		// The actual compression method is determined by parseZip().
+		return Format::ZipDeflate;
+	}
+
+	return Format::Unknown;
+}
+
+/**
+ * Locate the first usable zip member.
+ * Sets dataOffset, dataSize, uncompressedSize, and format.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::parseZip(void)
+{
+	// Find the End of Central Directory record.
+	// It's 22 bytes, plus an optional comment of up to 65535 bytes.
+	const qint64 fileSize = file->size();
+	const qint64 tailSize = qMin(fileSize, (qint64)(65535 + 22));
+	if (tailSize < 22 || !file->seek(fileSize - tailSize))
+		return -1;
+	const QByteArray tail = file->read(tailSize);
+	if (tail.size() != tailSize)
+		return -1;
+
+	const uint8_t *const t = reinterpret_cast<const uint8_t*>(tail.constData());
+	int eocd = -1;
+	for (int i = (int)tailSize - 22; i >= 0; i--) {
+		if (t[i] == 'P' && t[i+1] == 'K' && t[i+2] == 5 && t[i+3] == 6) {
+			eocd = i;
+			break;
+		}
+	}
+	if (eocd < 0)
+		return -1;
+
+	uint16_t u16;
+	uint32_t u32;
+	memcpy(&u16, &t[eocd+10], sizeof(u16));
+	const int entries = le16_to_cpu(u16);
+	memcpy(&u32, &t[eocd+12], sizeof(u32));
+	const uint32_t cdSize = le32_to_cpu(u32);
+	memcpy(&u32, &t[eocd+16], sizeof(u32));
+	const uint32_t cdOffset = le32_to_cpu(u32);
+	if (cdOffset == 0xFFFFFFFFU || (qint64)cdOffset + cdSize > fileSize) {
+		// ZIP64 is not supported.
+		return -1;
+	}
+
+	// Read the central directory.
+	if (!file->seek(cdOffset))
+		return -1;
+	const QByteArray cd = file->read(cdSize);
+	if (cd.size() != (int)cdSize)
+		return -1;
+
+	// Find the first non-directory member that's either
+	// stored or deflated and isn't encrypted.
+	const uint8_t *p = reinterpret_cast<const uint8_t*>(cd.constData());
+	const uint8_t *const p_end = p + cd.size();
+	for (int i = 0; i < entries && (p_end - p) >= 46; i++) {
+		if (p[0] != 'P' || p[1] != 'K' || p[2] != 1 || p[3] != 2)
+			return -1;
+
+		memcpy(&u16, &p[8], sizeof(u16));
+		const uint16_t flags = le16_to_cpu(u16);
+		memcpy(&u16, &p[10], sizeof(u16));
+		const uint16_t method = le16_to_cpu(u16);
+		memcpy(&u32, &p[20], sizeof(u32));
+		const uint32_t csize = le32_to_cpu(u32);
+		memcpy(&u32, &p[24], sizeof(u32));
+		const uint32_t usize = le32_to_cpu(u32);
+		memcpy(&u16, &p[28], sizeof(u16));
+		const int nlen = le16_to_cpu(u16);
+		memcpy(&u16, &p[30], sizeof(u16));
+		const int elen = le16_to_cpu(u16);
+		memcpy(&u16, &p[32], sizeof(u16));
+		const int clen = le16_to_cpu(u16);
+		memcpy(&u32, &p[42], sizeof(u32));
+		const uint32_t lho = le32_to_cpu(u32);
+
+		const bool isDir = (nlen > 0 && (p_end - p) >= 46 + nlen && p[46 + nlen - 1] == '/');
+		p += 46 + nlen + elen + clen;
+
+		if (isDir || (flags & 1) || (method != 0 && method != 8))
+			continue;
+		if (csize == 0xFFFFFFFFU || usize == 0xFFFFFFFFU || lho == 0xFFFFFFFFU)
+			continue;
+
+		// Found a usable member. Check its local file header.
+		uint8_t lfh[30];
+		if (!file->seek(lho) || file->read((char*)lfh, sizeof(lfh)) != (qint64)sizeof(lfh))
+			return -1;
+		if (lfh[0] != 'P' || lfh[1] != 'K' || lfh[2] != 3 || lfh[3] != 4)
+			return -1;
+		memcpy(&u16, &lfh[26], sizeof(u16));
+		const int lnlen = le16_to_cpu(u16);
+		memcpy(&u16, &lfh[28], sizeof(u16));
+		const int lelen = le16_to_cpu(u16);
+
+		dataOffset = (qint64)lho + sizeof(lfh) + lnlen + lelen;
+		dataSize = csize;
+		uncompressedSize = usize;
+		format = (method == 0 ? Format::ZipStored : Format::ZipDeflate);
+		if (dataOffset + dataSize > fileSize)
+			return -1;
+		return 0;
+	}
+
+	// No usable members.
+	return -1;
+}
+
+/**
+ * Open the compressed file and locate the compressed data.
+ * Sets file, format, dataOffset, dataSize, and uncompressedSize.
+ * The seek index is not loaded.
+ *
+ * NOTE: For gzip, uncompressedSize is taken from the
+ * ISIZE trailer, which is the size modulo 2^32.
+ * buildIndex() and loadIndex() set the actual size.
+ *
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::openSource(void)
+{
+	assert(file == nullptr);
+	file = new QFile(filename);
+	if (!file->open(QIODevice::ReadOnly))
+		return -1;
+
+	// Check the compression format.
+	uint8_t hdr[4];
+	const qint64 sz = file->read((char*)hdr, sizeof(hdr));
+	format = detectFormat(hdr, sz);
+	switch (format) {
+		case Format::Gzip: {
+			// ISIZE is stored in the last 4 bytes.
+			const qint64 fileSize = file->size();
+			uint32_t isize;
+			if (fileSize < 18 || !file->seek(fileSize - 4) ||
+			    file->read((char*)&isize, sizeof(isize)) != (qint64)sizeof(isize))
+			{
+				return -1;
+			}
+			dataOffset = 0;
+			dataSize = fileSize;
+			uncompressedSize = le32_to_cpu(isize);
+			return 0;
+		}
+
+		case Format::ZipDeflate:
+			return parseZip();
+
+		default:
+			break;
+	}
+
+	return -1;
+}
+
+/**
+ * Close the compressed file.
+ */
+void CompressedFilePrivate::closeSource(void)
+{
+	endStream();
+	delete file;
+	file = nullptr;
+	format = Format::Unknown;
+}
+
+/**
+ * Get the source file's timestamp for index validation.
+ * @return Timestamp, in milliseconds since the Unix epoch.
+ */
+qint64 CompressedFilePrivate::sourceMTime(void) const
+{
+	return QFileInfo(filename).lastModified().toMSecsSinceEpoch();
+}
+
+/**
+ * Load the seek index from the cache file.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::loadIndex(void)
+{
+	QFile idxFile(CompressedFile::indexFileName(filename));
+	if (!idxFile.open(QIODevice::ReadOnly))
+		return -1;
+
+	QDataStream ds(&idxFile);
+	ds.setByteOrder(QDataStream::LittleEndian);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version, count;
+	qint64 srcSize, srcMTime, srcDataOffset, srcUncompressedSize;
+	ds >> magic >> version >> srcSize >> srcMTime >> srcDataOffset >> srcUncompressedSize >> count;
+	if (ds.status() != QDataStream::Ok ||
+	    magic != INDEX_MAGIC || version != INDEX_VERSION ||
+	    srcSize != file->size() || srcMTime != sourceMTime() ||
+	    srcDataOffset != dataOffset || srcUncompressedSize < 0 ||
+	    count == 0 || count > (quint32)(srcUncompressedSize / SPAN) + 2)
+	{
+		// Index doesn't match this file.
+		return -1;
+	}
+
+	QVector<AccessPoint> tmpIndex;
+	tmpIndex.reserve(count);
+	for (quint32 i = 0; i < count; i++) {
+		AccessPoint pt;
+		qint32 bits;
+		ds >> pt.out >> pt.in >> bits >> pt.window;
+		pt.bits = bits;
+		if (!pt.window.isEmpty()) {
+			pt.window = qUncompress(pt.window);
+		}
+		if (ds.status() != QDataStream::Ok ||
+		    pt.bits < 0 || pt.bits > 7 ||
+		    pt.in < dataOffset || pt.in > dataOffset + dataSize ||
+		    (!tmpIndex.isEmpty() && pt.out <= tmpIndex.last().out) ||
+		    (!pt.window.isEmpty() && pt.window.size() != WINSIZE))
+		{
+			return -1;
+		}
+		tmpIndex.append(pt);
+	}
+
+	if (tmpIndex.first().out != 0)
+		return -1;
+
+	index = tmpIndex;
+	uncompressedSize = srcUncompressedSize;
+	return 0;
+}
+
+/**
+ * Save the seek index to the cache file.
+ * Failure is not fatal; the index will be rebuilt next time.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::saveIndex(void) const
+{
+	// NOTE: QSaveFile prevents a partially-written index
+	// from being used if something goes wrong.
+	QSaveFile idxFile(CompressedFile::indexFileName(filename));
+	if (!idxFile.open(QIODevice::WriteOnly))
+		return -1;
+
+	QDataStream ds(&idxFile);
+	ds.setByteOrder(QDataStream::LittleEndian);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	ds << INDEX_MAGIC << INDEX_VERSION << file->size() << sourceMTime()
+	   << dataOffset << uncompressedSize << (quint32)index.size();
+	foreach (const AccessPoint &pt, index) {
+		// NOTE: Dictionaries are compressed to reduce the index size.
+		ds << pt.out << pt.in << (qint32)pt.bits
+		   << (pt.window.isEmpty() ? pt.window : qCompress(pt.window));
+	}
+
+	if (ds.status() != QDataStream::Ok)
+		return -1;
+	return (idxFile.commit() ? 0 : -1);
+}
+
+/**
+ * Build the seek index by decompressing the entire stream.
+ * Sets uncompressedSize.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::buildIndex(void)
+{
+	index.clear();
+
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	// gzip: Automatic header detection. (windowBits 15 + 32)
+	// zip: Raw deflate. (windowBits -15)
+	if (inflateInit2(&zs, (format == Format::Gzip ? 47 : -15)) != Z_OK)
+		return -1;
+
+	if (format != Format::Gzip) {
+		// Raw deflate streams don't have a header,
+		// so the stream start is the first checkpoint.
+		AccessPoint pt;
+		pt.out = 0;
+		pt.in = dataOffset;
+		pt.bits = 0;
+		index.append(pt);
+	}
+
+	if (!file->seek(dataOffset)) {
+		inflateEnd(&zs);
+		return -1;
+	}
+
+	QByteArray window(WINSIZE, 0);
+	uint8_t *const win = reinterpret_cast<uint8_t*>(window.data());
+	qint64 totin = 0, totout = 0, last = 0;
+	qint64 remain = dataSize;
+	int ret = Z_OK;
+
+	zs.avail_out = 0;
+	do {
+		// Read more input.
+		const qint64 toRead = qMin(remain, (qint64)CHUNK);
+		const qint64 n = (toRead > 0 ? file->read((char*)inbuf, toRead) : 0);
+		if (n <= 0) {
+			// Premature end of file.
+			ret = Z_DATA_ERROR;
+			break;
+		}
+		remain -= n;
+		zs.avail_in = (uInt)n;
+		zs.next_in = inbuf;
+
+		// Process the input data.
+		do {
+			if (zs.avail_out == 0) {
+				zs.avail_out = WINSIZE;
+				zs.next_out = win;
+			}
+
+			// Stop at the end of each deflate block
+			// to check for checkpoint locations.
+			totin += zs.avail_in;
+			totout += zs.avail_out;
+			ret = inflate(&zs, Z_BLOCK);
+			totin -= zs.avail_in;
+			totout -= zs.avail_out;
+			if (ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR || ret == Z_STREAM_ERROR)
+				break;
+			if (ret == Z_STREAM_END)
+				break;
+
+			// Add a checkpoint if we're at the end of a block,
+			// it isn't the last block, and either this is the
+			// first checkpoint or we're past the span.
+			if ((zs.data_type & 128) && !(zs.data_type & 64) &&
+			    (index.isEmpty() || totout - last > SPAN))
+			{
+				AccessPoint pt;
+				pt.out = totout;
+				pt.in = dataOffset + totin;
+				pt.bits = zs.data_type & 7;
+				if (totout > 0) {
+					// Save the dictionary, oldest byte first.
+					const int left = zs.avail_out;
+					pt.window.resize(WINSIZE);
+					uint8_t *const dst = reinterpret_cast<uint8_t*>(pt.window.data());
+					if (left > 0) {
+						memcpy(dst, win + WINSIZE - left, left);
+					}
+					memcpy(dst + left, win, WINSIZE - left);
+				}
+				index.append(pt);
+				last = totout;
+			}
+
+			// NOTE: Raw deflate streams don't have a trailer, so inflate()
+			// may need to be called again after all input is consumed
+			// in order to get Z_STREAM_END.
+		} while (zs.avail_in != 0 || (remain == 0 && ret != Z_BUF_ERROR));
+	} while (ret != Z_STREAM_END && ret != Z_MEM_ERROR &&
+		 ret != Z_DATA_ERROR && ret != Z_STREAM_ERROR);
+
+	inflateEnd(&zs);
+	if (ret != Z_STREAM_END || index.isEmpty()) {
+		index.clear();
+		return -1;
+	}
+
+	if (format == Format::ZipDeflate && totout != uncompressedSize) {
+		// Size doesn't match the zip central directory.
+		index.clear();
+		return -1;
+	}
+
+	uncompressedSize = totout;
+	return 0;
+}
+
+/**
+ * End the current inflate stream.
+ */
+void CompressedFilePrivate::endStream(void)
+{
+	if (strmActive) {
+		inflateEnd(&strm);
+		strmActive = false;
+	}
+	strmEnd = false;
+}
+
+/**
+ * Start an inflate stream at the beginning of the compressed data.
+ * This doesn't require the seek index.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::startStream(void)
+{
+	endStream();
+
+	memset(&strm, 0, sizeof(strm));
+	// gzip: Automatic header detection. (windowBits 15 + 32)
+	// zip: Raw deflate. (windowBits -15)
+	if (inflateInit2(&strm, (format == Format::Gzip ? 47 : -15)) != Z_OK)
+		return -1;
+	strmActive = true;
+	inPos = dataOffset;
+	return 0;
+}
+
+/**
+ * Reset the inflate stream to a checkpoint.
+ * @param pt Checkpoint.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::resetStream(const AccessPoint &pt)
+{
+	endStream();
+
+	memset(&strm, 0, sizeof(strm));
+	if (inflateInit2(&strm, -15) != Z_OK)
+		return -1;
+	strmActive = true;
+
+	inPos = pt.in;
+	if (pt.bits) {
+		// Prime the stream with the remaining bits
+		// from the byte before the checkpoint.
+		uint8_t prev;
+		if (!file->seek(pt.in - 1) || file->read((char*)&prev, 1) != 1) {
+			endStream();
+			return -1;
+		}
+		inflatePrime(&strm, pt.bits, prev >> (8 - pt.bits));
+	}
+	if (!pt.window.isEmpty()) {
+		inflateSetDictionary(&strm,
+			reinterpret_cast<const Bytef*>(pt.window.constData()), WINSIZE);
+	}
+
+	return 0;
+}
+
+/**
+ * Decompress data from the current inflate stream.
+ * @param out Output buffer.
+ * @param len Number of bytes to decompress.
+ * @return Number of bytes decompressed, or -1 on error.
+ */
+qint64 CompressedFilePrivate::inflateTo(uint8_t *out, qint64 len)
+{
+	qint64 total = 0;
+
+	while (total < len && !strmEnd) {
+		const qint64 want = qMin(len - total, (qint64)0x40000000);
+		strm.next_out = out + total;
+		strm.avail_out = (uInt)want;
+
+		while (strm.avail_out != 0) {
+			if (strm.avail_in == 0) {
+				// Read more input.
+				const qint64 remain = (dataOffset + dataSize) - inPos;
+				const qint64 toRead = qMin(remain, (qint64)CHUNK);
+				if (toRead <= 0 || !file->seek(inPos))
+					break;
+				const qint64 n = file->read((char*)inbuf, toRead);
+				if (n <= 0)
+					break;
+				inPos += n;
+				strm.avail_in = (uInt)n;
+				strm.next_in = inbuf;
+			}
+
+			int ret = inflate(&strm, Z_NO_FLUSH);
+			if (ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+			if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR || ret == Z_STREAM_ERROR) {
+				return -1;
+			} else if (ret == Z_STREAM_END) {
+				strmEnd = true;
+				break;
+			}
+		}
+
+		const qint64 got = want - strm.avail_out;
+		total += got;
+		if (got < want) {
+			// End of data.
+			break;
+		}
+	}
+
+	return total;
+}
+
+/**
+ * Load a span into the span cache.
+ * @param idx Checkpoint index.
+ * @return 0 on success; non-zero on error.
+ */
+int CompressedFilePrivate::loadSpan(int idx)
+{
+	if (idx == spanIdx)
+		return 0;
+
+	const AccessPoint &pt = index.at(idx);
+	const qint64 end = (idx + 1 < index.size()
+		? index.at(idx + 1).out
+		: uncompressedSize);
+	const qint64 len = end - pt.out;
+	if (len <= 0 || len > 0x40000000)
+		return -1;
+
+	spanIdx = -1;
+	if (resetStream(pt) != 0)
+		return -1;
+	spanCache.resize((int)len);
+	const qint64 ret = inflateTo(reinterpret_cast<uint8_t*>(spanCache.data()), len);
+	endStream();
+	if (ret != len) {
+		spanCache.clear();
+		return -1;
+	}
+
+	spanIdx = idx;
+	return 0;
+}
+
+/**
+ * Read uncompressed data from the current position.
+ * @param data Output buffer.
+ * @param maxlen Maximum number of bytes to read.
+ * @return Number of bytes read, or -1 on error.
+ */
+qint64 CompressedFilePrivate::read(char *data, qint64 maxlen)
+{
+	if (pos >= uncompressedSize || maxlen <= 0)
+		return 0;
+	maxlen = qMin(maxlen, uncompressedSize - pos);
+
+	if (format == Format::ZipStored) {
+		// No compression.
+		if (!file->seek(dataOffset + pos))
+			return -1;
+		const qint64 ret = file->read(data, maxlen);
+		if (ret > 0)
+			pos += ret;
+		return ret;
+	}
+
+	// Copy data from each span that overlaps the requested range.
+	qint64 total = 0;
+	while (total < maxlen) {
+		// Find the closest checkpoint before pos.
+		int idx = index.size() - 1;
+		while (idx > 0 && index.at(idx).out > pos) {
+			idx--;
+		}
+		if (loadSpan(idx) != 0)
+			return (total > 0 ? total : -1);
+
+		const qint64 spanPos = pos - index.at(idx).out;
+		const qint64 n = qMin(maxlen - total, (qint64)spanCache.size() - spanPos);
+		memcpy(data + total, spanCache.constData() + spanPos, n);
+		total += n;
+		pos += n;
+	}
+
+	return total;
+}
+
+/** CompressedFile **/
+
+CompressedFile::CompressedFile(const QString &filename, QObject *parent)
+	: super(parent)
+	, d_ptr(new CompressedFilePrivate(this, filename))
+{ }
+
+CompressedFile::~CompressedFile()
+{
+	close();
+	delete d_ptr;
+}
+
+/**
+ * Check if a file is a supported compressed image.
+ * This checks the file's magic number, not the extension.
+ * @param filename Filename.
+ * @return True if the file is gzip- or zip-compressed.
+ */
+bool CompressedFile::isCompressed(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+
+	uint8_t hdr[4];
+	const qint64 sz = file.read((char*)hdr, sizeof(hdr));
+	return (CompressedFilePrivate::detectFormat(hdr, sz) !=
+		CompressedFilePrivate::Format::Unknown);
+}
+
+/**
+ * Get the uncompressed size of a compressed image without opening it.
+ * The size is read from the gzip trailer or the zip central directory,
+ * so nothing is decompressed and the seek index isn't built.
+ * @param filename Filename.
+ * @return Uncompressed size, or -1 on error.
+ */
+qint64 CompressedFile::uncompressedSize(const QString &filename)
+{
+	CompressedFilePrivate d(nullptr, filename);
+	if (d.openSource() != 0)
+		return -1;
+	return d.uncompressedSize;
+}
+
+/**
+ * Read the beginning of a compressed image without opening it.
+ * The data is decompressed sequentially, so the seek index isn't built.
+ * Use this to check the image type before opening the image.
+ * @param filename Filename.
+ * @param len Number of bytes to read.
+ * @return Uncompressed data. (may be shorter than len; empty on error)
+ */
+QByteArray CompressedFile::readHead(const QString &filename, qint64 len)
+{
+	CompressedFilePrivate d(nullptr, filename);
+	if (len <= 0 || len > 0x40000000 || d.openSource() != 0)
+		return QByteArray();
+
+	QByteArray data((int)len, 0);
+	qint64 ret;
+	if (d.format == CompressedFilePrivate::Format::ZipStored) {
+		// No compression.
+		len = qMin(len, d.uncompressedSize);
+		ret = (d.file->seek(d.dataOffset) ? d.file->read(data.data(), len) : -1);
+	} else {
+		ret = (d.startStream() == 0
+			? d.inflateTo(reinterpret_cast<uint8_t*>(data.data()), len)
+			: -1);
+	}
+
+	if (ret <= 0)
+		return QByteArray();
+	data.resize((int)ret);
+	return data;
+}
+
+/**
+ * Get the compressed file's filename.
+ * @return Filename.
+ */
+QString CompressedFile::fileName(void) const
+{
+	Q_D(const CompressedFile);
+	return d->filename;
+}
+
+/**
+ * Get the filename of the seek index cache.
+ * The index is stored next to the compressed image.
+ * @param filename Compressed image filename.
+ * @return Seek index cache filename.
+ */
+QString CompressedFile::indexFileName(const QString &filename)
+{
+	return filename + QLatin1String(".mcidx");
+}
+
+/**
+ * Open the compressed file.
+ * Only read-only access is supported.
+ * The seek index is loaded from the cache if possible;
+ * otherwise, it's built and saved to the cache.
+ * @param mode Open mode.
+ * @return True on success; false on error.
+ */
+bool CompressedFile::open(OpenMode mode)
+{
+	Q_D(CompressedFile);
+	if (isOpen()) {
+		// TODO: Translate the error message.
+		setErrorString(QLatin1String("File is already open"));
+		return false;
+	}
+	if (mode & QIODevice::WriteOnly) {
+		// Writing to compressed files isn't supported.
+		// TODO: Translate the error message.
+		setErrorString(QLatin1String("Compressed images cannot be opened for writing"));
+		return false;
+	}
+
+	int ret = d->openSource();
+	if (ret == 0 && d->format != CompressedFilePrivate::Format::ZipStored) {
+		// Load or build the seek index.
+		ret = d->loadIndex();
+		if (ret != 0) {
+			ret = d->buildIndex();
+			if (ret == 0) {
+				d->saveIndex();
+			}
+		}
+	}
+
+	if (ret != 0) {
+		// TODO: Translate the error message.
+		setErrorString(QLatin1String("Compressed image is invalid or unsupported"));
+		d->closeSource();
+		d->index.clear();
+		return false;
+	}
+
+	d->pos = 0;
+	// NOTE: Unbuffered, since reads are already
+	// buffered by the inflate stream.
+	return super::open(mode | QIODevice::Unbuffered);
+}
+
+/**
+ * Close the compressed file.
+ */
+void CompressedFile::close(void)
+{
+	Q_D(CompressedFile);
+	if (!isOpen())
+		return;
+
+	super::close();
+	d->closeSource();
+	d->index.clear();
+	d->spanCache.clear();
+	d->spanIdx = -1;
+	d->uncompressedSize = 0;
+	d->pos = 0;
+}
+
+/**
+ * Compressed files support random access using the seek index.
+ * @return False.
+ */
+bool CompressedFile::isSequential(void) const
+{
+	return false;
+}
+
+/**
+ * Get the uncompressed size.
+ * @return Uncompressed size, in bytes.
+ */
+qint64 CompressedFile::size(void) const
+{
+	Q_D(const CompressedFile);
+	return d->uncompressedSize;
+}
+
+/**
+ * Seek to a position in the uncompressed data.
+ * @param pos Position.
+ * @return True on success; false on error.
+ */
+bool CompressedFile::seek(qint64 pos)
+{
+	Q_D(CompressedFile);
+	if (pos < 0 || pos > d->uncompressedSize)
+		return false;
+	if (!super::seek(pos))
+		return false;
+	d->pos = pos;
+	return true;
+}
+
+qint64 CompressedFile::readData(char *data, qint64 maxlen)
+{
+	Q_D(CompressedFile);
+	return d->read(data, maxlen);
+}
+
+qint64 CompressedFile::writeData(const char *data, qint64 len)
+{
+	Q_UNUSED(data)
+	Q_UNUSED(len)
+	return -1;
+}
@@ -0,0 +1,117 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * CompressedFile.hpp: Random-access reader for gzip/zip card images.      *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_COMPRESSEDFILE_HPP__
+#define __LIBMEMCARD_COMPRESSEDFILE_HPP__
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QString>
+
+class CompressedFilePrivate;
+class CompressedFile : public QIODevice
+{
+	Q_OBJECT
+	typedef QIODevice super;
+
+	public:
+		explicit CompressedFile(const QString &filename, QObject *parent = 0);
+		virtual ~CompressedFile();
+
+	protected:
+		CompressedFilePrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(CompressedFile)
+	private:
+		Q_DISABLE_COPY(CompressedFile)
+
+	public:
+		/**
+		 * Check if a file is a supported compressed image.
+		 * This checks the file's magic number, not the extension.
+		 * @param filename Filename.
+		 * @return True if the file is gzip- or zip-compressed.
+		 */
+		static bool isCompressed(const QString &filename);
+
+		/**
+		 * Get the uncompressed size of a compressed image without opening it.
+		 * The size is read from the gzip trailer or the zip central directory,
+		 * so nothing is decompressed and the seek index isn't built.
+		 * @param filename Filename.
+		 * @return Uncompressed size, or -1 on error.
+		 */
+		static qint64 uncompressedSize(const QString &filename);
+
+		/**
+		 * Read the beginning of a compressed image without opening it.
+		 * The data is decompressed sequentially, so the seek index isn't built.
+		 * Use this to check the image type before opening the image.
+		 * @param filename Filename.
+		 * @param len Number of bytes to read.
+		 * @return Uncompressed data. (may be shorter than len; empty on error)
+		 */
+		static QByteArray readHead(const QString &filename, qint64 len);
+
+		/**
+		 * Get the compressed file's filename.
+		 * @return Filename.
+		 */
+		QString fileName(void) const;
+
+		/**
+		 * Get the filename of the seek index cache.
+		 * The index is stored next to the compressed image.
+		 * @param filename Compressed image filename.
+		 * @return Seek index cache filename.
+		 */
+		static QString indexFileName(const QString &filename);
+
+	public:
+		/** QIODevice functions. **/
+
+		/**
+		 * Open the compressed file.
+		 * Only read-only access is supported.
+		 * The seek index is loaded from the cache if possible;
+		 * otherwise, it's built and saved to the cache.
+		 * @param mode Open mode.
+		 * @return True on success; false on error.
+		 */
+		bool open(OpenMode mode) final;
+
+		/**
+		 * Close the compressed file.
+		 */
+		void close(void) final;
+
+		/**
+		 * Compressed files support random access using the seek index.
+		 * @return False.
+		 */
+		bool isSequential(void) const final;
+
+		/**
+		 * Get the uncompressed size.
+		 * @return Uncompressed size, in bytes.
+		 */
+		qint64 size(void) const final;
+
+		/**
+		 * Seek to a position in the uncompressed data.
+		 * @param pos Position.
+		 * @return True on success; false on error.
+		 */
+		bool seek(qint64 pos) final;
+
+	protected:
+		qint64 readData(char *data, qint64 maxlen) final;
+		qint64 writeData(const char *data, qint64 len) final;
+};
+
+#endif /* __LIBMEMCARD_COMPRESSEDFILE_HPP__ */
@@ -0,0 +1,402 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * DumpConsensus.cpp: Build a consensus image from multiple dumps.         *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "DumpConsensus.hpp"
+
+// libgctools
+#include "BlockHealth.hpp"
+#include "Checksum.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+#include <vector>
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+/**
+ * Read a big-endian 16-bit value.
+ * @param p Pointer to the value.
+ * @return Value.
+ */
+static inline uint16_t readBE16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * Check if a GameCube system block has a valid checksum.
+ * @param blockIdx Block index.
+ * @param buf Block data. (8 KB)
+ * @return True if this is a system block with a valid checksum; false if not.
+ */
+static bool isGcnChecksumGood(int blockIdx, const uint8_t *buf)
+{
+	uint32_t actual, expected;
+	switch (blockIdx) {
+		case 0:
+			// Header.
+			actual = Checksum::AddInvDual16(
+				reinterpret_cast<const uint16_t*>(buf), 0x1FC,
+				Checksum::CHKENDIAN_BIG);
+			expected = (readBE16(&buf[0x1FC]) << 16) | readBE16(&buf[0x1FE]);
+			break;
+		case 1: case 2:
+			// Directory tables.
+			actual = Checksum::AddInvDual16(
+				reinterpret_cast<const uint16_t*>(buf), 0x1FFC,
+				Checksum::CHKENDIAN_BIG);
+			expected = (readBE16(&buf[0x1FFC]) << 16) | readBE16(&buf[0x1FFE]);
+			break;
+		case 3: case 4:
+			// Block tables.
+			actual = Checksum::AddInvDual16(
+				reinterpret_cast<const uint16_t*>(buf) + 2, 0x1FFC,
+				Checksum::CHKENDIAN_BIG);
+			expected = (readBE16(&buf[0]) << 16) | readBE16(&buf[2]);
+			break;
+		default:
+			return false;
+	}
+	return (actual == expected);
+}
+
+/**
+ * Consensus task.
+ * Each task processes a contiguous range of blocks,
+ * using its own file handles.
+ */
+class DumpConsensusTask : public QRunnable
+{
+	public:
+		DumpConsensusTask(const QStringList &dumps, const QString &outFilename,
+				uint32_t blockSize, bool gcnChecksums,
+				DumpConsensus::BlockResult *results,
+				int start, int end, QAtomicInt *error,
+				QAtomicInt *cancelled, QAtomicInt *blocksDone)
+			: dumps(dumps)
+			, outFilename(outFilename)
+			, blockSize(blockSize)
+			, gcnChecksums(gcnChecksums)
+			, results(results)
+			, start(start)
+			, end(end)
+			, error(error)
+			, cancelled(cancelled)
+			, blocksDone(blocksDone) { }
+
+		void run(void) final;
+
+	private:
+		const QStringList dumps;
+		const QString outFilename;
+		const uint32_t blockSize;
+		const bool gcnChecksums;
+		DumpConsensus::BlockResult *const results;
+		const int start;
+		const int end;
+		QAtomicInt *const error;
+		QAtomicInt *const cancelled;
+		QAtomicInt *const blocksDone;
+		Q_DISABLE_COPY(DumpConsensusTask)
+};
+
+void DumpConsensusTask::run(void)
+{
+	const int dumpCount = dumps.size();
+
+	// Open the files.
+	std::vector<QFile*> files(dumpCount);
+	for (int i = 0; i < dumpCount; i++) {
+		files[i] = new QFile(dumps.at(i));
+		files[i]->open(QIODevice::ReadOnly);
+	}
+	QFile outFile(outFilename);
+	if (!outFile.open(QIODevice::ReadWrite)) {
+		error->testAndSetRelaxed(0, -EIO);
+		qDeleteAll(files);
+		return;
+	}
+
+	// One block per dump.
+	std::vector<uint8_t> blocks((size_t)dumpCount * blockSize);
+	std::vector<uint64_t> hashes(dumpCount);
+	// Version index for each dump. (-1 == missing)
+	std::vector<int> version(dumpCount);
+	// First dump and vote count for each version.
+	std::vector<int> versionDump;
+	std::vector<int> versionVotes;
+	versionDump.reserve(dumpCount);
+	versionVotes.reserve(dumpCount);
+
+	const qint64 startPos = (qint64)start * blockSize;
+	for (int i = 0; i < dumpCount; i++) {
+		files[i]->seek(startPos);
+	}
+	outFile.seek(startPos);
+
+	// NOTE: blocksDone is updated in the loop increment,
+	// so skipped (missing) blocks are counted as well.
+	for (int blockIdx = start; blockIdx < end; blockIdx++, blocksDone->fetchAndAddRelaxed(1)) {
+		if (error->load() != 0 || cancelled->load() != 0)
+			break;
+
+		DumpConsensus::BlockResult *const result = &results[blockIdx];
+		memset(result, 0, sizeof(*result));
+		versionDump.clear();
+		versionVotes.clear();
+
+		// Read the block from each dump and group identical blocks.
+		// NOTE: Reads are sequential, so no seeking is needed.
+		for (int i = 0; i < dumpCount; i++) {
+			uint8_t *const buf = &blocks[(size_t)i * blockSize];
+			version[i] = -1;
+			if (files[i]->read(reinterpret_cast<char*>(buf), blockSize) != (qint64)blockSize) {
+				// Block is missing from this dump.
+				continue;
+			}
+			result->dumps++;
+
+			// NOTE: Hash matches are verified with memcmp().
+			hashes[i] = BlockHealth::Hash(buf, blockSize);
+			for (int v = 0; v < (int)versionDump.size(); v++) {
+				const int j = versionDump[v];
+				if (hashes[j] == hashes[i] &&
+				    !memcmp(&blocks[(size_t)j * blockSize], buf, blockSize))
+				{
+					version[i] = v;
+					versionVotes[v]++;
+					break;
+				}
+			}
+			if (version[i] < 0) {
+				// New version.
+				version[i] = (int)versionDump.size();
+				versionDump.push_back(i);
+				versionVotes.push_back(1);
+			}
+		}
+
+		if (versionDump.empty()) {
+			// Block couldn't be read from any dump.
+			result->flags = DumpConsensus::BRF_MISSING;
+			outFile.seek((qint64)(blockIdx + 1) * blockSize);
+			continue;
+		}
+		result->versions = (uint8_t)versionDump.size();
+
+		// If any version has a valid checksum,
+		// only consider versions with valid checksums.
+		std::vector<bool> candidate(versionDump.size(), true);
+		if (gcnChecksums && blockIdx < 5) {
+			bool anyGood = false;
+			for (int v = 0; v < (int)versionDump.size(); v++) {
+				candidate[v] = isGcnChecksumGood(blockIdx,
+					&blocks[(size_t)versionDump[v] * blockSize]);
+				anyGood |= candidate[v];
+			}
+			if (anyGood) {
+				result->flags |= DumpConsensus::BRF_CHECKSUM_GOOD;
+			} else {
+				std::fill(candidate.begin(), candidate.end(), true);
+			}
+		}
+
+		// Choose the version with the most votes.
+		// Ties are broken in favor of non-uniform blocks,
+		// since failed reads usually return 0x00 or 0xFF.
+		int best = -1;
+		bool bestUniform = true;
+		bool tie = false;
+		for (int v = 0; v < (int)versionDump.size(); v++) {
+			if (!candidate[v])
+				continue;
+			const bool uniform = BlockHealth::IsUniform(
+				&blocks[(size_t)versionDump[v] * blockSize], blockSize);
+			if (best < 0 || versionVotes[v] > versionVotes[best]) {
+				best = v;
+				bestUniform = uniform;
+				tie = false;
+			} else if (versionVotes[v] == versionVotes[best]) {
+				tie = true;
+				if (bestUniform && !uniform) {
+					best = v;
+					bestUniform = false;
+				}
+			}
+		}
+		if (tie) {
+			result->flags |= DumpConsensus::BRF_TIE;
+		}
+		result->votes = (uint8_t)versionVotes[best];
+
+		// Write the chosen version.
+		const char *const chosen = reinterpret_cast<const char*>(
+			&blocks[(size_t)versionDump[best] * blockSize]);
+		if (outFile.write(chosen, blockSize) != (qint64)blockSize) {
+			error->testAndSetRelaxed(0, -EIO);
+			break;
+		}
+	}
+
+	qDeleteAll(files);
+}
+
+/** DumpConsensus **/
+
+/**
+ * Create a DumpConsensus.
+ * @param blockSize Block size.
+ */
+DumpConsensus::DumpConsensus(uint32_t blockSize)
+	: m_blockSize(blockSize)
+	, m_gcnChecksums(false)
+	, m_cancelled(0)
+	, m_blockCount(0)
+	, m_blocksDone(0)
+{ }
+
+/**
+ * Enable GameCube system block checksums.
+ * If enabled, a version of the header, directory tables,
+ * or block tables with a valid checksum is chosen over
+ * the majority.
+ * @param enable True to enable; false to disable.
+ */
+void DumpConsensus::setGcnChecksums(bool enable)
+{
+	m_gcnChecksums = enable;
+}
+
+/**
+ * Build the consensus image.
+ * @param dumps Dump filenames.
+ * @param outFilename Consensus image filename.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int DumpConsensus::build(const QStringList &dumps, const QString &outFilename)
+{
+	int ret = build_int(dumps, outFilename);
+	// Only the current build is cancelled.
+	m_cancelled.store(0);
+	return ret;
+}
+
+/**
+ * Cancel the current (or next) build().
+ * build() returns -ECANCELED, and the partial
+ * consensus image is deleted.
+ * This function is thread-safe.
+ */
+void DumpConsensus::cancel(void)
+{
+	m_cancelled.store(1);
+}
+
+/**
+ * Build the consensus image. (internal function)
+ * @param dumps Dump filenames.
+ * @param outFilename Consensus image filename.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int DumpConsensus::build_int(const QStringList &dumps, const QString &outFilename)
+{
+	m_results.clear();
+	m_errorString.clear();
+	m_blockCount.store(0);
+	m_blocksDone.store(0);
+	if (dumps.isEmpty() || dumps.size() > MAX_DUMPS || m_blockSize == 0)
+		return -EINVAL;
+
+	// Determine the image size.
+	// Dumps may be truncated, so use the largest one.
+	qint64 maxSize = 0;
+	foreach (const QString &dump, dumps) {
+		QFile file(dump);
+		if (!file.open(QIODevice::ReadOnly)) {
+			m_errorString = file.errorString();
+			return -ENOENT;
+		}
+		maxSize = std::max(maxSize, file.size());
+	}
+	const int blockCount = (int)(maxSize / m_blockSize);
+	if (blockCount <= 0) {
+		return -EINVAL;
+	}
+	if (m_cancelled.load() != 0) {
+		return -ECANCELED;
+	}
+
+	// Create the consensus image.
+	{
+		QFile outFile(outFilename);
+		if (!outFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+		    !outFile.resize((qint64)blockCount * m_blockSize))
+		{
+			m_errorString = outFile.errorString();
+			return -EIO;
+		}
+	}
+
+	// Process the blocks in parallel.
+	// Each thread gets a contiguous range so reads are sequential.
+	m_results.resize(blockCount);
+	BlockResult *const results = m_results.data();
+	QAtomicInt error(0);
+	m_blockCount.store(blockCount);
+
+	const int threadCount = std::max(1, std::min(QThread::idealThreadCount(), blockCount));
+	if (threadCount == 1) {
+		DumpConsensusTask task(dumps, outFilename, m_blockSize,
+			m_gcnChecksums, results, 0, blockCount, &error,
+			&m_cancelled, &m_blocksDone);
+		task.run();
+	} else {
+		QThreadPool pool;
+		pool.setMaxThreadCount(threadCount);
+		for (int i = 0; i < threadCount; i++) {
+			const int start = (int)((qint64)blockCount * i / threadCount);
+			const int end = (int)((qint64)blockCount * (i + 1) / threadCount);
+			pool.start(new DumpConsensusTask(dumps, outFilename, m_blockSize,
+				m_gcnChecksums, results, start, end, &error,
+				&m_cancelled, &m_blocksDone));
+		}
+		pool.waitForDone();
+	}
+
+	if (error.load() == 0 && m_cancelled.load() != 0) {
+		// Don't leave a partial consensus image behind.
+		m_results.clear();
+		QFile::remove(outFilename);
+		return -ECANCELED;
+	}
+	return error.load();
+}
+
+/**
+ * Get the number of blocks that didn't match in all dumps.
+ * @return Number of low-confidence blocks.
+ */
+int DumpConsensus::lowConfidenceCount(void) const
+{
+	int count = 0;
+	foreach (const BlockResult &result, m_results) {
+		if ((result.flags & BRF_MISSING) || result.versions > 1) {
+			count++;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,159 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * DumpConsensus.hpp: Build a consensus image from multiple dumps.         *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_DUMPCONSENSUS_HPP__
+#define __LIBMEMCARD_DUMPCONSENSUS_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+/**
+ * Build a consensus image from multiple dumps of the same card.
+ *
+ * Physically failing cards may return different data on each
+ * read, so several dumps are taken. Each block is compared
+ * across all dumps, and the version with a valid checksum
+ * (GCN system blocks only) or the most votes is written to
+ * the consensus image.
+ *
+ * Blocks are processed in parallel, and each thread only
+ * keeps one block per dump in memory.
+ *
+ * build() may be run from a worker thread. cancel() and the
+ * progress functions can be called from any thread.
+ */
+class DumpConsensus
+{
+	public:
+		/**
+		 * Create a DumpConsensus.
+		 * @param blockSize Block size.
+		 */
+		explicit DumpConsensus(uint32_t blockSize = 8192);
+
+	public:
+		/**
+		 * Block result flags.
+		 */
+		enum BlockFlags {
+			BRF_MISSING		= (1U << 0),	// Block couldn't be read from any dump.
+			BRF_CHECKSUM_GOOD	= (1U << 1),	// Chosen version has a valid checksum.
+			BRF_TIE			= (1U << 2),	// More than one version had the most votes.
+		};
+
+		/**
+		 * Per-block result.
+		 */
+		struct BlockResult {
+			uint8_t flags;		// BlockFlags
+			uint8_t votes;		// Number of dumps that match the chosen version.
+			uint8_t dumps;		// Number of dumps that contain this block.
+			uint8_t versions;	// Number of distinct versions.
+		};
+
+		// Maximum number of dumps.
+		static const int MAX_DUMPS = 255;
+
+		/**
+		 * Enable GameCube system block checksums.
+		 * If enabled, a version of the header, directory tables,
+		 * or block tables with a valid checksum is chosen over
+		 * the majority.
+		 * @param enable True to enable; false to disable.
+		 */
+		void setGcnChecksums(bool enable);
+
+		/**
+		 * Build the consensus image.
+		 * @param dumps Dump filenames.
+		 * @param outFilename Consensus image filename.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int build(const QStringList &dumps, const QString &outFilename);
+
+		/**
+		 * Cancel the current (or next) build().
+		 * build() returns -ECANCELED, and the partial
+		 * consensus image is deleted.
+		 * This function is thread-safe.
+		 */
+		void cancel(void);
+
+		/**
+		 * Get the number of blocks in the consensus image.
+		 * This function is thread-safe.
+		 * @return Number of blocks, or 0 if not known yet.
+		 */
+		inline int blockCount(void) const
+		{
+			return m_blockCount.load();
+		}
+
+		/**
+		 * Get the number of blocks processed so far.
+		 * This function is thread-safe.
+		 * @return Number of blocks processed.
+		 */
+		inline int blocksDone(void) const
+		{
+			return m_blocksDone.load();
+		}
+
+		/**
+		 * Get the per-block results. (confidence map)
+		 * @return Per-block results.
+		 */
+		inline QVector<BlockResult> results(void) const
+		{
+			return m_results;
+		}
+
+		/**
+		 * Get the number of blocks that didn't match in all dumps.
+		 * @return Number of low-confidence blocks.
+		 */
+		int lowConfidenceCount(void) const;
+
+		/**
+		 * Get the last error string.
+		 * @return Error string.
+		 */
+		inline QString errorString(void) const
+		{
+			return m_errorString;
+		}
+
+	private:
+		/**
+		 * Build the consensus image. (internal function)
+		 * @param dumps Dump filenames.
+		 * @param outFilename Consensus image filename.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int build_int(const QStringList &dumps, const QString &outFilename);
+
+	private:
+		uint32_t m_blockSize;
+		bool m_gcnChecksums;
+
+		// Cancellation and progress.
+		QAtomicInt m_cancelled;
+		QAtomicInt m_blockCount;
+		QAtomicInt m_blocksDone;
+
+		QVector<BlockResult> m_results;
+		QString m_errorString;
+};
+
+#endif /* __LIBMEMCARD_DUMPCONSENSUS_HPP__ */
@@ -18,8 +18,10 @@
 // C includes. (C++ namespace)
 #include <cerrno>
 #include <cassert>
+#include <cstring>
 
 // C++ includes.
+#include <algorithm>
 #include <string>
 #include <vector>
 using std::string;
@@ -30,6 +32,8 @@ using std::vector;
 #include <QtCore/QTextCodec>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
@@ -44,17 +48,28 @@ FilePrivate::FilePrivate(File *q, Card *card)
 	: q_ptr(q)
 	, card(card)
 	, mode(0)
+	, imagesLoaded(false)
 	, gcBanner(nullptr)
 	, iconAnimMode(0)
+	, iconMask(0)
 	, lostFile(false)
 { }
 
 FilePrivate::~FilePrivate()
 {
+	// Make sure the checksum task isn't using the card.
+	cancelChecksumJob();
+
 	// Delete the GcImages.
 	delete gcBanner;
 	qDeleteAll(gcIcons);
 	gcIcons.clear();
+
+	// Remove the QPixmaps from the cache.
+	QPixmapCache::remove(bannerKey);
+	foreach (const QPixmapCache::Key &key, iconKeys) {
+		QPixmapCache::remove(key);
+	}
 }
 
 /**
@@ -86,7 +101,7 @@ uint16_t FilePrivate::fileBlockAddrToPhysBlockAddr(uint16_t fileBlock) const
  * Load the file data.
  * @return QByteArray with file data, or empty QByteArray on error.
  */
-QByteArray FilePrivate::loadFileData(void)
+QByteArray FilePrivate::loadFileData(void) const
 {
 	// TODO: Combine with readBlocks()?
 	// TODO: Add a generic read() function?
@@ -115,7 +130,7 @@ QByteArray FilePrivate::loadFileData(void)
  * @param len Length, in blocks.
  * @return QByteArray with file data, or empty QByteArray on error.
  */
-QByteArray FilePrivate::readBlocks(uint16_t blockStart, int len)
+QByteArray FilePrivate::readBlocks(uint16_t blockStart, int len) const
 {
 	// Check if the starting block is valid.
 	if (blockStart >= this->size()) {
@@ -139,7 +154,7 @@ QByteArray FilePrivate::readBlocks(uint16_t blockStart, int len)
 
 	uint8_t *blockDataPtr = (uint8_t*)blockData.data();
 	for (int i = 0; i < len; i++, blockDataPtr += blockSize) {
-		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(i);
+		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(blockStart + i);
 		card->readBlock(blockDataPtr, blockSize, physBlockAddr);
 	}
 	return blockData;
@@ -241,193 +256,253 @@ QString FilePrivate::decodeText_SJISorCP1252(const char *str, int len)
 
 /**
  * Load the banner and icon images.
+ * This decodes the GcImages only; QPixmaps are
+ * created by getPixmap() when they're needed.
  * TODO: Move to File?
  */
-void FilePrivate::loadImages(void)
+void FilePrivate::loadImages(void) const
 {
+	if (imagesLoaded)
+		return;
+	imagesLoaded = true;
+
 	// Load the banner.
 	this->gcBanner = loadBannerImage();
-	if (gcBanner) {
-		// Set the new banner image.
-		QImage qBanner = gcImageToQImage(gcBanner);
-		if (!qBanner.isNull())
-			banner = QPixmap::fromImage(qBanner);
-		else
-			banner = QPixmap();
-	} else {
-		// No banner image.
-		banner = QPixmap();
-	}
 
 	// Load the icons.
 	this->gcIcons = loadIconImages();
-	icons.clear();
-	icons.reserve(gcIcons.size());
-	foreach (GcImage *gcIcon, gcIcons) {
-		if (gcIcon) {
-			QImage qIcon = gcImageToQImage(gcIcon);
-			if (!qIcon.isNull())
-				icons.append(QPixmap::fromImage(qIcon));
-			else
-				icons.append(QPixmap());
-		} else {
-			// No icon image.
-			icons.append(QPixmap());
-		}
+	iconKeys.resize(gcIcons.size());
+
+	// Update the icon mask using the decoded icons,
+	// since some icons may have failed to decode.
+	iconMask = 0;
+	for (int i = 0; i < gcIcons.size() && i < 8; i++) {
+		if (gcIcons.at(i))
+			iconMask |= (1 << i);
 	}
 }
 
+/**
+ * Get a QPixmap for a GcImage, using QPixmapCache.
+ * @param gcImage	[in] GcImage.
+ * @param key		[in,out] QPixmapCache key.
+ * @return QPixmap, or null QPixmap on error.
+ */
+QPixmap FilePrivate::getPixmap(const GcImage *gcImage, QPixmapCache::Key *key)
+{
+	if (!gcImage)
+		return QPixmap();
+
+	QPixmap pixmap;
+	if (QPixmapCache::find(*key, &pixmap))
+		return pixmap;
+
+	// Not in the cache. Convert the GcImage.
+	QImage qImg = gcImageToQImage(gcImage);
+	if (qImg.isNull())
+		return QPixmap();
+	pixmap = QPixmap::fromImage(qImg);
+	*key = QPixmapCache::insert(pixmap);
+	return pixmap;
+}
+
 /** Checksums **/
 
+/**
+ * Thread pool task for FilePrivate::calculateChecksum().
+ * Runs the checksum plan for a single file.
+ */
+class FileChecksumTask : public QRunnable
+{
+	public:
+		explicit FileChecksumTask(const QSharedPointer<ChecksumJob> &job)
+			: job(job) { }
+
+		void run(void) final
+		{
+			{
+				QMutexLocker locker(&job->mutex);
+				if (job->cancelled.load())
+					return;
+				job->running = true;
+			}
+
+			bool ok = FilePrivate::RunChecksumPlan(job->card, job->fatEntries,
+				job->checksumPlan, &job->cancelled);
+
+			QMutexLocker locker(&job->mutex);
+			job->running = false;
+			if (ok && !job->cancelled.load()) {
+				// Notify the File on its own thread.
+				// NOTE: The File waits for this task in its
+				// destructor, so job->file is still valid here.
+				job->finished = true;
+				QMetaObject::invokeMethod(job->file, "checksumJob_finished_slot",
+							  Qt::QueuedConnection);
+			}
+			job->stopped.wakeAll();
+		}
+
+	private:
+		const QSharedPointer<ChecksumJob> job;
+		Q_DISABLE_COPY(FileChecksumTask)
+};
+
 /**
  * Calculate the file checksum.
+ * The checksums are calculated in the background.
+ * checksumValues is empty until the job finishes,
+ * and then File::checksumChanged() is emitted.
  */
 void FilePrivate::calculateChecksum(void)
 {
+	cancelChecksumJob();
 	checksumValues.clear();
+	checksumPlan.clear();
 
 	if (checksumDefs.empty()) {
 		// No checksum definitions were set.
 		return;
 	}
 
-	// Load the file data.
-	QByteArray fileData = loadFileData();
-	if (fileData.isEmpty()) {
-		// File is empty.
+	if (this->size() > card->totalUserBlocks()) {
+		// File is larger than the card.
+		// This shouldn't happen...
 		return;
 	}
 
-	// Pointer to fileData's internal data array.
-	uint8_t *data = reinterpret_cast<uint8_t*>(fileData.data());
+	// Compile the checksum plan.
+	// All checksums are calculated in a single pass
+	// over the file's blocks, so the file data doesn't
+	// have to be loaded into memory all at once.
+	Q_Q(File);
+	QSharedPointer<ChecksumJob> job(new ChecksumJob(q, card));
+	job->fatEntries = fatEntries;
+	job->checksumPlan.compile(checksumDefs.toStdVector(),
+		(uint32_t)(this->size() * card->blockSize()));
+	if (job->checksumPlan.isEmpty()) {
+		// No usable checksum definitions.
+		return;
+	}
 
-	// Process all of the checksum definitions.
-	for (int i = 0; i < (int)checksumDefs.size(); i++) {
-		const Checksum::ChecksumDef &checksumDef = checksumDefs.at(i);
+	// Run the checksum plan on the thread pool.
+	// The plan is moved back to checksumPlan when it's done.
+	checksumJob = job;
+	QThreadPool::globalInstance()->start(new FileChecksumTask(job));
+}
 
-		if (checksumDef.algorithm == Checksum::CHKALG_NONE ||
-		    checksumDef.algorithm >= Checksum::CHKALG_MAX ||
-		    checksumDef.length == 0)
-		{
-			// No algorithm or invalid algorithm set,
-			// or the checksum data has no length.
-			continue;
-		}
+/**
+ * Cancel the background checksum job, if any.
+ * This waits for the task to stop reading the card.
+ */
+void FilePrivate::cancelChecksumJob(void)
+{
+	if (!checksumJob)
+		return;
 
-		// Make sure the checksum definition is in range.
-		if (fileData.size() < (int)checksumDef.address ||
-		    fileData.size() < (int)(checksumDef.start + checksumDef.length))
-		{
-			// File is too small...
-			// TODO: Also check the size of the checksum itself.
-			continue;
-		}
+	QMutexLocker locker(&checksumJob->mutex);
+	checksumJob->cancelled.store(1);
+	while (checksumJob->running) {
+		checksumJob->stopped.wait(&checksumJob->mutex);
+	}
+	locker.unlock();
+	checksumJob.clear();
+}
 
-		// Get the expected checksum.
-		// NOTE: Assuming big-endian for all values.
-		uint32_t expected = 0;
-		Checksum::ChaoGardenChecksumData chaoChk_orig;
-
-		// Use Exec() for most algorithms.
-		// Some unusual ones need to be run manually.
-		bool useExec = true;
-
-		const char *const start = (fileData.constData() + checksumDef.start);
-		uint32_t actual = 0;
-
-		switch (checksumDef.algorithm) {
-			case Checksum::CHKALG_CRC16:
-			case Checksum::CHKALG_DREAMCASTVMU:
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (data[checksumDef.address+0] << 8) |
-						   (data[checksumDef.address+1]);
-				} else {
-					// Little-endian.
-					expected = (data[checksumDef.address+1] << 8) |
-						   (data[checksumDef.address+0]);
-				}
-				break;
+/**
+ * Save the results of the background checksum job.
+ * @return True if the job has finished; false if not.
+ */
+bool FilePrivate::collectChecksumJob(void)
+{
+	if (!checksumJob)
+		return false;
 
-			case Checksum::CHKALG_CRC32:
-			case Checksum::CHKALG_ADDINVDUAL16:
-			case Checksum::CHKALG_ADDBYTES32:
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (data[checksumDef.address+0] << 24) |
-						   (data[checksumDef.address+1] << 16) |
-						   (data[checksumDef.address+2] << 8) |
-						   (data[checksumDef.address+3]);
-				} else {
-					// Little-endian.
-					expected = (data[checksumDef.address+3] << 24) |
-						   (data[checksumDef.address+2] << 16) |
-						   (data[checksumDef.address+1] << 8) |
-						   (data[checksumDef.address+0]);
-				}
-				break;
+	QMutexLocker locker(&checksumJob->mutex);
+	if (!checksumJob->finished) {
+		// Still running.
+		return false;
+	}
 
-			case Checksum::CHKALG_SONICCHAOGARDEN: {
-				memcpy(&chaoChk_orig, &data[checksumDef.address], sizeof(chaoChk_orig));
-
-				// Temporary working copy.
-				Checksum::ChaoGardenChecksumData chaoChk = chaoChk_orig;
-				if (checksumDef.endian != Checksum::CHKENDIAN_LITTLE) {
-					// Big-endian.
-					expected = (chaoChk.checksum_3 << 24) |
-						   (chaoChk.checksum_2 << 16) |
-						   (chaoChk.checksum_1 << 8) |
-						   (chaoChk.checksum_0);
-				} else {
-					// Little-endian.
-					// TODO: Is this correct?
-					expected = (chaoChk.checksum_0 << 24) |
-						   (chaoChk.checksum_1 << 16) |
-						   (chaoChk.checksum_2 << 8) |
-						   (chaoChk.checksum_3);
-				}
-
-				// Clear some fields that must be 0 when calculating the checksum.
-				chaoChk.checksum_3 = 0;
-				chaoChk.checksum_2 = 0;
-				chaoChk.checksum_1 = 0;
-				chaoChk.checksum_0 = 0;
-				chaoChk.random_3 = 0;
-				memcpy(&data[checksumDef.address], &chaoChk, sizeof(chaoChk));
-				break;
-			}
+	// Keep the plan so the checksums can be
+	// updated when the file is written.
+	std::swap(checksumPlan, checksumJob->checksumPlan);
+	checksumValues = QVector<Checksum::ChecksumValue>::fromStdVector(checksumPlan.finish());
+	locker.unlock();
+	checksumJob.clear();
+	return true;
+}
 
-			case Checksum::CHKALG_POKEMONXD:
-				// Pokémon XD has a more complicated checksum.
-				useExec = false;
-				actual = Checksum::PokemonXD(reinterpret_cast<const uint8_t*>(start),
-					checksumDef.length, checksumDef.address, &expected);
-				break;
+/**
+ * Update the file checksum after the file was written.
+ * Only the checksums affected by the written data are updated.
+ * @param address Address of the written data.
+ * @param oldData Old data.
+ * @param newData New data.
+ * @param length Length of the written data, in bytes.
+ */
+void FilePrivate::updateChecksum(uint32_t address, const uint8_t *oldData,
+				 const uint8_t *newData, uint32_t length)
+{
+	if (checksumPlan.isEmpty()) {
+		// No checksums.
+		return;
+	}
 
-			case Checksum::CHKALG_NONE:
-			default:
-				// Unsupported algorithm.
-				expected = 0;
-				break;
-		}
+	// Additive checksums are adjusted using the old and new data.
+	// Other checksums covering the written data are recalculated.
+	checksumPlan.modify(address, oldData, newData, length);
+	runChecksumPlan();
 
-		if (useExec) {
-			// Use Checksum::Exec().
-			actual = Checksum::Exec(checksumDef.algorithm,
-				start, checksumDef.length, checksumDef.endian, checksumDef.param);
-		}
+	Q_Q(File);
+	emit q->checksumChanged();
+}
 
-		if (checksumDef.algorithm == Checksum::CHKALG_SONICCHAOGARDEN) {
-			// Restore the Chao Garden checksum data.
-			memcpy(&data[checksumDef.address], &chaoChk_orig, sizeof(chaoChk_orig));
-		}
+/**
+ * Run the dirty checksums in a checksum plan over the file data.
+ * NOTE: This may be called from a worker thread.
+ * @param card Card.
+ * @param fatEntries FAT entries.
+ * @param checksumPlan Checksum plan.
+ * @param cancelled If not nullptr, stop if this is set.
+ * @return True if the plan was run; false if it was cancelled.
+ */
+bool FilePrivate::RunChecksumPlan(Card *card, const QVector<uint16_t> &fatEntries,
+				  Checksum::ChecksumPlan &checksumPlan,
+				  const QAtomicInt *cancelled)
+{
+	if (!checksumPlan.isDirty())
+		return true;
 
-		// Save the checksums.
-		Checksum::ChecksumValue checksumValue;
-		checksumValue.expected = expected;
-		checksumValue.actual = actual;
-		checksumValues.push_back(checksumValue);
+	// Only read the blocks needed by the dirty checksums.
+	const int blockSize = card->blockSize();
+	const uint32_t dataEnd = checksumPlan.dataEnd();
+	int i = (int)(checksumPlan.dataStart() / blockSize);
+	uint32_t offset = (uint32_t)(i * blockSize);
+
+	vector<uint8_t> block(blockSize);
+	for (; i < fatEntries.size() && offset < dataEnd; i++, offset += blockSize) {
+		if (cancelled && cancelled->load()) {
+			// Job was cancelled.
+			return false;
+		}
+		if (card->readBlock(block.data(), blockSize, fatEntries.at(i)) != blockSize) {
+			// Read error. Use an empty block.
+			memset(block.data(), 0, blockSize);
+		}
+		checksumPlan.update(offset, block.data(), blockSize);
 	}
+	return true;
+}
+
+/**
+ * Run the dirty checksums in the checksum plan
+ * over the file data, and save the checksum values.
+ */
+void FilePrivate::runChecksumPlan(void)
+{
+	RunChecksumPlan(card, fatEntries, checksumPlan);
+	checksumValues = QVector<Checksum::ChecksumValue>::fromStdVector(checksumPlan.finish());
 }
 
 /** File **/
@@ -448,6 +523,11 @@ File::File(FilePrivate *d, Card *card)
 	// Forward the card's readOnlyChanged signal.
 	connect(card, &Card::readOnlyChanged,
 		this, &File::readOnlyChanged);
+
+	// The card's damage map includes the checksum status,
+	// so the block health changes with the checksums.
+	connect(this, &File::checksumChanged,
+		card, &Card::blockHealthChanged);
 }
 
 File::~File()
@@ -508,10 +588,32 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 	if (address + length > d->size() * blockSize)
 		return -ERANGE;
 
+	// If the background checksum job has finished,
+	// save its results so the checksums can be updated.
+	if (d->collectChecksumJob()) {
+		emit checksumChanged();
+	}
+
+	// Save the old data so the checksums can be
+	// updated without reading the entire file.
+	const uint32_t writeAddress = address;
+	const uint32_t writeLength = length;
+	QByteArray oldData;
+	if (!d->checksumPlan.isEmpty() && length != 0) {
+		const uint16_t oldBlockStart = (uint16_t)(address / blockSize);
+		const int oldBlockEnd = (int)((address + length + blockSize - 1) / blockSize);
+		oldData = d->readBlocks(oldBlockStart, oldBlockEnd - oldBlockStart);
+	}
+
 	// Temporary block buffer.
 	// NOTE: Only resized (allocated) if necessary.
 	std::vector<uint8_t> block;
 
+	// Buffer the blocks so they're written in a single pass.
+	int ret = d->card->beginTransaction();
+	if (ret != 0)
+		return ret;
+
 	// Check if we're not starting on a block boundary.
 	const uint32_t blockStartOffset = (address % blockSize);
 	if (blockStartOffset != 0) {
@@ -522,14 +624,8 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 		d->card->readBlock(block.data(), blockSize, physBlockStartIdx);
 
 		// Bytes remaining in the block.
-		const uint32_t remaining = blockSize - (blockStartOffset);
-		if (length <= remaining) {
-			// This is the only block being written.
-			memcpy(block.data() + blockStartOffset, data_u8, length);
-			d->card->writeBlock(block.data(), blockSize, physBlockStartIdx);
-			// FIXME: Trigger card metadata update.
-			return 0;
-		}
+		// If length is smaller, this is the only block being written.
+		const uint32_t remaining = std::min(length, blockSize - blockStartOffset);
 
 		// Write 'remaining' bytes worth of data.
 		memcpy(block.data() + blockStartOffset, data_u8, remaining);
@@ -544,7 +640,7 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 	// Write entire blocks.
 	for (; length >= (uint32_t)blockSize; length -= blockSize, data_u8 += blockSize, address += blockSize) {
 		const uint16_t physBlockIdx = d->fileBlockAddrToPhysBlockAddr(address / blockSize);
-		d->card->writeBlock(data, blockSize, physBlockIdx);
+		d->card->writeBlock(data_u8, blockSize, physBlockIdx);
 	}
 
 	// Check if we still have data left (not a full block).
@@ -560,8 +656,27 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 		d->card->writeBlock(block.data(), blockSize, physBlockEndIdx);
 	}
 
-	// Data written successfully.
-	return 0;
+	// Write the blocks to the card.
+	// NOTE: Only the file's data blocks are written. The directory
+	// entry and block tables don't change, so the card metadata
+	// doesn't need to be updated; only the checksums do.
+	ret = d->card->commit();
+	if (ret != 0) {
+		// Error writing the blocks.
+		// Discard them so reads match the card again.
+		d->card->rollback();
+		return ret;
+	} else if (d->checksumJob) {
+		// The checksums are still being calculated,
+		// possibly from the old data. Start over.
+		d->calculateChecksum();
+	} else if (!oldData.isEmpty()) {
+		// Update the checksums.
+		d->updateChecksum(writeAddress,
+			reinterpret_cast<const uint8_t*>(oldData.constData()) + (writeAddress % blockSize),
+			static_cast<const uint8_t*>(data), writeLength);
+	}
+	return ret;
 }
 
 /**
@@ -623,35 +738,56 @@ int File::size(void) const
 
 /**
  * Get the banner image.
+ * The banner is decoded on first access.
  * @return Banner image, or null QPixmap on error.
  */
 QPixmap File::banner(void) const
 {
 	Q_D(const File);
-	return d->banner;
+	d->ensureImagesLoaded();
+	return FilePrivate::getPixmap(d->gcBanner, &d->bannerKey);
 }
 
 /**
  * Get the number of icons in the file.
+ * The icons are decoded on first access.
  * @return Number of icons.
  */
 int File::iconCount(void) const
 {
 	Q_D(const File);
-	return d->icons.size();
+	d->ensureImagesLoaded();
+	return d->gcIcons.size();
+}
+
+/**
+ * Check if an icon frame has an image.
+ * This uses the icon metadata, so the icons
+ * don't have to be decoded.
+ * @param idx Icon number.
+ * @return True if the icon frame has an image; false if not.
+ */
+bool File::hasIcon(int idx) const
+{
+	Q_D(const File);
+	if (idx < 0 || idx >= 8)
+		return false;
+	return !!(d->iconMask & (1 << idx));
 }
 
 /**
  * Get an icon from the file.
+ * The icons are decoded on first access.
  * @param idx Icon number.
  * @return Icon, or null QPixmap on error.
  */
 QPixmap File::icon(int idx) const
 {
 	Q_D(const File);
-	if (idx < 0 || idx >= d->icons.size())
+	d->ensureImagesLoaded();
+	if (idx < 0 || idx >= d->gcIcons.size())
 		return QPixmap();
-	return d->icons.at(idx);
+	return FilePrivate::getPixmap(d->gcIcons.at(idx), &d->iconKeys[idx]);
 }
 
 /**
@@ -680,6 +816,18 @@ int File::iconAnimMode(void) const
 	return (d->iconAnimMode & 0x4);
 }
 
+/**
+ * Decode the banner and icon images now.
+ * Images are normally decoded on first access;
+ * this can be used to prefetch them for files
+ * that are about to be displayed.
+ */
+void File::prefetchImages(void) const
+{
+	Q_D(const File);
+	d->ensureImagesLoaded();
+}
+
 /** Lost File information **/
 
 /**
@@ -733,7 +881,8 @@ int File::saveBanner(const QString &filenameNoExt) const
 	Q_D(const File);
 	// TODO: Make GcImageWriter more generic and move the
 	// internal image data here.
-	if (d->banner.isNull())
+	d->ensureImagesLoaded();
+	if (!d->gcBanner)
 		return -EINVAL;
 
 	// Append the correct extension.
@@ -770,6 +919,7 @@ int File::saveBanner(const QString &filenameNoExt) const
 int File::saveBanner(QIODevice *qioDevice) const
 {
 	Q_D(const File);
+	d->ensureImagesLoaded();
 	if (!d->gcBanner)
 		return -EINVAL;
 
@@ -798,6 +948,7 @@ int File::saveIcon(const QString &filenameNoExt,
 	GcImageWriter::AnimImageFormat animImgf) const
 {
 	Q_D(const File);
+	d->ensureImagesLoaded();
 	if (d->gcIcons.isEmpty())
 		return -EINVAL;
 
@@ -917,6 +1068,20 @@ void File::setChecksumDefs(const QVector<Checksum::ChecksumDef> &checksumDefs)
 	Q_D(File);
 	d->checksumDefs = checksumDefs;
 	d->calculateChecksum();
+
+	// The checksum status is unknown until
+	// the background checksum job finishes.
+	emit checksumChanged();
+}
+
+/**
+ * Are the checksums being calculated in the background?
+ * @return True if the checksums are being calculated; false if not.
+ */
+bool File::isChecksumPending(void) const
+{
+	Q_D(const File);
+	return !d->checksumJob.isNull();
 }
 
 /**
@@ -970,6 +1135,17 @@ QVector<QString> File::checksumValuesFormatted(void) const
 	return ret;
 }
 
+/**
+ * The background checksum job has finished.
+ */
+void File::checksumJob_finished_slot(void)
+{
+	Q_D(File);
+	if (d->collectChecksumJob()) {
+		emit checksumChanged();
+	}
+}
+
 /** Writing functions. **/
 
 /**
@@ -180,6 +180,7 @@ class File : public QObject
 
 		/**
 		 * Get the banner image.
+		 * The banner is decoded on first access.
 		 * @return Banner image, or null QPixmap on error.
 		 */
 		QPixmap banner(void) const;
@@ -192,11 +193,21 @@ class File : public QObject
 
 		/**
 		 * Get an icon from the file.
+		 * The icons are decoded on first access.
 		 * @param idx Icon number.
 		 * @return Icon, or null QPixmap on error.
 		 */
 		QPixmap icon(int idx) const;
 
+		/**
+		 * Check if an icon frame has an image.
+		 * This uses the icon metadata, so the icons
+		 * don't have to be decoded.
+		 * @param idx Icon number.
+		 * @return True if the icon frame has an image; false if not.
+		 */
+		bool hasIcon(int idx) const;
+
 		/**
 		 * Get the delay for a given icon.
 		 * FIXME: Use system-independent values.
@@ -214,6 +225,14 @@ class File : public QObject
 		 */
 		int iconAnimMode(void) const;
 
+		/**
+		 * Decode the banner and icon images now.
+		 * Images are normally decoded on first access;
+		 * this can be used to prefetch them for files
+		 * that are about to be displayed.
+		 */
+		void prefetchImages(void) const;
+
 	public:
 		/** Lost File information **/
 
@@ -292,6 +311,13 @@ class File : public QObject
 		 */
 		void setChecksumDefs(const QVector<Checksum::ChecksumDef> &checksumDefs);
 
+		/**
+		 * Are the checksums being calculated in the background?
+		 * The checksum status is CHKST_UNKNOWN until they're done.
+		 * @return True if the checksums are being calculated; false if not.
+		 */
+		bool isChecksumPending(void) const;
+
 		/**
 		 * Get the checksum values.
 		 * @return Checksum values, or empty QVector if no checksum definitions were set.
@@ -319,6 +345,21 @@ class File : public QObject
 		 */
 		QVector<QString> checksumValuesFormatted(void) const;
 
+	signals:
+		/**
+		 * The checksum values have changed.
+		 * This is emitted when the checksum definitions are set,
+		 * when the background checksum job finishes, and when
+		 * the checksums are updated after writing to the file.
+		 */
+		void checksumChanged(void);
+
+	private slots:
+		/**
+		 * The background checksum job has finished.
+		 */
+		void checksumJob_finished_slot(void);
+
 		/** Writing functions. **/
 	signals:
 		/**
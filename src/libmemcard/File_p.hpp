@@ -13,11 +13,49 @@
 class Card;
 class GcImage;
 
-#include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
 
 // C includes.
 #include <stdint.h>
 
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QWaitCondition>
+#include <QtGui/QPixmapCache>
+
+/**
+ * Background checksum job.
+ * Shared by a File and its checksum task.
+ */
+struct ChecksumJob
+{
+	ChecksumJob(File *file, Card *card)
+		: file(file)
+		, card(card)
+		, running(false)
+		, finished(false) { }
+
+	// Set before the task is started.
+	File *const file;
+	Card *const card;
+	QVector<uint16_t> fatEntries;
+	Checksum::ChecksumPlan checksumPlan;
+
+	// Set if the File no longer needs the results.
+	QAtomicInt cancelled;
+
+	// Protected by mutex.
+	QMutex mutex;
+	QWaitCondition stopped;	// Signaled when the task stops running.
+	bool running;
+	bool finished;
+
+	private:
+		Q_DISABLE_COPY(ChecksumJob)
+};
+
 class FilePrivate
 {
 	public:
@@ -52,16 +90,26 @@ class FilePrivate
 		// Size is calculated using fatEntries.size().
 
 		// GcImages. (internal use only)
-		GcImage *gcBanner;
-		QVector<GcImage*> gcIcons;
+		// NOTE: These are decoded on first use.
+		// Call ensureImagesLoaded() before accessing them.
+		mutable bool imagesLoaded;
+		mutable GcImage *gcBanner;
+		mutable QVector<GcImage*> gcIcons;
+
+		// Icon animation metadata.
+		// This is loaded by loadIconInfo(), so it's
+		// available without decoding the images.
 		// FIXME: Use system-independent values.
 		// Currently uses GCN values.
 		QVector<uint8_t> iconSpeed;
 		uint8_t iconAnimMode;
+		mutable uint8_t iconMask;	// Bitfield of icon frames that have an image.
 
 		// QPixmap images.
-		QPixmap banner;
-		QVector<QPixmap> icons;
+		// These are stored in QPixmapCache, which has a size limit.
+		// If a pixmap is evicted, it's converted from the GcImage again.
+		mutable QPixmapCache::Key bannerKey;
+		mutable QVector<QPixmapCache::Key> iconKeys;
 
 		// Lost File information.
 		bool lostFile;
@@ -83,7 +131,7 @@ class FilePrivate
 		 * Load the file data.
 		 * @return QByteArray with file data, or empty QByteArray on error.
 		 */
-		QByteArray loadFileData(void);
+		QByteArray loadFileData(void) const;
 
 		/**
 		 * Read the specified range from the file.
@@ -91,7 +139,7 @@ class FilePrivate
 		 * @param len Length, in blocks.
 		 * @return QByteArray with file data, or empty QByteArray on error.
 		 */
-		QByteArray readBlocks(uint16_t blockStart, int len);
+		QByteArray readBlocks(uint16_t blockStart, int len) const;
 
 		/**
 		 * Strip invalid DOS characters from a filename.
@@ -112,22 +160,49 @@ class FilePrivate
 
 		/** Images **/
 
+		/**
+		 * Load the icon animation metadata.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding any images.
+		 */
+		virtual void loadIconInfo(void) = 0;
+
 		/**
 		 * Load the banner and icon images.
+		 * This decodes the GcImages only; QPixmaps are
+		 * created by getPixmap() when they're needed.
+		 */
+		void loadImages(void) const;
+
+		/**
+		 * Make sure the banner and icon images are loaded.
+		 */
+		inline void ensureImagesLoaded(void) const
+		{
+			if (!imagesLoaded) {
+				loadImages();
+			}
+		}
+
+		/**
+		 * Get a QPixmap for a GcImage, using QPixmapCache.
+		 * @param gcImage	[in] GcImage.
+		 * @param key		[in,out] QPixmapCache key.
+		 * @return QPixmap, or null QPixmap on error.
 		 */
-		void loadImages(void);
+		static QPixmap getPixmap(const GcImage *gcImage, QPixmapCache::Key *key);
 
 		/**
 		 * Load the banner image.
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		virtual GcImage *loadBannerImage(void) = 0;
+		virtual GcImage *loadBannerImage(void) const = 0;
 
 		/**
 		 * Load the icon images.
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		virtual QVector<GcImage*> loadIconImages(void) = 0;
+		virtual QVector<GcImage*> loadIconImages(void) const = 0;
 
 		/** Checksums **/
 
@@ -135,10 +210,65 @@ class FilePrivate
 		QVector<Checksum::ChecksumDef> checksumDefs;
 		QVector<Checksum::ChecksumValue> checksumValues;
 
+		// Checksum plan.
+		// Kept after calculating the checksums so
+		// they can be updated when the file is written.
+		Checksum::ChecksumPlan checksumPlan;
+
+		// Background checksum job.
+		// Null if the checksums aren't being calculated.
+		QSharedPointer<ChecksumJob> checksumJob;
+
 		/**
 		 * Calculate the file checksum.
+		 * The checksums are calculated in the background.
+		 * checksumValues is empty until the job finishes,
+		 * and then File::checksumChanged() is emitted.
 		 */
 		void calculateChecksum(void);
+
+		/**
+		 * Cancel the background checksum job, if any.
+		 * This waits for the task to stop reading the card.
+		 */
+		void cancelChecksumJob(void);
+
+		/**
+		 * Save the results of the background checksum job.
+		 * @return True if the job has finished; false if not.
+		 */
+		bool collectChecksumJob(void);
+
+		/**
+		 * Update the file checksum after the file was written.
+		 * Only the checksums affected by the written data are updated.
+		 * @param address Address of the written data.
+		 * @param oldData Old data.
+		 * @param newData New data.
+		 * @param length Length of the written data, in bytes.
+		 */
+		void updateChecksum(uint32_t address, const uint8_t *oldData,
+				    const uint8_t *newData, uint32_t length);
+
+		/**
+		 * Run the dirty checksums in a checksum plan over the file data.
+		 * NOTE: This may be called from a worker thread.
+		 * @param card Card.
+		 * @param fatEntries FAT entries.
+		 * @param checksumPlan Checksum plan.
+		 * @param cancelled If not nullptr, stop if this is set.
+		 * @return True if the plan was run; false if it was cancelled.
+		 */
+		static bool RunChecksumPlan(Card *card, const QVector<uint16_t> &fatEntries,
+					    Checksum::ChecksumPlan &checksumPlan,
+					    const QAtomicInt *cancelled = nullptr);
+
+	private:
+		/**
+		 * Run the dirty checksums in the checksum plan
+		 * over the file data, and save the checksum values.
+		 */
+		void runChecksumPlan(void);
 };
 
 #endif /* __LIBMEMCARD_FILE_P_HPP__ */
@@ -52,6 +52,20 @@ class GciCardPrivate : public CardPrivate
 		 * @return 0 on success; non-zero on error. (also check errorString)
 		 */
 		int open(const QString &filename);
+
+		/**
+		 * Open a GCI file from memory.
+		 * @param data GCI file data. (implicitly shared)
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int open(const QByteArray &data);
+
+	private:
+		/**
+		 * Load the GCI file after it has been opened.
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int load(void);
 };
 
 GciCardPrivate::GciCardPrivate(GciCard *q)
@@ -83,6 +97,31 @@ int GciCardPrivate::open(const QString &filename)
 		return ret;
 	}
 
+	return load();
+}
+
+/**
+ * Open a GCI file from memory.
+ * @param data GCI file data. (implicitly shared)
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int GciCardPrivate::open(const QByteArray &data)
+{
+	int ret = CardPrivate::open(data, QIODevice::ReadOnly);
+	if (ret != 0) {
+		// Error opening the buffer.
+		return ret;
+	}
+
+	return load();
+}
+
+/**
+ * Load the GCI file after it has been opened.
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int GciCardPrivate::load(void)
+{
 	// Load the directory entry.
 	// This is the first 64 bytes of the GCI file.
 	file->seek(0);
@@ -157,6 +196,23 @@ GciCard *GciCard::open(const QString& filename, QObject *parent)
 	return gciFile;
 }
 
+/**
+ * Open a GCI file from memory.
+ * The data is implicitly shared.
+ * @param data GCI file data.
+ * @param parent Parent object.
+ * @return GciCard object, or nullptr on error.
+ */
+GciCard *GciCard::open(const QByteArray &data, QObject *parent)
+{
+	GciCard *const gciFile = new GciCard(parent);
+	GciCardPrivate *const d = gciFile->d_func();
+	d->open(data);
+	// NOTE: GCI files aren't powers of two, so clear that error.
+	d->errors &= ~Card::MCE_SZ_NON_POW2;
+	return gciFile;
+}
+
 /** Card information **/
 
 /**
@@ -46,6 +46,15 @@ class GciCard : public Card
 		 */
 		static GciCard *open(const QString& filename, QObject *parent);
 
+		/**
+		 * Open a GCI file from memory.
+		 * The data is implicitly shared.
+		 * @param data GCI file data.
+		 * @param parent Parent object.
+		 * @return GciCard object, or nullptr on error.
+		 */
+		static GciCard *open(const QByteArray &data, QObject *parent);
+
 	public:
 		/** File system **/
 
@@ -13,13 +13,27 @@
 #include "GcnFile.hpp"
 
 // C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
 
 // C++ includes.
+#include <algorithm>
 #include <limits>
 using std::list;
 
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtCore/QWaitCondition>
+
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
 /** GcnCardPrivate **/
@@ -47,13 +61,45 @@ class GcnCardPrivate : public CardPrivate
 		 */
 		int open(const QString &filename);
 
+		/**
+		 * Open a Memory Card image from memory.
+		 * @param data Memory Card image data. (implicitly shared)
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int open(const QByteArray &data);
+
+		/**
+		 * Open an existing Memory Card image asynchronously.
+		 * The header and tables are loaded by loadThread.
+		 * @param filename Memory Card image filename.
+		 * @return 0 if loading started; non-zero on error. (also check errorString)
+		 */
+		int openAsync(const QString &filename);
+
 		/**
 		 * Format a new Memory Card image.
 		 * @param filename Memory Card image filename.
-		 * TODO: Parameters.
+		 * @param totalPhysBlocks Total number of physical blocks. (multiple of 16)
 		 * @return 0 on success; non-zero on error. (also check errorString)
 		 */
-		int format(const QString &filename);
+		int format(const QString &filename, int totalPhysBlocks = 256);
+
+		/**
+		 * Is a block part of the file system metadata?
+		 * @param blockIdx Block index.
+		 * @return True if this is a system block; false if not.
+		 */
+		bool isSystemBlock(int blockIdx) const final;
+
+		/**
+		 * Write files to a newly-formatted Memory Card image.
+		 * Files are written in contiguous blocks, followed by
+		 * both copies of the directory and block tables.
+		 * @param files		[in] Files to write.
+		 * @param pFilesWritten	[out,opt] Number of files written.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int rebuild(const QVector<File*> &files, int *pFilesWritten);
 
 	public:
 		// Header checksum.
@@ -75,26 +121,100 @@ class GcnCardPrivate : public CardPrivate
 		card_dat *mc_dat;
 		card_bat *mc_bat;
 
+		// File system consistency report.
+		// Updated by loadGcnFileList().
+		GcnFsck fsck;
+
+	public:
+		/** Asynchronous loading **/
+
+		// Load thread. (Only set while loading the system information.)
+		QThread *loadThread;
+		// Timer for adding files in batches after loadThread finishes.
+		QTimer *loadTimer;
+		// True if the card is being loaded by openAsync().
+		bool loading;
+		// Set by GcnCard::cancelOpen().
+		QAtomicInt loadCancelled;
+		// Error code from loadSysInfo(), set by loadThread.
+		int loadError;
+		// Next directory entry to add.
+		int loadDirIdx;
+
+		// Number of directory entries added per loadTimer tick.
+		static const int LOAD_BATCH_SIZE = 8;
+		// Progress steps: header, 2 DATs, 2 BATs, and the directory entries.
+		static const int LOAD_PROGRESS_SYSINFO = 5;
+		static const int LOAD_PROGRESS_TOTAL = LOAD_PROGRESS_SYSINFO + CARD_MAXFILE;
+
 		/**
-		 * Used block map.
-		 * NOTE: This is only valid for regular files, not "lost" files.
-		 * Value indicates how many files are "using" that block.
-		 * Should be 0 for free, 1 for normal files,
-		 * and >1 for "lost" files that are overlapping other files.
+		 * Report asynchronous loading progress.
+		 * This does nothing if the card isn't being loaded asynchronously.
+		 * @param current Current progress step.
 		 */
-		QVector<uint8_t> usedBlockMap;
+		void updateLoadProgress(int current);
+
+		/**
+		 * Load the system information.
+		 * Called by loadThread.
+		 */
+		void loadSysInfo_threaded(void);
+
+		// File information for each directory entry.
+		// Set by preloadGcnFiles(); used by addGcnFiles().
+		QVector<GcnFile::Info> loadInfo;
+
+		/**
+		 * Load the file information for the active directory table.
+		 * The comment blocks are read on this thread, and the text
+		 * is decoded using the global thread pool. No QObjects are
+		 * created, so this can be called from loadThread.
+		 */
+		void preloadGcnFiles(void);
+
+		/**
+		 * Add GcnFiles for a range of directory entries.
+		 * loadGcnFileList() must be called with addFiles == false first,
+		 * and the file information must be loaded by preloadGcnFiles().
+		 * @param start First directory entry.
+		 * @param end Last directory entry, plus one.
+		 */
+		void addGcnFiles(int start, int end);
+
+		/**
+		 * Stop the load thread and timer.
+		 */
+		void stopLoading(void);
 
 	private:
 		/**
-		 * Reset the used block map.
+		 * Initialize the GCN-specific sizes after the image has been opened.
+		 */
+		void initSizes(void);
+
+		/**
+		 * Load the Memory Card image after it has been opened.
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int load(void);
+
+		/**
+		 * Check if the system information is garbage.
+		 * This should only be called if errors were detected.
+		 */
+		void checkGarbage(void);
+
+		/**
+		 * Reset the block allocation map.
 		 * This function should be called on initial load
 		 * and on directory/block table reload.
 		 */
-		void resetUsedBlockMap(void);
+		void resetBlockMap(void);
 
 		/**
 		 * Load the memory card system information.
-		 * @return 0 on success; non-zero on error.
+		 * A truncated image sets MCE_SHORT_READ; it isn't an error.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
 		 */
 		int loadSysInfo(void);
 
@@ -124,21 +244,53 @@ class GcnCardPrivate : public CardPrivate
 		 */
 		int checkTables(void);
 
+	public:
 		/**
 		 * Load the GcnFile list.
+		 * @param addFiles If false, only clear the current list.
 		 */
-		void loadGcnFileList(void);
+		void loadGcnFileList(bool addFiles = true);
+};
+
+/**
+ * Load thread for GcnCard::openAsync().
+ * Loads the header and tables, which are then
+ * used to add files on the card's thread.
+ */
+class GcnCardLoadThread : public QThread
+{
+	typedef QThread super;
+
+	public:
+		GcnCardLoadThread(GcnCardPrivate *d, QObject *parent)
+			: super(parent)
+			, d(d) { }
+
+	protected:
+		void run(void) final
+		{
+			d->loadSysInfo_threaded();
+		}
+
+	private:
+		GcnCardPrivate *const d;
+		Q_DISABLE_COPY(GcnCardLoadThread)
 };
 
 GcnCardPrivate::GcnCardPrivate(GcnCard *q)
 	: super(q,
 		8192,	// 8 KB blocks.
 		64,	// Minimum card size, in blocks.
-		2048,	// Maximum card size, in blocks.
+		CARD_MAXBLOCKS,	// Maximum card size, in blocks.
 		2,	// Number of directory tables.
 		2)	// Number of block tables.
 	, mc_dat(nullptr)
 	, mc_bat(nullptr)
+	, loadThread(nullptr)
+	, loadTimer(nullptr)
+	, loading(false)
+	, loadError(0)
+	, loadDirIdx(0)
 {
 	// Clear variables.
 	memset(&mc_header, 0, sizeof(mc_header));
@@ -155,7 +307,19 @@ GcnCardPrivate::GcnCardPrivate(GcnCard *q)
 
 GcnCardPrivate::~GcnCardPrivate()
 {
-	// TODO: Remove this?
+	// Make sure the load thread isn't using the card.
+	stopLoading();
+}
+
+/**
+ * Is a block part of the file system metadata?
+ * @param blockIdx Block index.
+ * @return True if this is a system block; false if not.
+ */
+bool GcnCardPrivate::isSystemBlock(int blockIdx) const
+{
+	// Blocks 0-4: Header, DAT x2, BAT x2.
+	return (blockIdx >= 0 && blockIdx < 5);
 }
 
 /**
@@ -171,59 +335,208 @@ int GcnCardPrivate::open(const QString &filename)
 		return ret;
 	}
 
-	// Load the GCN-specific data.
+	return load();
+}
 
+/**
+ * Open a Memory Card image from memory.
+ * @param data Memory Card image data. (implicitly shared)
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int GcnCardPrivate::open(const QByteArray &data)
+{
+	int ret = CardPrivate::open(data, QIODevice::ReadOnly);
+	if (ret != 0) {
+		// Error opening the buffer.
+		return ret;
+	}
+
+	return load();
+}
+
+/**
+ * Open an existing Memory Card image asynchronously.
+ * The header and tables are loaded by loadThread.
+ * @param filename Memory Card image filename.
+ * @return 0 if loading started; non-zero on error. (also check errorString)
+ */
+int GcnCardPrivate::openAsync(const QString &filename)
+{
+	int ret = CardPrivate::open(filename, QIODevice::ReadOnly);
+	if (ret != 0) {
+		// Error opening the file.
+		return ret;
+	}
+
+	initSizes();
+
+	// Start the load thread.
+	// NOTE: The card must not be accessed until loadThread finishes.
+	Q_Q(GcnCard);
+	loading = true;
+	loadCancelled.store(0);
+	loadError = 0;
+	loadThread = new GcnCardLoadThread(this, q);
+	QObject::connect(loadThread, &QThread::finished,
+			 q, &GcnCard::loadThread_finished_slot);
+	loadThread->start();
+	return 0;
+}
+
+/**
+ * Initialize the GCN-specific sizes after the image has been opened.
+ */
+void GcnCardPrivate::initSizes(void)
+{
 	// Total user blocks.
 	totalUserBlocks = (totalPhysBlocks - 5);
 	if (totalUserBlocks < 0)
 		totalUserBlocks = 0;
 
-	// Reset the used block map.
-	resetUsedBlockMap();
+	// Reset the block allocation map.
+	resetBlockMap();
+}
+
+/**
+ * Load the Memory Card image after it has been opened.
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int GcnCardPrivate::load(void)
+{
+	// Load the GCN-specific data.
+	initSizes();
 
 	// Load the memory card system information.
 	// This includes the header, directory, and block allocation table.
-	loadSysInfo();
+	// NOTE: Short reads are reported in errors, not as a failure,
+	// since truncated images can still be searched for lost files.
+	int ret = loadSysInfo();
+	if (ret != 0) {
+		// Device error loading the system information.
+		close();
+		return ret;
+	}
 
 	// Load the GcnFile list.
 	loadGcnFileList();
 
 	if (errors != 0) {
 		// Errors were detected.
-		// Check for garbage.
-		// FIXME: mc_header is only 512 bytes; not the full 8 KB block.
-		// FIXME: Just reread the entire header?
-		uint8_t gbyte[3];
-		int gcount[3];
-		findMostCommonByte((const uint8_t*)&mc_header, sizeof(mc_header), &gbyte[0], &gcount[0]);
-		findMostCommonByte((const uint8_t*)mc_bat_int, sizeof(mc_bat_int), &gbyte[1], &gcount[1]);
-		findMostCommonByte((const uint8_t*)mc_dat_int, sizeof(mc_dat_int), &gbyte[2], &gcount[2]);
-		if (gbyte[0] == gbyte[1] && gbyte[1] == gbyte[2]) {
-			const int count = gcount[0] + gcount[1] + gcount[2];
-			const int total = sizeof(mc_header) + sizeof(mc_bat_int) + sizeof(mc_dat_int);
-			if (count >= (total * 3 / 4)) {
-				// At least 75% of the header is the same byte.
-				// Garbage is likely.
-				// TODO: Figure out the best ratio?
-				garbage.bad_byte = gbyte[0];
-				garbage.count = count;
-				garbage.total = total;
-				errors |= Card::MCE_HEADER_GARBAGE;
-			}
-		}
+		checkGarbage();
 	}
 
 	return 0;
 }
 
+/**
+ * Check if the system information is garbage.
+ * This should only be called if errors were detected.
+ */
+void GcnCardPrivate::checkGarbage(void)
+{
+	// FIXME: mc_header is only 512 bytes; not the full 8 KB block.
+	// FIXME: Just reread the entire header?
+	uint8_t gbyte[3];
+	int gcount[3];
+	findMostCommonByte((const uint8_t*)&mc_header, sizeof(mc_header), &gbyte[0], &gcount[0]);
+	findMostCommonByte((const uint8_t*)mc_bat_int, sizeof(mc_bat_int), &gbyte[1], &gcount[1]);
+	findMostCommonByte((const uint8_t*)mc_dat_int, sizeof(mc_dat_int), &gbyte[2], &gcount[2]);
+	if (gbyte[0] == gbyte[1] && gbyte[1] == gbyte[2]) {
+		const int count = gcount[0] + gcount[1] + gcount[2];
+		const int total = sizeof(mc_header) + sizeof(mc_bat_int) + sizeof(mc_dat_int);
+		if (count >= (total * 3 / 4)) {
+			// At least 75% of the header is the same byte.
+			// Garbage is likely.
+			// TODO: Figure out the best ratio?
+			garbage.bad_byte = gbyte[0];
+			garbage.count = count;
+			garbage.total = total;
+			errors |= Card::MCE_HEADER_GARBAGE;
+		}
+	}
+}
+
+/**
+ * Report asynchronous loading progress.
+ * This does nothing if the card isn't being loaded asynchronously.
+ * @param current Current progress step.
+ */
+void GcnCardPrivate::updateLoadProgress(int current)
+{
+	if (!loading)
+		return;
+
+	// NOTE: This may be emitted from loadThread.
+	// Receivers in other threads get a queued signal.
+	Q_Q(GcnCard);
+	emit q->openProgress(current, LOAD_PROGRESS_TOTAL);
+}
+
+/**
+ * Load the system information.
+ * Called by loadThread.
+ * Errors are stored in loadError.
+ */
+void GcnCardPrivate::loadSysInfo_threaded(void)
+{
+	int ret = loadSysInfo();
+	if (ret == -ECANCELED || loadCancelled.load())
+		return;
+	if (ret != 0) {
+		// Error loading the system information.
+		loadError = ret;
+		return;
+	}
+
+	if (errors != 0) {
+		// Errors were detected.
+		checkGarbage();
+	}
+
+	// Load the file information.
+	// The GcnFiles are created by loadTimer.
+	preloadGcnFiles();
+}
+
+/**
+ * Stop the load thread and timer.
+ */
+void GcnCardPrivate::stopLoading(void)
+{
+	if (loadThread) {
+		loadCancelled.store(1);
+		loadThread->wait();
+		delete loadThread;
+		loadThread = nullptr;
+	}
+	if (loadTimer) {
+		// NOTE: This may be called from the timer's slot.
+		loadTimer->stop();
+		loadTimer->deleteLater();
+		loadTimer = nullptr;
+	}
+	loadInfo.clear();
+	loading = false;
+}
+
 /**
  * Format a new Memory Card image.
  * @param filename Memory Card image filename.
- * TODO: Parameters.
+ * @param totalPhysBlocks Total number of physical blocks. (multiple of 16)
  * @return 0 on success; non-zero on error. (also check errorString)
  */
-int GcnCardPrivate::format(const QString &filename)
+int GcnCardPrivate::format(const QString &filename, int totalPhysBlocks)
 {
+	// The header stores the card size in megabits. (16 blocks)
+	// Valid sizes range from 4 Mbit to the largest card
+	// addressable by the FAT.
+	if (totalPhysBlocks < 64 || totalPhysBlocks > CARD_FATBLOCKS ||
+	    (totalPhysBlocks % 16) != 0)
+	{
+		errorString = QLatin1String("Invalid Memory Card size");
+		return -EINVAL;
+	}
+
 	int ret = CardPrivate::open(filename, QIODevice::ReadWrite);
 	if (ret != 0) {
 		// Error opening the file.
@@ -235,14 +548,17 @@ int GcnCardPrivate::format(const QString &filename)
 	// that doesn't check for errors?
 	errors = QFlags<Card::Error>();
 
-	// Create a 251-block card.
+	// Create the card with the specified number of blocks.
 	// Formatting routine based on the Nintendont Loader (r254).
-	// TODO: Parameters.
 	// TODO: Separate Card::open()'s block count initialization
 	// so it can be used in this function.
-	totalPhysBlocks = 256;
-	file->resize(totalPhysBlocks * blockSize);
-	filesize = file->size();
+	// NOTE: CardPrivate::open() always uses QFile for writable images.
+	QFile *const qfile = qobject_cast<QFile*>(file);
+	assert(qfile != nullptr);
+	this->totalPhysBlocks = totalPhysBlocks;
+	initSizes();
+	qfile->resize(totalPhysBlocks * blockSize);
+	filesize = qfile->size();
 	// TODO: Verify that the filesize matches.
 
 	/**
@@ -315,7 +631,7 @@ int GcnCardPrivate::format(const QString &filename)
 	file->seek(1*blockSize);
 	file->write((char*)mc_dat_int, sizeof(mc_dat_int));
 	file->write((char*)mc_bat_int, sizeof(mc_bat_int));
-	file->flush();
+	qfile->flush();
 
 #if SYS_BYTEORDER != SYS_BIG_ENDIAN
 	// Un-byteswap the tables.
@@ -352,8 +668,8 @@ int GcnCardPrivate::format(const QString &filename)
 		bat_info.valid |= (1 << i);
 	}
 
-	// Reset the used block map.
-	resetUsedBlockMap();
+	// Reset the block allocation map.
+	resetBlockMap();
 
 	// Check which table is active.
 	checkTables();
@@ -368,34 +684,192 @@ int GcnCardPrivate::format(const QString &filename)
 }
 
 /**
- * Reset the used block map.
+ * Write files to a newly-formatted Memory Card image.
+ * Files are written in contiguous blocks, followed by
+ * both copies of the directory and block tables.
+ * @param files		[in] Files to write.
+ * @param pFilesWritten	[out,opt] Number of files written.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnCardPrivate::rebuild(const QVector<File*> &files, int *pFilesWritten)
+{
+	Q_Q(GcnCard);
+
+	// New tables.
+	// Unused directory entries are 0xFF; free blocks are 0.
+	card_dat dat;
+	card_bat bat;
+	memset(&dat, 0xFF, sizeof(dat));
+	memset(&bat, 0, sizeof(bat));
+	static_assert(sizeof(dat) == 8192, "card_dat has the wrong size");
+	static_assert(sizeof(bat) == 8192, "card_bat has the wrong size");
+
+	// Buffer all writes so the data blocks are written in a
+	// single sequential pass before the tables.
+	int ret = q->beginTransaction();
+	if (ret != 0)
+		return ret;
+
+	// Files can only be written to blocks addressable by the FAT.
+	const int maxBlock = std::min(totalPhysBlocks, CARD_FATBLOCKS);
+
+	int filesWritten = 0;
+	int nextBlock = CARD_SYSAREA;
+	foreach (File *file, files) {
+		const GcnFile *const gcnFile = qobject_cast<const GcnFile*>(file);
+		if (!gcnFile)
+			continue;
+		const card_direntry *const srcEntry = gcnFile->dirEntry();
+		const int length = srcEntry->length;
+		if (length <= 0)
+			continue;
+
+		// Check for a file with the same name.
+		// (e.g. a lost file that was also found in the directory)
+		bool isDuplicate = false;
+		for (int i = 0; i < filesWritten; i++) {
+			const card_direntry *const dirEntry = &dat.entries[i];
+			if (!memcmp(dirEntry->gamecode, srcEntry->gamecode, sizeof(dirEntry->gamecode)) &&
+			    !memcmp(dirEntry->company, srcEntry->company, sizeof(dirEntry->company)) &&
+			    !strncmp(dirEntry->filename, srcEntry->filename, sizeof(dirEntry->filename)))
+			{
+				isDuplicate = true;
+				break;
+			}
+		}
+		if (isDuplicate)
+			continue;
+
+		if (filesWritten >= CARD_MAXFILES || nextBlock + length > maxBlock) {
+			// Out of space.
+			ret = -ENOSPC;
+			break;
+		}
+
+		// Load the file data.
+		QByteArray data = file->loadFileData();
+		if (data.isEmpty())
+			continue;
+		const int dataSize = length * (int)blockSize;
+		if (data.size() < dataSize) {
+			data.append(QByteArray(dataSize - data.size(), 0));
+		}
+
+		// Write the blocks and build the FAT chain.
+		const char *const p = data.constData();
+		for (int i = 0; i < length; i++) {
+			const int block = nextBlock + i;
+			ret = q->writeBlock(p + (i * blockSize), blockSize, block);
+			if (ret < 0)
+				break;
+			bat.fat[block - CARD_SYSAREA] = (i == length - 1 ? 0xFFFF : block + 1);
+		}
+		if (ret < 0)
+			break;
+		ret = 0;
+
+		card_direntry *const dirEntry = &dat.entries[filesWritten++];
+		*dirEntry = *srcEntry;
+		dirEntry->block = nextBlock;
+		nextBlock += length;
+	}
+
+	if (ret != 0) {
+		q->rollback();
+		return ret;
+	}
+
+	// Byteswap the tables.
+	// NOTE: Tables are stored in big-endian on the card.
+	bat.freeblocks	= cpu_to_be16(maxBlock - nextBlock);
+	bat.lastalloc	= cpu_to_be16(nextBlock - 1);
+#if SYS_BYTEORDER != SYS_BIG_ENDIAN
+	for (int i = 0; i < filesWritten; i++) {
+		card_direntry *dirEntry	= &dat.entries[i];
+		dirEntry->lastmodified	= cpu_to_be32(dirEntry->lastmodified);
+		dirEntry->iconaddr	= cpu_to_be32(dirEntry->iconaddr);
+		dirEntry->iconfmt	= cpu_to_be16(dirEntry->iconfmt);
+		dirEntry->iconspeed	= cpu_to_be16(dirEntry->iconspeed);
+		dirEntry->block		= cpu_to_be16(dirEntry->block);
+		dirEntry->length	= cpu_to_be16(dirEntry->length);
+		dirEntry->commentaddr	= cpu_to_be32(dirEntry->commentaddr);
+	}
+	for (int i = 0; i < NUM_ELEMENTS(bat.fat); i++) {
+		bat.fat[i] = cpu_to_be16(bat.fat[i]);
+	}
+#endif /* SYS_BYTEORDER != SYS_BIG_ENDIAN */
+
+	// Write both copies of the tables. (blocks 1-4)
+	// The copies are identical except for the update counter.
+	for (int i = 0; i < 2; i++) {
+		dat.dircntrl.updated = cpu_to_be16(i);
+		uint32_t chksum = Checksum::AddInvDual16(
+			reinterpret_cast<const uint16_t*>(&dat),
+			(uint32_t)(sizeof(dat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		dat.dircntrl.chksum1 = cpu_to_be16(chksum >> 16);
+		dat.dircntrl.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		q->writeBlock(&dat, sizeof(dat), 1 + i);
+
+		bat.updated = cpu_to_be16(i);
+		chksum = Checksum::AddInvDual16(
+			(reinterpret_cast<const uint16_t*>(&bat) + 2),
+			(uint32_t)(sizeof(bat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		bat.chksum1 = cpu_to_be16(chksum >> 16);
+		bat.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		q->writeBlock(&bat, sizeof(bat), 3 + i);
+	}
+
+	// Data blocks are committed first, then the tables.
+	ret = q->commit();
+	if (ret != 0) {
+		// Error writing the blocks.
+		q->rollback();
+		return ret;
+	}
+
+	if (pFilesWritten) {
+		*pFilesWritten = filesWritten;
+	}
+	return 0;
+}
+
+/**
+ * Reset the block allocation map.
  * This function should be called on initial load
  * and on directory/block table reload.
  */
-void GcnCardPrivate::resetUsedBlockMap(void)
+void GcnCardPrivate::resetBlockMap(void)
 {
-	// Initialize the used block map.
+	// Initialize the block allocation map.
 	// (The first 5 blocks are always used.)
-	usedBlockMap = QVector<uint8_t>(totalPhysBlocks, 0);
-	for (int i = 0; i < 5 && i < totalPhysBlocks; i++) {
-		usedBlockMap[i] = 1;
-	}
+	blockMap.reset(totalPhysBlocks);
+	blockMap.markUsed(0, std::min(5, totalPhysBlocks));
 }
 
 /**
  * Load the memory card system information.
- * @return 0 on success; non-zero on error.
+ * A truncated image sets MCE_SHORT_READ; it isn't an error.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
  */
 int GcnCardPrivate::loadSysInfo(void)
 {
 	if (!file)
-		return -1;
+		return -EBADF;
 
 	// Header.
 	file->seek(0);
 	qint64 sz = file->read((char*)&mc_header, sizeof(mc_header));
-	if (sz < (qint64)sizeof(mc_header)) {
-		// Error reading the card header.
+	if (sz < 0) {
+		// Device error.
+		// TODO: Translate the error message.
+		this->errorString = file->errorString();
+		return -EIO;
+	} else if (sz < (qint64)sizeof(mc_header)) {
+		// Short read on the card header.
+		// The image is truncated, but the card is still opened
+		// with blank tables so lost files can be searched for.
 		this->errors |= Card::MCE_SHORT_READ;
 
 		// Zero the header and block tables,
@@ -429,11 +903,12 @@ int GcnCardPrivate::loadSysInfo(void)
 
 		// Make sure mc_dat and mc_bat are initialized.
 		checkTables();
-		return -2;
+		return 0;
 	}
 
 	// Calculate the header checksum.
 	headerChecksumValue.actual = Checksum::AddInvDual16((uint16_t*)&mc_header, 0x1FC, Checksum::CHKENDIAN_BIG);
+	updateLoadProgress(1);
 
 #if SYS_BYTEORDER != SYS_BIG_ENDIAN
 	// Byteswap the header contents.
@@ -486,6 +961,11 @@ int GcnCardPrivate::loadSysInfo(void)
 	dat_info.valid = 0;
 	bat_info.valid = 0;
 	for (int i = 0; i < 2; i++) {
+		if (loadCancelled.load()) {
+			// Asynchronous load was cancelled.
+			return -ECANCELED;
+		}
+
 		// Load the directory table.
 		int ret = loadDirTable(&mc_dat_int[i], DAT_addr[i], &mc_dat_chk_actual[i]);
 		if (ret != 0) {
@@ -504,6 +984,7 @@ int GcnCardPrivate::loadSysInfo(void)
 			// DAT is valid.
 			dat_info.valid |= (1 << i);
 		}
+		updateLoadProgress(2 + (i * 2));
 
 		// Load the block table.
 		ret = loadBlockTable(&mc_bat_int[i], BAT_addr[i], &mc_bat_chk_actual[i]);
@@ -545,6 +1026,7 @@ int GcnCardPrivate::loadSysInfo(void)
 			// Free block count is valid.
 			bat_info.valid_freeblocks |= (1 << i);
 		}
+		updateLoadProgress(3 + (i * 2));
 	}
 
 	// Determine which tables are active.
@@ -733,8 +1215,9 @@ int GcnCardPrivate::checkTables(void)
 
 /**
  * Load the GcnFile list.
+ * @param addFiles If false, only clear the current list.
  */
-void GcnCardPrivate::loadGcnFileList(void)
+void GcnCardPrivate::loadGcnFileList(bool addFiles)
 {
 	if (!file)
 		return;
@@ -750,14 +1233,132 @@ void GcnCardPrivate::loadGcnFileList(void)
 	if (init_size > 0)
 		emit q->filesRemoved();
 
-	// Reset the used block map.
-	resetUsedBlockMap();
+	// Reset the block allocation map.
+	resetBlockMap();
+
+	// Check the file system.
+	// The selected block table is checked with the selected
+	// directory table, and the other block table is checked
+	// with the other directory table.
+	if (mc_dat && mc_bat) {
+		const int datIdx = (int)(mc_dat - mc_dat_int);
+		const int batIdx = (int)(mc_bat - mc_bat_int);
+		const card_dat *pairedDat[2];
+		pairedDat[batIdx] = mc_dat;
+		pairedDat[!batIdx] = &mc_dat_int[!datIdx];
+		fsck.check(pairedDat, mc_bat_int, totalPhysBlocks);
+	}
 
-	QVector<File*> lstFiles_new;
-	lstFiles_new.reserve(NUM_ELEMENTS(mc_dat->entries));
+	if (addFiles) {
+		preloadGcnFiles();
+		addGcnFiles(0, NUM_ELEMENTS(mc_dat->entries));
+		loadInfo.clear();
 
-	// Byteswap the directory table contents.
-	for (int i = 0; i < NUM_ELEMENTS(mc_dat->entries); i++) {
+		// Block count has changed.
+		emit q->blockCountChanged(totalPhysBlocks, totalUserBlocks, freeBlocks);
+	}
+}
+
+/**
+ * Decode the text of GcnFile information in parallel.
+ * The calling thread decodes entries too, so it never waits
+ * for tasks that are queued behind other jobs in the pool.
+ */
+class GcnFileDecodeJob
+{
+	public:
+		GcnFileDecodeJob(const Card *card, const QVector<GcnFile::Info*> &infos)
+			: card(card)
+			, infos(infos)
+			, remaining(infos.size()) { }
+
+		/**
+		 * Decode entries until there are none left.
+		 * Tasks that start after all entries were taken just return.
+		 */
+		void run(void)
+		{
+			int count = 0;
+			for (;;) {
+				const int i = next.fetchAndAddRelaxed(1);
+				if (i >= infos.size())
+					break;
+				GcnFile::decodeInfo(card, infos[i]);
+				count++;
+			}
+			if (count == 0)
+				return;
+
+			QMutexLocker locker(&mutex);
+			remaining -= count;
+			if (remaining == 0) {
+				finished.wakeAll();
+			}
+		}
+
+		/**
+		 * Wait for all entries to be decoded.
+		 */
+		void wait(void)
+		{
+			QMutexLocker locker(&mutex);
+			while (remaining > 0) {
+				finished.wait(&mutex);
+			}
+		}
+
+	private:
+		const Card *const card;
+		const QVector<GcnFile::Info*> infos;
+		QAtomicInt next;	// Next entry to decode.
+
+		QMutex mutex;
+		QWaitCondition finished;
+		int remaining;		// Entries not decoded yet. (protected by mutex)
+
+		Q_DISABLE_COPY(GcnFileDecodeJob)
+};
+
+/**
+ * Thread pool task for GcnFileDecodeJob.
+ */
+class GcnFileDecodeTask : public QRunnable
+{
+	public:
+		explicit GcnFileDecodeTask(const QSharedPointer<GcnFileDecodeJob> &job)
+			: job(job) { }
+
+		void run(void) final
+		{
+			job->run();
+		}
+
+	private:
+		const QSharedPointer<GcnFileDecodeJob> job;
+		Q_DISABLE_COPY(GcnFileDecodeTask)
+};
+
+/**
+ * Load the file information for the active directory table.
+ * The comment blocks are read on this thread, and the text
+ * is decoded using the global thread pool. No QObjects are
+ * created, so this can be called from loadThread.
+ */
+void GcnCardPrivate::preloadGcnFiles(void)
+{
+	loadInfo.clear();
+	if (!mc_dat)
+		return;
+
+	Q_Q(GcnCard);
+	loadInfo.resize(NUM_ELEMENTS(mc_dat->entries));
+	GcnFile::Info *const infos = loadInfo.data();
+	QVector<GcnFile::Info*> toDecode;
+	toDecode.reserve(loadInfo.size());
+
+	// Read the comment blocks.
+	// NOTE: The card's device is shared, so this isn't done in parallel.
+	for (int i = 0; i < loadInfo.size(); i++) {
 		const card_direntry *dirEntry = &mc_dat->entries[i];
 
 		// If the game code is 0xFFFFFFFF, the entry is empty.
@@ -772,35 +1373,67 @@ void GcnCardPrivate::loadGcnFileList(void)
 			continue;
 
 		// Valid directory entry.
-		GcnFile *mcFile = new GcnFile(q, dirEntry, mc_bat);
+		GcnFile::readInfo(q, dirEntry, mc_bat, &infos[i]);
+		toDecode.append(&infos[i]);
+	}
+
+	// Decode the text.
+	// Small directories aren't worth using the thread pool.
+	static const int MIN_FILES_PER_TASK = 16;
+	QThreadPool *const pool = QThreadPool::globalInstance();
+	const int taskCount = std::min(pool->maxThreadCount(),
+		(int)toDecode.size() / MIN_FILES_PER_TASK) - 1;
+	QSharedPointer<GcnFileDecodeJob> job(new GcnFileDecodeJob(q, toDecode));
+	for (int i = 0; i < taskCount; i++) {
+		pool->start(new GcnFileDecodeTask(job));
+	}
+	job->run();
+	job->wait();
+}
+
+/**
+ * Add GcnFiles for a range of directory entries.
+ * loadGcnFileList() must be called with addFiles == false first,
+ * and the file information must be loaded by preloadGcnFiles().
+ * @param start First directory entry.
+ * @param end Last directory entry, plus one.
+ */
+void GcnCardPrivate::addGcnFiles(int start, int end)
+{
+	Q_Q(GcnCard);
+	QVector<File*> lstFiles_new;
+	lstFiles_new.reserve(end - start);
+	end = std::min(end, loadInfo.size());
+
+	for (int i = start; i < end; i++) {
+		const GcnFile::Info &info = loadInfo.at(i);
+		if (!info.dirEntry) {
+			// Empty directory entry.
+			continue;
+		}
+
+		// Valid directory entry.
+		GcnFile *mcFile = new GcnFile(q, info);
 		lstFiles_new.append(mcFile);
 
 		// Mark the file's blocks as used.
-		QVector<uint16_t> fatEntries = mcFile->fatEntries();
-		foreach (uint16_t block, fatEntries) {
-			if (block >= 5 && block < usedBlockMap.size()) {
+		foreach (uint16_t block, info.fatEntries) {
+			if (block >= 5 && block < blockMap.size()) {
 				// Valid block.
-				// Increment its entry in the usedBlockMap.
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max())
-					usedBlockMap[block]++;
-			} else {
-				// Invalid block.
-				// TODO: Store an error value somewhere.
-				fprintf(stderr, "WARNING: File %d has invalid FAT entry 0x%04X.\n", i, block);
+				// Mark it as used in the block map.
+				blockMap.markUsed(block);
 			}
+			// NOTE: Invalid blocks are reported by GcnFsck.
 		}
 	}
 
 	if (!lstFiles_new.isEmpty()) {
 		// Files have been added to the memory card.
-		emit q->filesAboutToBeInserted(0, (lstFiles_new.size() - 1));
-		// NOTE: QVector::swap() was added in qt-4.8.
-		lstFiles = lstFiles_new;
+		const int idx = lstFiles.size();
+		emit q->filesAboutToBeInserted(idx, idx + (lstFiles_new.size() - 1));
+		lstFiles += lstFiles_new;
 		emit q->filesInserted();
 	}
-
-	// Block count has changed.
-	emit q->blockCountChanged(totalPhysBlocks, totalUserBlocks, freeBlocks);
 }
 
 /** GcnCard **/
@@ -828,6 +1461,21 @@ GcnCard *GcnCard::open(const QString& filename, QObject *parent)
 	return gcnCard;
 }
 
+/**
+ * Open a Memory Card image from memory.
+ * The data is implicitly shared, and is detached if written to.
+ * @param data Memory Card image data.
+ * @param parent Parent object.
+ * @return GcnCard object, or nullptr on error.
+ */
+GcnCard *GcnCard::open(const QByteArray &data, QObject *parent)
+{
+	GcnCard *gcnCard = new GcnCard(parent);
+	GcnCardPrivate *const d = gcnCard->d_func();
+	d->open(data);
+	return gcnCard;
+}
+
 /**
  * Format a new Memory Card image.
  * @param filename Filename.
@@ -844,6 +1492,95 @@ GcnCard *GcnCard::format(const QString& filename, QObject *parent)
 	return gcnCard;
 }
 
+/**
+ * Rebuild a Memory Card image.
+ *
+ * A new image is formatted, and the specified files are
+ * written to it in contiguous blocks, in order, followed
+ * by consistent directory and block tables.
+ *
+ * Non-GCN files and files with the same name as a file
+ * that was already written are skipped.
+ *
+ * NOTE: filename must not be the image that contains
+ * the specified files.
+ *
+ * @param filename	[in] Filename for the new image.
+ * @param files		[in] Files to write. (may be from any GcnCard)
+ * @param totalPhysBlocks	[in] Size of the new image, in blocks. (usually the source card's size)
+ * @param pFilesWritten	[out,opt] Number of files written.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcnCard::rebuild(const QString &filename, const QVector<File*> &files,
+		     int totalPhysBlocks, int *pFilesWritten)
+{
+	// Truncated or padded dumps may not be a valid card size.
+	// Round up to the next megabit, within the supported sizes.
+	totalPhysBlocks = (totalPhysBlocks + 15) & ~15;
+	totalPhysBlocks = std::max(totalPhysBlocks, 64);
+	totalPhysBlocks = std::min(totalPhysBlocks, CARD_FATBLOCKS);
+
+	GcnCard gcnCard;
+	GcnCardPrivate *const d = gcnCard.d_func();
+	int ret = d->format(filename, totalPhysBlocks);
+	if (ret != 0) {
+		// Error formatting the new image.
+		return (ret < 0 ? ret : -EIO);
+	}
+	return d->rebuild(files, pFilesWritten);
+}
+
+/**
+ * Open an existing Memory Card image asynchronously.
+ * The header and tables are loaded in a separate thread,
+ * and files are added in batches from the event loop.
+ * openFinished() is emitted once loading is complete.
+ * @param filename Filename.
+ * @param parent Parent object.
+ * @return GcnCard object, or nullptr on error.
+ */
+GcnCard *GcnCard::openAsync(const QString& filename, QObject *parent)
+{
+	GcnCard *gcnCard = new GcnCard(parent);
+	GcnCardPrivate *const d = gcnCard->d_func();
+	d->openAsync(filename);
+	return gcnCard;
+}
+
+/**
+ * Is the Memory Card image still being loaded?
+ * Only applicable if opened with openAsync().
+ * @return True if loading; false if not.
+ */
+bool GcnCard::isLoading(void) const
+{
+	Q_D(const GcnCard);
+	return d->loading;
+}
+
+/**
+ * Cancel an asynchronous open.
+ * openFinished() will be emitted with -ECANCELED.
+ */
+void GcnCard::cancelOpen(void)
+{
+	Q_D(GcnCard);
+	if (!d->loading)
+		return;
+
+	d->loadCancelled.store(1);
+	if (d->loadTimer) {
+		// The load thread has already finished.
+		// Stop adding files.
+		d->stopLoading();
+		d->close();
+		emit openFinished(-ECANCELED);
+	}
+
+	// Otherwise, loadThread_finished_slot()
+	// will handle the cancellation.
+}
+
 /** File system **/
 
 /**
@@ -853,9 +1590,9 @@ GcnCard *GcnCard::format(const QString& filename, QObject *parent)
  */
 void GcnCard::setActiveDatIdx(int idx)
 {
-	if (!isOpen())
-		return;
 	Q_D(GcnCard);
+	if (!isOpen() || d->loading)
+		return;
 	if (idx < 0 || idx >= NUM_ELEMENTS(d->mc_dat_int))
 		return;
 	const int old_idx = d->dat_info.active;
@@ -873,9 +1610,9 @@ void GcnCard::setActiveDatIdx(int idx)
  */
 void GcnCard::setActiveBatIdx(int idx)
 {
-	if (!isOpen())
-		return;
 	Q_D(GcnCard);
+	if (!isOpen() || d->loading)
+		return;
 	if (idx < 0 || idx >= NUM_ELEMENTS(d->mc_bat_int))
 		return;
 	const int old_idx = d->dat_info.active;
@@ -899,19 +1636,6 @@ QString GcnCard::productName(void) const
 	return tr("GameCube memory card");
 }
 
-/**
- * Get the used block map.
- * NOTE: This is only valid for regular files, not "lost" files.
- * @return Used block map.
- */
-QVector<uint8_t> GcnCard::usedBlockMap(void)
-{
-	if (!isOpen())
-		return QVector<uint8_t>();
-	Q_D(GcnCard);
-	return d->usedBlockMap;
-}
-
 /**
  * Add a "lost" file.
  * NOTE: This is a debugging version.
@@ -928,21 +1652,22 @@ GcnFile *GcnCard::addLostFile(const card_direntry *dirEntry)
 	QVector<uint16_t> fatEntries;
 	fatEntries.reserve(dirEntry->length);
 
-	const uint16_t maxBlockNum = ((uint16_t)totalPhysBlocks() - 1);
+	// NOTE: Lost files aren't in the FAT, so they may use
+	// any block on the card, including oversized cards.
+	const int maxBlockNum = (totalPhysBlocks() - 1);
 	// FIXME: <= 5? Maybe it should be < 5, but since
 	// GCN cards are supposed to be at least 59(64),
 	// this probably isn't a problem.
-	if (maxBlockNum <= 5 || maxBlockNum > 4091) {
+	if (maxBlockNum <= 5) {
 		// Invalid maximum block size. Don't initialize the FAT.
 		// TODO: Print an error message.
 	} else {
 		// Initialize the FAT.
-		uint16_t block = dirEntry->block;
-		uint16_t length = dirEntry->length;
-		for (; length > 0; length--, block++) {
+		int block = dirEntry->block;
+		for (int length = dirEntry->length; length > 0; length--, block++) {
 			if (block > maxBlockNum)
 				block = 5;
-			fatEntries.append(block);
+			fatEntries.append((uint16_t)block);
 		}
 	}
 
@@ -1007,6 +1732,18 @@ QList<GcnFile*> GcnCard::addLostFiles(const std::list<GcnSearchData> &filesFound
 	return files;
 }
 
+/**
+ * Get the file system consistency report.
+ * The file system is checked whenever the
+ * directory and block tables are (re)loaded.
+ * @return File system consistency report.
+ */
+GcnFsck GcnCard::fsck(void) const
+{
+	Q_D(const GcnCard);
+	return d->fsck;
+}
+
 /**
  * Get the header checksum value.
  * NOTE: Header checksum is always AddInvDual16.
@@ -1017,3 +1754,68 @@ Checksum::ChecksumValue GcnCard::headerChecksumValue(void) const
 	Q_D(const GcnCard);
 	return d->headerChecksumValue;
 }
+
+/** Asynchronous loading **/
+
+/**
+ * The load thread has finished.
+ */
+void GcnCard::loadThread_finished_slot(void)
+{
+	Q_D(GcnCard);
+	if (!d->loadThread)
+		return;
+	d->loadThread->deleteLater();
+	d->loadThread = nullptr;
+
+	if (d->loadCancelled.load()) {
+		// Loading was cancelled.
+		d->loading = false;
+		d->close();
+		emit openFinished(-ECANCELED);
+		return;
+	}
+
+	if (d->loadError != 0) {
+		// Error loading the system information.
+		// NOTE: errorString was set by loadSysInfo().
+		d->loading = false;
+		d->close();
+		emit openFinished(d->loadError);
+		return;
+	}
+
+	// Add files in batches from the event loop.
+	// NOTE: GcnFile objects are children of the GcnCard,
+	// so they must be created on the GcnCard's thread.
+	d->loadGcnFileList(false);
+	d->loadDirIdx = 0;
+	d->loadTimer = new QTimer(this);
+	d->loadTimer->setInterval(0);
+	connect(d->loadTimer, &QTimer::timeout,
+		this, &GcnCard::loadTimer_timeout_slot);
+	d->loadTimer->start();
+}
+
+/**
+ * Add the next batch of files.
+ */
+void GcnCard::loadTimer_timeout_slot(void)
+{
+	Q_D(GcnCard);
+	if (!d->loadTimer)
+		return;
+
+	const int count = NUM_ELEMENTS(d->mc_dat->entries);
+	const int end = std::min(d->loadDirIdx + GcnCardPrivate::LOAD_BATCH_SIZE, count);
+	d->addGcnFiles(d->loadDirIdx, end);
+	d->loadDirIdx = end;
+	d->updateLoadProgress(GcnCardPrivate::LOAD_PROGRESS_SYSINFO + end);
+	if (end < count)
+		return;
+
+	// All files have been added.
+	d->stopLoading();
+	emit blockCountChanged(d->totalPhysBlocks, d->totalUserBlocks, d->freeBlocks);
+	emit openFinished(0);
+}
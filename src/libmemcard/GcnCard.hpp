@@ -13,6 +13,7 @@
 
 #include "card.h"
 #include "Checksum.hpp"
+#include "GcnFsck.hpp"
 #include "GcnSearchData.hpp"
 
 // C++ includes.
@@ -48,6 +49,15 @@ class GcnCard : public Card
 		 */
 		static GcnCard *open(const QString& filename, QObject *parent);
 
+		/**
+		 * Open a Memory Card image from memory.
+		 * The data is implicitly shared, and is detached if written to.
+		 * @param data Memory Card image data.
+		 * @param parent Parent object.
+		 * @return GcnCard object, or nullptr on error.
+		 */
+		static GcnCard *open(const QByteArray &data, QObject *parent);
+
 		/**
 		 * Format a new Memory Card image.
 		 * @param filename Filename.
@@ -56,6 +66,77 @@ class GcnCard : public Card
 		 */
 		static GcnCard *format(const QString& filename, QObject *parent);
 
+		/**
+		 * Rebuild a Memory Card image.
+		 *
+		 * A new image is formatted, and the specified files are
+		 * written to it in contiguous blocks, in order, followed
+		 * by consistent directory and block tables.
+		 *
+		 * Non-GCN files and files with the same name as a file
+		 * that was already written are skipped.
+		 *
+		 * NOTE: filename must not be the image that contains
+		 * the specified files.
+		 *
+		 * @param filename	[in] Filename for the new image.
+		 * @param files		[in] Files to write. (may be from any GcnCard)
+		 * @param totalPhysBlocks	[in] Size of the new image, in blocks. (usually the source card's size)
+		 * @param pFilesWritten	[out,opt] Number of files written.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		static int rebuild(const QString &filename, const QVector<File*> &files,
+				   int totalPhysBlocks, int *pFilesWritten = nullptr);
+
+		/**
+		 * Open an existing Memory Card image asynchronously.
+		 * The header and tables are loaded in a separate thread,
+		 * and files are added in batches from the event loop.
+		 * openFinished() is emitted once loading is complete.
+		 * @param filename Filename.
+		 * @param parent Parent object.
+		 * @return GcnCard object, or nullptr on error.
+		 */
+		static GcnCard *openAsync(const QString& filename, QObject *parent);
+
+		/**
+		 * Is the Memory Card image still being loaded?
+		 * Only applicable if opened with openAsync().
+		 * @return True if loading; false if not.
+		 */
+		bool isLoading(void) const;
+
+		/**
+		 * Cancel an asynchronous open.
+		 * openFinished() will be emitted with -ECANCELED.
+		 */
+		void cancelOpen(void);
+
+	signals:
+		/**
+		 * Asynchronous open progress.
+		 * @param current Current step.
+		 * @param total Total number of steps.
+		 */
+		void openProgress(int current, int total);
+
+		/**
+		 * Asynchronous open has finished.
+		 * @param ret 0 on success; negative POSIX error code on error.
+		 */
+		void openFinished(int ret);
+
+	private slots:
+		/**
+		 * The load thread has finished.
+		 */
+		void loadThread_finished_slot(void);
+
+		/**
+		 * Add the next batch of files.
+		 */
+		void loadTimer_timeout_slot(void);
+
 	public:
 		/** File system **/
 
@@ -84,13 +165,6 @@ class GcnCard : public Card
 		 */
 		QString productName(void) const final;
 
-		/**
-		 * Get the used block map.
-		 * NOTE: This is only valid for regular files, not "lost" files.
-		 * @return Used block map.
-		 */
-		QVector<uint8_t> usedBlockMap(void);
-
 		/**
 		 * Add a "lost" file.
 		 * NOTE: This is a debugging version.
@@ -114,6 +188,14 @@ class GcnCard : public Card
 		 */
 		QList<GcnFile*> addLostFiles(const std::list<GcnSearchData> &filesFoundList);
 
+		/**
+		 * Get the file system consistency report.
+		 * The file system is checked whenever the
+		 * directory and block tables are (re)loaded.
+		 * @return File system consistency report.
+		 */
+		GcnFsck fsck(void) const;
+
 		/**
 		 * Get the header checksum value.
 		 * NOTE: Header checksum is always AddInvDual16.
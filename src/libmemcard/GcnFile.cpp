@@ -21,6 +21,7 @@
 #include <cassert>
 
 // C++ includes.
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -72,6 +73,17 @@ class GcnFilePrivate : public FilePrivate
 			const card_direntry *dirEntry,
 			const QVector<uint16_t> &fatEntries);
 
+		/**
+		 * Initialize the GcnFile private class.
+		 * This constructor is for valid files,
+		 * using file information from GcnFile::readInfo()
+		 * and GcnFile::decodeInfo().
+		 * @param q GcnFile.
+		 * @param card GcnCard (or GciCard)
+		 * @param info File information.
+		 */
+		GcnFilePrivate(GcnFile *q, Card *card, const GcnFile::Info &info);
+
 		virtual ~GcnFilePrivate();
 
 	protected:
@@ -79,19 +91,49 @@ class GcnFilePrivate : public FilePrivate
 	private:
 		Q_DISABLE_COPY(GcnFilePrivate)
 
+		/**
+		 * Load the file information.
+		 */
+		void loadFileInfo(void);
+
+		/**
+		 * Set the file information.
+		 * @param info File information.
+		 */
+		void applyInfo(const GcnFile::Info &info);
+
+	public:
 		/**
 		 * Get a QTextCodec for a given region.
 		 * @param region Region code. (If 0, use the memory card's encoding.)
+		 * @param cardEncoding Memory card's encoding.
 		 * @return QTextCodec.
 		 */
-		QTextCodec *textCodecForRegion(char region) const;
+		static QTextCodec *textCodecForRegion(char region, Card::Encoding cardEncoding);
 
 		/**
-		 * Load the file information.
+		 * Get the FAT entries for a valid file.
+		 * @param card GcnCard (or GciCard)
+		 * @param dirEntry Directory Entry pointer.
+		 * @param mc_bat Block table.
+		 * @return FAT entries.
 		 */
-		void loadFileInfo(void);
+		static QVector<uint16_t> loadFatEntries(const Card *card,
+			const card_direntry *dirEntry,
+			const card_bat *mc_bat);
+
+		/**
+		 * Read the file comments.
+		 * @param card GcnCard (or GciCard)
+		 * @param dirEntry Directory Entry pointer.
+		 * @param fatEntries FAT entries.
+		 * @return Raw comments (64 bytes), or empty QByteArray on error.
+		 */
+		static QByteArray readComments(Card *card,
+			const card_direntry *dirEntry,
+			const QVector<uint16_t> &fatEntries);
+
 
-	public:
 		const card_bat *mc_bat;	// Block table. (TODO: Do we need to store this?)
 
 		/**
@@ -107,17 +149,24 @@ class GcnFilePrivate : public FilePrivate
 		QString gameDesc;
 		QString fileDesc;
 
+		/**
+		 * Load the icon animation metadata.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding any images.
+		 */
+		void loadIconInfo(void) final;
+
 		/**
 		 * Load the banner image.
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		GcImage *loadBannerImage(void) final;
+		GcImage *loadBannerImage(void) const final;
 
 		/**
 		 * Load the icon images.
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		QVector<GcImage*> loadIconImages(void) final;
+		QVector<GcImage*> loadIconImages(void) const final;
 };
 
 /**
@@ -144,34 +193,8 @@ GcnFilePrivate::GcnFilePrivate(GcnFile *q, Card *card,
 		return;
 	}
 
-	// Clamp file length to the size of the memory card.
-	// This shouldn't happen, but it's possible if either
-	// the filesystem is heavily corrupted, or the file
-	// isn't actually a GCN Memory Card image.
-	int length = dirEntry->length;
-	if (length > card->totalUserBlocks())
-		length = card->totalUserBlocks();
-
 	// Load the FAT entries.
-	fatEntries.clear();
-	fatEntries.reserve(length);
-	uint16_t next_block = dirEntry->block;
-	if (next_block >= 5 && next_block != 0xFFFF &&
-	    next_block < (uint16_t)NUM_ELEMENTS(mc_bat->fat)) {
-		fatEntries.append(next_block);
-
-		// Go through the rest of the blocks.
-		for (int i = length; i > 1; i--) {
-			next_block = mc_bat->fat[next_block - 5];
-			if (next_block == 0xFFFF || next_block < 5 ||
-			    next_block >= (uint16_t)NUM_ELEMENTS(mc_bat->fat))
-			{
-				// Next block is invalid.
-				break;
-			}
-			fatEntries.append(next_block);
-		}
-	}
+	fatEntries = loadFatEntries(card, dirEntry, mc_bat);
 
 	// Load the file information.
 	loadFileInfo();
@@ -233,6 +256,33 @@ GcnFilePrivate::GcnFilePrivate(GcnFile *q, Card *card,
 	loadFileInfo();
 }
 
+/**
+ * Initialize the GcnFile private class.
+ * This constructor is for valid files,
+ * using file information from GcnFile::readInfo()
+ * and GcnFile::decodeInfo().
+ * @param q GcnFile.
+ * @param card GcnCard (or GciCard)
+ * @param info File information.
+ */
+GcnFilePrivate::GcnFilePrivate(GcnFile *q, Card *card, const GcnFile::Info &info)
+	: super(q, card)
+	, mc_bat(info.mc_bat)
+	, dirEntry(info.dirEntry)
+{
+	if (!dirEntry || !mc_bat) {
+		// Invalid data.
+		this->dirEntry = nullptr;
+		this->mc_bat = nullptr;
+
+		// This file is basically useless now...
+		return;
+	}
+
+	this->fatEntries = info.fatEntries;
+	applyInfo(info);
+}
+
 GcnFilePrivate::~GcnFilePrivate()
 {
 	if (lostFile) {
@@ -245,9 +295,10 @@ GcnFilePrivate::~GcnFilePrivate()
 /**
  * Get a QTextCodec for a given region.
  * @param region Region code. (If 0, use the memory card's encoding.)
+ * @param cardEncoding Memory card's encoding.
  * @return QTextCodec.
  */
-QTextCodec *GcnFilePrivate::textCodecForRegion(char region) const
+QTextCodec *GcnFilePrivate::textCodecForRegion(char region, Card::Encoding cardEncoding)
 {
 	static QTextCodec *shiftJis = QTextCodec::codecForName("Shift_JIS");
 	static QTextCodec *cp1252 = QTextCodec::codecForName("cp1252");
@@ -263,7 +314,7 @@ QTextCodec *GcnFilePrivate::textCodecForRegion(char region) const
 	switch (region) {
 		case 0:
 			// Use the memory card's encoding.
-			encoding = card->encoding();
+			encoding = cardEncoding;
 			break;
 
 		case 'J':
@@ -289,102 +340,171 @@ QTextCodec *GcnFilePrivate::textCodecForRegion(char region) const
 }
 
 /**
- * Load the file information.
+ * Get the FAT entries for a valid file.
+ * @param card GcnCard (or GciCard)
+ * @param dirEntry Directory Entry pointer.
+ * @param mc_bat Block table.
+ * @return FAT entries.
  */
-void GcnFilePrivate::loadFileInfo(void)
+QVector<uint16_t> GcnFilePrivate::loadFatEntries(const Card *card,
+	const card_direntry *dirEntry,
+	const card_bat *mc_bat)
 {
-	// Game ID is always Latin-1.
-	// NOTE: gamecode and company are right next to each other,
-	// so we can "overrun" the buffer here.
-	gameID = QString::fromLatin1(dirEntry->gamecode,
-			sizeof(dirEntry->gamecode) + sizeof(dirEntry->company));
-
-	// TODO: Use decodeText_SJISorCP1252() instead?
-	// Get the appropriate QTextCodec for this file.
-	const char region = (gameID.size() >= 4
-				? gameID.at(3).toLatin1()
-				: 0);
-	QTextCodec *textCodec = textCodecForRegion(region);
+	// Clamp file length to the size of the memory card.
+	// This shouldn't happen, but it's possible if either
+	// the filesystem is heavily corrupted, or the file
+	// isn't actually a GCN Memory Card image.
+	int length = dirEntry->length;
+	if (length > card->totalUserBlocks())
+		length = card->totalUserBlocks();
 
-	// Remove trailing NULL characters before converting to UTF-8.
-	QByteArray filenameData(dirEntry->filename, sizeof(dirEntry->filename));
-	int nullChr = filenameData.indexOf('\0');
-	if (nullChr >= 0)
-		filenameData.resize(nullChr);
+	// Load the FAT entries.
+	// Only blocks addressable by the FAT are valid,
+	// even if the card image is larger.
+	const int maxBlock = std::min(card->totalPhysBlocks(), CARD_FATBLOCKS);
+	QVector<uint16_t> fatEntries;
+	fatEntries.reserve(length);
+	int next_block = dirEntry->block;
+	if (next_block >= CARD_SYSAREA && next_block < maxBlock) {
+		fatEntries.append((uint16_t)next_block);
 
-	// Convert the filename to UTF-8.
-	if (!textCodec) {
-		// No text codec was found.
-		// Default to Latin-1.
-		filename = QString::fromLatin1(filenameData.constData(), filenameData.size());
-	} else {
-		// Use the text codec.
-		filename = textCodec->toUnicode(filenameData.constData(), filenameData.size());
+		// Go through the rest of the blocks.
+		for (int i = length; i > 1; i--) {
+			next_block = mc_bat->fat[next_block - CARD_SYSAREA];
+			if (next_block < CARD_SYSAREA || next_block >= maxBlock)
+			{
+				// Next block is invalid.
+				break;
+			}
+			fatEntries.append((uint16_t)next_block);
+		}
 	}
 
-	// Timestamp.
-	mtime = TimeFuncs::fromGcnTimestamp(dirEntry->lastmodified);
-
-	// Mode.
-	// GCN permission bits map nicely to File::ModeBits.
-	this->mode = (dirEntry->permission >> 2) & 0x0F;
+	return fatEntries;
+}
 
+/**
+ * Read the file comments.
+ * @param card GcnCard (or GciCard)
+ * @param dirEntry Directory Entry pointer.
+ * @param fatEntries FAT entries.
+ * @return Raw comments (64 bytes), or empty QByteArray on error.
+ */
+QByteArray GcnFilePrivate::readComments(Card *card,
+	const card_direntry *dirEntry,
+	const QVector<uint16_t> &fatEntries)
+{
 	// Get the block size.
 	const int blockSize = card->blockSize();
 
 	// Load the block containing the comments.
 	const int commentBlock = (dirEntry->commentaddr / blockSize);
 	const int commentOffset = (dirEntry->commentaddr % blockSize);
+	if (commentBlock >= fatEntries.size() || commentOffset > blockSize - 64) {
+		// Comments are outside of the file.
+		// File is probably invalid.
+		return QByteArray();
+	}
 
 	unique_ptr<char[]> commentData(new char[blockSize]);
-	int ret = card->readBlock(commentData.get(), blockSize, fileBlockAddrToPhysBlockAddr(commentBlock));
+	int ret = card->readBlock(commentData.get(), blockSize, fatEntries.at(commentBlock));
 	if (ret != blockSize) {
 		// Read error.
 		// File is probably invalid.
-		return;
+		return QByteArray();
 	}
 
-	// Load the file comments. (64 bytes)
 	// NOTE: These comments are supposed to be NULL-terminated.
 	// 0x00: Game description.
 	// 0x20: File description.
-	QByteArray gameDescData(&commentData[commentOffset], 32);
-	QByteArray fileDescData(&commentData[commentOffset+32], 32);
+	return QByteArray(&commentData[commentOffset], 64);
+}
 
-	// Remove trailing NULL characters before converting to UTF-8.
-	nullChr = gameDescData.indexOf('\0');
-	if (nullChr >= 0)
-		gameDescData.resize(nullChr);
-	nullChr = fileDescData.indexOf('\0');
-	if (nullChr >= 0)
-		fileDescData.resize(nullChr);
+/**
+ * Load the file information.
+ */
+void GcnFilePrivate::loadFileInfo(void)
+{
+	GcnFile::Info info;
+	info.dirEntry = dirEntry;
+	info.mc_bat = mc_bat;
+	info.comments = readComments(card, dirEntry, fatEntries);
+	GcnFile::decodeInfo(card, &info);
+	applyInfo(info);
+}
 
-	// Convert the descriptions to UTF-8.
-	// Trim the descriptions while we're at it.
-	if (!textCodec) {
-		// No text codec was found.
-		// Default to Latin-1.
-		gameDesc = QString::fromLatin1(gameDescData.constData(), gameDescData.size()).trimmed();
-		fileDesc = QString::fromLatin1(fileDescData.constData(), fileDescData.size()).trimmed();
-	} else {
-		// Use the text codec.
-		gameDesc = textCodec->toUnicode(gameDescData.constData(), gameDescData.size()).trimmed();
-		fileDesc = textCodec->toUnicode(fileDescData.constData(), fileDescData.size()).trimmed();
+/**
+ * Set the file information.
+ * @param info File information.
+ */
+void GcnFilePrivate::applyInfo(const GcnFile::Info &info)
+{
+	gameID = info.gameID;
+	filename = info.filename;
+
+	// Timestamp.
+	mtime = TimeFuncs::fromGcnTimestamp(dirEntry->lastmodified);
+
+	// Mode.
+	// GCN permission bits map nicely to File::ModeBits.
+	this->mode = (dirEntry->permission >> 2) & 0x0F;
+
+	if (info.comments.isEmpty()) {
+		// Read error.
+		// File is probably invalid.
+		return;
 	}
 
+	gameDesc = info.gameDesc;
+	fileDesc = info.fileDesc;
+
 	// TODO: Change gameDesc and fileDesc to QStringRefs
 	// pointing to description.
 	description = gameDesc + QChar(L'\0') + fileDesc;
 
-	// Load the banner and icon images.
-	loadImages();
+	// Load the icon animation metadata.
+	// NOTE: The banner and icon images are decoded on first use.
+	loadIconInfo();
+}
+
+/**
+ * Load the icon animation metadata.
+ * This sets iconSpeed, iconAnimMode, and iconMask
+ * without decoding any images.
+ */
+void GcnFilePrivate::loadIconInfo(void)
+{
+	// TODO: Convert these to system-independent values.
+	this->iconAnimMode = (dirEntry->bannerfmt & CARD_ANIM_MASK);
+	this->iconSpeed.clear();
+	this->iconMask = 0;
+
+	uint16_t iconfmt = dirEntry->iconfmt;
+	uint16_t iconspeed = dirEntry->iconspeed;
+	for (int i = 0; i < CARD_MAXICONS; i++, iconfmt >>= 2, iconspeed >>= 2) {
+		if ((iconspeed & CARD_SPEED_MASK) == CARD_SPEED_END)
+			break;
+		this->iconSpeed.append(iconspeed & CARD_SPEED_MASK);
+
+		switch (iconfmt & CARD_ICON_MASK) {
+			case CARD_ICON_CI_SHARED:
+			case CARD_ICON_CI_UNIQUE:
+			case CARD_ICON_RGB:
+				// Icon frame has an image.
+				this->iconMask |= (1 << i);
+				break;
+			default:
+				// No icon.
+				break;
+		}
+	}
 }
 
 /**
  * Load the banner image.
  * @return GcImage* containing the banner image, or nullptr on error.
  */
-GcImage *GcnFilePrivate::loadBannerImage(void)
+GcImage *GcnFilePrivate::loadBannerImage(void) const
 {
 	// Determine the banner length.
 	uint32_t imgSize = 0;
@@ -435,12 +555,9 @@ GcImage *GcnFilePrivate::loadBannerImage(void)
  * Load the icon images.
  * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
  */
-QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
+QVector<GcImage*> GcnFilePrivate::loadIconImages(void) const
 {
-	// TODO: Convert these to system-independent values.
-	// Icon animation metadata.
-	// TODO: Should be part of a struct that's returned...
-	this->iconAnimMode = (dirEntry->bannerfmt & CARD_ANIM_MASK);
+	// NOTE: Icon animation metadata is loaded by loadIconInfo().
 
 	// Calculate the first icon address.
 	uint32_t imgAddr = dirEntry->iconaddr;
@@ -509,16 +626,12 @@ QVector<GcImage*> GcnFilePrivate::loadIconImages(void)
 	// Decode the icon(s).
 	QVector<CI8_SHARED_data> lst_CI8_SHARED;
 	QVector<GcImage*> gcImages;
-	// TODO: Should be part of a struct that's returned...
-	this->iconSpeed.clear();
 
 	iconfmt = dirEntry->iconfmt;
 	iconspeed = dirEntry->iconspeed;
 	for (int i = 0; i < CARD_MAXICONS; i++, iconfmt >>= 2, iconspeed >>= 2) {
 		if ((iconspeed & CARD_SPEED_MASK) == CARD_SPEED_END)
 			break;
-		// TODO: Should be part of a struct that's returned...
-		this->iconSpeed.append(iconspeed & CARD_SPEED_MASK);
 
 		switch (iconfmt & CARD_ICON_MASK) {
 			case CARD_ICON_CI_SHARED: {
@@ -626,6 +739,107 @@ GcnFile::GcnFile(Card *card,
 	: super(new GcnFilePrivate(this, card, dirEntry, fatEntries), card)
 { }
 
+/**
+ * Create a GcnFile for a GcnCard.
+ * This constructor is for valid files,
+ * using file information from readInfo() and decodeInfo().
+ * @param card GcnCard (or GciCard)
+ * @param info File information.
+ */
+GcnFile::GcnFile(Card *card, const Info &info)
+	: super(new GcnFilePrivate(this, card, info), card)
+{ }
+
+/**
+ * Read the file information for a valid file.
+ * This reads the file's comment block.
+ * @param card		[in] GcnCard (or GciCard)
+ * @param dirEntry	[in] Directory Entry pointer.
+ * @param mc_bat	[in] Block table.
+ * @param info		[out] File information.
+ */
+void GcnFile::readInfo(Card *card,
+	const card_direntry *dirEntry,
+	const card_bat *mc_bat,
+	Info *info)
+{
+	info->dirEntry = dirEntry;
+	info->mc_bat = mc_bat;
+	info->fatEntries = GcnFilePrivate::loadFatEntries(card, dirEntry, mc_bat);
+	info->comments = GcnFilePrivate::readComments(card, dirEntry, info->fatEntries);
+}
+
+/**
+ * Decode the text in the file information.
+ * readInfo() must be called first.
+ * NOTE: This may be called from a worker thread.
+ * @param card		[in] GcnCard (or GciCard)
+ * @param info		[in/out] File information.
+ */
+void GcnFile::decodeInfo(const Card *card, Info *info)
+{
+	const card_direntry *const dirEntry = info->dirEntry;
+
+	// Game ID is always Latin-1.
+	// NOTE: gamecode and company are right next to each other,
+	// so we can "overrun" the buffer here.
+	info->gameID = QString::fromLatin1(dirEntry->gamecode,
+			sizeof(dirEntry->gamecode) + sizeof(dirEntry->company));
+
+	// TODO: Use decodeText_SJISorCP1252() instead?
+	// Get the appropriate QTextCodec for this file.
+	const char region = (info->gameID.size() >= 4
+				? info->gameID.at(3).toLatin1()
+				: 0);
+	QTextCodec *textCodec = GcnFilePrivate::textCodecForRegion(region, card->encoding());
+
+	// Remove trailing NULL characters before converting to UTF-8.
+	QByteArray filenameData(dirEntry->filename, sizeof(dirEntry->filename));
+	int nullChr = filenameData.indexOf('\0');
+	if (nullChr >= 0)
+		filenameData.resize(nullChr);
+
+	// Convert the filename to UTF-8.
+	if (!textCodec) {
+		// No text codec was found.
+		// Default to Latin-1.
+		info->filename = QString::fromLatin1(filenameData.constData(), filenameData.size());
+	} else {
+		// Use the text codec.
+		info->filename = textCodec->toUnicode(filenameData.constData(), filenameData.size());
+	}
+
+	if (info->comments.size() < 64) {
+		// Comments weren't loaded.
+		return;
+	}
+
+	// Load the file comments. (64 bytes)
+	QByteArray gameDescData = info->comments.left(32);
+	QByteArray fileDescData = info->comments.mid(32, 32);
+
+	// Remove trailing NULL characters before converting to UTF-8.
+	nullChr = gameDescData.indexOf('\0');
+	if (nullChr >= 0)
+		gameDescData.resize(nullChr);
+	nullChr = fileDescData.indexOf('\0');
+	if (nullChr >= 0)
+		fileDescData.resize(nullChr);
+
+	// Convert the descriptions to UTF-8.
+	// Trim the descriptions while we're at it.
+	if (!textCodec) {
+		// No text codec was found.
+		// Default to Latin-1.
+		info->gameDesc = QString::fromLatin1(gameDescData.constData(), gameDescData.size()).trimmed();
+		info->fileDesc = QString::fromLatin1(fileDescData.constData(), fileDescData.size()).trimmed();
+	} else {
+		// Use the text codec.
+		info->gameDesc = textCodec->toUnicode(gameDescData.constData(), gameDescData.size()).trimmed();
+		info->fileDesc = textCodec->toUnicode(fileDescData.constData(), fileDescData.size()).trimmed();
+	}
+}
+
 /**
  * Get the game description.
  * @return Game description.
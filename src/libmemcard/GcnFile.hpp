@@ -14,6 +14,9 @@
 #include "card.h"
 
 // Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
 class QIODevice;
 
 // Checksum algorithm class.
@@ -60,6 +63,62 @@ class GcnFile : public File
 			const card_direntry *dirEntry,
 			const QVector<uint16_t> &fatEntries);
 
+		/**
+		 * File information for a valid file.
+		 *
+		 * This is loaded without creating a GcnFile, so the
+		 * files on a card can be loaded in parallel:
+		 * - readInfo() reads the comment block.
+		 * - decodeInfo() decodes the text. This doesn't use
+		 *   the card's device, so it can be called from any thread.
+		 * - The GcnFile is then created on the card's thread.
+		 */
+		struct Info {
+			const card_direntry *dirEntry;	// nullptr if not loaded.
+			const card_bat *mc_bat;
+			QVector<uint16_t> fatEntries;
+			QByteArray comments;	// Raw comments. (64 bytes; empty on read error)
+
+			// Set by decodeInfo().
+			QString gameID;
+			QString filename;
+			QString gameDesc;
+			QString fileDesc;
+
+			Info() : dirEntry(nullptr), mc_bat(nullptr) { }
+		};
+
+		/**
+		 * Read the file information for a valid file.
+		 * This reads the file's comment block.
+		 * @param card		[in] GcnCard (or GciCard)
+		 * @param dirEntry	[in] Directory Entry pointer.
+		 * @param mc_bat	[in] Block table.
+		 * @param info		[out] File information.
+		 */
+		static void readInfo(Card *card,
+			const card_direntry *dirEntry,
+			const card_bat *mc_bat,
+			Info *info);
+
+		/**
+		 * Decode the text in the file information.
+		 * readInfo() must be called first.
+		 * NOTE: This may be called from a worker thread.
+		 * @param card		[in] GcnCard (or GciCard)
+		 * @param info		[in/out] File information.
+		 */
+		static void decodeInfo(const Card *card, Info *info);
+
+		/**
+		 * Create a GcnFile for a GcnCard.
+		 * This constructor is for valid files,
+		 * using file information from readInfo() and decodeInfo().
+		 * @param card GcnCard (or GciCard)
+		 * @param info File information.
+		 */
+		GcnFile(Card *card, const Info &info);
+
 	protected:
 		Q_DECLARE_PRIVATE(GcnFile)
 	private:
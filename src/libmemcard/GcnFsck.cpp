@@ -0,0 +1,181 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * GcnFsck.cpp: GameCube file system consistency checker.                  *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnFsck.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// C++ includes.
+#include <algorithm>
+
+#define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
+
+GcnFsck::GcnFsck()
+{
+	for (int i = 0; i < 2; i++) {
+		m_summary[i].freeBlocks = 0;
+		m_summary[i].issueCount = 0;
+	}
+}
+
+/**
+ * Add an issue.
+ * @param type Issue type.
+ * @param batIdx Block table index.
+ * @param dirIdx Directory entry index.
+ * @param block Block number.
+ * @param expected Expected value.
+ * @param actual Actual value.
+ */
+void GcnFsck::addIssue(IssueType type, int batIdx, int dirIdx, int block,
+		       int expected, int actual)
+{
+	Issue issue;
+	issue.type = type;
+	issue.batIdx = (uint8_t)batIdx;
+	issue.dirIdx = (int8_t)dirIdx;
+	issue.block = (uint16_t)block;
+	issue.expected = expected;
+	issue.actual = actual;
+	m_issues.append(issue);
+	m_summary[batIdx].issueCount++;
+}
+
+/**
+ * Check the file system.
+ *
+ * The directory and block tables are updated together,
+ * so the active block table should be paired with the
+ * active directory table, and the inactive block table
+ * with the inactive directory table.
+ *
+ * @param dat Directory table to check with each block table. (byteswapped; two elements)
+ * @param bat Block tables. (byteswapped; two elements)
+ * @param totalPhysBlocks Total physical blocks.
+ */
+void GcnFsck::check(const card_dat *const dat[2], const card_bat *bat, int totalPhysBlocks)
+{
+	m_issues.clear();
+	for (int i = 0; i < 2; i++) {
+		m_summary[i].issueCount = 0;
+		checkBat(dat[i], &bat[i], i, totalPhysBlocks);
+	}
+}
+
+/**
+ * Check a single block table.
+ * @param dat Directory table.
+ * @param bat Block table.
+ * @param batIdx Block table index.
+ * @param totalPhysBlocks Total physical blocks.
+ */
+void GcnFsck::checkBat(const card_dat *dat, const card_bat *bat,
+		       int batIdx, int totalPhysBlocks)
+{
+	// Blocks past the end of the FAT can't be allocated.
+	const int maxBlock = std::min(totalPhysBlocks, CARD_FATBLOCKS);
+
+	BatSummary &summary = m_summary[batIdx];
+	summary.blocks.reset(totalPhysBlocks);
+	summary.orphaned.reset(totalPhysBlocks);
+	summary.blocks.markUsed(0, std::min(CARD_SYSAREA, totalPhysBlocks));
+
+	// Blocks in the current file's chain.
+	// Only the chain's blocks are cleared after each file,
+	// so loop detection doesn't depend on the card size.
+	BlockMap chainMap(totalPhysBlocks);
+	QVector<uint16_t> chain;
+	chain.reserve(maxBlock);
+
+	for (int i = 0; i < NUM_ELEMENTS(dat->entries); i++) {
+		const card_direntry *dirEntry = &dat->entries[i];
+
+		// Skip empty directory entries.
+		// NOTE: Same rules as GcnCardPrivate::addGcnFiles().
+		static const uint8_t gamecode_empty[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+		if (!memcmp(dirEntry->gamecode, gamecode_empty, sizeof(gamecode_empty)))
+			continue;
+		if (!dirEntry->filename[0])
+			continue;
+
+		int block = dirEntry->block;
+		if (block < CARD_SYSAREA || block >= maxBlock) {
+			addIssue(FSCK_INVALID_START, batIdx, i, block);
+			continue;
+		}
+
+		// Walk the FAT chain.
+		while (true) {
+			if (chainMap.isUsed(block)) {
+				addIssue(FSCK_LOOP, batIdx, i, block);
+				break;
+			}
+			chainMap.markUsed(block);
+			chain.append(block);
+
+			if (summary.blocks.isUsed(block)) {
+				addIssue(FSCK_CROSS_LINK, batIdx, i, block);
+			}
+			summary.blocks.markUsed(block);
+
+			const int next = bat->fat[block - CARD_SYSAREA];
+			if (next == 0xFFFF) {
+				// End of chain.
+				break;
+			} else if (next < CARD_SYSAREA || next >= maxBlock) {
+				// Invalid link. (includes free blocks)
+				addIssue(FSCK_INVALID_LINK, batIdx, i, block);
+				break;
+			}
+			block = next;
+		}
+
+		if (chain.size() != dirEntry->length) {
+			addIssue(FSCK_LENGTH_MISMATCH, batIdx, i, dirEntry->block,
+				 dirEntry->length, chain.size());
+		}
+
+		foreach (uint16_t chainBlock, chain) {
+			chainMap.markFree(chainBlock);
+		}
+		chain.clear();
+	}
+
+	// Find allocated blocks that aren't used by any file.
+	for (int block = CARD_SYSAREA; block < maxBlock; block++) {
+		if (bat->fat[block - CARD_SYSAREA] != 0 && !summary.blocks.isUsed(block)) {
+			summary.orphaned.markUsed(block);
+			addIssue(FSCK_ORPHANED_BLOCK, batIdx, -1, block);
+		}
+	}
+
+	// Compare the free block count to the bitset.
+	summary.freeBlocks = maxBlock - summary.blocks.usedCount();
+	if (bat->freeblocks != summary.freeBlocks) {
+		addIssue(FSCK_FREE_COUNT_MISMATCH, batIdx, -1, 0,
+			 summary.freeBlocks, bat->freeblocks);
+	}
+}
+
+/**
+ * Count the issues of a given type in a block table.
+ * @param idx Block table index.
+ * @param type Issue type.
+ * @return Number of issues.
+ */
+int GcnFsck::count(int idx, IssueType type) const
+{
+	int ret = 0;
+	foreach (const Issue &issue, m_issues) {
+		if (issue.batIdx == idx && issue.type == type) {
+			ret++;
+		}
+	}
+	return ret;
+}
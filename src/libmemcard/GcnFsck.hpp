@@ -0,0 +1,160 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * GcnFsck.hpp: GameCube file system consistency checker.                  *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_GCNFSCK_HPP__
+#define __LIBMEMCARD_GCNFSCK_HPP__
+
+#include "BlockMap.hpp"
+#include "card.h"
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QVector>
+
+/**
+ * GameCube file system consistency checker.
+ *
+ * Each block table is paired with a directory table, and the
+ * FAT chain of every file in that directory table is walked
+ * in the block table. Each block table is checked
+ * for invalid links, loops, cross-linked blocks, orphaned
+ * blocks, file length mismatches, and an incorrect free
+ * block count.
+ *
+ * Block tables are checked using bitsets, so this is fast
+ * enough to run every time a card is loaded.
+ */
+class GcnFsck
+{
+	public:
+		GcnFsck();
+
+	public:
+		/**
+		 * Issue type.
+		 */
+		enum IssueType {
+			// Directory entry's starting block is invalid.
+			FSCK_INVALID_START,
+			// FAT entry points to an invalid block.
+			FSCK_INVALID_LINK,
+			// FAT chain loops back on itself.
+			FSCK_LOOP,
+			// Block is used by more than one file.
+			FSCK_CROSS_LINK,
+			// FAT chain length doesn't match the directory entry.
+			FSCK_LENGTH_MISMATCH,
+			// Block is allocated, but not used by any file.
+			FSCK_ORPHANED_BLOCK,
+			// Free block count doesn't match the block table.
+			FSCK_FREE_COUNT_MISMATCH,
+		};
+
+		/**
+		 * Consistency issue.
+		 */
+		struct Issue {
+			IssueType type;
+			uint8_t batIdx;		// Block table index.
+			int8_t dirIdx;		// Directory entry index. (-1 if none)
+			uint16_t block;		// Block number. (0 if none)
+			int expected;		// Expected value. (length and free count only)
+			int actual;		// Actual value. (length and free count only)
+		};
+
+		/**
+		 * Per-block table summary.
+		 */
+		struct BatSummary {
+			BlockMap blocks;	// Blocks used by files. (collision == cross-linked)
+			BlockMap orphaned;	// Blocks allocated in the FAT but not used by files.
+			int freeBlocks;		// Free blocks according to the bitset.
+			int issueCount;		// Number of issues in this block table.
+		};
+
+		/**
+		 * Check the file system.
+		 *
+		 * The directory and block tables are updated together,
+		 * so the active block table should be paired with the
+		 * active directory table, and the inactive block table
+		 * with the inactive directory table.
+		 *
+		 * @param dat Directory table to check with each block table. (byteswapped; two elements)
+		 * @param bat Block tables. (byteswapped; two elements)
+		 * @param totalPhysBlocks Total physical blocks.
+		 */
+		void check(const card_dat *const dat[2], const card_bat *bat, int totalPhysBlocks);
+
+		/**
+		 * Were any issues found?
+		 * @return True if the file system is consistent; false if not.
+		 */
+		inline bool isClean(void) const
+		{
+			return m_issues.isEmpty();
+		}
+
+		/**
+		 * Get the issues found.
+		 * @return Issues.
+		 */
+		inline QVector<Issue> issues(void) const
+		{
+			return m_issues;
+		}
+
+		/**
+		 * Get the summary for a block table.
+		 * @param idx Block table index.
+		 * @return Summary.
+		 */
+		inline BatSummary summary(int idx) const
+		{
+			return m_summary[idx & 1];
+		}
+
+		/**
+		 * Count the issues of a given type in a block table.
+		 * @param idx Block table index.
+		 * @param type Issue type.
+		 * @return Number of issues.
+		 */
+		int count(int idx, IssueType type) const;
+
+	private:
+		/**
+		 * Check a single block table.
+		 * @param dat Directory table.
+		 * @param bat Block table.
+		 * @param batIdx Block table index.
+		 * @param totalPhysBlocks Total physical blocks.
+		 */
+		void checkBat(const card_dat *dat, const card_bat *bat,
+			      int batIdx, int totalPhysBlocks);
+
+		/**
+		 * Add an issue.
+		 * @param type Issue type.
+		 * @param batIdx Block table index.
+		 * @param dirIdx Directory entry index.
+		 * @param block Block number.
+		 * @param expected Expected value.
+		 * @param actual Actual value.
+		 */
+		void addIssue(IssueType type, int batIdx, int dirIdx, int block,
+			      int expected = 0, int actual = 0);
+
+	private:
+		QVector<Issue> m_issues;
+		BatSummary m_summary[2];
+};
+
+#endif /* __LIBMEMCARD_GCNFSCK_HPP__ */
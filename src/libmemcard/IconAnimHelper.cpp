@@ -82,7 +82,7 @@ void IconAnimHelperPrivate::reset(void)
 		// File is specified.
 		// Determine the initial state.
 		enabled = true;
-		frameHasIcon = !(file->icon(frame).isNull());
+		frameHasIcon = file->hasIcon(frame);
 		delayLen = file->iconDelay(frame);
 		mode = file->iconAnimMode();
 	}
@@ -147,7 +147,9 @@ bool IconAnimHelperPrivate::tick(void)
 	delayLen = file->iconDelay(frame);
 
 	// Check if this frame has an icon.
-	frameHasIcon = !file->icon(frame).isNull();
+	// NOTE: This uses the icon metadata so the icons
+	// don't have to be decoded for every tick.
+	frameHasIcon = file->hasIcon(frame);
 	if (frameHasIcon && lastValidFrame != frame) {
 		// Frame has an icon. Save this frame as the last valid frame.
 		lastValidFrame = frame;
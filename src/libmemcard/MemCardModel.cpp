@@ -69,11 +69,34 @@ class MemCardModelPrivate
 		 */
 		void updateAnimTimerState(void);
 
+		/**
+		 * Connect or disconnect the checksumChanged() signals for a range of files.
+		 * @param start First file index.
+		 * @param end Last file index.
+		 * @param conn True to connect; false to disconnect.
+		 */
+		void connectFileSignals(int start, int end, bool conn);
+
 		// Animation timer.
 		QTimer *animTimer;
 		// Pause count. If >0, animation is paused.
 		int pauseCounter;
 
+		// Image prefetch.
+		// Banners and icons are decoded on first use. When a row's
+		// images are requested, the next few rows are decoded while
+		// the event loop is idle, so scrolling doesn't stall.
+		static const int PREFETCH_COUNT = 8;
+		QTimer *prefetchTimer;
+		mutable int prefetchRow;
+		mutable int prefetchEnd;
+
+		/**
+		 * Schedule image prefetching.
+		 * @param row First row to prefetch.
+		 */
+		void schedulePrefetch(int row) const;
+
 		// Style variables.
 		struct style_t {
 			/**
@@ -132,6 +155,9 @@ MemCardModelPrivate::MemCardModelPrivate(MemCardModel *q)
 	, card(nullptr)
 	, animTimer(new QTimer(q))
 	, pauseCounter(0)
+	, prefetchTimer(new QTimer(q))
+	, prefetchRow(0)
+	, prefetchEnd(0)
 	, fileCount(0)
 	, insertStart(-1)
 	, insertEnd(-1)
@@ -140,6 +166,12 @@ MemCardModelPrivate::MemCardModelPrivate(MemCardModel *q)
 	QObject::connect(animTimer, &QTimer::timeout,
 			 q, &MemCardModel::animTimerSlot);
 
+	// Connect prefetchTimer's timeout() signal.
+	// NOTE: A 0 ms timer runs when the event loop is idle.
+	prefetchTimer->setInterval(0);
+	QObject::connect(prefetchTimer, &QTimer::timeout,
+			 q, &MemCardModel::prefetchTimerSlot);
+
 	// Initialize the style variables.
 	style.init();
 }
@@ -234,6 +266,8 @@ MemCardModelPrivate::~MemCardModelPrivate()
 {
 	animTimer->stop();
 	delete animTimer;
+	prefetchTimer->stop();
+	delete prefetchTimer;
 
 	// TODO: Check for race conditions.
 	qDeleteAll(animState);
@@ -298,6 +332,50 @@ void MemCardModelPrivate::updateAnimTimerState(void)
 	}
 }
 
+/**
+ * Connect or disconnect the checksumChanged() signals for a range of files.
+ * @param start First file index.
+ * @param end Last file index.
+ * @param conn True to connect; false to disconnect.
+ */
+void MemCardModelPrivate::connectFileSignals(int start, int end, bool conn)
+{
+	if (!card)
+		return;
+
+	Q_Q(MemCardModel);
+	for (int i = start; i <= end; i++) {
+		const File *file = card->getFile(i);
+		if (!file)
+			continue;
+
+		if (conn) {
+			QObject::connect(file, &File::checksumChanged,
+					 q, &MemCardModel::file_checksumChanged_slot);
+		} else {
+			QObject::disconnect(file, &File::checksumChanged,
+					    q, &MemCardModel::file_checksumChanged_slot);
+		}
+	}
+}
+
+/**
+ * Schedule image prefetching.
+ * @param row First row to prefetch.
+ */
+void MemCardModelPrivate::schedulePrefetch(int row) const
+{
+	if (row >= fileCount)
+		return;
+
+	prefetchRow = row;
+	prefetchEnd = row + PREFETCH_COUNT;
+	if (prefetchEnd > fileCount)
+		prefetchEnd = fileCount;
+	if (!prefetchTimer->isActive())
+		prefetchTimer->start();
+}
+
 /** MemCardModel **/
 
 MemCardModel::MemCardModel(QObject *parent)
@@ -369,6 +447,9 @@ QVariant MemCardModel::data(const QModelIndex& index, int role) const
 			// Images must use Qt::DecorationRole.
 			switch (index.column()) {
 				case COL_ICON:
+					// Prefetch images for the next few rows.
+					d->schedulePrefetch(index.row() + 1);
+
 					// Check if this is an animated icon.
 					if (d->animState.contains(file)) {
 						// Animated icon.
@@ -542,6 +623,7 @@ void MemCardModel::setCard(Card *card)
 			beginRemoveRows(QModelIndex(), 0, (fileCount - 1));
 
 		// Disconnect the Card's signals.
+		d->connectFileSignals(0, fileCount - 1, false);
 		disconnect(d->card, &QObject::destroyed,
 			   this, &MemCardModel::card_destroyed_slot);
 		disconnect(d->card, &Card::filesAboutToBeInserted,
@@ -586,6 +668,7 @@ void MemCardModel::setCard(Card *card)
 			this, &MemCardModel::card_filesAboutToBeRemoved_slot);
 		connect(d->card, &Card::filesRemoved,
 			this, &MemCardModel::card_filesRemoved_slot);
+		d->connectFileSignals(0, fileCount - 1, true);
 
 		// Done adding rows.
 		if (fileCount > 0)
@@ -659,6 +742,28 @@ void MemCardModel::animTimerSlot(void)
 	}
 }
 
+/**
+ * Image prefetch timer slot.
+ * Decodes the images for one file per tick.
+ */
+void MemCardModel::prefetchTimerSlot(void)
+{
+	Q_D(MemCardModel);
+	if (!d->card || d->prefetchRow >= d->prefetchEnd ||
+	    d->prefetchRow >= d->fileCount)
+	{
+		// Nothing to prefetch.
+		d->prefetchTimer->stop();
+		return;
+	}
+
+	const File *file = d->card->getFile(d->prefetchRow);
+	if (file) {
+		file->prefetchImages();
+	}
+	d->prefetchRow++;
+}
+
 /**
  * Card object was destroyed.
  * @param obj QObject that was destroyed.
@@ -709,6 +814,9 @@ void MemCardModel::card_filesInserted_slot(void)
 			d->initAnimState(file);
 		}
 
+		// Checksums may be calculated in the background.
+		d->connectFileSignals(d->insertStart, d->insertEnd, true);
+
 		// Reset the row insert start/end indexes.
 		d->insertStart = -1;
 		d->insertEnd = -1;
@@ -741,6 +849,8 @@ void MemCardModel::card_filesAboutToBeRemoved_slot(int start, int end)
 		const File *file = d->card->getFile(i);
 		d->animState.remove(file);
 	}
+
+	d->connectFileSignals(start, end, false);
 }
 
 /**
@@ -757,6 +867,26 @@ void MemCardModel::card_filesRemoved_slot(void)
 	endRemoveRows();
 }
 
+/**
+ * A file's checksum values have changed.
+ * Only the file's checksum status is updated.
+ */
+void MemCardModel::file_checksumChanged_slot(void)
+{
+	Q_D(MemCardModel);
+	const File *file = qobject_cast<const File*>(sender());
+	if (!d->card || !file)
+		return;
+
+	for (int i = 0; i < d->fileCount; i++) {
+		if (d->card->getFile(i) == file) {
+			QModelIndex validIndex = createIndex(i, MemCardModel::COL_ISVALID);
+			emit dataChanged(validIndex, validIndex);
+			break;
+		}
+	}
+}
+
 /** Slots. **/
 
 /**
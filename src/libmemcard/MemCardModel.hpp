@@ -83,6 +83,12 @@ class MemCardModel : public QAbstractListModel
 		 */
 		void animTimerSlot(void);
 
+		/**
+		 * Image prefetch timer slot.
+		 * Decodes the images for one file per tick.
+		 */
+		void prefetchTimerSlot(void);
+
 		/**
 		 * Card object was destroyed.
 		 * @param obj QObject that was destroyed.
@@ -113,6 +119,12 @@ class MemCardModel : public QAbstractListModel
 		 */
 		void card_filesRemoved_slot(void);
 
+		/**
+		 * A file's checksum values have changed.
+		 * Only the file's checksum status is updated.
+		 */
+		void file_checksumChanged_slot(void);
+
 		/**
 		 * The system theme has changed.
 		 */
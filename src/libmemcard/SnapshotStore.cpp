@@ -0,0 +1,599 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * SnapshotStore.cpp: Content-addressed card snapshot store.               *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "SnapshotStore.hpp"
+#include "Card.hpp"
+#include "File.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <algorithm>
+#include <utility>
+
+// fsync() / _commit()
+#ifdef _WIN32
+# include <io.h>
+#else /* !_WIN32 */
+# include <unistd.h>
+#endif /* _WIN32 */
+
+// Qt includes.
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+// Block index file magic and version.
+static const quint32 INDEX_MAGIC = 0x4953434D;		// "MCSI"
+static const quint32 INDEX_VERSION = 1;
+// Snapshot manifest magic and version.
+static const quint32 MANIFEST_MAGIC = 0x5353434D;	// "MCSS"
+static const quint32 MANIFEST_VERSION = 1;
+
+// Block hash algorithm and size.
+static const QCryptographicHash::Algorithm HASH_ALGORITHM = QCryptographicHash::Sha1;
+static const int HASH_SIZE = 20;
+
+/**
+ * Flush a file and write it to the storage device.
+ * @param file File.
+ * @return True on success; false on error.
+ */
+static bool syncFile(QFileDevice *file)
+{
+	if (!file->flush())
+		return false;
+
+	const int fd = file->handle();
+	if (fd < 0)
+		return true;
+#ifdef _WIN32
+	return (_commit(fd) == 0);
+#else /* !_WIN32 */
+	return (fsync(fd) == 0);
+#endif /* _WIN32 */
+}
+
+/**
+ * Create a SnapshotStore.
+ * open() must be called before using the store.
+ * @param path Store directory.
+ */
+SnapshotStore::SnapshotStore(const QString &path)
+	: m_path(path)
+	, m_idxEnd(-1)
+{ }
+
+/**
+ * Open the store.
+ * The directory is created if it doesn't exist.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int SnapshotStore::open(void)
+{
+	m_errorString.clear();
+	m_index.clear();
+	m_idxEnd = -1;
+
+	QDir dir(m_path);
+	if (!dir.mkpath(QLatin1String("."))) {
+		m_errorString = QLatin1String("Unable to create the snapshot store directory");
+		return -EIO;
+	}
+
+	QFile idxFile(dir.filePath(QLatin1String("blocks.idx")));
+	if (!idxFile.exists()) {
+		// New store.
+		m_idxEnd = 0;
+		return 0;
+	}
+	if (!idxFile.open(QIODevice::ReadOnly)) {
+		m_errorString = idxFile.errorString();
+		return -EIO;
+	}
+	const qint64 packSize = QFileInfo(dir.filePath(QLatin1String("blocks.pack"))).size();
+
+	QDataStream ds(&idxFile);
+	ds.setByteOrder(QDataStream::LittleEndian);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version;
+	ds >> magic >> version;
+	if (ds.status() != QDataStream::Ok ||
+	    magic != INDEX_MAGIC || version != INDEX_VERSION)
+	{
+		m_errorString = QLatin1String("Snapshot store index is invalid");
+		return -EIO;
+	}
+	m_idxEnd = idxFile.pos();
+
+	while (!ds.atEnd()) {
+		QByteArray hash;
+		BlockLoc loc;
+		ds >> hash >> loc.offset >> loc.size;
+		if (ds.status() != QDataStream::Ok) {
+			// Truncated record.
+			// This can happen if a snapshot was interrupted;
+			// the pack data for it is ignored, and the record
+			// is removed by the next addSnapshot().
+			break;
+		}
+		m_idxEnd = idxFile.pos();
+		if (hash.size() != HASH_SIZE || loc.offset < 0 ||
+		    loc.offset + loc.size > packSize)
+		{
+			// Invalid record.
+			continue;
+		}
+		m_index.insert(hash, loc);
+	}
+
+	return 0;
+}
+
+/**
+ * Create a default snapshot ID for a card image.
+ * @param filename Card image filename.
+ * @return Snapshot ID. (image name and current date/time)
+ */
+QString SnapshotStore::defaultId(const QString &filename)
+{
+	QString name = QFileInfo(filename).baseName();
+	if (name.isEmpty()) {
+		name = QLatin1String("card");
+	}
+
+	// Replace characters that aren't allowed in IDs.
+	for (int i = 0; i < name.size(); i++) {
+		const QChar chr = name.at(i);
+		if (!chr.isLetterOrNumber() && chr != QChar(L'-') &&
+		    chr != QChar(L'_') && chr != QChar(L'.'))
+		{
+			name[i] = QChar(L'_');
+		}
+	}
+
+	return name + QChar(L'-') +
+		QDateTime::currentDateTime().toString(QLatin1String("yyyyMMdd-hhmmss"));
+}
+
+/**
+ * Check if a snapshot ID is valid.
+ * IDs may contain letters, digits, '-', '_', and '.'.
+ * @param id Snapshot ID.
+ * @return True if valid; false if not.
+ */
+bool SnapshotStore::isValidId(const QString &id)
+{
+	if (id.isEmpty() || id.at(0) == QChar(L'.'))
+		return false;
+
+	foreach (const QChar chr, id) {
+		if (!chr.isLetterOrNumber() && chr != QChar(L'-') &&
+		    chr != QChar(L'_') && chr != QChar(L'.'))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Get the snapshots in the store.
+ * @return Snapshot IDs, sorted by creation time. (oldest first)
+ */
+QStringList SnapshotStore::snapshots(void) const
+{
+	QDir dir(m_path);
+	const QStringList files = dir.entryList(
+		QStringList(QLatin1String("*.snap")), QDir::Files, QDir::Name);
+
+	// IDs can be chosen by the user, so they can't be
+	// used for sorting. Use the manifest timestamps.
+	QVector<std::pair<qint64, QString> > sorted;
+	sorted.reserve(files.size());
+	foreach (const QString &file, files) {
+		const QString id = file.left(file.size() - 5);
+		sorted.append(std::make_pair(manifestTimestamp(id), id));
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	QStringList ids;
+	ids.reserve(sorted.size());
+	for (int i = 0; i < sorted.size(); i++) {
+		ids.append(sorted.at(i).second);
+	}
+	return ids;
+}
+
+/**
+ * Get the filename of a snapshot manifest.
+ * @param id Snapshot ID.
+ * @return Manifest filename.
+ */
+QString SnapshotStore::manifestFileName(const QString &id) const
+{
+	return QDir(m_path).filePath(id + QLatin1String(".snap"));
+}
+
+/**
+ * Get the creation time of a snapshot.
+ * Only the manifest header is read.
+ * @param id Snapshot ID.
+ * @return Timestamp (msec since epoch), or -1 on error.
+ */
+qint64 SnapshotStore::manifestTimestamp(const QString &id) const
+{
+	QFile file(manifestFileName(id));
+	if (!file.open(QIODevice::ReadOnly))
+		return -1;
+
+	QDataStream ds(&file);
+	ds.setByteOrder(QDataStream::LittleEndian);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version, blockSize;
+	qint64 timestamp;
+	ds >> magic >> version >> blockSize >> timestamp;
+	if (ds.status() != QDataStream::Ok ||
+	    magic != MANIFEST_MAGIC || version != MANIFEST_VERSION)
+	{
+		return -1;
+	}
+	return timestamp;
+}
+
+/**
+ * Load a snapshot manifest.
+ * @param id		[in] Snapshot ID.
+ * @param manifest	[out] Manifest.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int SnapshotStore::loadManifest(const QString &id, Manifest *manifest)
+{
+	if (!isValidId(id))
+		return -EINVAL;
+
+	QFile file(manifestFileName(id));
+	if (!file.open(QIODevice::ReadOnly)) {
+		m_errorString = file.errorString();
+		return -ENOENT;
+	}
+
+	QDataStream ds(&file);
+	ds.setByteOrder(QDataStream::LittleEndian);
+	ds.setVersion(QDataStream::Qt_5_0);
+
+	quint32 magic, version, count;
+	ds >> magic >> version >> manifest->blockSize >> manifest->timestamp
+	   >> manifest->source >> count;
+	if (ds.status() != QDataStream::Ok ||
+	    magic != MANIFEST_MAGIC || version != MANIFEST_VERSION ||
+	    manifest->blockSize == 0 || count > 65536)
+	{
+		m_errorString = QLatin1String("Snapshot manifest is invalid");
+		return -EIO;
+	}
+
+	manifest->hashes.resize(count);
+	for (quint32 i = 0; i < count; i++) {
+		QByteArray hash(HASH_SIZE, 0);
+		if (ds.readRawData(hash.data(), HASH_SIZE) != HASH_SIZE) {
+			m_errorString = QLatin1String("Snapshot manifest is truncated");
+			return -EIO;
+		}
+		manifest->hashes[i] = hash;
+	}
+
+	return 0;
+}
+
+/**
+ * Hash all blocks of a card.
+ * @param card Card.
+ * @return Block hashes, or empty QVector on error.
+ */
+QVector<QByteArray> SnapshotStore::hashBlocks(Card *card)
+{
+	const int blockSize = card->blockSize();
+	const int blockCount = card->totalPhysBlocks();
+
+	QVector<QByteArray> hashes;
+	hashes.reserve(blockCount);
+	QByteArray block(blockSize, 0);
+	for (int i = 0; i < blockCount; i++) {
+		if (card->readBlock(block.data(), blockSize, i) != blockSize)
+			return QVector<QByteArray>();
+		hashes.append(QCryptographicHash::hash(block, HASH_ALGORITHM));
+	}
+	return hashes;
+}
+
+/**
+ * Add a snapshot of a card.
+ * @param card		[in] Card.
+ * @param id		[in] Snapshot ID.
+ * @param pNewBlocks	[out,opt] Number of blocks added to the pack.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int SnapshotStore::addSnapshot(Card *card, const QString &id, int *pNewBlocks)
+{
+	m_errorString.clear();
+	if (m_idxEnd < 0) {
+		// Store isn't open, or its index is invalid.
+		return -EBADF;
+	}
+	if (!card || !card->isOpen() || !isValidId(id))
+		return -EINVAL;
+
+	const QString manifestName = manifestFileName(id);
+	if (QFile::exists(manifestName)) {
+		m_errorString = QLatin1String("A snapshot with this ID already exists");
+		return -EEXIST;
+	}
+
+	const int blockSize = card->blockSize();
+	const int blockCount = card->totalPhysBlocks();
+	if (blockSize <= 0 || blockCount <= 0)
+		return -EINVAL;
+
+	QDir dir(m_path);
+	QFile packFile(dir.filePath(QLatin1String("blocks.pack")));
+	QFile idxFile(dir.filePath(QLatin1String("blocks.idx")));
+	if (!packFile.open(QIODevice::ReadWrite)) {
+		m_errorString = packFile.errorString();
+		return -EIO;
+	}
+	if (!idxFile.open(QIODevice::ReadWrite)) {
+		m_errorString = idxFile.errorString();
+		return -EIO;
+	}
+
+	// Write new blocks to the end of the pack.
+	qint64 packPos = packFile.size();
+	packFile.seek(packPos);
+
+	QVector<QByteArray> hashes;
+	QVector<QByteArray> newHashes;
+	hashes.reserve(blockCount);
+	QByteArray block(blockSize, 0);
+	int ret = 0;
+	for (int i = 0; i < blockCount; i++) {
+		if (card->readBlock(block.data(), blockSize, i) != blockSize) {
+			ret = -EIO;
+			break;
+		}
+
+		const QByteArray hash = QCryptographicHash::hash(block, HASH_ALGORITHM);
+		hashes.append(hash);
+		if (m_index.contains(hash)) {
+			// Block is already stored.
+			continue;
+		}
+
+		if (packFile.write(block) != blockSize) {
+			m_errorString = packFile.errorString();
+			ret = -EIO;
+			break;
+		}
+		BlockLoc loc;
+		loc.offset = packPos;
+		loc.size = blockSize;
+		m_index.insert(hash, loc);
+		newHashes.append(hash);
+		packPos += blockSize;
+	}
+
+	// NOTE: The pack is written before the index, and the index is
+	// written before the manifest, so an interrupted snapshot never
+	// references blocks that weren't stored. Each file is synced
+	// before the next one is written, since the OS may otherwise
+	// write them to the device in any order.
+	if (ret == 0 && !syncFile(&packFile)) {
+		m_errorString = packFile.errorString();
+		ret = -EIO;
+	}
+
+	if (ret == 0) {
+		QDataStream ds(&idxFile);
+		ds.setByteOrder(QDataStream::LittleEndian);
+		ds.setVersion(QDataStream::Qt_5_0);
+		// Remove a truncated record left by an interrupted snapshot.
+		// Otherwise, open() would stop reading at that record,
+		// and the records appended after it would be lost.
+		if (idxFile.size() != m_idxEnd && !idxFile.resize(m_idxEnd)) {
+			m_errorString = idxFile.errorString();
+			ret = -EIO;
+		} else if (m_idxEnd == 0) {
+			// New index.
+			ds << INDEX_MAGIC << INDEX_VERSION;
+		} else {
+			idxFile.seek(m_idxEnd);
+		}
+		if (ret == 0) {
+			foreach (const QByteArray &hash, newHashes) {
+				const BlockLoc &loc = m_index[hash];
+				ds << hash << loc.offset << loc.size;
+			}
+			if (ds.status() != QDataStream::Ok || !syncFile(&idxFile)) {
+				m_errorString = idxFile.errorString();
+				ret = -EIO;
+			} else {
+				m_idxEnd = idxFile.pos();
+			}
+		}
+	}
+
+	if (ret == 0) {
+		QSaveFile manifestFile(manifestName);
+		if (!manifestFile.open(QIODevice::WriteOnly)) {
+			m_errorString = manifestFile.errorString();
+			ret = -EIO;
+		} else {
+			QDataStream ds(&manifestFile);
+			ds.setByteOrder(QDataStream::LittleEndian);
+			ds.setVersion(QDataStream::Qt_5_0);
+			ds << MANIFEST_MAGIC << MANIFEST_VERSION << (quint32)blockSize
+			   << QDateTime::currentMSecsSinceEpoch() << card->filename()
+			   << (quint32)hashes.size();
+			foreach (const QByteArray &hash, hashes) {
+				ds.writeRawData(hash.constData(), HASH_SIZE);
+			}
+			// NOTE: QSaveFile::commit() syncs the file before renaming it.
+			if (ds.status() != QDataStream::Ok || !manifestFile.commit()) {
+				m_errorString = manifestFile.errorString();
+				ret = -EIO;
+			}
+		}
+	}
+
+	if (ret != 0) {
+		// Forget the new blocks.
+		// They'll be written again by the next snapshot.
+		foreach (const QByteArray &hash, newHashes) {
+			m_index.remove(hash);
+		}
+		return ret;
+	}
+
+	if (pNewBlocks) {
+		*pNewBlocks = newHashes.size();
+	}
+	return 0;
+}
+
+/**
+ * Restore a snapshot to a raw card image.
+ * NOTE: Only the card blocks are stored, so formats
+ * with a file header are restored as raw images.
+ * @param id Snapshot ID.
+ * @param filename Output filename.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int SnapshotStore::restore(const QString &id, const QString &filename)
+{
+	m_errorString.clear();
+	Manifest manifest;
+	int ret = loadManifest(id, &manifest);
+	if (ret != 0)
+		return ret;
+
+	QFile packFile(QDir(m_path).filePath(QLatin1String("blocks.pack")));
+	if (!packFile.open(QIODevice::ReadOnly)) {
+		m_errorString = packFile.errorString();
+		return -EIO;
+	}
+
+	QSaveFile outFile(filename);
+	if (!outFile.open(QIODevice::WriteOnly)) {
+		m_errorString = outFile.errorString();
+		return -EIO;
+	}
+
+	QByteArray block(manifest.blockSize, 0);
+	foreach (const QByteArray &hash, manifest.hashes) {
+		auto iter = m_index.constFind(hash);
+		if (iter == m_index.cend() || iter->size != manifest.blockSize) {
+			m_errorString = QLatin1String("Snapshot references a missing block");
+			outFile.cancelWriting();
+			return -EIO;
+		}
+
+		if (!packFile.seek(iter->offset) ||
+		    packFile.read(block.data(), manifest.blockSize) != (qint64)manifest.blockSize)
+		{
+			m_errorString = packFile.errorString();
+			outFile.cancelWriting();
+			return -EIO;
+		}
+		if (outFile.write(block) != (qint64)manifest.blockSize) {
+			m_errorString = outFile.errorString();
+			outFile.cancelWriting();
+			return -EIO;
+		}
+	}
+
+	if (!outFile.commit()) {
+		m_errorString = outFile.errorString();
+		return -EIO;
+	}
+	return 0;
+}
+
+/**
+ * Export files that changed since a snapshot.
+ * A file is exported if any of its blocks differ from
+ * the same blocks in the snapshot.
+ * @param baseId		[in] Snapshot ID to compare against.
+ * @param card			[in] Card.
+ * @param path			[in] Output directory.
+ * @param pFilesExported	[out,opt] Number of files exported.
+ * @return 0 on success; negative POSIX error code on error. (also check errorString)
+ */
+int SnapshotStore::exportChanged(const QString &baseId, Card *card,
+				 const QString &path, int *pFilesExported)
+{
+	m_errorString.clear();
+	if (!card || !card->isOpen())
+		return -EINVAL;
+
+	Manifest manifest;
+	int ret = loadManifest(baseId, &manifest);
+	if (ret != 0)
+		return ret;
+	if (manifest.blockSize != (quint32)card->blockSize()) {
+		m_errorString = QLatin1String("Snapshot is from a different type of card");
+		return -EINVAL;
+	}
+
+	const QVector<QByteArray> hashes = hashBlocks(card);
+	if (hashes.isEmpty())
+		return -EIO;
+
+	QDir dir(path);
+	if (!dir.mkpath(QLatin1String("."))) {
+		m_errorString = QLatin1String("Unable to create the output directory");
+		return -EIO;
+	}
+
+	int filesExported = 0;
+	foreach (File *file, card->getFiles()) {
+		// Files without a FAT (e.g. GCI) are always exported.
+		const QVector<uint16_t> fatEntries = file->fatEntries();
+		bool changed = fatEntries.isEmpty();
+		foreach (uint16_t block, fatEntries) {
+			if (block >= hashes.size())
+				continue;
+			if (block >= manifest.hashes.size() ||
+			    hashes.at(block) != manifest.hashes.at(block))
+			{
+				changed = true;
+				break;
+			}
+		}
+		if (!changed)
+			continue;
+
+		ret = file->exportToFile(dir.filePath(file->defaultExportFilename()));
+		if (ret != 0) {
+			m_errorString = QLatin1String("Unable to export ") + file->filename();
+			return (ret < 0 ? ret : -EIO);
+		}
+		filesExported++;
+	}
+
+	if (pFilesExported) {
+		*pFilesExported = filesExported;
+	}
+	return 0;
+}
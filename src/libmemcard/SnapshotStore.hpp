@@ -0,0 +1,194 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * SnapshotStore.hpp: Content-addressed card snapshot store.               *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_SNAPSHOTSTORE_HPP__
+#define __LIBMEMCARD_SNAPSHOTSTORE_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+
+class Card;
+
+/**
+ * Content-addressed card snapshot store.
+ *
+ * Each block of a card is hashed (SHA-1), and unique blocks are
+ * stored once in a pack file. Each snapshot is a manifest that
+ * lists the block hashes in order, so repeated backups of the
+ * same card only store the blocks that changed.
+ *
+ * Store layout:
+ * - blocks.pack: Unique blocks, appended.
+ * - blocks.idx: Block index. (hash, pack offset, size)
+ * - <id>.snap: Snapshot manifests.
+ */
+class SnapshotStore
+{
+	public:
+		/**
+		 * Create a SnapshotStore.
+		 * open() must be called before using the store.
+		 * @param path Store directory.
+		 */
+		explicit SnapshotStore(const QString &path);
+
+	public:
+		/**
+		 * Open the store.
+		 * The directory is created if it doesn't exist.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int open(void);
+
+		/**
+		 * Get the store directory.
+		 * @return Store directory.
+		 */
+		inline QString path(void) const
+		{
+			return m_path;
+		}
+
+		/**
+		 * Get the last error string.
+		 * @return Error string.
+		 */
+		inline QString errorString(void) const
+		{
+			return m_errorString;
+		}
+
+		/**
+		 * Get the number of unique blocks in the store.
+		 * @return Number of unique blocks.
+		 */
+		inline int blockCount(void) const
+		{
+			return m_index.size();
+		}
+
+		/**
+		 * Create a default snapshot ID for a card image.
+		 * @param filename Card image filename.
+		 * @return Snapshot ID. (image name and current date/time)
+		 */
+		static QString defaultId(const QString &filename);
+
+		/**
+		 * Check if a snapshot ID is valid.
+		 * IDs may contain letters, digits, '-', '_', and '.'.
+		 * @param id Snapshot ID.
+		 * @return True if valid; false if not.
+		 */
+		static bool isValidId(const QString &id);
+
+		/**
+		 * Get the snapshots in the store.
+		 * @return Snapshot IDs, sorted by creation time. (oldest first)
+		 */
+		QStringList snapshots(void) const;
+
+		/**
+		 * Add a snapshot of a card.
+		 * @param card		[in] Card.
+		 * @param id		[in] Snapshot ID.
+		 * @param pNewBlocks	[out,opt] Number of blocks added to the pack.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int addSnapshot(Card *card, const QString &id, int *pNewBlocks = nullptr);
+
+		/**
+		 * Restore a snapshot to a raw card image.
+		 * NOTE: Only the card blocks are stored, so formats
+		 * with a file header are restored as raw images.
+		 * @param id Snapshot ID.
+		 * @param filename Output filename.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int restore(const QString &id, const QString &filename);
+
+		/**
+		 * Export files that changed since a snapshot.
+		 * A file is exported if any of its blocks differ from
+		 * the same blocks in the snapshot.
+		 * @param baseId		[in] Snapshot ID to compare against.
+		 * @param card			[in] Card.
+		 * @param path			[in] Output directory.
+		 * @param pFilesExported	[out,opt] Number of files exported.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int exportChanged(const QString &baseId, Card *card,
+				  const QString &path, int *pFilesExported = nullptr);
+
+	private:
+		/**
+		 * Snapshot manifest.
+		 */
+		struct Manifest {
+			quint32 blockSize;
+			qint64 timestamp;		// msec since epoch
+			QString source;			// Source filename.
+			QVector<QByteArray> hashes;	// Block hashes.
+		};
+
+		/**
+		 * Block location in the pack file.
+		 */
+		struct BlockLoc {
+			qint64 offset;
+			quint32 size;
+		};
+
+		/**
+		 * Get the filename of a snapshot manifest.
+		 * @param id Snapshot ID.
+		 * @return Manifest filename.
+		 */
+		QString manifestFileName(const QString &id) const;
+
+		/**
+		 * Get the creation time of a snapshot.
+		 * Only the manifest header is read.
+		 * @param id Snapshot ID.
+		 * @return Timestamp (msec since epoch), or -1 on error.
+		 */
+		qint64 manifestTimestamp(const QString &id) const;
+
+		/**
+		 * Load a snapshot manifest.
+		 * @param id		[in] Snapshot ID.
+		 * @param manifest	[out] Manifest.
+		 * @return 0 on success; negative POSIX error code on error. (also check errorString)
+		 */
+		int loadManifest(const QString &id, Manifest *manifest);
+
+		/**
+		 * Hash all blocks of a card.
+		 * @param card Card.
+		 * @return Block hashes, or empty QVector on error.
+		 */
+		static QVector<QByteArray> hashBlocks(Card *card);
+
+	private:
+		QString m_path;
+		QString m_errorString;
+
+		// Block index.
+		QHash<QByteArray, BlockLoc> m_index;
+		// End of the last valid record in blocks.idx. (-1 if not open)
+		qint64 m_idxEnd;
+};
+
+#endif /* __LIBMEMCARD_SNAPSHOTSTORE_HPP__ */
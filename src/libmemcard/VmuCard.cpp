@@ -51,6 +51,13 @@ class VmuCardPrivate : public CardPrivate
 		 */
 		int open(const QString &filename);
 
+		/**
+		 * Open a VMU image from memory.
+		 * @param data VMU image data. (implicitly shared)
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int open(const QByteArray &data);
+
 		/**
 		 * Format a new VMU image.
 		 * @param filename VMU image filename.
@@ -59,6 +66,13 @@ class VmuCardPrivate : public CardPrivate
 		 */
 		int format(const QString &filename);
 
+		/**
+		 * Is a block part of the file system metadata?
+		 * @param blockIdx Block index.
+		 * @return True if this is a system block; false if not.
+		 */
+		bool isSystemBlock(int blockIdx) const final;
+
 	public:
 		vmu_root_block mc_root;
 		vmu_fat mc_fat; // TODO: Multi-block FATs?
@@ -70,6 +84,12 @@ class VmuCardPrivate : public CardPrivate
 		vmu_dir_entry mc_dir[VMU_DIR_ENTRIES];
 
 	private:
+		/**
+		 * Load the VMU image after it has been opened.
+		 * @return 0 on success; non-zero on error. (also check errorString)
+		 */
+		int load(void);
+
 		/**
 		 * Load the memory card system information.
 		 * @return 0 on success; non-zero on error.
@@ -147,6 +167,23 @@ VmuCardPrivate::~VmuCardPrivate()
 	// TODO: Remove this?
 }
 
+/**
+ * Is a block part of the file system metadata?
+ * @param blockIdx Block index.
+ * @return True if this is a system block; false if not.
+ */
+bool VmuCardPrivate::isSystemBlock(int blockIdx) const
+{
+	if (blockIdx == VMU_ROOT_BLOCK_ADDRESS || blockIdx == mc_root.fat_addr)
+		return true;
+
+	// The directory is stored in reverse order,
+	// starting at dir_addr.
+	const int dir_first = (int)mc_root.dir_addr - (int)mc_root.dir_size + 1;
+	return (mc_root.dir_size > 0 &&
+		blockIdx >= dir_first && blockIdx <= (int)mc_root.dir_addr);
+}
+
 /**
  * Open an existing VMU image.
  * @param filename VMU image image filename.
@@ -160,11 +197,36 @@ int VmuCardPrivate::open(const QString &filename)
 		return ret;
 	}
 
+	return load();
+}
+
+/**
+ * Open a VMU image from memory.
+ * @param data VMU image data. (implicitly shared)
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int VmuCardPrivate::open(const QByteArray &data)
+{
+	int ret = CardPrivate::open(data, QIODevice::ReadOnly);
+	if (ret != 0) {
+		// Error opening the buffer.
+		return ret;
+	}
+
+	return load();
+}
+
+/**
+ * Load the VMU image after it has been opened.
+ * @return 0 on success; non-zero on error. (also check errorString)
+ */
+int VmuCardPrivate::load(void)
+{
 	// Load the VMU-specific data.
 
 	// Load the memory card system information.
 	// This includes the root block, directory, and FAT.
-	ret = loadSysInfo();
+	int ret = loadSysInfo();
 	if (ret != 0) {
 		// Error loading system information.
 		return ret;
@@ -447,9 +509,9 @@ void VmuCardPrivate::loadFileList(void)
 	if (init_size > 0)
 		emit q->filesRemoved();
 
-	// Reset the used block map.
+	// Reset the block allocation map.
 	// TODO
-	//resetUsedBlockMap();
+	//resetBlockMap();
 
 	QVector<File*> lstFiles_new;
 	lstFiles_new.reserve(NUM_ELEMENTS(mc_dir));
@@ -487,11 +549,10 @@ void VmuCardPrivate::loadFileList(void)
 		/*
 		QVector<uint16_t> fatEntries = vmuFile->fatEntries();
 		foreach (uint16_t block, fatEntries) {
-			if (block >= 5 && block < usedBlockMap.size()) {
+			if (block >= 5 && block < blockMap.size()) {
 				// Valid block.
-				// Increment its entry in the usedBlockMap.
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max())
-					usedBlockMap[block]++;
+				// Mark it as used in the block map.
+				blockMap.markUsed(block);
 			} else {
 				// Invalid block.
 				// TODO: Store an error value somewhere.
@@ -538,6 +599,21 @@ VmuCard *VmuCard::open(const QString& filename, QObject *parent)
 	return vmuCard;
 }
 
+/**
+ * Open a VMU image from memory.
+ * The data is implicitly shared, and is detached if written to.
+ * @param data VMU image data.
+ * @param parent Parent object.
+ * @return VmuCard object, or nullptr on error.
+ */
+VmuCard *VmuCard::open(const QByteArray &data, QObject *parent)
+{
+	VmuCard *vmuCard = new VmuCard(parent);
+	VmuCardPrivate *const d = vmuCard->d_func();
+	d->open(data);
+	return vmuCard;
+}
+
 /**
  * Format a new Memory Card image.
  * @param filename VMU image filename.
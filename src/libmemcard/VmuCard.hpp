@@ -36,6 +36,15 @@ class VmuCard : public Card
 		 */
 		static VmuCard *open(const QString& filename, QObject *parent);
 
+		/**
+		 * Open a VMU image from memory.
+		 * The data is implicitly shared, and is detached if written to.
+		 * @param data VMU image data.
+		 * @param parent Parent object.
+		 * @return VmuCard object, or nullptr on error.
+		 */
+		static VmuCard *open(const QByteArray &data, QObject *parent);
+
 		/**
 		 * Format a new VMU image.
 		 * @param filename VMU image filename.
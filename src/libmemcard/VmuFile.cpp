@@ -90,20 +90,27 @@ class VmuFilePrivate : public FilePrivate
 		// NOTE: These must NOT be the same as
 		// gcBanner or any icon in gcIcons.
 		bool isIconData;
-		GcImage *vmu_icon_mono;
-		GcImage *vmu_icon_color;
+		mutable GcImage *vmu_icon_mono;
+		mutable GcImage *vmu_icon_color;
+
+		/**
+		 * Load the icon animation metadata.
+		 * This sets iconSpeed, iconAnimMode, and iconMask
+		 * without decoding any images.
+		 */
+		void loadIconInfo(void) final;
 
 		/**
 		 * Load the banner image.
 		 * @return GcImage containing the banner image, or nullptr on error.
 		 */
-		GcImage *loadBannerImage(void) final;
+		GcImage *loadBannerImage(void) const final;
 
 		/**
 		 * Load the icon images.
 		 * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
 		 */
-		QVector<GcImage*> loadIconImages(void) final;
+		QVector<GcImage*> loadIconImages(void) const final;
 
 		/**
 		 * Load the icon images.
@@ -113,7 +120,7 @@ class VmuFilePrivate : public FilePrivate
 		 * vmu_icon_mono and vmu_icon_color. The caller must
 		 * check those variables afterwards.
 		 */
-		void loadIconImages_ICONDATA_VMS(void);
+		void loadIconImages_ICONDATA_VMS(void) const;
 };
 
 /**
@@ -285,15 +292,53 @@ void VmuFilePrivate::loadFileInfo(void)
 		description = filename + QChar(L'\0') + dc_desc;
 	}
 
-	// Load the banner and icon images.
-	loadImages();
+	// Load the icon animation metadata.
+	// NOTE: The banner and icon images are decoded on first use.
+	loadIconInfo();
+}
+
+/**
+ * Load the icon animation metadata.
+ * This sets iconSpeed, iconAnimMode, and iconMask
+ * without decoding any images.
+ */
+void VmuFilePrivate::loadIconInfo(void)
+{
+	// DC only supports looping icon animations.
+	// TODO: Use system-independent values?
+	this->iconAnimMode = 0;
+	this->iconSpeed.clear();
+	this->iconMask = 0;
+
+	if (isIconData) {
+		// ICONDATA_VMS has a single icon.
+		// It's verified when the icon is decoded.
+		this->iconMask = 1;
+		return;
+	}
+
+	if (!fileHeader || fileHeader->icon_count == 0) {
+		// No file header or icons.
+		return;
+	}
+
+	// Sanity check: Clamp to 8 icons maximum.
+	int iconCount = fileHeader->icon_count;
+	if (iconCount > 8)
+		iconCount = 8;
+
+	for (int i = 0; i < iconCount; i++) {
+		// TODO: Convert DC icon speed to system-independent value.
+		this->iconSpeed.append(3);
+	}
+	this->iconMask = (uint8_t)((1U << iconCount) - 1);
 }
 
 /**
  * Load the banner image.
  * @return GcImage* containing the banner image, or nullptr on error.
  */
-GcImage *VmuFilePrivate::loadBannerImage(void)
+GcImage *VmuFilePrivate::loadBannerImage(void) const
 {
 	if (isIconData) {
 		// ICONDATA_VMS
@@ -347,7 +392,7 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
  * Load the icon images.
  * @return QVector<GcImage*> containing the icon images, or empty QVector on error.
  */
-QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
+QVector<GcImage*> VmuFilePrivate::loadIconImages(void) const
 {
 	if (isIconData) {
 		// ICONDATA_VMS
@@ -381,10 +426,7 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 		return ret;
 	}
 
-	// DC only supports looping icon animations.
-	// TODO: Use system-independent values?
-	this->iconAnimMode = 0;
-
+	// NOTE: Icon animation metadata is loaded by loadIconInfo().
 	if (!fileHeader || fileHeader->icon_count == 0) {
 		// No file header or icons.
 		return QVector<GcImage*>();
@@ -418,12 +460,7 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 	const vmu_icon_palette *palette = (const vmu_icon_palette*)pIconStart;
 	const vmu_icon_data *iconData = (const vmu_icon_data*)(pIconStart + sizeof(*palette));
 	QVector<GcImage*> gcImages;
-	// TODO: Should be part of a struct that's returned...
-	this->iconSpeed.clear();
 	for (int i = 0; i < iconCount; i++, iconData++) {
-		// TODO: Should be part of a struct that's returned...
-		// TODO: Convert DC icon speed to system-independent value.
-		this->iconSpeed.append(3);
 		GcImage *gcImage = DcImageLoader::fromPalette16(
 					VMU_ICON_W, VMU_ICON_H,
 					iconData->icon, sizeof(iconData->icon),
@@ -442,7 +479,7 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
  * vmu_icon_mono and vmu_icon_color. The caller must
  * check those variables afterwards.
  */
-void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
+void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void) const
 {
 	// Delete any allocated VMU icons.
 	delete vmu_icon_mono;
@@ -450,10 +487,6 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 	delete vmu_icon_color;
 	vmu_icon_color = nullptr;
 
-	// DC only supports looping icon animations.
-	// TODO: Use system-independent values?
-	this->iconAnimMode = 0;
-
 	// Load the file into memory.
 	// TODO: Optimize by only reading in required data.
 	// TODO: Copy over the block code from GcnFile::loadIconImages(),
@@ -533,6 +566,7 @@ VmuFile::VmuFile(VmuCard *card,
 		checksumDef.start = 0;
 		checksumDef.length = (this->size() * card->blockSize());
 		checksumDef.endian = Checksum::CHKENDIAN_LITTLE;
+		Checksum::BindKernel(&checksumDef);
 
 		// TODO: Optimize this?
 		QVector<Checksum::ChecksumDef> checksumDefs;
@@ -611,6 +645,7 @@ int VmuFile::exportToFile(QIODevice *qioDevice)
 const GcImage *VmuFile::vmu_icondata_mono(void) const
 {
 	Q_D(const VmuFile);
+	d->ensureImagesLoaded();
 	return d->vmu_icon_mono;
 }
 
@@ -622,5 +657,6 @@ const GcImage *VmuFile::vmu_icondata_mono(void) const
 const GcImage *VmuFile::vmu_icondata_color(void) const
 {
 	Q_D(const VmuFile);
+	d->ensureImagesLoaded();
 	return d->vmu_icon_color;
 }
@@ -0,0 +1,276 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * BlockMapTest.cpp: BlockMap tests.                                       *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "BlockMap.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+namespace LibMemCard { namespace Tests {
+
+class BlockMapTest : public ::testing::Test
+{
+	protected:
+		BlockMapTest() { }
+
+	public:
+		/**
+		 * Check nextFree(), nextUsed(), and freeRunLength()
+		 * at every position against a simple linear search.
+		 * @param map Block map.
+		 * @param used Expected block states.
+		 */
+		static void checkQueries(const BlockMap &map, const vector<bool> &used);
+
+		// Map sizes around the 64-bit word boundaries,
+		// plus a full-size GCN card.
+		static const int sizes[];
+};
+
+const int BlockMapTest::sizes[] = {
+	1, 2, 63, 64, 65, 127, 128, 129, 191, 192, 193, 2043, 2048
+};
+
+/**
+ * Check nextFree(), nextUsed(), and freeRunLength()
+ * at every position against a simple linear search.
+ * @param map Block map.
+ * @param used Expected block states.
+ */
+void BlockMapTest::checkQueries(const BlockMap &map, const vector<bool> &used)
+{
+	const int size = (int)used.size();
+	ASSERT_EQ(size, map.size());
+
+	// Start past the end of the map, too.
+	int expectedFree = -1, expectedUsed = -1;
+	for (int start = size + 1; start >= 0; start--) {
+		if (start < size) {
+			if (used[start])
+				expectedUsed = start;
+			else
+				expectedFree = start;
+		}
+
+		ASSERT_EQ(expectedFree, map.nextFree(start)) << "size == " << size << ", start == " << start;
+		ASSERT_EQ(expectedUsed, map.nextUsed(start)) << "size == " << size << ", start == " << start;
+
+		int expectedRun = 0;
+		if (start < size && !used[start]) {
+			expectedRun = (expectedUsed >= 0 ? expectedUsed : size) - start;
+		}
+		ASSERT_EQ(expectedRun, map.freeRunLength(start)) << "size == " << size << ", start == " << start;
+	}
+
+	// Negative start positions are treated as 0.
+	EXPECT_EQ(map.nextFree(0), map.nextFree(-1));
+	EXPECT_EQ(map.nextUsed(0), map.nextUsed(-1));
+	EXPECT_EQ(0, map.freeRunLength(-1));
+}
+
+/**
+ * Used blocks at the word edges. (63, 64, 65)
+ */
+TEST_F(BlockMapTest, wordEdges)
+{
+	BlockMap map(200);
+	map.markUsed(63);
+	map.markUsed(64);
+	map.markUsed(65);
+
+	EXPECT_EQ(63, map.nextUsed(0));
+	EXPECT_EQ(63, map.nextUsed(63));
+	EXPECT_EQ(64, map.nextUsed(64));
+	EXPECT_EQ(65, map.nextUsed(65));
+	EXPECT_EQ(-1, map.nextUsed(66));
+
+	EXPECT_EQ(62, map.nextFree(62));
+	EXPECT_EQ(66, map.nextFree(63));
+	EXPECT_EQ(66, map.nextFree(64));
+	EXPECT_EQ(66, map.nextFree(65));
+
+	EXPECT_EQ(63, map.freeRunLength(0));
+	EXPECT_EQ(1, map.freeRunLength(62));
+	EXPECT_EQ(0, map.freeRunLength(63));
+	EXPECT_EQ(0, map.freeRunLength(64));
+	EXPECT_EQ(0, map.freeRunLength(65));
+	EXPECT_EQ(200 - 66, map.freeRunLength(66));
+
+	// Free block between two used words.
+	map.markFree(64);
+	EXPECT_EQ(64, map.nextFree(63));
+	EXPECT_EQ(1, map.freeRunLength(64));
+	EXPECT_EQ(65, map.nextUsed(64));
+	EXPECT_EQ(2, map.usedCount());
+}
+
+/**
+ * Every single block used, in maps of every size.
+ * Large maps only check the blocks at the word edges.
+ */
+TEST_F(BlockMapTest, singleBlock)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const int size = sizes[s];
+		for (int block = 0; block < size; block++) {
+			if (size > 256 && (block & 63) != 0 && (block & 63) != 63 && block != size - 1)
+				continue;
+
+			BlockMap map(size);
+			vector<bool> used(size, false);
+			map.markUsed(block);
+			used[block] = true;
+			checkQueries(map, used);
+			if (HasFatalFailure())
+				return;
+		}
+	}
+}
+
+/**
+ * Bits past the end of a partial last word
+ * must not be reported as free blocks.
+ */
+TEST_F(BlockMapTest, partialLastWord)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const int size = sizes[s];
+		BlockMap map(size);
+		map.markUsed(0, size);
+
+		// Only the last block is free.
+		map.markFree(size - 1);
+		EXPECT_EQ(size - 1, map.nextFree(0)) << "size == " << size;
+		EXPECT_EQ(1, map.freeRunLength(size - 1)) << "size == " << size;
+		EXPECT_EQ(-1, map.nextFree(size)) << "size == " << size;
+		EXPECT_EQ(-1, map.nextUsed(size - 1)) << "size == " << size;
+	}
+}
+
+/**
+ * A full map has no free blocks.
+ */
+TEST_F(BlockMapTest, fullMap)
+{
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const int size = sizes[s];
+		BlockMap map(size);
+		map.markUsed(0, size);
+
+		EXPECT_EQ(size, map.usedCount()) << "size == " << size;
+		EXPECT_EQ(0, map.freeCount()) << "size == " << size;
+		EXPECT_EQ(-1, map.nextFree(0)) << "size == " << size;
+		EXPECT_EQ(-1, map.nextFree(size - 1)) << "size == " << size;
+		EXPECT_EQ(0, map.freeRunLength(0)) << "size == " << size;
+		EXPECT_EQ(0, map.nextUsed(0)) << "size == " << size;
+		EXPECT_EQ(0, map.collisionCount()) << "size == " << size;
+	}
+
+	// An empty map has no blocks at all.
+	BlockMap empty;
+	EXPECT_EQ(0, empty.size());
+	EXPECT_EQ(-1, empty.nextFree(0));
+	EXPECT_EQ(-1, empty.nextUsed(0));
+	EXPECT_EQ(0, empty.freeRunLength(0));
+}
+
+/**
+ * Pseudo-random maps, checked at every position.
+ */
+TEST_F(BlockMapTest, randomMaps)
+{
+	// xorshift32, so the maps are the same on every run.
+	uint32_t x = 0x6D637263;
+	for (size_t s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++) {
+		const int size = sizes[s];
+		for (int density = 1; density <= 7; density += 3) {
+			BlockMap map(size);
+			vector<bool> used(size, false);
+			for (int block = 0; block < size; block++) {
+				x ^= x << 13;
+				x ^= x >> 17;
+				x ^= x << 5;
+				if ((int)(x & 7) < density) {
+					map.markUsed(block);
+					used[block] = true;
+				}
+			}
+			checkQueries(map, used);
+			if (HasFatalFailure())
+				return;
+		}
+	}
+}
+
+/**
+ * Blocks marked as used more than once are collisions.
+ */
+TEST_F(BlockMapTest, collisions)
+{
+	BlockMap map(130);
+
+	// Overlapping ranges across a word boundary.
+	map.markUsed(60, 8);	// 60-67
+	map.markUsed(64, 8);	// 64-71
+	EXPECT_EQ(12, map.usedCount());
+	EXPECT_EQ(4, map.collisionCount());
+	for (int block = 0; block < map.size(); block++) {
+		EXPECT_EQ(block >= 60 && block < 72, map.isUsed(block)) << "block == " << block;
+		EXPECT_EQ(block >= 64 && block < 68, map.isCollision(block)) << "block == " << block;
+	}
+
+	// Collisions don't affect the free block queries.
+	EXPECT_EQ(72, map.nextFree(60));
+	EXPECT_EQ(60, map.nextUsed(0));
+
+	// A third use is still a single collision.
+	map.markUsed(64);
+	EXPECT_EQ(12, map.usedCount());
+	EXPECT_EQ(4, map.collisionCount());
+
+	// Freeing a block clears the collision.
+	map.markFree(64);
+	EXPECT_FALSE(map.isUsed(64));
+	EXPECT_FALSE(map.isCollision(64));
+	EXPECT_EQ(11, map.usedCount());
+	EXPECT_EQ(3, map.collisionCount());
+
+	// Last block in a partial word.
+	map.markUsed(129);
+	map.markUsed(129);
+	EXPECT_TRUE(map.isCollision(129));
+	EXPECT_EQ(4, map.collisionCount());
+
+	// Out of range blocks are ignored.
+	map.markUsed(-1);
+	map.markUsed(130);
+	map.markUsed(128, 4);
+	EXPECT_FALSE(map.isUsed(-1));
+	EXPECT_FALSE(map.isUsed(130));
+	EXPECT_FALSE(map.isCollision(130));
+	EXPECT_EQ(13, map.usedCount());
+	EXPECT_EQ(4, map.collisionCount());
+
+	// Copies are independent. (implicit sharing)
+	const BlockMap copy = map;
+	map.reset(130);
+	EXPECT_EQ(0, map.usedCount());
+	EXPECT_EQ(0, map.collisionCount());
+	EXPECT_EQ(13, copy.usedCount());
+	EXPECT_EQ(4, copy.collisionCount());
+	EXPECT_TRUE(copy.isCollision(129));
+}
+
+} }
@@ -0,0 +1,350 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * CardDiffTest.cpp: CardDiff tests.                                       *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "CardDiff.hpp"
+#include "GcnCard.hpp"
+
+// libgctools
+#include "card.h"
+#include "util/byteswap.h"
+#include "Checksum.hpp"
+
+// C includes.
+#include <errno.h>
+#include <string.h>
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QByteArray>
+
+namespace LibMemCard { namespace Tests {
+
+class CardDiffTest : public ::testing::Test
+{
+	protected:
+		CardDiffTest() { }
+
+	public:
+		/**
+		 * In-memory card image.
+		 * Tables are in host byte order until the image is built.
+		 */
+		struct Image {
+			Image();
+
+			/**
+			 * Add a file.
+			 * The blocks are allocated contiguously.
+			 * Each block is filled with (fill + file-relative block index).
+			 * @param dirIdx Directory entry index.
+			 * @param name Filename.
+			 * @param block Starting block.
+			 * @param length Length, in blocks.
+			 * @param fill Fill value of the first block.
+			 * @param mtime Last modified time. (GCN timestamp)
+			 */
+			void addFile(int dirIdx, const char *name, int block, int length,
+				     uint8_t fill, uint32_t mtime);
+
+			/**
+			 * Build the card image.
+			 * Both copies of the tables are written with valid checksums.
+			 * @return Card image.
+			 */
+			QByteArray build(void) const;
+
+			card_dat dat;
+			card_bat bat;
+			QByteArray data;
+		};
+
+		/**
+		 * Find a file difference by filename.
+		 * @param files File differences.
+		 * @param filename Filename.
+		 * @return File difference, or nullptr if not found.
+		 */
+		static const CardDiff::FileDiff *findDiff(
+			const QVector<CardDiff::FileDiff> &files, const char *filename);
+
+		// Card size used by the tests. (4 Mbit)
+		static const int SIZE_MBIT = 4;
+		static const int TOTAL_BLOCKS = SIZE_MBIT * 16;
+		static const int BLOCK_SIZE = 8192;
+};
+
+CardDiffTest::Image::Image()
+	: data(TOTAL_BLOCKS * BLOCK_SIZE, 0)
+{
+	memset(&dat, 0xFF, sizeof(dat));
+	memset(&bat, 0, sizeof(bat));
+	bat.freeblocks = TOTAL_BLOCKS - CARD_SYSAREA;
+	bat.lastalloc = CARD_SYSAREA - 1;
+}
+
+/**
+ * Add a file.
+ * The blocks are allocated contiguously.
+ * Each block is filled with (fill + file-relative block index).
+ * @param dirIdx Directory entry index.
+ * @param name Filename.
+ * @param block Starting block.
+ * @param length Length, in blocks.
+ * @param fill Fill value of the first block.
+ * @param mtime Last modified time. (GCN timestamp)
+ */
+void CardDiffTest::Image::addFile(int dirIdx, const char *name, int block, int length,
+				  uint8_t fill, uint32_t mtime)
+{
+	card_direntry *const dirEntry = &dat.entries[dirIdx];
+	memset(dirEntry, 0, sizeof(*dirEntry));
+	memcpy(dirEntry->gamecode, "GTST", sizeof(dirEntry->gamecode));
+	memcpy(dirEntry->company, "01", sizeof(dirEntry->company));
+	dirEntry->pad_00 = 0xFF;
+	strncpy(dirEntry->filename, name, sizeof(dirEntry->filename));
+	dirEntry->lastmodified = mtime;
+	dirEntry->iconaddr = 0xFFFFFFFF;
+	dirEntry->permission = CARD_ATTRIB_PUBLIC;
+	dirEntry->block = block;
+	dirEntry->length = length;
+	dirEntry->pad_01 = 0xFFFF;
+
+	for (int i = 0; i < length; i++) {
+		bat.fat[block + i - CARD_SYSAREA] =
+			(i == length - 1 ? 0xFFFF : block + i + 1);
+		memset(data.data() + ((block + i) * BLOCK_SIZE), (uint8_t)(fill + i), BLOCK_SIZE);
+	}
+	bat.freeblocks -= length;
+	if (block + length - 1 > bat.lastalloc)
+		bat.lastalloc = block + length - 1;
+}
+
+/**
+ * Build the card image.
+ * Both copies of the tables are written with valid checksums.
+ * @return Card image.
+ */
+QByteArray CardDiffTest::Image::build(void) const
+{
+	QByteArray image = data;
+
+	// Card header. (block 0)
+	card_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.serial, "mcrecovertst", sizeof(hdr.serial));
+	hdr.size = cpu_to_be16(SIZE_MBIT);
+	uint32_t chksum = Checksum::AddInvDual16(
+		reinterpret_cast<const uint16_t*>(&hdr), 0x1FC, Checksum::CHKENDIAN_BIG);
+	hdr.chksum1 = cpu_to_be16(chksum >> 16);
+	hdr.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+	memcpy(image.data(), &hdr, sizeof(hdr));
+
+	// Byteswap the tables.
+	card_dat bdat = dat;
+	card_bat bbat = bat;
+	for (int i = 0; i < CARD_MAXFILES; i++) {
+		card_direntry *dirEntry	= &bdat.entries[i];
+		dirEntry->lastmodified	= cpu_to_be32(dirEntry->lastmodified);
+		dirEntry->iconaddr	= cpu_to_be32(dirEntry->iconaddr);
+		dirEntry->iconfmt	= cpu_to_be16(dirEntry->iconfmt);
+		dirEntry->iconspeed	= cpu_to_be16(dirEntry->iconspeed);
+		dirEntry->block		= cpu_to_be16(dirEntry->block);
+		dirEntry->length	= cpu_to_be16(dirEntry->length);
+		dirEntry->commentaddr	= cpu_to_be32(dirEntry->commentaddr);
+	}
+	bbat.freeblocks	= cpu_to_be16(bbat.freeblocks);
+	bbat.lastalloc	= cpu_to_be16(bbat.lastalloc);
+	for (size_t i = 0; i < sizeof(bbat.fat)/sizeof(bbat.fat[0]); i++) {
+		bbat.fat[i] = cpu_to_be16(bbat.fat[i]);
+	}
+
+	// Both copies of the tables. (blocks 1-4)
+	for (int i = 0; i < 2; i++) {
+		bdat.dircntrl.updated = cpu_to_be16(i);
+		chksum = Checksum::AddInvDual16(
+			reinterpret_cast<const uint16_t*>(&bdat),
+			(uint32_t)(sizeof(bdat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		bdat.dircntrl.chksum1 = cpu_to_be16(chksum >> 16);
+		bdat.dircntrl.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		memcpy(image.data() + ((1 + i) * BLOCK_SIZE), &bdat, sizeof(bdat));
+
+		bbat.updated = cpu_to_be16(i);
+		chksum = Checksum::AddInvDual16(
+			(reinterpret_cast<const uint16_t*>(&bbat) + 2),
+			(uint32_t)(sizeof(bbat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		bbat.chksum1 = cpu_to_be16(chksum >> 16);
+		bbat.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		memcpy(image.data() + ((3 + i) * BLOCK_SIZE), &bbat, sizeof(bbat));
+	}
+
+	return image;
+}
+
+/**
+ * Find a file difference by filename.
+ * @param files File differences.
+ * @param filename Filename.
+ * @return File difference, or nullptr if not found.
+ */
+const CardDiff::FileDiff *CardDiffTest::findDiff(
+	const QVector<CardDiff::FileDiff> &files, const char *filename)
+{
+	const QString qFilename = QLatin1String(filename);
+	for (int i = 0; i < files.size(); i++) {
+		if (files.at(i).filename == qFilename)
+			return &files.at(i);
+	}
+	return nullptr;
+}
+
+/**
+ * Added, removed, modified, and moved files.
+ */
+TEST_F(CardDiffTest, fileChanges)
+{
+	Image imgA;
+	imgA.addFile(0, "unchanged",  5, 2, 0x10, 1000);
+	imgA.addFile(1, "removed",    7, 1, 0x20, 1000);
+	imgA.addFile(2, "modified",   8, 3, 0x30, 1000);
+	imgA.addFile(3, "moved",     11, 2, 0x40, 1000);
+	imgA.addFile(4, "touched",   13, 1, 0x50, 1000);
+	imgA.addFile(5, "moved-mod", 15, 2, 0x70, 1000);
+
+	// Card B has the files in a different directory order,
+	// so they have to be matched by name.
+	Image imgB;
+	imgB.addFile(0, "modified",   8, 3, 0x30, 1000);
+	imgB.addFile(1, "unchanged",  5, 2, 0x10, 1000);
+	imgB.addFile(2, "added",     14, 1, 0x60, 1000);
+	imgB.addFile(3, "touched",   13, 1, 0x50, 1001);
+	imgB.addFile(4, "moved",     20, 2, 0x40, 1000);
+	imgB.addFile(5, "moved-mod", 22, 2, 0x70, 1000);
+	// Change the second block of "modified" and "moved-mod".
+	memset(imgB.data.data() + (9 * BLOCK_SIZE), 0xA5, BLOCK_SIZE);
+	memset(imgB.data.data() + (23 * BLOCK_SIZE), 0xA5, BLOCK_SIZE);
+
+	unique_ptr<GcnCard> cardA(GcnCard::open(imgA.build(), nullptr));
+	unique_ptr<GcnCard> cardB(GcnCard::open(imgB.build(), nullptr));
+	ASSERT_TRUE(cardA.get() != nullptr);
+	ASSERT_TRUE(cardB.get() != nullptr);
+	ASSERT_TRUE(cardA->isOpen());
+	ASSERT_TRUE(cardB->isOpen());
+	ASSERT_EQ(6, cardA->getFiles(Card::FTYPE_NORMAL).size());
+	ASSERT_EQ(6, cardB->getFiles(Card::FTYPE_NORMAL).size());
+
+	CardDiff diff;
+	ASSERT_EQ(0, diff.compare(cardA.get(), cardB.get()));
+
+	// "unchanged" and "moved" are unchanged.
+	// Files that were only moved are not reported.
+	const QVector<CardDiff::FileDiff> files = diff.files();
+	EXPECT_EQ(5, files.size());
+	EXPECT_EQ(2, diff.unchangedFileCount());
+	EXPECT_TRUE(findDiff(files, "unchanged") == nullptr);
+	EXPECT_TRUE(findDiff(files, "moved") == nullptr);
+
+	const CardDiff::FileDiff *fd = findDiff(files, "removed");
+	ASSERT_TRUE(fd != nullptr);
+	EXPECT_EQ(CardDiff::DIFF_REMOVED, fd->type);
+	EXPECT_EQ(QLatin1String("GTST01"), fd->gameID);
+	EXPECT_TRUE(fd->fileA != nullptr);
+	EXPECT_TRUE(fd->fileB == nullptr);
+
+	fd = findDiff(files, "added");
+	ASSERT_TRUE(fd != nullptr);
+	EXPECT_EQ(CardDiff::DIFF_ADDED, fd->type);
+	EXPECT_TRUE(fd->fileA == nullptr);
+	EXPECT_TRUE(fd->fileB != nullptr);
+
+	fd = findDiff(files, "modified");
+	ASSERT_TRUE(fd != nullptr);
+	EXPECT_EQ(CardDiff::DIFF_MODIFIED, fd->type);
+	EXPECT_TRUE(fd->fileA != nullptr);
+	EXPECT_TRUE(fd->fileB != nullptr);
+	EXPECT_EQ(QVector<int>() << 1, fd->changedBlocks);
+	EXPECT_FALSE(fd->moved);
+	EXPECT_FALSE(fd->mtimeChanged);
+
+	// Timestamp change only.
+	fd = findDiff(files, "touched");
+	ASSERT_TRUE(fd != nullptr);
+	EXPECT_EQ(CardDiff::DIFF_MODIFIED, fd->type);
+	EXPECT_TRUE(fd->changedBlocks.isEmpty());
+	EXPECT_FALSE(fd->moved);
+	EXPECT_TRUE(fd->mtimeChanged);
+
+	// Moved and modified.
+	fd = findDiff(files, "moved-mod");
+	ASSERT_TRUE(fd != nullptr);
+	EXPECT_EQ(CardDiff::DIFF_MODIFIED, fd->type);
+	EXPECT_EQ(QVector<int>() << 1, fd->changedBlocks);
+	EXPECT_TRUE(fd->moved);
+	EXPECT_FALSE(fd->mtimeChanged);
+
+	// Physical blocks.
+	// The header is identical; the tables and moved data differ.
+	const BlockMap blocks = diff.changedBlocks();
+	EXPECT_EQ(TOTAL_BLOCKS, blocks.size());
+	EXPECT_FALSE(blocks.isUsed(0));
+	for (int i = 1; i < CARD_SYSAREA; i++) {
+		EXPECT_TRUE(blocks.isUsed(i)) << "block == " << i;
+	}
+	static const int unchangedBlocks[] = {5, 6, 8, 10, 13, 24, TOTAL_BLOCKS - 1};
+	for (size_t i = 0; i < sizeof(unchangedBlocks)/sizeof(unchangedBlocks[0]); i++) {
+		EXPECT_FALSE(blocks.isUsed(unchangedBlocks[i])) << "block == " << unchangedBlocks[i];
+	}
+	static const int changedBlocks[] = {7, 9, 11, 12, 14, 15, 16, 20, 21, 22, 23};
+	for (size_t i = 0; i < sizeof(changedBlocks)/sizeof(changedBlocks[0]); i++) {
+		EXPECT_TRUE(blocks.isUsed(changedBlocks[i])) << "block == " << changedBlocks[i];
+	}
+}
+
+/**
+ * Identical cards have no differences.
+ */
+TEST_F(CardDiffTest, identicalCards)
+{
+	Image img;
+	img.addFile(0, "first",  5, 2, 0x10, 1000);
+	img.addFile(1, "second", 7, 3, 0x20, 2000);
+	const QByteArray image = img.build();
+
+	unique_ptr<GcnCard> cardA(GcnCard::open(image, nullptr));
+	unique_ptr<GcnCard> cardB(GcnCard::open(image, nullptr));
+	ASSERT_TRUE(cardA.get() != nullptr);
+	ASSERT_TRUE(cardB.get() != nullptr);
+
+	CardDiff diff;
+	ASSERT_EQ(0, diff.compare(cardA.get(), cardB.get()));
+	EXPECT_TRUE(diff.files().isEmpty());
+	EXPECT_EQ(2, diff.unchangedFileCount());
+	EXPECT_EQ(-1, diff.changedBlocks().nextUsed(0));
+}
+
+/**
+ * Cards that aren't open can't be compared.
+ */
+TEST_F(CardDiffTest, invalidCards)
+{
+	unique_ptr<GcnCard> card(GcnCard::open(Image().build(), nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+
+	CardDiff diff;
+	EXPECT_EQ(-EINVAL, diff.compare(nullptr, card.get()));
+	EXPECT_EQ(-EINVAL, diff.compare(card.get(), nullptr));
+}
+
+} }
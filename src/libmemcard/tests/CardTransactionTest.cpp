@@ -0,0 +1,221 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * CardTransactionTest.cpp: Card write transaction tests.                  *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "GcnCard.hpp"
+
+// C includes.
+#ifndef _WIN32
+# include <signal.h>
+# include <sys/resource.h>
+#endif /* !_WIN32 */
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+namespace LibMemCard { namespace Tests {
+
+class CardTransactionTest : public ::testing::Test
+{
+	protected:
+		CardTransactionTest() { }
+
+	public:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+		/**
+		 * Read a block directly from the card image file.
+		 * @param blockIdx Block index.
+		 * @return Block data, or empty QByteArray on error.
+		 */
+		QByteArray readFileBlock(int blockIdx) const;
+
+		// Block indexes used by the tests.
+		static const int SYSTEM_BLOCK = 1;	// Directory table
+		static const int DATA_BLOCK = 10;
+
+	public:
+		QTemporaryDir tmpDir;
+		QString filename;
+		unique_ptr<GcnCard> card;
+		int blockSize;
+};
+
+/**
+ * Format a new memory card image.
+ */
+void CardTransactionTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+	filename = tmpDir.path() + QLatin1String("/card.raw");
+	card.reset(GcnCard::format(filename, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	ASSERT_TRUE(card->isOpen());
+	ASSERT_FALSE(card->isReadOnly());
+	blockSize = card->blockSize();
+	ASSERT_GT(blockSize, 0);
+}
+
+void CardTransactionTest::TearDown(void)
+{
+	card.reset();
+}
+
+/**
+ * Read a block directly from the card image file.
+ * @param blockIdx Block index.
+ * @return Block data, or empty QByteArray on error.
+ */
+QByteArray CardTransactionTest::readFileBlock(int blockIdx) const
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	if (!file.seek((qint64)blockIdx * blockSize))
+		return QByteArray();
+	return file.read(blockSize);
+}
+
+/**
+ * Blocks are buffered until commit(), and readBlock()
+ * returns the buffered data in the meantime.
+ */
+TEST_F(CardTransactionTest, commitWritesBufferedBlocks)
+{
+	const QByteArray origData = readFileBlock(DATA_BLOCK);
+	ASSERT_EQ(blockSize, origData.size());
+	const QByteArray newData(blockSize, '\x5A');
+
+	ASSERT_EQ(0, card->beginTransaction());
+	EXPECT_TRUE(card->inTransaction());
+	ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+
+	// The card returns the buffered block...
+	QByteArray buf(blockSize, 0);
+	ASSERT_EQ(blockSize, card->readBlock(buf.data(), blockSize, DATA_BLOCK));
+	EXPECT_EQ(newData, buf);
+	// ...but it hasn't been written to the file yet.
+	EXPECT_EQ(origData, readFileBlock(DATA_BLOCK));
+
+	ASSERT_EQ(0, card->commit());
+	EXPECT_FALSE(card->inTransaction());
+	EXPECT_EQ(newData, readFileBlock(DATA_BLOCK));
+}
+
+/**
+ * rollback() discards the buffered blocks.
+ */
+TEST_F(CardTransactionTest, rollbackDiscardsBufferedBlocks)
+{
+	const QByteArray origData = readFileBlock(DATA_BLOCK);
+	ASSERT_EQ(blockSize, origData.size());
+	const QByteArray newData(blockSize, '\x5A');
+
+	ASSERT_EQ(0, card->beginTransaction());
+	ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+	card->rollback();
+	EXPECT_FALSE(card->inTransaction());
+
+	QByteArray buf(blockSize, 0);
+	ASSERT_EQ(blockSize, card->readBlock(buf.data(), blockSize, DATA_BLOCK));
+	EXPECT_EQ(origData, buf);
+	EXPECT_EQ(origData, readFileBlock(DATA_BLOCK));
+}
+
+/**
+ * Only the outermost commit() writes to the device.
+ */
+TEST_F(CardTransactionTest, nestedCommitIsDeferred)
+{
+	const QByteArray origData = readFileBlock(DATA_BLOCK);
+	const QByteArray newData(blockSize, '\x5A');
+
+	ASSERT_EQ(0, card->beginTransaction());
+	ASSERT_EQ(0, card->beginTransaction());
+	ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+
+	ASSERT_EQ(0, card->commit());
+	EXPECT_TRUE(card->inTransaction());
+	EXPECT_EQ(origData, readFileBlock(DATA_BLOCK));
+
+	ASSERT_EQ(0, card->commit());
+	EXPECT_FALSE(card->inTransaction());
+	EXPECT_EQ(newData, readFileBlock(DATA_BLOCK));
+}
+
+/**
+ * commit() without a transaction fails.
+ */
+TEST_F(CardTransactionTest, commitWithoutTransaction)
+{
+	EXPECT_EQ(-EINVAL, card->commit());
+}
+
+#ifndef _WIN32
+/**
+ * If the data blocks can't be written, the system blocks
+ * aren't written either, and the transaction is kept so
+ * commit() can be retried.
+ */
+TEST_F(CardTransactionTest, failedCommitKeepsTransaction)
+{
+	const QByteArray origSysData = readFileBlock(SYSTEM_BLOCK);
+	const QByteArray origData = readFileBlock(DATA_BLOCK);
+	ASSERT_EQ(blockSize, origSysData.size());
+	ASSERT_EQ(blockSize, origData.size());
+	const QByteArray newSysData(blockSize, '\xA5');
+	const QByteArray newData(blockSize, '\x5A');
+
+	ASSERT_EQ(0, card->beginTransaction());
+	ASSERT_EQ(blockSize, card->writeBlock(newSysData.constData(), blockSize, SYSTEM_BLOCK));
+	ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+
+	// Limit the file size so the data block can't be written,
+	// but the system block could be.
+	struct rlimit oldLimit, newLimit;
+	ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &oldLimit));
+	newLimit = oldLimit;
+	newLimit.rlim_cur = (rlim_t)DATA_BLOCK * blockSize;
+	void (*oldHandler)(int) = signal(SIGXFSZ, SIG_IGN);
+	ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &newLimit));
+	const int ret = card->commit();
+	setrlimit(RLIMIT_FSIZE, &oldLimit);
+	signal(SIGXFSZ, oldHandler);
+
+	EXPECT_NE(0, ret);
+	EXPECT_TRUE(card->inTransaction());
+	EXPECT_EQ(origSysData, readFileBlock(SYSTEM_BLOCK));
+
+	// The buffered blocks are still available.
+	QByteArray buf(blockSize, 0);
+	ASSERT_EQ(blockSize, card->readBlock(buf.data(), blockSize, SYSTEM_BLOCK));
+	EXPECT_EQ(newSysData, buf);
+	ASSERT_EQ(blockSize, card->readBlock(buf.data(), blockSize, DATA_BLOCK));
+	EXPECT_EQ(newData, buf);
+
+	// Retry the commit.
+	ASSERT_EQ(0, card->commit());
+	EXPECT_FALSE(card->inTransaction());
+	EXPECT_EQ(newSysData, readFileBlock(SYSTEM_BLOCK));
+	EXPECT_EQ(newData, readFileBlock(DATA_BLOCK));
+}
+#endif /* !_WIN32 */
+
+} }
@@ -0,0 +1,394 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * CompressedFileTest.cpp: CompressedFile tests.                           *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "CompressedFile.hpp"
+#include "GcnCard.hpp"
+
+// zlib
+#include <zlib.h>
+
+// C includes.
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+namespace LibMemCard { namespace Tests {
+
+class CompressedFileTest : public ::testing::Test
+{
+	protected:
+		CompressedFileTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Compress data with deflate.
+		 * @param data Uncompressed data.
+		 * @param windowBits zlib windowBits. (31 for gzip; -15 for raw deflate)
+		 * @return Compressed data, or empty QByteArray on error.
+		 */
+		static QByteArray deflateData(const QByteArray &data, int windowBits);
+
+		/**
+		 * Write data to a file.
+		 * @param filename Filename.
+		 * @param data Data.
+		 * @return True on success; false on error.
+		 */
+		static bool writeFile(const QString &filename, const QByteArray &data);
+
+		/**
+		 * Write a gzip-compressed file.
+		 * @param filename Filename.
+		 * @param data Uncompressed data.
+		 * @return True on success; false on error.
+		 */
+		static bool writeGzip(const QString &filename, const QByteArray &data);
+
+		/**
+		 * Write a zip file with a single deflated member.
+		 * @param filename Filename.
+		 * @param data Uncompressed data.
+		 * @return True on success; false on error.
+		 */
+		static bool writeZip(const QString &filename, const QByteArray &data);
+
+		/**
+		 * Read random blocks from a compressed file and
+		 * compare them to the uncompressed data.
+		 * @param file Opened compressed file.
+		 */
+		void checkRandomBlocks(CompressedFile *file) const;
+
+		/**
+		 * Open a compressed file, check random blocks, and close it.
+		 * This is done twice: the first open builds the seek index,
+		 * and the second open loads it from the .mcidx file.
+		 * @param filename Filename.
+		 */
+		void checkCompressedFile(const QString &filename) const;
+
+		// GCN block size.
+		static const int BLOCK_SIZE = 8192;
+		// Uncompressed data size. (several seek index spans, plus an odd tail)
+		static const int DATA_SIZE = (BLOCK_SIZE * 320) + 1000;
+
+	public:
+		QTemporaryDir tmpDir;
+		QByteArray data;
+};
+
+void CompressedFileTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+
+	// Mix of random, repeating, and blank blocks, so the
+	// deflate stream has stored and compressed blocks.
+	// xorshift32, so the data is the same on every run.
+	data.resize(DATA_SIZE);
+	uint8_t *const p = reinterpret_cast<uint8_t*>(data.data());
+	uint32_t x = 0x6D637263;
+	for (int i = 0; i < DATA_SIZE; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		switch ((i / BLOCK_SIZE) % 4) {
+			case 0:
+				// Random.
+				p[i] = (uint8_t)(x >> 24);
+				break;
+			case 1:
+				// Mostly repeating, with some noise.
+				p[i] = ((x & 0xF0) == 0 ? (uint8_t)(x >> 24) : (uint8_t)(i % 61));
+				break;
+			case 2:
+				// Blank.
+				p[i] = 0x00;
+				break;
+			default:
+				// Low entropy.
+				p[i] = (uint8_t)((x >> 24) & 0x03);
+				break;
+		}
+	}
+}
+
+/**
+ * Compress data with deflate.
+ * @param data Uncompressed data.
+ * @param windowBits zlib windowBits. (31 for gzip; -15 for raw deflate)
+ * @return Compressed data, or empty QByteArray on error.
+ */
+QByteArray CompressedFileTest::deflateData(const QByteArray &data, int windowBits)
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return QByteArray();
+
+	QByteArray out;
+	out.resize((int)deflateBound(&zs, data.size()) + 32);
+	zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+	zs.avail_in = data.size();
+	zs.next_out = reinterpret_cast<Bytef*>(out.data());
+	zs.avail_out = out.size();
+	const int ret = deflate(&zs, Z_FINISH);
+	const int outSize = out.size() - zs.avail_out;
+	deflateEnd(&zs);
+	if (ret != Z_STREAM_END)
+		return QByteArray();
+
+	out.resize(outSize);
+	return out;
+}
+
+/**
+ * Write data to a file.
+ * @param filename Filename.
+ * @param data Data.
+ * @return True on success; false on error.
+ */
+bool CompressedFileTest::writeFile(const QString &filename, const QByteArray &data)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	return (file.write(data) == data.size());
+}
+
+/**
+ * Write a gzip-compressed file.
+ * @param filename Filename.
+ * @param data Uncompressed data.
+ * @return True on success; false on error.
+ */
+bool CompressedFileTest::writeGzip(const QString &filename, const QByteArray &data)
+{
+	const QByteArray gz = deflateData(data, 15 + 16);
+	if (gz.isEmpty())
+		return false;
+	return writeFile(filename, gz);
+}
+
+/**
+ * Write a zip file with a single deflated member.
+ * @param filename Filename.
+ * @param data Uncompressed data.
+ * @return True on success; false on error.
+ */
+bool CompressedFileTest::writeZip(const QString &filename, const QByteArray &data)
+{
+	const QByteArray raw = deflateData(data, -15);
+	if (raw.isEmpty())
+		return false;
+
+	const QByteArray name("card.raw");
+	const quint32 crc = (quint32)crc32(crc32(0, nullptr, 0),
+		reinterpret_cast<const Bytef*>(data.constData()), data.size());
+
+	QByteArray zip;
+	QDataStream ds(&zip, QIODevice::WriteOnly);
+	ds.setByteOrder(QDataStream::LittleEndian);
+
+	// Local file header.
+	ds << (quint32)0x04034B50	// Signature
+	   << (quint16)20		// Version needed to extract
+	   << (quint16)0		// Flags
+	   << (quint16)8		// Compression method (deflate)
+	   << (quint16)0		// Modification time
+	   << (quint16)0x0021		// Modification date (1980/01/01)
+	   << crc
+	   << (quint32)raw.size()
+	   << (quint32)data.size()
+	   << (quint16)name.size()
+	   << (quint16)0;		// Extra field length
+	ds.writeRawData(name.constData(), name.size());
+	ds.writeRawData(raw.constData(), raw.size());
+
+	// Central directory.
+	const quint32 cdOffset = (quint32)zip.size();
+	ds << (quint32)0x02014B50	// Signature
+	   << (quint16)20		// Version made by
+	   << (quint16)20		// Version needed to extract
+	   << (quint16)0		// Flags
+	   << (quint16)8		// Compression method (deflate)
+	   << (quint16)0		// Modification time
+	   << (quint16)0x0021		// Modification date (1980/01/01)
+	   << crc
+	   << (quint32)raw.size()
+	   << (quint32)data.size()
+	   << (quint16)name.size()
+	   << (quint16)0		// Extra field length
+	   << (quint16)0		// Comment length
+	   << (quint16)0		// Disk number
+	   << (quint16)0		// Internal attributes
+	   << (quint32)0		// External attributes
+	   << (quint32)0;		// Local header offset
+	ds.writeRawData(name.constData(), name.size());
+	const quint32 cdSize = (quint32)zip.size() - cdOffset;
+
+	// End of central directory.
+	ds << (quint32)0x06054B50	// Signature
+	   << (quint16)0		// Disk number
+	   << (quint16)0		// Central directory disk number
+	   << (quint16)1		// Entries on this disk
+	   << (quint16)1		// Total entries
+	   << cdSize
+	   << cdOffset
+	   << (quint16)0;		// Comment length
+
+	if (ds.status() != QDataStream::Ok)
+		return false;
+	return writeFile(filename, zip);
+}
+
+/**
+ * Read random blocks from a compressed file and
+ * compare them to the uncompressed data.
+ * @param file Opened compressed file.
+ */
+void CompressedFileTest::checkRandomBlocks(CompressedFile *file) const
+{
+	ASSERT_EQ((qint64)DATA_SIZE, file->size());
+
+	// xorshift32, so the blocks are the same on every run.
+	// Every fourth read is unaligned, so it may cross
+	// a seek index checkpoint.
+	const int blockCount = (DATA_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	QByteArray buf(BLOCK_SIZE, 0);
+	uint32_t x = 0x12345678;
+	for (int i = 0; i < 256; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+
+		qint64 pos = (qint64)(x % blockCount) * BLOCK_SIZE;
+		if ((i & 3) == 3) {
+			pos = x % DATA_SIZE;
+		}
+		const int len = (int)qMin((qint64)BLOCK_SIZE, DATA_SIZE - pos);
+
+		ASSERT_TRUE(file->seek(pos)) << "pos == " << pos;
+		ASSERT_EQ((qint64)len, file->read(buf.data(), len)) << "pos == " << pos;
+		ASSERT_EQ(0, memcmp(buf.constData(), data.constData() + pos, len)) << "pos == " << pos;
+	}
+
+	// Reading at the end of the file returns 0 bytes.
+	ASSERT_TRUE(file->seek(DATA_SIZE));
+	EXPECT_EQ(0, file->read(buf.data(), buf.size()));
+}
+
+/**
+ * Open a compressed file, check random blocks, and close it.
+ * This is done twice: the first open builds the seek index,
+ * and the second open loads it from the .mcidx file.
+ * @param filename Filename.
+ */
+void CompressedFileTest::checkCompressedFile(const QString &filename) const
+{
+	const QString idxFilename = CompressedFile::indexFileName(filename);
+	ASSERT_FALSE(QFile::exists(idxFilename));
+	EXPECT_TRUE(CompressedFile::isCompressed(filename));
+	EXPECT_EQ((qint64)DATA_SIZE, CompressedFile::uncompressedSize(filename));
+
+	// Build the seek index.
+	{
+		CompressedFile file(filename);
+		ASSERT_TRUE(file.open(QIODevice::ReadOnly))
+			<< file.errorString().toUtf8().constData();
+		checkRandomBlocks(&file);
+	}
+	ASSERT_TRUE(QFile::exists(idxFilename));
+
+	// Reload the seek index.
+	CompressedFile file(filename);
+	ASSERT_TRUE(file.open(QIODevice::ReadOnly))
+		<< file.errorString().toUtf8().constData();
+	checkRandomBlocks(&file);
+}
+
+/**
+ * Random blocks from a gzip file, with a new and a reloaded seek index.
+ */
+TEST_F(CompressedFileTest, gzipRandomBlocks)
+{
+	const QString filename = tmpDir.path() + QLatin1String("/card.raw.gz");
+	ASSERT_TRUE(writeGzip(filename, data));
+	checkCompressedFile(filename);
+}
+
+/**
+ * Random blocks from a zip file, with a new and a reloaded seek index.
+ */
+TEST_F(CompressedFileTest, zipRandomBlocks)
+{
+	const QString filename = tmpDir.path() + QLatin1String("/card.zip");
+	ASSERT_TRUE(writeZip(filename, data));
+	checkCompressedFile(filename);
+}
+
+/**
+ * readHead() decompresses the beginning of the file
+ * without building the seek index.
+ */
+TEST_F(CompressedFileTest, readHead)
+{
+	const QString filename = tmpDir.path() + QLatin1String("/card.raw.gz");
+	ASSERT_TRUE(writeGzip(filename, data));
+
+	const QByteArray head = CompressedFile::readHead(filename, 0x6000);
+	ASSERT_EQ(0x6000, head.size());
+	EXPECT_EQ(0, memcmp(head.constData(), data.constData(), head.size()));
+	EXPECT_FALSE(QFile::exists(CompressedFile::indexFileName(filename)));
+}
+
+/**
+ * Compressed memory card images are opened read-only,
+ * and can't be made writable.
+ */
+TEST_F(CompressedFileTest, cardIsReadOnly)
+{
+	const QString rawFilename = tmpDir.path() + QLatin1String("/formatted.raw");
+	{
+		unique_ptr<GcnCard> card(GcnCard::format(rawFilename, nullptr));
+		ASSERT_TRUE(card.get() != nullptr);
+		ASSERT_TRUE(card->isOpen());
+		EXPECT_TRUE(card->canMakeWritable());
+	}
+
+	QFile rawFile(rawFilename);
+	ASSERT_TRUE(rawFile.open(QIODevice::ReadOnly));
+	const QByteArray image = rawFile.readAll();
+	rawFile.close();
+	const QString gzFilename = tmpDir.path() + QLatin1String("/formatted.raw.gz");
+	ASSERT_TRUE(writeGzip(gzFilename, image));
+
+	unique_ptr<GcnCard> card(GcnCard::open(gzFilename, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	ASSERT_TRUE(card->isOpen());
+	EXPECT_TRUE(card->isReadOnly());
+	EXPECT_FALSE(card->canMakeWritable());
+	EXPECT_EQ(-EROFS, card->setReadOnly(false));
+	EXPECT_TRUE(card->isReadOnly());
+}
+
+} }
@@ -0,0 +1,161 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * DumpConsensusTest.cpp: DumpConsensus tests.                             *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "DumpConsensus.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+namespace LibMemCard { namespace Tests {
+
+class DumpConsensusTest : public ::testing::Test
+{
+	protected:
+		DumpConsensusTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Write a dump file.
+		 * @param name Filename, relative to tmpDir.
+		 * @param data Dump data.
+		 * @return Full filename, or empty string on error.
+		 */
+		QString writeDump(const char *name, const QByteArray &data);
+
+		/**
+		 * Create a dump with the specified fill byte per block.
+		 * @param fill Fill bytes, one per block.
+		 * @param count Number of blocks.
+		 * @return Dump data.
+		 */
+		static QByteArray makeDump(const char *fill, int count);
+
+		static const int BLOCK_SIZE = 512;
+		static const int BLOCK_COUNT = 4;
+
+	public:
+		QTemporaryDir tmpDir;
+		QString outFilename;
+};
+
+void DumpConsensusTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+	outFilename = tmpDir.path() + QLatin1String("/consensus.raw");
+}
+
+/**
+ * Write a dump file.
+ * @param name Filename, relative to tmpDir.
+ * @param data Dump data.
+ * @return Full filename, or empty string on error.
+ */
+QString DumpConsensusTest::writeDump(const char *name, const QByteArray &data)
+{
+	const QString filename = tmpDir.path() + QChar(L'/') + QLatin1String(name);
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+		return QString();
+	return filename;
+}
+
+/**
+ * Create a dump with the specified fill byte per block.
+ * @param fill Fill bytes, one per block.
+ * @param count Number of blocks.
+ * @return Dump data.
+ */
+QByteArray DumpConsensusTest::makeDump(const char *fill, int count)
+{
+	QByteArray data;
+	for (int i = 0; i < count; i++) {
+		data.append(QByteArray(BLOCK_SIZE, fill[i]));
+	}
+	return data;
+}
+
+/**
+ * Each block is chosen by majority vote.
+ */
+TEST_F(DumpConsensusTest, majorityVote)
+{
+	QStringList dumps;
+	dumps.append(writeDump("a.raw", makeDump("ABCD", BLOCK_COUNT)));
+	dumps.append(writeDump("b.raw", makeDump("AXCD", BLOCK_COUNT)));
+	dumps.append(writeDump("c.raw", makeDump("ABCY", BLOCK_COUNT)));
+
+	DumpConsensus consensus(BLOCK_SIZE);
+	ASSERT_EQ(0, consensus.build(dumps, outFilename));
+	EXPECT_EQ(BLOCK_COUNT, consensus.blockCount());
+	EXPECT_EQ(BLOCK_COUNT, consensus.blocksDone());
+	EXPECT_EQ(2, consensus.lowConfidenceCount());
+
+	QFile file(outFilename);
+	ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+	EXPECT_EQ(makeDump("ABCD", BLOCK_COUNT), file.readAll());
+
+	const QVector<DumpConsensus::BlockResult> results = consensus.results();
+	ASSERT_EQ(BLOCK_COUNT, results.size());
+	EXPECT_EQ(3, results[0].votes);
+	EXPECT_EQ(2, results[1].votes);
+	EXPECT_EQ(2, results[1].versions);
+}
+
+/**
+ * Blocks missing from truncated dumps are taken from the others.
+ */
+TEST_F(DumpConsensusTest, truncatedDump)
+{
+	QStringList dumps;
+	dumps.append(writeDump("a.raw", makeDump("ABCD", BLOCK_COUNT)));
+	dumps.append(writeDump("b.raw", makeDump("AB", 2)));
+
+	DumpConsensus consensus(BLOCK_SIZE);
+	ASSERT_EQ(0, consensus.build(dumps, outFilename));
+	EXPECT_EQ(BLOCK_COUNT, consensus.blocksDone());
+
+	const QVector<DumpConsensus::BlockResult> results = consensus.results();
+	ASSERT_EQ(BLOCK_COUNT, results.size());
+	EXPECT_EQ(2, results[0].dumps);
+	EXPECT_EQ(1, results[3].dumps);
+
+	QFile file(outFilename);
+	ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+	EXPECT_EQ(makeDump("ABCD", BLOCK_COUNT), file.readAll());
+}
+
+/**
+ * A cancelled build doesn't leave a consensus image behind,
+ * and the next build isn't affected.
+ */
+TEST_F(DumpConsensusTest, cancel)
+{
+	QStringList dumps;
+	dumps.append(writeDump("a.raw", makeDump("ABCD", BLOCK_COUNT)));
+	dumps.append(writeDump("b.raw", makeDump("ABCD", BLOCK_COUNT)));
+
+	DumpConsensus consensus(BLOCK_SIZE);
+	consensus.cancel();
+	EXPECT_EQ(-ECANCELED, consensus.build(dumps, outFilename));
+	EXPECT_FALSE(QFile::exists(outFilename));
+
+	EXPECT_EQ(0, consensus.build(dumps, outFilename));
+	EXPECT_TRUE(QFile::exists(outFilename));
+}
+
+} }
@@ -0,0 +1,127 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * GcnCardOpenTest.cpp: GcnCard::open() tests.                             *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "GcnCard.hpp"
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+
+namespace LibMemCard { namespace Tests {
+
+class GcnCardOpenTest : public ::testing::Test
+{
+	protected:
+		GcnCardOpenTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Write a truncated memory card image.
+		 * The image contains the first bytes of a formatted card.
+		 * @param size Image size, in bytes.
+		 * @return True on success; false on error.
+		 */
+		bool writeTruncatedImage(int size);
+
+	public:
+		QTemporaryDir tmpDir;
+		QString filename;
+};
+
+void GcnCardOpenTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+	filename = tmpDir.path() + QLatin1String("/truncated.raw");
+}
+
+/**
+ * Write a truncated memory card image.
+ * The image contains the first bytes of a formatted card.
+ * @param size Image size, in bytes.
+ * @return True on success; false on error.
+ */
+bool GcnCardOpenTest::writeTruncatedImage(int size)
+{
+	const QString formatted = tmpDir.path() + QLatin1String("/formatted.raw");
+	{
+		unique_ptr<GcnCard> card(GcnCard::format(formatted, nullptr));
+		if (!card || !card->isOpen())
+			return false;
+	}
+
+	QFile src(formatted);
+	if (!src.open(QIODevice::ReadOnly))
+		return false;
+	const QByteArray data = src.read(size);
+	if (data.size() != size)
+		return false;
+
+	QFile dest(filename);
+	if (!dest.open(QIODevice::WriteOnly))
+		return false;
+	return (dest.write(data) == size);
+}
+
+/**
+ * A 4 KiB image has a complete header, but no tables.
+ * The card is opened with the short read flagged.
+ */
+TEST_F(GcnCardOpenTest, truncated4KiB)
+{
+	ASSERT_TRUE(writeTruncatedImage(4096));
+
+	unique_ptr<GcnCard> card(GcnCard::open(filename, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	EXPECT_TRUE(card->isOpen());
+	EXPECT_TRUE(card->errors().testFlag(Card::MCE_SZ_TOO_SMALL));
+	EXPECT_TRUE(card->errors().testFlag(Card::MCE_SHORT_READ));
+	EXPECT_EQ(0, card->fileCount());
+}
+
+/**
+ * An image that's smaller than the card header
+ * is still opened, with blank tables.
+ */
+TEST_F(GcnCardOpenTest, truncatedHeader)
+{
+	ASSERT_TRUE(writeTruncatedImage(256));
+
+	unique_ptr<GcnCard> card(GcnCard::open(filename, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	EXPECT_TRUE(card->isOpen());
+	EXPECT_TRUE(card->errors().testFlag(Card::MCE_SHORT_READ));
+	EXPECT_EQ(0, card->fileCount());
+}
+
+/**
+ * Truncated images can also be opened from memory.
+ */
+TEST_F(GcnCardOpenTest, truncatedBuffer)
+{
+	ASSERT_TRUE(writeTruncatedImage(4096));
+	QFile file(filename);
+	ASSERT_TRUE(file.open(QIODevice::ReadOnly));
+	const QByteArray data = file.readAll();
+
+	unique_ptr<GcnCard> card(GcnCard::open(data, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	EXPECT_TRUE(card->isOpen());
+	EXPECT_TRUE(card->errors().testFlag(Card::MCE_SHORT_READ));
+}
+
+} }
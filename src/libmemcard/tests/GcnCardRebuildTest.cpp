@@ -0,0 +1,98 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * GcnCardRebuildTest.cpp: GcnCard::rebuild() tests.                       *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "GcnCard.hpp"
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+
+namespace LibMemCard { namespace Tests {
+
+class GcnCardRebuildTest : public ::testing::Test
+{
+	protected:
+		GcnCardRebuildTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Rebuild an empty card and reopen it.
+		 * @param totalPhysBlocks Requested size, in blocks.
+		 * @return GcnCard, or nullptr on error.
+		 */
+		GcnCard *rebuildEmpty(int totalPhysBlocks);
+
+	public:
+		QTemporaryDir tmpDir;
+		QString filename;
+};
+
+void GcnCardRebuildTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+	filename = tmpDir.path() + QLatin1String("/rebuilt.raw");
+}
+
+/**
+ * Rebuild an empty card and reopen it.
+ * @param totalPhysBlocks Requested size, in blocks.
+ * @return GcnCard, or nullptr on error.
+ */
+GcnCard *GcnCardRebuildTest::rebuildEmpty(int totalPhysBlocks)
+{
+	int filesWritten = -1;
+	int ret = GcnCard::rebuild(filename, QVector<File*>(), totalPhysBlocks, &filesWritten);
+	EXPECT_EQ(0, ret);
+	EXPECT_EQ(0, filesWritten);
+	if (ret != 0)
+		return nullptr;
+	return GcnCard::open(filename, nullptr);
+}
+
+/**
+ * The rebuilt image has the requested size.
+ */
+TEST_F(GcnCardRebuildTest, sizeMatchesSourceCard)
+{
+	static const int sizes[] = {64, 256, 1024, 2048};
+	for (int i = 0; i < (int)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+		unique_ptr<GcnCard> card(rebuildEmpty(sizes[i]));
+		ASSERT_TRUE(card.get() != nullptr);
+		ASSERT_TRUE(card->isOpen());
+		EXPECT_EQ(sizes[i], card->totalPhysBlocks());
+		EXPECT_EQ(sizes[i] - 5, card->freeBlocks());
+		EXPECT_EQ(0, (int)card->errors());
+		EXPECT_EQ((qint64)sizes[i] * card->blockSize(), QFileInfo(filename).size());
+	}
+}
+
+/**
+ * Sizes that aren't a whole number of megabits are rounded up.
+ */
+TEST_F(GcnCardRebuildTest, sizeIsRoundedUp)
+{
+	unique_ptr<GcnCard> card(rebuildEmpty(250));
+	ASSERT_TRUE(card.get() != nullptr);
+	EXPECT_EQ(256, card->totalPhysBlocks());
+
+	card.reset(rebuildEmpty(16));
+	ASSERT_TRUE(card.get() != nullptr);
+	EXPECT_EQ(64, card->totalPhysBlocks());
+}
+
+} }
@@ -0,0 +1,163 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * GcnFsckTest.cpp: GcnFsck tests.                                         *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "GcnFsck.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+namespace LibMemCard { namespace Tests {
+
+class GcnFsckTest : public ::testing::Test
+{
+	protected:
+		GcnFsckTest() { }
+
+	public:
+		void SetUp(void) final;
+
+		/**
+		 * Add a file to a directory table and block table.
+		 * The blocks are allocated contiguously.
+		 * @param dat Directory table.
+		 * @param bat Block table.
+		 * @param dirIdx Directory entry index.
+		 * @param name Filename.
+		 * @param block Starting block.
+		 * @param length Length, in blocks.
+		 */
+		static void addFile(card_dat *dat, card_bat *bat, int dirIdx,
+				    const char *name, int block, int length);
+
+		// Card size used by the tests.
+		static const int TOTAL_BLOCKS = 64;
+
+	public:
+		// Tables are in host byte order.
+		card_dat dat[2];
+		card_bat bat[2];
+};
+
+/**
+ * Create two empty directory and block tables.
+ */
+void GcnFsckTest::SetUp(void)
+{
+	memset(dat, 0xFF, sizeof(dat));
+	memset(bat, 0, sizeof(bat));
+	for (int i = 0; i < 2; i++) {
+		bat[i].freeblocks = TOTAL_BLOCKS - CARD_SYSAREA;
+	}
+}
+
+/**
+ * Add a file to a directory table and block table.
+ * The blocks are allocated contiguously.
+ * @param dat Directory table.
+ * @param bat Block table.
+ * @param dirIdx Directory entry index.
+ * @param name Filename.
+ * @param block Starting block.
+ * @param length Length, in blocks.
+ */
+void GcnFsckTest::addFile(card_dat *dat, card_bat *bat, int dirIdx,
+			  const char *name, int block, int length)
+{
+	card_direntry *const dirEntry = &dat->entries[dirIdx];
+	memcpy(dirEntry->gamecode, "GTST", sizeof(dirEntry->gamecode));
+	memcpy(dirEntry->company, "01", sizeof(dirEntry->company));
+	memset(dirEntry->filename, 0, sizeof(dirEntry->filename));
+	strncpy(dirEntry->filename, name, sizeof(dirEntry->filename));
+	dirEntry->block = block;
+	dirEntry->length = length;
+
+	for (int i = 0; i < length; i++) {
+		bat->fat[block + i - CARD_SYSAREA] =
+			(i == length - 1 ? 0xFFFF : block + i + 1);
+	}
+	bat->freeblocks -= length;
+}
+
+/**
+ * Each block table is checked against its own directory table.
+ * If both block tables were checked against the same directory
+ * table, the other block table would have orphaned blocks and
+ * broken chains.
+ */
+TEST_F(GcnFsckTest, tablesArePaired)
+{
+	// Table 0: One file.
+	addFile(&dat[0], &bat[0], 0, "first", 5, 2);
+	// Table 1: A different file in different blocks.
+	addFile(&dat[1], &bat[1], 0, "second", 10, 3);
+
+	const card_dat *const pairedDat[2] = {&dat[0], &dat[1]};
+	GcnFsck fsck;
+	fsck.check(pairedDat, bat, TOTAL_BLOCKS);
+	EXPECT_TRUE(fsck.isClean());
+	EXPECT_EQ(TOTAL_BLOCKS - CARD_SYSAREA - 2, fsck.summary(0).freeBlocks);
+	EXPECT_EQ(TOTAL_BLOCKS - CARD_SYSAREA - 3, fsck.summary(1).freeBlocks);
+
+	// Checking block table 1 with directory table 0
+	// reports issues in block table 1 only.
+	const card_dat *const mismatchedDat[2] = {&dat[0], &dat[0]};
+	fsck.check(mismatchedDat, bat, TOTAL_BLOCKS);
+	EXPECT_FALSE(fsck.isClean());
+	EXPECT_EQ(0, fsck.summary(0).issueCount);
+	EXPECT_GT(fsck.summary(1).issueCount, 0);
+	EXPECT_EQ(3, fsck.count(1, GcnFsck::FSCK_ORPHANED_BLOCK));
+}
+
+/**
+ * Cross-linked blocks are detected.
+ */
+TEST_F(GcnFsckTest, crossLink)
+{
+	addFile(&dat[0], &bat[0], 0, "first", 5, 3);
+	// Second file starts in the middle of the first file's chain.
+	card_direntry *const dirEntry = &dat[0].entries[1];
+	*dirEntry = dat[0].entries[0];
+	strncpy(dirEntry->filename, "second", sizeof(dirEntry->filename));
+	dirEntry->block = 6;
+	dirEntry->length = 2;
+
+	const card_dat *const pairedDat[2] = {&dat[0], &dat[1]};
+	GcnFsck fsck;
+	fsck.check(pairedDat, bat, TOTAL_BLOCKS);
+	EXPECT_EQ(2, fsck.count(0, GcnFsck::FSCK_CROSS_LINK));
+	EXPECT_EQ(0, fsck.summary(1).issueCount);
+}
+
+/**
+ * Loops and length mismatches are detected.
+ */
+TEST_F(GcnFsckTest, loopAndLength)
+{
+	addFile(&dat[0], &bat[0], 0, "first", 5, 3);
+	// Make the last block link back to the first.
+	bat[0].fat[7 - CARD_SYSAREA] = 5;
+
+	const card_dat *const pairedDat[2] = {&dat[0], &dat[1]};
+	GcnFsck fsck;
+	fsck.check(pairedDat, bat, TOTAL_BLOCKS);
+	EXPECT_EQ(1, fsck.count(0, GcnFsck::FSCK_LOOP));
+	EXPECT_EQ(0, fsck.count(0, GcnFsck::FSCK_LENGTH_MISMATCH));
+
+	// Shorten the directory entry.
+	bat[0].fat[7 - CARD_SYSAREA] = 0xFFFF;
+	dat[0].entries[0].length = 2;
+	fsck.check(pairedDat, bat, TOTAL_BLOCKS);
+	EXPECT_EQ(1, fsck.count(0, GcnFsck::FSCK_LENGTH_MISMATCH));
+	// Free block count is based on the chains, not the directory.
+	EXPECT_EQ(0, fsck.count(0, GcnFsck::FSCK_FREE_COUNT_MISMATCH));
+}
+
+} }
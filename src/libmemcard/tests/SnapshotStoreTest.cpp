@@ -0,0 +1,224 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard/tests]                *
+ * SnapshotStoreTest.cpp: SnapshotStore tests.                             *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "GcnCard.hpp"
+#include "SnapshotStore.hpp"
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// C++ includes.
+#include <memory>
+using std::unique_ptr;
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QThread>
+
+namespace LibMemCard { namespace Tests {
+
+class SnapshotStoreTest : public ::testing::Test
+{
+	protected:
+		SnapshotStoreTest() { }
+
+	public:
+		void SetUp(void) final;
+		void TearDown(void) final;
+
+		/**
+		 * Read the entire contents of a file.
+		 * @param filename Filename.
+		 * @return File contents, or empty QByteArray on error.
+		 */
+		static QByteArray readFile(const QString &filename);
+
+		// Block modified by the tests.
+		static const int DATA_BLOCK = 10;
+
+	public:
+		QTemporaryDir tmpDir;
+		QString cardFilename;
+		QString storePath;
+		unique_ptr<GcnCard> card;
+		int blockSize;
+};
+
+/**
+ * Format a new memory card image.
+ */
+void SnapshotStoreTest::SetUp(void)
+{
+	ASSERT_TRUE(tmpDir.isValid());
+	cardFilename = tmpDir.path() + QLatin1String("/card.raw");
+	storePath = tmpDir.path() + QLatin1String("/store");
+	card.reset(GcnCard::format(cardFilename, nullptr));
+	ASSERT_TRUE(card.get() != nullptr);
+	ASSERT_TRUE(card->isOpen());
+	blockSize = card->blockSize();
+}
+
+void SnapshotStoreTest::TearDown(void)
+{
+	card.reset();
+}
+
+/**
+ * Read the entire contents of a file.
+ * @param filename Filename.
+ * @return File contents, or empty QByteArray on error.
+ */
+QByteArray SnapshotStoreTest::readFile(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	return file.readAll();
+}
+
+/**
+ * Only changed blocks are added to the pack,
+ * and each snapshot can be restored.
+ */
+TEST_F(SnapshotStoreTest, addAndRestore)
+{
+	SnapshotStore store(storePath);
+	ASSERT_EQ(0, store.open());
+
+	const QByteArray origImage = readFile(cardFilename);
+	ASSERT_EQ(card->totalPhysBlocks() * blockSize, origImage.size());
+
+	int newBlocks = -1;
+	ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("first"), &newBlocks));
+	EXPECT_GT(newBlocks, 0);
+	const int firstBlockCount = store.blockCount();
+
+	// Modify one block.
+	const QByteArray newData(blockSize, '\x5A');
+	ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+	QByteArray newImage = origImage;
+	newImage.replace(DATA_BLOCK * blockSize, blockSize, newData);
+
+	ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("second"), &newBlocks));
+	EXPECT_EQ(1, newBlocks);
+	EXPECT_EQ(firstBlockCount + 1, store.blockCount());
+
+	// IDs must be unique.
+	EXPECT_EQ(-EEXIST, store.addSnapshot(card.get(), QLatin1String("second")));
+
+	const QString restored = tmpDir.path() + QLatin1String("/restored.raw");
+	ASSERT_EQ(0, store.restore(QLatin1String("first"), restored));
+	EXPECT_EQ(origImage, readFile(restored));
+	ASSERT_EQ(0, store.restore(QLatin1String("second"), restored));
+	EXPECT_EQ(newImage, readFile(restored));
+}
+
+/**
+ * The block index is reloaded when the store is reopened.
+ */
+TEST_F(SnapshotStoreTest, reopen)
+{
+	int blockCount;
+	{
+		SnapshotStore store(storePath);
+		ASSERT_EQ(0, store.open());
+		ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("first")));
+		blockCount = store.blockCount();
+	}
+
+	SnapshotStore store(storePath);
+	ASSERT_EQ(0, store.open());
+	EXPECT_EQ(blockCount, store.blockCount());
+
+	// All blocks are already stored.
+	int newBlocks = -1;
+	ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("second"), &newBlocks));
+	EXPECT_EQ(0, newBlocks);
+}
+
+/**
+ * A truncated index record (interrupted snapshot) is ignored,
+ * and it's removed before the next snapshot's records are added.
+ */
+TEST_F(SnapshotStoreTest, truncatedIndex)
+{
+	const QByteArray origImage = readFile(cardFilename);
+	int blockCount;
+	{
+		SnapshotStore store(storePath);
+		ASSERT_EQ(0, store.open());
+		ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("first")));
+		blockCount = store.blockCount();
+	}
+
+	QFile idxFile(storePath + QLatin1String("/blocks.idx"));
+	ASSERT_TRUE(idxFile.resize(idxFile.size() - 4));
+
+	{
+		SnapshotStore store(storePath);
+		ASSERT_EQ(0, store.open());
+		EXPECT_EQ(blockCount - 1, store.blockCount());
+
+		// Modify one block and add another snapshot.
+		// The block with the truncated record is stored again.
+		const QByteArray newData(blockSize, '\x5A');
+		ASSERT_EQ(blockSize, card->writeBlock(newData.constData(), blockSize, DATA_BLOCK));
+		int newBlocks = -1;
+		ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String("second"), &newBlocks));
+		EXPECT_EQ(2, newBlocks);
+		EXPECT_EQ(blockCount + 1, store.blockCount());
+	}
+
+	// Reopen the store. The new records must be loaded.
+	SnapshotStore store(storePath);
+	ASSERT_EQ(0, store.open());
+	EXPECT_EQ(blockCount + 1, store.blockCount());
+
+	QByteArray newImage = origImage;
+	newImage.replace(DATA_BLOCK * blockSize, blockSize, QByteArray(blockSize, '\x5A'));
+	const QString restored = tmpDir.path() + QLatin1String("/restored.raw");
+	ASSERT_EQ(0, store.restore(QLatin1String("first"), restored));
+	EXPECT_EQ(origImage, readFile(restored));
+	ASSERT_EQ(0, store.restore(QLatin1String("second"), restored));
+	EXPECT_EQ(newImage, readFile(restored));
+}
+
+/**
+ * addSnapshot() fails if the store isn't open.
+ */
+TEST_F(SnapshotStoreTest, notOpen)
+{
+	SnapshotStore store(storePath);
+	EXPECT_EQ(-EBADF, store.addSnapshot(card.get(), QLatin1String("first")));
+}
+
+/**
+ * Snapshots are sorted by creation time, not by ID.
+ */
+TEST_F(SnapshotStoreTest, snapshotsSortedByTime)
+{
+	SnapshotStore store(storePath);
+	ASSERT_EQ(0, store.open());
+
+	static const char *const ids[] = {"zebra", "apple", "mango"};
+	QStringList expected;
+	for (int i = 0; i < 3; i++) {
+		ASSERT_EQ(0, store.addSnapshot(card.get(), QLatin1String(ids[i])));
+		expected.append(QLatin1String(ids[i]));
+		// Make sure the timestamps are different.
+		QThread::msleep(5);
+	}
+	EXPECT_EQ(expected, store.snapshots());
+}
+
+} }
@@ -0,0 +1,152 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * SnapshotCli.cpp: Snapshot store command line interface.                 *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "SnapshotCli.hpp"
+
+#include "libmemcard/GcnCard.hpp"
+#include "libmemcard/SnapshotStore.hpp"
+
+// C includes.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Qt includes.
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QStringList>
+
+namespace SnapshotCli {
+
+/**
+ * Print the usage information.
+ * @param argv0 Program name.
+ */
+static void printUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage:\n"
+		"  %s --snapshot-save STORE IMAGE [ID]\n"
+		"  %s --snapshot-list STORE\n"
+		"  %s --snapshot-restore STORE ID OUTPUT\n"
+		"  %s --snapshot-export STORE ID IMAGE OUTDIR\n",
+		argv0, argv0, argv0, argv0);
+}
+
+/**
+ * Print a snapshot store error.
+ * @param store Snapshot store.
+ * @param ret Error code. (negative POSIX error code)
+ */
+static void printError(const SnapshotStore &store, int ret)
+{
+	const QString errorString = store.errorString();
+	fprintf(stderr, "*** ERROR: %s\n", (!errorString.isEmpty()
+		? errorString.toLocal8Bit().constData()
+		: strerror(-ret)));
+}
+
+/**
+ * Open a card image.
+ * TODO: Other card types.
+ * @param filename Card image filename.
+ * @return Card, or nullptr on error.
+ */
+static GcnCard *openCard(const QString &filename)
+{
+	GcnCard *const card = GcnCard::open(filename, nullptr);
+	if (card && !card->isOpen()) {
+		fprintf(stderr, "*** ERROR: %s: %s\n",
+			filename.toLocal8Bit().constData(),
+			card->errorString().toLocal8Bit().constData());
+		delete card;
+		return nullptr;
+	}
+	return card;
+}
+
+/**
+ * Check if the command line is a snapshot command.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return True if this is a snapshot command; false if not.
+ */
+bool isSnapshotCommand(int argc, char *argv[])
+{
+	return (argc >= 2 && !strncmp(argv[1], "--snapshot-", 11));
+}
+
+/**
+ * Run a snapshot command.
+ * This doesn't use the GUI.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return Exit code.
+ */
+int exec(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QStringList args = app.arguments();
+	for (int i = 1; i < args.size(); i++) {
+		args[i] = QDir::fromNativeSeparators(args.at(i));
+	}
+
+	const QString cmd = args.value(1);
+	if (args.size() < 3) {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	SnapshotStore store(args.at(2));
+	int ret = store.open();
+	if (ret != 0) {
+		printError(store, ret);
+		return EXIT_FAILURE;
+	}
+
+	if (cmd == QLatin1String("--snapshot-save") && (args.size() == 4 || args.size() == 5)) {
+		QScopedPointer<GcnCard> card(openCard(args.at(3)));
+		if (!card)
+			return EXIT_FAILURE;
+
+		const QString id = (args.size() == 5 ? args.at(4) : SnapshotStore::defaultId(args.at(3)));
+		int newBlocks = 0;
+		ret = store.addSnapshot(card.data(), id, &newBlocks);
+		if (ret == 0) {
+			printf("%s: %d new block(s) stored.\n", id.toLocal8Bit().constData(), newBlocks);
+		}
+	} else if (cmd == QLatin1String("--snapshot-list") && args.size() == 3) {
+		foreach (const QString &id, store.snapshots()) {
+			printf("%s\n", id.toLocal8Bit().constData());
+		}
+	} else if (cmd == QLatin1String("--snapshot-restore") && args.size() == 5) {
+		ret = store.restore(args.at(3), args.at(4));
+	} else if (cmd == QLatin1String("--snapshot-export") && args.size() == 6) {
+		QScopedPointer<GcnCard> card(openCard(args.at(4)));
+		if (!card)
+			return EXIT_FAILURE;
+
+		int filesExported = 0;
+		ret = store.exportChanged(args.at(3), card.data(), args.at(5), &filesExported);
+		if (ret == 0) {
+			printf("%d file(s) changed since %s.\n", filesExported, args.at(3).toLocal8Bit().constData());
+		}
+	} else {
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (ret != 0) {
+		printError(store, ret);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+}
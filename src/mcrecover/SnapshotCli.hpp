@@ -0,0 +1,33 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * SnapshotCli.hpp: Snapshot store command line interface.                 *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_SNAPSHOTCLI_HPP__
+#define __MCRECOVER_SNAPSHOTCLI_HPP__
+
+namespace SnapshotCli {
+
+/**
+ * Check if the command line is a snapshot command.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return True if this is a snapshot command; false if not.
+ */
+bool isSnapshotCommand(int argc, char *argv[]);
+
+/**
+ * Run a snapshot command.
+ * This doesn't use the GUI.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return Exit code.
+ */
+int exec(int argc, char *argv[]);
+
+}
+
+#endif /* __MCRECOVER_SNAPSHOTCLI_HPP__ */
@@ -0,0 +1,363 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * BenchData.cpp: Synthetic benchmark data.                                *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "BenchData.hpp"
+#include "card.h"
+#include "util/array_size.h"
+#include "util/byteswap.h"
+
+// C includes.
+#include <stdio.h>
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QIODevice>
+#include <QtCore/QXmlStreamWriter>
+
+using std::vector;
+
+namespace BenchData {
+
+// GCN memory card block size.
+static const int BLOCK_SIZE = 0x2000;
+
+// Synthetic memory card: 2048 blocks. (16 MB, 2043 user blocks)
+static const int CARD_BLOCKS = 2048;
+
+/**
+ * Generate random data.
+ * @param siz Size of the data.
+ * @param seed Random seed. (must not be 0)
+ * @return Random data.
+ */
+QByteArray RandomData(int siz, uint32_t seed)
+{
+	assert(seed != 0);
+	QByteArray data(siz, 0);
+	uint8_t *p = reinterpret_cast<uint8_t*>(data.data());
+
+	// xorshift32
+	uint32_t x = seed;
+	for (int i = 0; i < siz; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		p[i] = (uint8_t)(x >> 24);
+	}
+	return data;
+}
+
+/**
+ * Get the synthetic game description for a save file.
+ * @param buf	[out] Buffer.
+ * @param siz	[in] Size of buf.
+ * @param idx	[in] Save file index.
+ */
+static inline void saveGameDesc(char *buf, size_t siz, int idx)
+{
+	snprintf(buf, siz, "Bench Game %03d", idx);
+}
+
+/**
+ * Get the synthetic file description for a save file.
+ * @param buf	[out] Buffer.
+ * @param siz	[in] Size of buf.
+ * @param idx	[in] Save file index.
+ */
+static inline void saveFileDesc(char *buf, size_t siz, int idx)
+{
+	snprintf(buf, siz, "Save Data %03d", idx);
+}
+
+/**
+ * Get the synthetic ID6 for a save file.
+ * @param buf	[out] Buffer. (must be at least 7 bytes)
+ * @param idx	[in] Save file index.
+ */
+static inline void saveID6(char *buf, int idx)
+{
+	snprintf(buf, 7, "GB%02X01", idx & 0xFF);
+}
+
+/**
+ * Create a GameCube memory card image with synthetic save files.
+ * Each save file starts with a comment that matches a
+ * file definition written by WriteGcnMcFileDb().
+ * @param saveCount Number of save files. (max 127)
+ * @param saveLength Length of each save file, in blocks.
+ * @return Memory card image, or empty QByteArray on error.
+ */
+QByteArray MakeGcnCard(int saveCount, int saveLength)
+{
+	if (saveCount < 0 || saveCount > CARD_MAXFILES || saveLength <= 0 ||
+	    (saveCount * saveLength) > (CARD_BLOCKS - CARD_SYSAREA))
+	{
+		// Invalid parameters.
+		return QByteArray();
+	}
+
+	// Random data for the user blocks.
+	// Save files are then written over the random data.
+	QByteArray data = RandomData(CARD_BLOCKS * BLOCK_SIZE, 0x6D637263);
+	uint8_t *const p = reinterpret_cast<uint8_t*>(data.data());
+
+	/**
+	 * NOTE: The system areas are created in the same way as
+	 * GcnCardPrivate::format() and GcnCardPrivate::rebuild().
+	 * Everything is Big-Endian.
+	 */
+
+	// Header. (block 0)
+	card_header header;
+	memset(&header, 0xFF, sizeof(header));
+	memset(header.serial, 0, sizeof(header.serial));
+	memset(&header.formatTime, 0, sizeof(header.formatTime));
+	header.sramBias = cpu_to_be32(0x17CA2A85U);
+	header.sramLang = cpu_to_be32(0);
+	memset(header.reserved1, 0, sizeof(header.reserved1));
+	header.device_id = cpu_to_be16(0);
+	header.size = cpu_to_be16(CARD_BLOCKS / 16);
+	header.encoding = cpu_to_be16(SYS_FONT_ENCODING_ANSI);
+	uint32_t chksum = Checksum::AddInvDual16((uint16_t*)&header, 0x1FC, Checksum::CHKENDIAN_BIG);
+	header.chksum1 = cpu_to_be16(chksum >> 16);
+	header.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+	memset(p, 0xFF, BLOCK_SIZE);
+	memcpy(p, &header, sizeof(header));
+
+	// Directory and block tables.
+	card_dat dat;
+	card_bat bat;
+	memset(&dat, 0xFF, sizeof(dat));
+	memset(&bat, 0xFF, sizeof(bat));
+
+	uint16_t block = CARD_SYSAREA;
+	for (int i = 0; i < saveCount; i++) {
+		card_direntry *const dirEntry = &dat.entries[i];
+		char id6[7];
+		saveID6(id6, i);
+		memcpy(dirEntry->gamecode, id6, sizeof(dirEntry->gamecode));
+		memcpy(dirEntry->company, &id6[4], sizeof(dirEntry->company));
+		dirEntry->bannerfmt = CARD_BANNER_NONE;
+		memset(dirEntry->filename, 0, sizeof(dirEntry->filename));
+		snprintf(dirEntry->filename, sizeof(dirEntry->filename), "bench_%03d", i);
+		dirEntry->lastmodified = cpu_to_be32(0x20000000U + (uint32_t)i);
+		dirEntry->iconaddr = cpu_to_be32(0x40);
+		dirEntry->iconfmt = cpu_to_be16(CARD_ICON_NONE);
+		dirEntry->iconspeed = cpu_to_be16(CARD_SPEED_END);
+		dirEntry->permission = CARD_ATTRIB_PUBLIC;
+		dirEntry->copytimes = 0;
+		dirEntry->block = cpu_to_be16(block);
+		dirEntry->length = cpu_to_be16((uint16_t)saveLength);
+		dirEntry->commentaddr = cpu_to_be32(0);
+
+		// Comment. (start of the first block)
+		uint8_t *const comment = &p[block * BLOCK_SIZE];
+		memset(comment, 0, 64);
+		saveGameDesc((char*)comment, 32, i);
+		saveFileDesc((char*)&comment[32], 32, i);
+
+		// FAT entries.
+		for (int j = 0; j < saveLength; j++, block++) {
+			bat.fat[block - CARD_SYSAREA] = cpu_to_be16(
+				j == (saveLength - 1) ? 0xFFFF : (block + 1));
+		}
+	}
+
+	// Unused blocks are free.
+	for (int i = block; i < CARD_BLOCKS; i++) {
+		bat.fat[i - CARD_SYSAREA] = 0;
+	}
+
+	// Write both copies of the tables. (blocks 1-4)
+	// The copies are identical except for the update counter.
+	bat.freeblocks = cpu_to_be16(CARD_BLOCKS - block);
+	bat.lastalloc = cpu_to_be16(block > CARD_SYSAREA ? (block - 1) : 4);
+	for (int i = 0; i < 2; i++) {
+		dat.dircntrl.updated = cpu_to_be16(i);
+		chksum = Checksum::AddInvDual16(
+			reinterpret_cast<const uint16_t*>(&dat),
+			(uint32_t)(sizeof(dat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		dat.dircntrl.chksum1 = cpu_to_be16(chksum >> 16);
+		dat.dircntrl.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		memcpy(&p[(1+i) * BLOCK_SIZE], &dat, sizeof(dat));
+
+		bat.updated = cpu_to_be16(i);
+		chksum = Checksum::AddInvDual16(
+			(reinterpret_cast<const uint16_t*>(&bat) + 2),
+			(uint32_t)(sizeof(bat) - 4),
+			Checksum::CHKENDIAN_BIG);
+		bat.chksum1 = cpu_to_be16(chksum >> 16);
+		bat.chksum2 = cpu_to_be16(chksum & 0xFFFF);
+		memcpy(&p[(3+i) * BLOCK_SIZE], &bat, sizeof(bat));
+	}
+
+	return data;
+}
+
+/**
+ * Write a synthetic GCN Memory Card File database.
+ * The first saveCount definitions match the save files created by
+ * MakeGcnCard(). The rest use other game IDs and search addresses,
+ * and won't match anything.
+ * @param qioDevice	[in] QIODevice to write to.
+ * @param defCount	[in] Total number of file definitions.
+ * @param saveCount	[in] Number of save files on the card.
+ * @param saveLength	[in] Length of each save file, in blocks.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int WriteGcnMcFileDb(QIODevice *qioDevice, int defCount, int saveCount, int saveLength)
+{
+	// Search addresses used by the other definitions.
+	static const uint16_t otherAddresses[] = {
+		0x0000, 0x0004, 0x0010, 0x0024, 0x0040, 0x0180, 0x1000, 0x1FC0
+	};
+
+	QXmlStreamWriter xml(qioDevice);
+	xml.setAutoFormatting(true);
+	xml.setAutoFormattingIndent(-1);
+	xml.writeStartDocument();
+	xml.writeStartElement(QLatin1String("GcnMcFileDb"));
+
+	char tmp[64];
+	char regex[72];
+	char id6[7];
+	for (int i = 0; i < defCount; i++) {
+		const bool isSave = (i < saveCount);
+		xml.writeStartElement(QLatin1String("file"));
+
+		if (isSave) {
+			saveGameDesc(tmp, sizeof(tmp), i);
+			saveID6(id6, i);
+		} else {
+			snprintf(tmp, sizeof(tmp), "Other Game %04d", i);
+			snprintf(id6, sizeof(id6), "GO%02X%02X", (i >> 8) & 0xFF, i & 0xFF);
+		}
+		xml.writeTextElement(QLatin1String("gameName"), QLatin1String(tmp));
+		xml.writeTextElement(QLatin1String("fileInfo"), QLatin1String("Save File"));
+		xml.writeTextElement(QLatin1String("id6"), QLatin1String(id6));
+
+		// <search> block.
+		// Every fourth definition uses a regular expression
+		// for the file description. The rest are plain text.
+		xml.writeStartElement(QLatin1String("search"));
+		const uint16_t address = (isSave ? 0 : otherAddresses[i % ARRAY_SIZE(otherAddresses)]);
+		snprintf(tmp, sizeof(tmp), "0x%04X", address);
+		xml.writeTextElement(QLatin1String("address"), QLatin1String(tmp));
+		if (isSave) {
+			saveGameDesc(tmp, sizeof(tmp), i);
+		} else {
+			snprintf(tmp, sizeof(tmp), "Other Game %04d", i);
+		}
+		snprintf(regex, sizeof(regex), "^%s$", tmp);
+		xml.writeTextElement(QLatin1String("gameDesc"), QLatin1String(regex));
+		if ((i & 3) == 3) {
+			xml.writeTextElement(QLatin1String("fileDesc"), QLatin1String("^Save Data (\\d+)$"));
+		} else if (isSave) {
+			saveFileDesc(tmp, sizeof(tmp), i);
+			snprintf(regex, sizeof(regex), "^%s$", tmp);
+			xml.writeTextElement(QLatin1String("fileDesc"), QLatin1String(regex));
+		} else {
+			xml.writeTextElement(QLatin1String("fileDesc"), QLatin1String("^Other Data$"));
+		}
+		xml.writeEndElement();
+
+		// <dirEntry> block.
+		xml.writeStartElement(QLatin1String("dirEntry"));
+		snprintf(tmp, sizeof(tmp), "bench_%03d", i);
+		xml.writeTextElement(QLatin1String("filename"), QLatin1String(tmp));
+		xml.writeTextElement(QLatin1String("bannerFormat"), QLatin1String("0x00"));
+		xml.writeTextElement(QLatin1String("iconAddress"), QLatin1String("0x0040"));
+		xml.writeTextElement(QLatin1String("iconFormat"), QLatin1String("0x00"));
+		xml.writeTextElement(QLatin1String("iconSpeed"), QLatin1String("0x00"));
+		xml.writeTextElement(QLatin1String("permission"), QLatin1String("0x04"));
+		xml.writeTextElement(QLatin1String("length"), QString::number(saveLength));
+		xml.writeEndElement();
+
+		// </file>
+		xml.writeEndElement();
+	}
+
+	// </GcnMcFileDb>
+	xml.writeEndElement();
+	xml.writeEndDocument();
+	return (xml.hasError() ? -EIO : 0);
+}
+
+/**
+ * Create a synthetic Pokémon XD save file.
+ * Pokémon XD save slots are encrypted, so random data is used.
+ * @param checksumDefs [out] Checksum definitions for the save slots.
+ * @return Save file data.
+ */
+QByteArray MakePokemonXDSave(vector<Checksum::ChecksumDef> *checksumDefs)
+{
+	// Three save slots, with four checksums each.
+	// Same layout as the Pokémon XD file definition.
+	static const uint32_t slotStart = 0x6000;
+	static const uint32_t slotSize = 0x28000;
+	static const int slotCount = 3;
+
+	checksumDefs->clear();
+	for (int slot = 0; slot < slotCount; slot++) {
+		for (int chk = 0; chk < 4; chk++) {
+			Checksum::ChecksumDef checksumDef;
+			checksumDef.algorithm = Checksum::CHKALG_POKEMONXD;
+			checksumDef.address = (slotStart + (slot * slotSize) + 0x10 + (chk * 4));
+			checksumDef.start = slotStart + (slot * slotSize);
+			checksumDef.length = slotSize;
+			Checksum::BindKernel(&checksumDef);
+			checksumDefs->push_back(checksumDef);
+		}
+	}
+
+	return RandomData(slotStart + (slotCount * slotSize), 0x58445844);
+}
+
+/**
+ * Get checksum definitions for a typical mix of checksum algorithms.
+ * The definitions fit in a file of MixedChecksumFileSize bytes.
+ * @param checksumDefs [out] Checksum definitions.
+ */
+void GetMixedChecksumDefs(vector<Checksum::ChecksumDef> *checksumDefs)
+{
+	struct MixedChecksumDef {
+		Checksum::ChkAlgorithm algorithm;
+		uint32_t address;
+		uint32_t start;
+		uint32_t length;
+	};
+	static const MixedChecksumDef mixedDefs[] = {
+		// Luigi's Mansion
+		{Checksum::CHKALG_ADDINVDUAL16, 0x3FFC, 0x2000, 0x1FFC},
+		{Checksum::CHKALG_ADDINVDUAL16, 0x5FFC, 0x4000, 0x1FFC},
+		// Sonic Adventure DX
+		{Checksum::CHKALG_CRC16, 0x1442, 0x1444, 0x056C},
+		{Checksum::CHKALG_SONICCHAOGARDEN, 0xF858, 0x3040, 0xC820},
+		// Other games
+		{Checksum::CHKALG_CRC32, 0x6000, 0x6004, 0x1FFC},
+		{Checksum::CHKALG_ADDBYTES32, 0x8000, 0x8004, 0x1FFC},
+	};
+
+	checksumDefs->clear();
+	for (int i = 0; i < ARRAY_SIZE(mixedDefs); i++) {
+		Checksum::ChecksumDef checksumDef;
+		checksumDef.algorithm = mixedDefs[i].algorithm;
+		checksumDef.address = mixedDefs[i].address;
+		checksumDef.start = mixedDefs[i].start;
+		checksumDef.length = mixedDefs[i].length;
+		Checksum::BindKernel(&checksumDef);
+		checksumDefs->push_back(checksumDef);
+	}
+}
+
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * BenchData.hpp: Synthetic benchmark data.                                *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_BENCH_BENCHDATA_HPP__
+#define __MCRECOVER_BENCH_BENCHDATA_HPP__
+
+#include "Checksum.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// C++ includes.
+#include <vector>
+
+// Qt includes.
+#include <QtCore/QByteArray>
+class QIODevice;
+
+/**
+ * Synthetic benchmark data.
+ * All data is generated in-process from fixed seeds,
+ * so every run uses the same input data.
+ */
+namespace BenchData {
+
+/**
+ * Generate random data.
+ * @param siz Size of the data.
+ * @param seed Random seed. (must not be 0)
+ * @return Random data.
+ */
+QByteArray RandomData(int siz, uint32_t seed);
+
+/**
+ * Create a GameCube memory card image with synthetic save files.
+ * Each save file starts with a comment that matches a
+ * file definition written by WriteGcnMcFileDb().
+ * @param saveCount Number of save files. (max 127)
+ * @param saveLength Length of each save file, in blocks.
+ * @return Memory card image, or empty QByteArray on error.
+ */
+QByteArray MakeGcnCard(int saveCount, int saveLength);
+
+/**
+ * Write a synthetic GCN Memory Card File database.
+ * The first saveCount definitions match the save files created by
+ * MakeGcnCard(). The rest use other game IDs and search addresses,
+ * and won't match anything.
+ * @param qioDevice	[in] QIODevice to write to.
+ * @param defCount	[in] Total number of file definitions.
+ * @param saveCount	[in] Number of save files on the card.
+ * @param saveLength	[in] Length of each save file, in blocks.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int WriteGcnMcFileDb(QIODevice *qioDevice, int defCount, int saveCount, int saveLength);
+
+/**
+ * Create a synthetic Pokémon XD save file.
+ * Pokémon XD save slots are encrypted, so random data is used.
+ * @param checksumDefs [out] Checksum definitions for the save slots.
+ * @return Save file data.
+ */
+QByteArray MakePokemonXDSave(std::vector<Checksum::ChecksumDef> *checksumDefs);
+
+/**
+ * Get checksum definitions for a typical mix of checksum algorithms.
+ * The definitions fit in a file of MixedChecksumFileSize bytes.
+ * @param checksumDefs [out] Checksum definitions.
+ */
+void GetMixedChecksumDefs(std::vector<Checksum::ChecksumDef> *checksumDefs);
+
+// File size used by GetMixedChecksumDefs().
+static const int MixedChecksumFileSize = 0x10000;
+
+}
+
+#endif /* __MCRECOVER_BENCH_BENCHDATA_HPP__ */
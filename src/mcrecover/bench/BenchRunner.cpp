@@ -0,0 +1,228 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * BenchRunner.cpp: Benchmark runner.                                      *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "config.mcrecover.h"
+#include "BenchRunner.hpp"
+#include "util/cpuflags_x86.h"
+#include "util/git.h"
+
+// C includes.
+#include <stdio.h>
+
+// C includes. (C++ namespace)
+#include <cerrno>
+
+// Qt includes.
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+BenchRunner::BenchRunner()
+	: m_minTime(0.5)
+{ }
+
+/**
+ * Set the minimum time for each benchmark.
+ * @param seconds Minimum time, in seconds.
+ */
+void BenchRunner::setMinTime(double seconds)
+{
+	m_minTime = seconds;
+}
+
+/**
+ * Get the minimum time for each benchmark.
+ * @return Minimum time, in seconds.
+ */
+double BenchRunner::minTime(void) const
+{
+	return m_minTime;
+}
+
+/**
+ * Set the benchmark filter.
+ * Only benchmarks whose "suite/name" contains
+ * the filter string will be run.
+ * @param filter Filter string. (empty to run all benchmarks)
+ */
+void BenchRunner::setFilter(const QString &filter)
+{
+	m_filter = filter;
+}
+
+/**
+ * Check if a benchmark suite has any benchmarks that will be run.
+ * This can be used to skip generating the suite's input data.
+ * @param suite Suite name.
+ * @return True if the suite should be run; false if not.
+ */
+bool BenchRunner::isSuiteEnabled(const char *suite) const
+{
+	if (m_filter.isEmpty())
+		return true;
+
+	const int slash = m_filter.indexOf(QChar(L'/'));
+	if (slash < 0) {
+		// The filter might match any suite or benchmark name.
+		return true;
+	}
+
+	// "suite/name" can only contain "xxx/yyy"
+	// if the suite name ends with "xxx".
+	return QString::fromLatin1(suite).endsWith(m_filter.left(slash));
+}
+
+/**
+ * Run a benchmark.
+ * @param suite		[in] Suite name.
+ * @param name		[in] Benchmark name.
+ * @param func		[in] Benchmark function.
+ * @param ctx		[in] Benchmark context.
+ * @param bytes		[in] Bytes processed per iteration. (0 if not used)
+ * @param blocks	[in] Blocks processed per iteration. (0 if not used)
+ * @param itemUnit	[in,opt] Unit for the items returned by func.
+ */
+void BenchRunner::run(const char *suite, const QString &name,
+	BenchFunc func, void *ctx,
+	uint64_t bytes, uint64_t blocks,
+	const char *itemUnit)
+{
+	const QString fullName = QString::fromLatin1(suite) + QChar(L'/') + name;
+	if (!m_filter.isEmpty() && !fullName.contains(m_filter)) {
+		// Filtered out.
+		return;
+	}
+
+	// Warm up the caches and any lazily-initialized tables.
+	func(ctx);
+
+	// Run the benchmark until the minimum time has elapsed.
+	const qint64 minTime_ns = (qint64)(m_minTime * 1000000000.0);
+	uint64_t iterations = 0;
+	uint64_t items = 0;
+	qint64 elapsed_ns;
+	QElapsedTimer timer;
+	timer.start();
+	do {
+		items += func(ctx);
+		iterations++;
+		elapsed_ns = timer.nsecsElapsed();
+	} while (elapsed_ns < minTime_ns);
+
+	Result result;
+	result.suite = QString::fromLatin1(suite);
+	result.name = name;
+	if (itemUnit) {
+		result.itemUnit = QString::fromLatin1(itemUnit);
+	}
+	result.iterations = iterations;
+	result.seconds = (double)elapsed_ns / 1000000000.0;
+	if (result.seconds <= 0) {
+		// Timer resolution is too low.
+		result.seconds = 1.0 / 1000000000.0;
+	}
+	result.bytesPerSec = (double)(bytes * iterations) / result.seconds;
+	result.blocksPerSec = (double)(blocks * iterations) / result.seconds;
+	result.itemsPerSec = (itemUnit ? (double)items / result.seconds : 0);
+	m_results.append(result);
+
+	// Print the result.
+	char mbps[32], blocksps[32], itemsps[64];
+	if (bytes != 0) {
+		snprintf(mbps, sizeof(mbps), "%10.2f MB/s", result.bytesPerSec / (1024.0*1024.0));
+	} else {
+		snprintf(mbps, sizeof(mbps), "%15s", "-");
+	}
+	if (blocks != 0) {
+		snprintf(blocksps, sizeof(blocksps), "%12.0f blocks/s", result.blocksPerSec);
+	} else {
+		snprintf(blocksps, sizeof(blocksps), "%21s", "-");
+	}
+	if (itemUnit) {
+		snprintf(itemsps, sizeof(itemsps), "%12.0f %s/s", result.itemsPerSec, itemUnit);
+	} else {
+		itemsps[0] = 0;
+	}
+	printf("%-36s %s %s  %s\n", fullName.toUtf8().constData(), mbps, blocksps, itemsps);
+	fflush(stdout);
+}
+
+/**
+ * Get the benchmark results.
+ * @return Benchmark results.
+ */
+const QVector<BenchRunner::Result> &BenchRunner::results(void) const
+{
+	return m_results;
+}
+
+/**
+ * Write the benchmark results to a JSON file.
+ * @param filename Filename.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int BenchRunner::writeJson(const QString &filename) const
+{
+	QJsonObject root;
+	root.insert(QLatin1String("program"), QLatin1String("mcrecover-bench"));
+	root.insert(QLatin1String("version"), QLatin1String(MCRECOVER_VERSION_STRING));
+#ifdef MCRECOVER_GIT_VERSION
+	root.insert(QLatin1String("git"), QLatin1String(MCRECOVER_GIT_VERSION));
+#endif /* MCRECOVER_GIT_VERSION */
+	root.insert(QLatin1String("qtVersion"), QLatin1String(qVersion()));
+
+	// CPU flags.
+	// NOTE: These can be limited using the MCRECOVER_CPU environment variable.
+	QJsonArray cpuFlags;
+	if (MCR_CPU_HasSSE2()) {
+		cpuFlags.append(QLatin1String("sse2"));
+	}
+	if (MCR_CPU_HasSSSE3()) {
+		cpuFlags.append(QLatin1String("ssse3"));
+	}
+	if (MCR_CPU_HasAVX2()) {
+		cpuFlags.append(QLatin1String("avx2"));
+	}
+	root.insert(QLatin1String("cpuFlags"), cpuFlags);
+	root.insert(QLatin1String("minTime"), m_minTime);
+
+	QJsonArray results;
+	foreach (const Result &result, m_results) {
+		QJsonObject obj;
+		obj.insert(QLatin1String("suite"), result.suite);
+		obj.insert(QLatin1String("name"), result.name);
+		obj.insert(QLatin1String("iterations"), (double)result.iterations);
+		obj.insert(QLatin1String("seconds"), result.seconds);
+		if (result.bytesPerSec > 0) {
+			obj.insert(QLatin1String("bytesPerSec"), result.bytesPerSec);
+		}
+		if (result.blocksPerSec > 0) {
+			obj.insert(QLatin1String("blocksPerSec"), result.blocksPerSec);
+		}
+		if (!result.itemUnit.isEmpty()) {
+			obj.insert(QLatin1String("itemUnit"), result.itemUnit);
+			obj.insert(QLatin1String("itemsPerSec"), result.itemsPerSec);
+		}
+		results.append(obj);
+	}
+	root.insert(QLatin1String("results"), results);
+
+	QFile file(filename);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		// Error opening the file.
+		return -EIO;
+	}
+	const QByteArray json = QJsonDocument(root).toJson();
+	if (file.write(json) != json.size()) {
+		// Error writing the file.
+		return -EIO;
+	}
+	return 0;
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * BenchRunner.hpp: Benchmark runner.                                      *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_BENCH_BENCHRUNNER_HPP__
+#define __MCRECOVER_BENCH_BENCHRUNNER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+class BenchRunner
+{
+	public:
+		BenchRunner();
+
+	private:
+		Q_DISABLE_COPY(BenchRunner)
+
+	public:
+		/**
+		 * Benchmark function.
+		 * This is called repeatedly until the minimum time has elapsed.
+		 * @param ctx Benchmark context.
+		 * @return Number of items processed, e.g. matches found.
+		 */
+		typedef uint64_t (*BenchFunc)(void *ctx);
+
+		/**
+		 * Benchmark result.
+		 */
+		struct Result {
+			QString suite;
+			QString name;
+			QString itemUnit;	// Item unit, e.g. "matches". (empty if not used)
+			uint64_t iterations;
+			double seconds;		// Total time, in seconds.
+			double bytesPerSec;	// Throughput, in bytes/s. (0 if not used)
+			double blocksPerSec;	// Throughput, in blocks/s. (0 if not used)
+			double itemsPerSec;	// Throughput, in items/s. (0 if not used)
+		};
+
+		/**
+		 * Set the minimum time for each benchmark.
+		 * @param seconds Minimum time, in seconds.
+		 */
+		void setMinTime(double seconds);
+
+		/**
+		 * Get the minimum time for each benchmark.
+		 * @return Minimum time, in seconds.
+		 */
+		double minTime(void) const;
+
+		/**
+		 * Set the benchmark filter.
+		 * Only benchmarks whose "suite/name" contains
+		 * the filter string will be run.
+		 * @param filter Filter string. (empty to run all benchmarks)
+		 */
+		void setFilter(const QString &filter);
+
+		/**
+		 * Check if a benchmark suite has any benchmarks that will be run.
+		 * This can be used to skip generating the suite's input data.
+		 * @param suite Suite name.
+		 * @return True if the suite should be run; false if not.
+		 */
+		bool isSuiteEnabled(const char *suite) const;
+
+		/**
+		 * Run a benchmark.
+		 * @param suite		[in] Suite name.
+		 * @param name		[in] Benchmark name.
+		 * @param func		[in] Benchmark function.
+		 * @param ctx		[in] Benchmark context.
+		 * @param bytes		[in] Bytes processed per iteration. (0 if not used)
+		 * @param blocks	[in] Blocks processed per iteration. (0 if not used)
+		 * @param itemUnit	[in,opt] Unit for the items returned by func.
+		 */
+		void run(const char *suite, const QString &name,
+			BenchFunc func, void *ctx,
+			uint64_t bytes, uint64_t blocks,
+			const char *itemUnit = nullptr);
+
+		/**
+		 * Get the benchmark results.
+		 * @return Benchmark results.
+		 */
+		const QVector<Result> &results(void) const;
+
+		/**
+		 * Write the benchmark results to a JSON file.
+		 * @param filename Filename.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int writeJson(const QString &filename) const;
+
+	private:
+		double m_minTime;
+		QString m_filter;
+		QVector<Result> m_results;
+};
+
+#endif /* __MCRECOVER_BENCH_BENCHRUNNER_HPP__ */
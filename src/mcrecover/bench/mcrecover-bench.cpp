@@ -0,0 +1,491 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * mcrecover-bench.cpp: Benchmark program.                                 *
+ *                                                                         *
+ * Copyright (c) 2011-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "config.mcrecover.h"
+#include "BenchRunner.hpp"
+#include "BenchData.hpp"
+
+#include "db/GcnMcFileDb.hpp"
+#include "libmemcard/GcnCard.hpp"
+#include "libmemcard/File.hpp"
+
+// libgctools
+#include "card.h"
+#include "Checksum.hpp"
+#include "ChecksumPlan.hpp"
+#include "GcImage.hpp"
+#include "GcImageLoader.hpp"
+#include "util/array_size.h"
+#include "util/cpuflags_x86.h"
+
+// C includes.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// C++ includes.
+#include <vector>
+using std::vector;
+
+// Qt includes.
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTemporaryFile>
+
+// Checksum results are stored here so the
+// compiler doesn't optimize the checksums out.
+static volatile uint32_t bench_sink;
+
+/**
+ * Print the usage information.
+ * @param argv0 Program name.
+ */
+static void printUsage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTIONS]\n"
+		"\n"
+		"Options:\n"
+		"  --time SECONDS   Minimum time for each benchmark. (default is 0.5)\n"
+		"  --filter TEXT    Only run benchmarks whose \"suite/name\" contains TEXT.\n"
+		"  --saves N        Number of save files on the synthetic card. (default is 64)\n"
+		"  --defs N         Number of synthetic file definitions. (default is 1000)\n"
+		"  --output FILE    Write the results to FILE in JSON format.\n"
+		"\n"
+		"All input data is synthetic and generated in-process.\n"
+		"Set MCRECOVER_CPU=scalar, sse2, or ssse3 to limit the instruction sets.\n",
+		argv0);
+}
+
+/** Checksums **/
+
+struct ChecksumCtx {
+	const uint8_t *buf;
+	uint32_t siz;
+	Checksum::ChkAlgorithm algorithm;
+	Checksum::ChkEndian endian;
+};
+
+static uint64_t bench_checksum(void *p)
+{
+	const ChecksumCtx *const ctx = static_cast<const ChecksumCtx*>(p);
+	bench_sink ^= Checksum::Exec(ctx->algorithm, ctx->buf, ctx->siz, ctx->endian);
+	return 1;
+}
+
+/**
+ * Checksum algorithms.
+ * @param runner Benchmark runner.
+ */
+static void suite_checksum(BenchRunner &runner)
+{
+	static const char suite[] = "checksum";
+	if (!runner.isSuiteEnabled(suite))
+		return;
+
+	// 160 KB: large enough for the Pokémon XD algorithm.
+	const QByteArray data = BenchData::RandomData(0x28000, 0x43484B53);
+
+	ChecksumCtx ctx;
+	ctx.buf = reinterpret_cast<const uint8_t*>(data.constData());
+	ctx.siz = (uint32_t)data.size();
+	for (int alg = Checksum::CHKALG_NONE + 1; alg < Checksum::CHKALG_MAX; alg++) {
+		ctx.algorithm = (Checksum::ChkAlgorithm)alg;
+		const QString name = QLatin1String(Checksum::ChkAlgorithmToString(ctx.algorithm));
+
+		ctx.endian = Checksum::CHKENDIAN_BIG;
+		runner.run(suite, name, bench_checksum, &ctx,
+			ctx.siz, ctx.siz / 0x2000, "checksums");
+		if (ctx.algorithm == Checksum::CHKALG_ADDINVDUAL16) {
+			// AddInvDual16 is the only algorithm that
+			// depends on the data's endianness.
+			ctx.endian = Checksum::CHKENDIAN_LITTLE;
+			runner.run(suite, name + QLatin1String("-LE"), bench_checksum, &ctx,
+				ctx.siz, ctx.siz / 0x2000, "checksums");
+		}
+	}
+}
+
+/** Checksum plans **/
+
+struct ChecksumPlanCtx {
+	const uint8_t *buf;
+	uint32_t siz;
+	const vector<Checksum::ChecksumDef> *checksumDefs;
+	Checksum::ChecksumPlan checksumPlan;
+};
+
+static uint64_t bench_checksumPlan(void *p)
+{
+	ChecksumPlanCtx *const ctx = static_cast<ChecksumPlanCtx*>(p);
+
+	// Same access pattern as File: one block at a time.
+	ctx->checksumPlan.compile(*ctx->checksumDefs, ctx->siz);
+	const uint32_t end = ctx->checksumPlan.dataEnd();
+	for (uint32_t offset = 0; offset < end; offset += 0x2000) {
+		const uint32_t len = (end - offset >= 0x2000 ? 0x2000 : end - offset);
+		ctx->checksumPlan.update(offset, &ctx->buf[offset], len);
+	}
+
+	const vector<Checksum::ChecksumValue> values = ctx->checksumPlan.finish();
+	for (auto iter = values.cbegin(); iter != values.cend(); ++iter) {
+		bench_sink ^= iter->actual;
+	}
+	return values.size();
+}
+
+/**
+ * Checksum plans over complete files.
+ * @param runner Benchmark runner.
+ */
+static void suite_plan(BenchRunner &runner)
+{
+	static const char suite[] = "plan";
+	if (!runner.isSuiteEnabled(suite))
+		return;
+
+	// Typical mix of checksum algorithms.
+	vector<Checksum::ChecksumDef> mixedDefs;
+	BenchData::GetMixedChecksumDefs(&mixedDefs);
+	const QByteArray mixedData = BenchData::RandomData(
+		BenchData::MixedChecksumFileSize, 0x4D495844);
+
+	ChecksumPlanCtx ctx;
+	ctx.buf = reinterpret_cast<const uint8_t*>(mixedData.constData());
+	ctx.siz = (uint32_t)mixedData.size();
+	ctx.checksumDefs = &mixedDefs;
+	runner.run(suite, QLatin1String("mixed"), bench_checksumPlan, &ctx,
+		ctx.siz, ctx.siz / 0x2000, "checksums");
+
+	// Encrypted Pokémon XD save file.
+	vector<Checksum::ChecksumDef> xdDefs;
+	const QByteArray xdData = BenchData::MakePokemonXDSave(&xdDefs);
+	ctx.buf = reinterpret_cast<const uint8_t*>(xdData.constData());
+	ctx.siz = (uint32_t)xdData.size();
+	ctx.checksumDefs = &xdDefs;
+	runner.run(suite, QLatin1String("PokemonXD"), bench_checksumPlan, &ctx,
+		ctx.siz, ctx.siz / 0x2000, "checksums");
+}
+
+/** Images **/
+
+struct ImageCtx {
+	int w, h;
+	const uint8_t *img_buf;
+	int img_siz;
+	const uint16_t *pal_buf;	// nullptr for RGB5A3
+};
+
+static uint64_t bench_image(void *p)
+{
+	const ImageCtx *const ctx = static_cast<const ImageCtx*>(p);
+	GcImage *gcImage;
+	if (ctx->pal_buf) {
+		gcImage = GcImageLoader::fromCI8(ctx->w, ctx->h,
+			ctx->img_buf, ctx->img_siz, ctx->pal_buf, 0x200);
+	} else {
+		gcImage = GcImageLoader::fromRGB5A3(ctx->w, ctx->h,
+			reinterpret_cast<const uint16_t*>(ctx->img_buf), ctx->img_siz);
+	}
+	if (!gcImage)
+		return 0;
+	delete gcImage;
+	return 1;
+}
+
+/**
+ * Banner and icon decoding.
+ * @param runner Benchmark runner.
+ */
+static void suite_image(BenchRunner &runner)
+{
+	static const char suite[] = "image";
+	if (!runner.isSuiteEnabled(suite))
+		return;
+
+	// Large enough for an RGB5A3 banner.
+	const QByteArray imgData = BenchData::RandomData(CARD_BANNER_W * CARD_BANNER_H * 2, 0x494D4147);
+	const QByteArray palData = BenchData::RandomData(0x200, 0x50414C00);
+
+	struct ImageDef {
+		const char *name;
+		int w, h;
+		bool ci8;
+	};
+	static const ImageDef imageDefs[] = {
+		{"CI8 icon",		CARD_ICON_W,	CARD_ICON_H,	true},
+		{"CI8 banner",		CARD_BANNER_W,	CARD_BANNER_H,	true},
+		{"RGB5A3 icon",		CARD_ICON_W,	CARD_ICON_H,	false},
+		{"RGB5A3 banner",	CARD_BANNER_W,	CARD_BANNER_H,	false},
+	};
+
+	ImageCtx ctx;
+	ctx.img_buf = reinterpret_cast<const uint8_t*>(imgData.constData());
+	for (int i = 0; i < ARRAY_SIZE(imageDefs); i++) {
+		const ImageDef &imageDef = imageDefs[i];
+		ctx.w = imageDef.w;
+		ctx.h = imageDef.h;
+		if (imageDef.ci8) {
+			ctx.img_siz = ctx.w * ctx.h;
+			ctx.pal_buf = reinterpret_cast<const uint16_t*>(palData.constData());
+		} else {
+			ctx.img_siz = ctx.w * ctx.h * 2;
+			ctx.pal_buf = nullptr;
+		}
+		runner.run(suite, QLatin1String(imageDef.name), bench_image, &ctx,
+			ctx.img_siz + (ctx.pal_buf ? 0x200 : 0), 0, "images");
+	}
+}
+
+/** Card I/O **/
+
+struct CardCtx {
+	QByteArray image;
+	Card *card;
+	uint8_t *blockBuf;
+};
+
+static uint64_t bench_card_open(void *p)
+{
+	const CardCtx *const ctx = static_cast<const CardCtx*>(p);
+	GcnCard *const gcnCard = GcnCard::open(ctx->image, nullptr);
+	if (!gcnCard)
+		return 0;
+	const int fileCount = (gcnCard->isOpen() ? gcnCard->fileCount() : 0);
+	delete gcnCard;
+	return fileCount;
+}
+
+static uint64_t bench_card_readBlock(void *p)
+{
+	CardCtx *const ctx = static_cast<CardCtx*>(p);
+	const int blockSize = ctx->card->blockSize();
+	const int totalPhysBlocks = ctx->card->totalPhysBlocks();
+	for (int i = 0; i < totalPhysBlocks; i++) {
+		ctx->card->readBlock(ctx->blockBuf, blockSize, (uint16_t)i);
+	}
+	bench_sink ^= ctx->blockBuf[0];
+	return 0;
+}
+
+static uint64_t bench_card_loadFileData(void *p)
+{
+	CardCtx *const ctx = static_cast<CardCtx*>(p);
+	const int fileCount = ctx->card->fileCount();
+	for (int i = 0; i < fileCount; i++) {
+		const QByteArray fileData = ctx->card->getFile(i)->loadFileData();
+		if (!fileData.isEmpty()) {
+			bench_sink ^= (uint8_t)fileData.at(0);
+		}
+	}
+	return fileCount;
+}
+
+/**
+ * Card I/O using a synthetic card image.
+ * @param runner Benchmark runner.
+ * @param image Synthetic card image.
+ * @param saveCount Number of save files on the card.
+ * @param saveLength Length of each save file, in blocks.
+ * @return 0 on success; non-zero on error.
+ */
+static int suite_card(BenchRunner &runner, const QByteArray &image, int saveCount, int saveLength)
+{
+	static const char suite[] = "card";
+	if (!runner.isSuiteEnabled(suite))
+		return 0;
+
+	CardCtx ctx;
+	ctx.image = image;
+	runner.run(suite, QLatin1String("open"), bench_card_open, &ctx,
+		0, 0, "files");
+
+	GcnCard *const gcnCard = GcnCard::open(image, nullptr);
+	if (!gcnCard || !gcnCard->isOpen() || gcnCard->fileCount() != saveCount) {
+		fprintf(stderr, "*** ERROR: The synthetic card image could not be opened.\n");
+		delete gcnCard;
+		return EXIT_FAILURE;
+	}
+	ctx.card = gcnCard;
+	ctx.blockBuf = static_cast<uint8_t*>(malloc(gcnCard->blockSize()));
+
+	const uint64_t totalPhysBlocks = (uint64_t)gcnCard->totalPhysBlocks();
+	runner.run(suite, QLatin1String("readBlock"), bench_card_readBlock, &ctx,
+		totalPhysBlocks * gcnCard->blockSize(), totalPhysBlocks);
+
+	const uint64_t fileBlocks = (uint64_t)saveCount * saveLength;
+	runner.run(suite, QLatin1String("loadFileData"), bench_card_loadFileData, &ctx,
+		fileBlocks * gcnCard->blockSize(), fileBlocks, "files");
+
+	free(ctx.blockBuf);
+	delete gcnCard;
+	return 0;
+}
+
+/** Scanning **/
+
+struct ScanCtx {
+	QString dbFilename;
+	const GcnMcFileDb *db;
+	const uint8_t *buf;
+	int siz;
+};
+
+static uint64_t bench_scan_load(void *p)
+{
+	const ScanCtx *const ctx = static_cast<const ScanCtx*>(p);
+	GcnMcFileDb db;
+	db.load(ctx->dbFilename);
+	return 1;
+}
+
+static uint64_t bench_scan_checkBlock(void *p)
+{
+	const ScanCtx *const ctx = static_cast<const ScanCtx*>(p);
+	uint64_t matches = 0;
+	for (int offset = 0; offset < ctx->siz; offset += 0x2000) {
+		matches += ctx->db->checkBlock(&ctx->buf[offset], 0x2000).size();
+	}
+	return matches;
+}
+
+/**
+ * Scanning a synthetic card image for lost files.
+ * @param runner Benchmark runner.
+ * @param image Synthetic card image.
+ * @param saveCount Number of save files on the card.
+ * @param saveLength Length of each save file, in blocks.
+ * @param defCount Number of synthetic file definitions.
+ * @return 0 on success; non-zero on error.
+ */
+static int suite_scan(BenchRunner &runner, const QByteArray &image,
+	int saveCount, int saveLength, int defCount)
+{
+	static const char suite[] = "scan";
+	if (!runner.isSuiteEnabled(suite))
+		return 0;
+
+	// GcnMcFileDb can only load files.
+	QTemporaryFile dbFile;
+	if (!dbFile.open() ||
+	    BenchData::WriteGcnMcFileDb(&dbFile, defCount, saveCount, saveLength) != 0)
+	{
+		fprintf(stderr, "*** ERROR: The synthetic database could not be written.\n");
+		return EXIT_FAILURE;
+	}
+	dbFile.close();
+
+	GcnMcFileDb db;
+	if (db.load(dbFile.fileName()) != 0) {
+		fprintf(stderr, "*** ERROR: The synthetic database could not be loaded: %s\n",
+			db.errorString().toLocal8Bit().constData());
+		return EXIT_FAILURE;
+	}
+
+	ScanCtx ctx;
+	ctx.dbFilename = dbFile.fileName();
+	ctx.db = &db;
+	ctx.buf = reinterpret_cast<const uint8_t*>(image.constData());
+	ctx.siz = image.size();
+
+	// Make sure the scan finds every save file.
+	const uint64_t matches = bench_scan_checkBlock(&ctx);
+	if (matches != (uint64_t)saveCount) {
+		fprintf(stderr, "*** WARNING: Expected %d matches; found %u.\n",
+			saveCount, (unsigned int)matches);
+	}
+
+	runner.run(suite, QLatin1String("dbLoad"), bench_scan_load, &ctx,
+		0, 0, "databases");
+	runner.run(suite, QLatin1String("checkBlock"), bench_scan_checkBlock, &ctx,
+		ctx.siz, ctx.siz / 0x2000, "matches");
+	return 0;
+}
+
+/**
+ * Main entry point.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return Return value.
+ */
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+
+	double minTime = 0.5;
+	int saveCount = 64;
+	int defCount = 1000;
+	QString filter;
+	QString output;
+
+	for (int i = 1; i < argc; i++) {
+		const bool hasArg = (i + 1 < argc);
+		if (!strcmp(argv[i], "--help")) {
+			printUsage(argv[0]);
+			return EXIT_SUCCESS;
+		} else if (!strcmp(argv[i], "--time") && hasArg) {
+			minTime = atof(argv[++i]);
+		} else if (!strcmp(argv[i], "--filter") && hasArg) {
+			filter = QString::fromLocal8Bit(argv[++i]);
+		} else if (!strcmp(argv[i], "--saves") && hasArg) {
+			saveCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--defs") && hasArg) {
+			defCount = atoi(argv[++i]);
+		} else if (!strcmp(argv[i], "--output") && hasArg) {
+			output = QString::fromLocal8Bit(argv[++i]);
+		} else {
+			printUsage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (minTime <= 0 || saveCount < 1 || saveCount > CARD_MAXFILES ||
+	    defCount < saveCount)
+	{
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// Use as many blocks as possible, up to 16 blocks per file.
+	int saveLength = (2048 - CARD_SYSAREA) / saveCount;
+	if (saveLength > 16) {
+		saveLength = 16;
+	}
+
+	printf("mcrecover-bench " MCRECOVER_VERSION_STRING "\n");
+	printf("CPU flags:%s%s%s\n",
+		(MCR_CPU_HasSSE2() ? " sse2" : ""),
+		(MCR_CPU_HasSSSE3() ? " ssse3" : ""),
+		(MCR_CPU_HasAVX2() ? " avx2" : ""));
+	printf("Synthetic card: %d files, %d blocks each; %d file definitions\n\n",
+		saveCount, saveLength, defCount);
+
+	BenchRunner runner;
+	runner.setMinTime(minTime);
+	runner.setFilter(filter);
+
+	suite_checksum(runner);
+	suite_plan(runner);
+	suite_image(runner);
+
+	const QByteArray image = BenchData::MakeGcnCard(saveCount, saveLength);
+	int ret = suite_card(runner, image, saveCount, saveLength);
+	if (ret == 0) {
+		ret = suite_scan(runner, image, saveCount, saveLength, defCount);
+	}
+
+	if (!output.isEmpty()) {
+		int jret = runner.writeJson(output);
+		if (jret != 0) {
+			fprintf(stderr, "*** ERROR: %s: %s\n",
+				output.toLocal8Bit().constData(), strerror(-jret));
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	return ret;
+}
@@ -33,6 +33,7 @@ const ConfigDefaults::DefaultSetting ConfigDefaults::DefaultSettings[] =
 	{"animIconFormat",	"APNG", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 	{"language",		"", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 	{"fileType",		"0", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
+	{"snapshotStore",	"", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 
 	/** End of array. **/
 	{nullptr, nullptr, 0, 0, DefaultSetting::VT_NONE, 0, 0}
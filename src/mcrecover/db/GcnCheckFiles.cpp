@@ -111,6 +111,10 @@ void GcnCheckFiles::addChecksumDefs(GcnFile *file) const
 		// Checksum has already been obtained for this file.
 		return;
 	}
+	if (file->isChecksumPending()) {
+		// Checksum is being calculated for this file.
+		return;
+	}
 
 	Q_D(const GcnCheckFiles);
 	foreach (GcnMcFileDb *db, d->dbs) {
@@ -0,0 +1,557 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnImageScanner.cpp: Streaming scanner for large raw images.            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "GcnImageScanner.hpp"
+#include "util/byteswap.h"
+
+// GCN Memory Card File Database
+#include "db/GcnMcFileDb.hpp"
+
+// Checksum algorithm class.
+#include "Checksum.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QIODevice>
+#include <QtCore/QThread>
+
+/** GcnImageScannerPrivate **/
+
+class GcnImageScannerPrivate
+{
+	public:
+		explicit GcnImageScannerPrivate(GcnImageScanner *q);
+		~GcnImageScannerPrivate();
+
+	protected:
+		GcnImageScanner *const q_ptr;
+		Q_DECLARE_PUBLIC(GcnImageScanner)
+	private:
+		Q_DISABLE_COPY(GcnImageScannerPrivate)
+
+	public:
+		// GCN block size.
+		static const int BLOCK_SIZE = 8192;
+		// Maximum number of blocks in a GCN file.
+		// (Limited by the FAT, even on oversized cards.)
+		static const int MAX_USER_BLOCKS = (CARD_FATBLOCKS - CARD_SYSAREA);
+
+		// Last error string.
+		QString errorString;
+
+		// Hits from the last scan.
+		QVector<GcnScanHit> hits;
+
+		// Properties.
+		QVector<GcnMcFileDb*> databases;
+		int alignment;
+		int chunkSize;
+
+		// Set by cancel().
+		QAtomicInt cancelled;
+
+		// Asynchronous scan.
+		// NOTE: asyncDevice is owned by the scanner.
+		QThread *scanThread;
+		QIODevice *asyncDevice;
+
+		/**
+		 * Check for a GCN memory card header.
+		 * @param buf		[in] Data. (at least sizeof(card_header) bytes)
+		 * @param cardBlocks	[out] Card size, in blocks.
+		 * @return True if this is a valid card header.
+		 */
+		static bool checkCardHeader(const uint8_t *buf, int *cardBlocks);
+
+		/**
+		 * Check for a GCI directory entry.
+		 * @param buf		[in] Data. (at least sizeof(card_direntry) bytes)
+		 * @param dirEntry	[out] Directory entry. (host-endian)
+		 * @return True if this looks like a GCI directory entry.
+		 */
+		static bool checkGciDirEntry(const uint8_t *buf, card_direntry *dirEntry);
+
+		/**
+		 * Check a position in the image.
+		 * @param buf Data at the position.
+		 * @param len Length of buf. (usually BLOCK_SIZE; less at the end of the image)
+		 * @param offset Offset in the image.
+		 * @param totalSize Total image size. (-1 if unknown)
+		 */
+		void checkPosition(const uint8_t *buf, int len, qint64 offset, qint64 totalSize);
+};
+
+/**
+ * Scan thread for GcnImageScanner::scan_async().
+ */
+class GcnImageScanThread : public QThread
+{
+	typedef QThread super;
+
+	public:
+		GcnImageScanThread(GcnImageScanner *scanner, QIODevice *device)
+			: super(scanner)
+			, scanner(scanner)
+			, device(device) { }
+
+	protected:
+		void run(void) final
+		{
+			scanner->scan(device);
+		}
+
+	private:
+		GcnImageScanner *const scanner;
+		QIODevice *const device;
+		Q_DISABLE_COPY(GcnImageScanThread)
+};
+
+GcnImageScannerPrivate::GcnImageScannerPrivate(GcnImageScanner* q)
+	: q_ptr(q)
+	, alignment(BLOCK_SIZE)
+	, chunkSize(1024*1024)
+	, scanThread(nullptr)
+	, asyncDevice(nullptr)
+{ }
+
+GcnImageScannerPrivate::~GcnImageScannerPrivate()
+{
+	if (scanThread) {
+		// Stop the scan thread.
+		cancelled.store(1);
+		scanThread->wait();
+		delete scanThread;
+	}
+	delete asyncDevice;
+}
+
+/**
+ * Check for a GCN memory card header.
+ * @param buf		[in] Data. (at least sizeof(card_header) bytes)
+ * @param cardBlocks	[out] Card size, in blocks.
+ * @return True if this is a valid card header.
+ */
+bool GcnImageScannerPrivate::checkCardHeader(const uint8_t *buf, int *cardBlocks)
+{
+	card_header hdr;
+	memcpy(&hdr, buf, sizeof(hdr));
+
+	// Card size, in megabits.
+	// Official cards are 4 Mbit to 128 Mbit, but oversized
+	// images may be larger. (1 Mbit == 16 blocks)
+	const uint16_t size = be16_to_cpu(hdr.size);
+	if (size < 4 || size > (CARD_MAXBLOCKS / 16) || (size & (size - 1)) != 0)
+		return false;
+
+	// Header checksum.
+	const uint32_t expected = (be16_to_cpu(hdr.chksum1) << 16) |
+				  (be16_to_cpu(hdr.chksum2));
+	const uint32_t actual = Checksum::AddInvDual16(
+		reinterpret_cast<const uint16_t*>(&hdr), 0x1FC, Checksum::CHKENDIAN_BIG);
+	if (expected != actual)
+		return false;
+
+	// 1 Mbit == 16 blocks.
+	*cardBlocks = size * 16;
+	return true;
+}
+
+/**
+ * Check for a GCI directory entry.
+ * @param buf		[in] Data. (at least sizeof(card_direntry) bytes)
+ * @param dirEntry	[out] Directory entry. (host-endian)
+ * @return True if this looks like a GCI directory entry.
+ */
+bool GcnImageScannerPrivate::checkGciDirEntry(const uint8_t *buf, card_direntry *dirEntry)
+{
+	const card_direntry *const de = reinterpret_cast<const card_direntry*>(buf);
+
+	// Game code and company code must be alphanumeric.
+	for (int i = 0; i < 6; i++) {
+		const char chr = (i < 4 ? de->gamecode[i] : de->company[i-4]);
+		if (!((chr >= '0' && chr <= '9') || (chr >= 'A' && chr <= 'Z')))
+			return false;
+	}
+
+	// Padding bytes.
+	if (de->pad_00 != 0xFF || de->pad_01 != 0xFFFF)
+		return false;
+
+	// Filename must not be empty, and must not have control characters.
+	if (de->filename[0] == 0)
+		return false;
+	for (int i = 0; i < CARD_FILENAMELEN && de->filename[i] != 0; i++) {
+		if ((uint8_t)de->filename[i] < 0x20)
+			return false;
+	}
+
+	// File length.
+	const uint16_t length = be16_to_cpu(de->length);
+	if (length == 0 || length > MAX_USER_BLOCKS)
+		return false;
+	const uint32_t dataSize = (uint32_t)length * BLOCK_SIZE;
+
+	// Comment and icon addresses must be within the file.
+	const uint32_t commentaddr = be32_to_cpu(de->commentaddr);
+	if (commentaddr > dataSize - 64)
+		return false;
+	const uint32_t iconaddr = be32_to_cpu(de->iconaddr);
+	if (iconaddr != 0xFFFFFFFF && iconaddr >= dataSize)
+		return false;
+
+	// This looks like a GCI directory entry.
+	memcpy(dirEntry, de, sizeof(*dirEntry));
+#if SYS_BYTEORDER != SYS_BIG_ENDIAN
+	// Byteswap the directory entry.
+	dirEntry->lastmodified	= be32_to_cpu(dirEntry->lastmodified);
+	dirEntry->iconaddr	= iconaddr;
+	dirEntry->iconfmt	= be16_to_cpu(dirEntry->iconfmt);
+	dirEntry->iconspeed	= be16_to_cpu(dirEntry->iconspeed);
+	dirEntry->block		= be16_to_cpu(dirEntry->block);
+	dirEntry->length	= length;
+	dirEntry->commentaddr	= commentaddr;
+#endif /* SYS_BYTEORDER != SYS_BIG_ENDIAN */
+	return true;
+}
+
+/**
+ * Check a position in the image.
+ * @param buf Data at the position.
+ * @param len Length of buf. (usually BLOCK_SIZE; less at the end of the image)
+ * @param offset Offset in the image.
+ * @param totalSize Total image size. (-1 if unknown)
+ */
+void GcnImageScannerPrivate::checkPosition(const uint8_t *buf, int len, qint64 offset, qint64 totalSize)
+{
+	GcnScanHit hit;
+	hit.offset = offset;
+	hit.cardBlocks = 0;
+
+	// GCN memory card header.
+	if (len >= (int)sizeof(card_header) && checkCardHeader(buf, &hit.cardBlocks)) {
+		hit.type = GcnScanHit::Type::CardHeader;
+		hit.length = (qint64)hit.cardBlocks * BLOCK_SIZE;
+		hits.append(hit);
+		hit.cardBlocks = 0;
+	}
+
+	// GCI directory entry.
+	card_direntry dirEntry;
+	if (len >= (int)sizeof(card_direntry) && checkGciDirEntry(buf, &dirEntry)) {
+		const qint64 gciSize = (qint64)sizeof(card_direntry) + ((qint64)dirEntry.length * BLOCK_SIZE);
+		if (totalSize < 0 || offset + gciSize <= totalSize) {
+			hit.type = GcnScanHit::Type::GciFile;
+			hit.length = gciSize;
+			hit.searchData.dirEntry = dirEntry;
+			hits.append(hit);
+			hit.searchData = GcnSearchData();
+		}
+	}
+
+	// "Lost" files.
+	// TODO: Search for preferred region. For now, just use the first hit.
+	foreach (GcnMcFileDb *db, databases) {
+		QVector<GcnSearchData> searchDataEntries = db->checkBlock(buf, len);
+		if (searchDataEntries.isEmpty())
+			continue;
+
+		hit.type = GcnScanHit::Type::LostFile;
+		hit.searchData = searchDataEntries.at(0);
+		const int blocks = (hit.searchData.dirEntry.length > 0
+			? hit.searchData.dirEntry.length : 1);
+		hit.length = (qint64)blocks * BLOCK_SIZE;
+		hits.append(hit);
+		break;
+	}
+}
+
+/** GcnImageScanner **/
+
+GcnImageScanner::GcnImageScanner(QObject *parent)
+	: super(parent)
+	, d_ptr(new GcnImageScannerPrivate(this))
+{ }
+
+GcnImageScanner::~GcnImageScanner()
+{
+	Q_D(GcnImageScanner);
+	delete d;
+}
+
+/** Read-only properties. **/
+
+/**
+ * Get the last error string.
+ *
+ * NOTE: This is NOT cleared if no error occurs.
+ * It should only be checked if an error occurred.
+ *
+ * @return Last error string.
+ */
+QString GcnImageScanner::errorString(void) const
+{
+	Q_D(const GcnImageScanner);
+	return d->errorString;
+}
+
+/**
+ * Get the hits from the last scan.
+ * Hits are sorted by offset.
+ * @return Hits.
+ */
+QVector<GcnScanHit> GcnImageScanner::hits(void) const
+{
+	Q_D(const GcnImageScanner);
+	return d->hits;
+}
+
+/** Properties. **/
+
+/**
+ * Get the vector of GCN file databases.
+ * @return GCN file databases.
+ */
+QVector<GcnMcFileDb*> GcnImageScanner::databases(void) const
+{
+	Q_D(const GcnImageScanner);
+	return d->databases;
+}
+
+/**
+ * Set the vector of GCN file databases.
+ * If empty, only card headers and GCI files will be detected.
+ * @param databases GCN file databases.
+ */
+void GcnImageScanner::setDatabases(const QVector<GcnMcFileDb*> &databases)
+{
+	// TODO: Not if scanning?
+	Q_D(GcnImageScanner);
+	d->databases = databases;
+}
+
+/**
+ * Get the scan alignment.
+ * @return Scan alignment, in bytes.
+ */
+int GcnImageScanner::alignment(void) const
+{
+	Q_D(const GcnImageScanner);
+	return d->alignment;
+}
+
+/**
+ * Set the scan alignment.
+ * Default is 8 KiB (one block). Smaller values can be
+ * used to find data that isn't block-aligned, e.g. GCI
+ * files stored in a filesystem dump.
+ * @param alignment Scan alignment. (power of two; 64 to 8192)
+ */
+void GcnImageScanner::setAlignment(int alignment)
+{
+	if (alignment < 64 || alignment > GcnImageScannerPrivate::BLOCK_SIZE ||
+	    (alignment & (alignment - 1)) != 0)
+	{
+		// Invalid alignment.
+		return;
+	}
+
+	// TODO: Not if scanning?
+	Q_D(GcnImageScanner);
+	d->alignment = alignment;
+}
+
+/**
+ * Get the chunk size.
+ * @return Chunk size, in bytes.
+ */
+int GcnImageScanner::chunkSize(void) const
+{
+	Q_D(const GcnImageScanner);
+	return d->chunkSize;
+}
+
+/**
+ * Set the chunk size.
+ * This is the amount of data read at once, which
+ * determines the scanner's memory usage.
+ * @param chunkSize Chunk size. (multiple of 8 KiB)
+ */
+void GcnImageScanner::setChunkSize(int chunkSize)
+{
+	if (chunkSize <= 0 || (chunkSize % GcnImageScannerPrivate::BLOCK_SIZE) != 0) {
+		// Invalid chunk size.
+		return;
+	}
+
+	// TODO: Not if scanning?
+	Q_D(GcnImageScanner);
+	d->chunkSize = chunkSize;
+}
+
+/** Scan functions. **/
+
+/**
+ * Scan an image of any size.
+ * The image is read sequentially, so memory usage
+ * is bounded by the chunk size.
+ * @param device Opened device to scan. (QFile, CompressedFile, etc.)
+ * @return Number of hits on success; negative on error.
+ */
+int GcnImageScanner::scan(QIODevice *device)
+{
+	Q_D(GcnImageScanner);
+	d->hits.clear();
+	if (QThread::currentThread() != d->scanThread) {
+		// NOTE: scan_async() resets this before starting the
+		// thread, so cancel() works before the scan starts.
+		d->cancelled.store(0);
+	}
+
+	if (!device || !device->isOpen() || !device->isReadable()) {
+		// Device is not open.
+		d->errorString = tr("scan(): The image is not open.");
+		emit scanError(d->errorString);
+		return -1;
+	}
+
+	static const int BLOCK_SIZE = GcnImageScannerPrivate::BLOCK_SIZE;
+	const int alignment = d->alignment;
+	const qint64 totalSize = (device->isSequential() ? -1 : device->size());
+
+	// The buffer has room for one extra block so positions
+	// near the end of a chunk can be checked as full blocks.
+	QByteArray buffer;
+	buffer.resize(d->chunkSize + BLOCK_SIZE);
+	uint8_t *const buf = reinterpret_cast<uint8_t*>(buffer.data());
+	int valid = 0;		// Number of valid bytes in buf.
+	qint64 bufOffset = 0;	// Image offset of buf[0].
+	bool eof = false;
+
+	emit scanStarted(totalSize);
+
+	while (true) {
+		if (d->cancelled.load()) {
+			// Scan was cancelled.
+			emit scanCancelled();
+			return -ECANCELED;
+		}
+
+		// Fill the buffer.
+		while (!eof && valid < buffer.size()) {
+			const qint64 n = device->read(reinterpret_cast<char*>(buf + valid), buffer.size() - valid);
+			if (n < 0) {
+				// Read error.
+				d->errorString = tr("scan(): Read error at offset %1: %2")
+					.arg(bufOffset + valid).arg(device->errorString());
+				emit scanError(d->errorString);
+				return -EIO;
+			} else if (n == 0) {
+				eof = true;
+			}
+			valid += (int)n;
+		}
+
+		// Check every aligned position that has a full block available.
+		// At the end of the image, check the remaining partial blocks.
+		int pos = 0;
+		for (; pos + BLOCK_SIZE <= valid; pos += alignment) {
+			d->checkPosition(buf + pos, BLOCK_SIZE, bufOffset + pos, totalSize);
+		}
+		if (eof) {
+			for (; pos < valid; pos += alignment) {
+				d->checkPosition(buf + pos, valid - pos, bufOffset + pos, totalSize);
+			}
+			break;
+		}
+
+		// Move the unchecked data to the beginning of the buffer.
+		memmove(buf, buf + pos, valid - pos);
+		bufOffset += pos;
+		valid -= pos;
+		emit scanUpdate(bufOffset, d->hits.size());
+	}
+
+	// Scan is finished.
+	emit scanUpdate(bufOffset + valid, d->hits.size());
+	emit scanFinished(d->hits.size());
+	return d->hits.size();
+}
+
+/**
+ * Scan an image of any size.
+ * Asynchronous scan; uses a separate thread.
+ * The scanner takes ownership of the device, and
+ * deletes it once the scan thread has finished.
+ * @param device Opened device to scan. (QFile, CompressedFile, etc.)
+ * @return 0 if the thread was started; negative POSIX error code on error.
+ *
+ * The scan is completed when one of the following signals is emitted:
+ * - scanFinished(): Scan has completed. Use hits() to get the hits.
+ * - scanCancelled(): Scan was cancelled.
+ * - scanError(): Scan failed due to an error.
+ */
+int GcnImageScanner::scan_async(QIODevice *device)
+{
+	Q_D(GcnImageScanner);
+	if (d->scanThread) {
+		// Thread is already running.
+		delete device;
+		return -EBUSY;
+	}
+
+	// NOTE: The device must not have a parent,
+	// since it's used on the scan thread.
+	assert(device != nullptr);
+	assert(device->parent() == nullptr);
+	d->asyncDevice = device;
+	d->cancelled.store(0);
+	d->scanThread = new GcnImageScanThread(this, device);
+	connect(d->scanThread, &QThread::finished,
+		this, &GcnImageScanner::scanThread_finished_slot);
+	d->scanThread->start();
+	return 0;
+}
+
+/**
+ * Is an asynchronous scan running?
+ * @return True if the scan thread is running.
+ */
+bool GcnImageScanner::isScanning(void) const
+{
+	Q_D(const GcnImageScanner);
+	return (d->scanThread != nullptr);
+}
+
+/**
+ * Cancel the current scan.
+ * This can be called from any thread.
+ */
+void GcnImageScanner::cancel(void)
+{
+	Q_D(GcnImageScanner);
+	d->cancelled.store(1);
+}
+
+/** Slots. **/
+
+/**
+ * The scan thread has finished.
+ */
+void GcnImageScanner::scanThread_finished_slot(void)
+{
+	Q_D(GcnImageScanner);
+	delete d->scanThread;
+	d->scanThread = nullptr;
+	delete d->asyncDevice;
+	d->asyncDevice = nullptr;
+}
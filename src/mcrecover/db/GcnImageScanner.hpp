@@ -0,0 +1,215 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * GcnImageScanner.hpp: Streaming scanner for large raw images.            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_DB_GCNIMAGESCANNER_HPP__
+#define __MCRECOVER_DB_GCNIMAGESCANNER_HPP__
+
+// Search Data struct.
+#include "GcnSearchData.hpp"
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// Qt classes.
+class QIODevice;
+
+// Forward declarations.
+class GcnMcFileDb;
+
+/**
+ * Something found by GcnImageScanner.
+ */
+struct GcnScanHit
+{
+	enum class Type {
+		CardHeader,	// GCN memory card header.
+		GciFile,	// GCI file. (directory entry + data)
+		LostFile,	// Block matching a database entry.
+	};
+
+	Type type;
+	qint64 offset;	// Offset in the image, in bytes.
+	qint64 length;	// Length of the region, in bytes.
+
+	// CardHeader: Card size, in blocks.
+	int cardBlocks;
+
+	// GciFile: Directory entry. (host-endian)
+	// LostFile: Database match. (dirEntry.block is not set)
+	GcnSearchData searchData;
+};
+
+class GcnImageScannerPrivate;
+class GcnImageScanner : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	Q_PROPERTY(QString errorString READ errorString)
+	Q_PROPERTY(QVector<GcnScanHit> hits READ hits)
+
+	Q_PROPERTY(QVector<GcnMcFileDb*> databases READ databases WRITE setDatabases)
+	Q_PROPERTY(int alignment READ alignment WRITE setAlignment)
+	Q_PROPERTY(int chunkSize READ chunkSize WRITE setChunkSize)
+
+	public:
+		explicit GcnImageScanner(QObject *parent = 0);
+		virtual ~GcnImageScanner();
+
+	protected:
+		GcnImageScannerPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(GcnImageScanner)
+	private:
+		Q_DISABLE_COPY(GcnImageScanner)
+
+	signals:
+		/**
+		 * Scan has started.
+		 * @param totalSize Total size of the image, in bytes. (-1 if unknown)
+		 */
+		void scanStarted(qint64 totalSize);
+
+		/**
+		 * Update scan status.
+		 * Emitted once per chunk.
+		 * @param position Current position, in bytes.
+		 * @param hitCount Number of hits so far.
+		 */
+		void scanUpdate(qint64 position, int hitCount);
+
+		/**
+		 * Scan has completed.
+		 * @param hitCount Number of hits.
+		 */
+		void scanFinished(int hitCount);
+
+		/**
+		 * Scan has been cancelled.
+		 */
+		void scanCancelled(void);
+
+		/**
+		 * An error has occurred during the scan.
+		 * @param errorString Error string.
+		 */
+		void scanError(QString errorString);
+
+	public:
+		/** Read-only properties. **/
+
+		/**
+		 * Get the last error string.
+		 *
+		 * NOTE: This is NOT cleared if no error occurs.
+		 * It should only be checked if an error occurred.
+		 *
+		 * @return Last error string.
+		 */
+		QString errorString(void) const;
+
+		/**
+		 * Get the hits from the last scan.
+		 * Hits are sorted by offset.
+		 * @return Hits.
+		 */
+		QVector<GcnScanHit> hits(void) const;
+
+	public:
+		/** Properties. **/
+
+		/**
+		 * Get the vector of GCN file databases.
+		 * @return GCN file databases.
+		 */
+		QVector<GcnMcFileDb*> databases(void) const;
+
+		/**
+		 * Set the vector of GCN file databases.
+		 * If empty, only card headers and GCI files will be detected.
+		 * @param databases GCN file databases.
+		 */
+		void setDatabases(const QVector<GcnMcFileDb*> &databases);
+
+		/**
+		 * Get the scan alignment.
+		 * @return Scan alignment, in bytes.
+		 */
+		int alignment(void) const;
+
+		/**
+		 * Set the scan alignment.
+		 * Default is 8 KiB (one block). Smaller values can be
+		 * used to find data that isn't block-aligned, e.g. GCI
+		 * files stored in a filesystem dump.
+		 * @param alignment Scan alignment. (power of two; 64 to 8192)
+		 */
+		void setAlignment(int alignment);
+
+		/**
+		 * Get the chunk size.
+		 * @return Chunk size, in bytes.
+		 */
+		int chunkSize(void) const;
+
+		/**
+		 * Set the chunk size.
+		 * This is the amount of data read at once, which
+		 * determines the scanner's memory usage.
+		 * @param chunkSize Chunk size. (multiple of 8 KiB)
+		 */
+		void setChunkSize(int chunkSize);
+
+	public:
+		/** Scan functions. **/
+
+		/**
+		 * Scan an image of any size.
+		 * The image is read sequentially, so memory usage
+		 * is bounded by the chunk size.
+		 * @param device Opened device to scan. (QFile, CompressedFile, etc.)
+		 * @return Number of hits on success; negative on error.
+		 */
+		int scan(QIODevice *device);
+
+		/**
+		 * Scan an image of any size.
+		 * Asynchronous scan; uses a separate thread.
+		 * The scanner takes ownership of the device, and
+		 * deletes it once the scan thread has finished.
+		 * @param device Opened device to scan. (QFile, CompressedFile, etc.)
+		 * @return 0 if the thread was started; negative POSIX error code on error.
+		 *
+		 * The scan is completed when one of the following signals is emitted:
+		 * - scanFinished(): Scan has completed. Use hits() to get the hits.
+		 * - scanCancelled(): Scan was cancelled.
+		 * - scanError(): Scan failed due to an error.
+		 */
+		int scan_async(QIODevice *device);
+
+		/**
+		 * Is an asynchronous scan running?
+		 * @return True if the scan thread is running.
+		 */
+		bool isScanning(void) const;
+
+		/**
+		 * Cancel the current scan.
+		 * This can be called from any thread.
+		 */
+		void cancel(void);
+
+	private slots:
+		/**
+		 * The scan thread has finished.
+		 */
+		void scanThread_finished_slot(void);
+};
+
+#endif /* __MCRECOVER_DB_GCNIMAGESCANNER_HPP__ */
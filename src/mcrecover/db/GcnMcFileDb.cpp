@@ -35,6 +35,7 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QTextCodec>
 #include <QtCore/QVector>
@@ -62,6 +63,20 @@ class GcnMcFileDbPrivate
 		 */
 		QMap<uint32_t, QVector<GcnMcFileDef*>*> addr_file_defs;
 
+		/**
+		 * GCN memory card file definitions, indexed by ID6.
+		 * Used by addChecksumDefs().
+		 * - Key: ID6.
+		 * - Value: GcnMcFileDef*, in addr_file_defs order.
+		 * NOTE: The GcnMcFileDefs are owned by addr_file_defs.
+		 */
+		QHash<QString, QVector<GcnMcFileDef*> > id6_file_defs;
+
+		/**
+		 * Build the ID6 index from addr_file_defs.
+		 */
+		void buildId6Index(void);
+
 		/**
 		 * Convert a region character to a GcnMcFileDef::regions_t bitfield value.
 		 * @param regionChr Region character.
@@ -69,6 +84,25 @@ class GcnMcFileDbPrivate
 		 */
 		static uint8_t RegionCharToBitfield(QChar regionChr);
 
+		/**
+		 * Check if a regex is a plain "^text$" pattern.
+		 * @param pattern	[in] Regex pattern.
+		 * @param literal	[out] Literal text, if the pattern is plain.
+		 * @return True if the pattern is plain; false if not.
+		 */
+		static bool IsLiteralPattern(const QString &pattern, QString *literal);
+
+		/**
+		 * Check if a description matches a <search> description.
+		 * @param regex		[in] Regular expression.
+		 * @param isLiteral	[in] True if the regex is a plain "^text$" pattern.
+		 * @param literal	[in] Literal text.
+		 * @param desc		[in] Description.
+		 * @return True if the description matches; false if not.
+		 */
+		static inline bool DescMatches(const QRegularExpression &regex,
+			bool isLiteral, const QString &literal, const QString &desc);
+
 		/**
 		 * Clear the GCN Memory Card File database.
 		 * This clears addr_file_defs.
@@ -166,6 +200,57 @@ uint8_t GcnMcFileDbPrivate::RegionCharToBitfield(QChar regionChr)
 }
 
 
+/**
+ * Check if a regex is a plain "^text$" pattern.
+ * @param pattern	[in] Regex pattern.
+ * @param literal	[out] Literal text, if the pattern is plain.
+ * @return True if the pattern is plain; false if not.
+ */
+bool GcnMcFileDbPrivate::IsLiteralPattern(const QString &pattern, QString *literal)
+{
+	if (pattern.size() < 2 ||
+	    pattern.at(0) != QChar(L'^') ||
+	    pattern.at(pattern.size() - 1) != QChar(L'$'))
+	{
+		// Not anchored at both ends.
+		return false;
+	}
+
+	const QString text = pattern.mid(1, pattern.size() - 2);
+	static const char metaChars[] = "\\.^$|?*+()[]{}";
+	foreach (const QChar &chr, text) {
+		if (chr.unicode() < 0x80 && strchr(metaChars, (char)chr.unicode()) != nullptr) {
+			// Regex metacharacter.
+			return false;
+		}
+	}
+
+	*literal = text;
+	return true;
+}
+
+/**
+ * Check if a description matches a <search> description.
+ * @param regex		[in] Regular expression.
+ * @param isLiteral	[in] True if the regex is a plain "^text$" pattern.
+ * @param literal	[in] Literal text.
+ * @param desc		[in] Description.
+ * @return True if the description matches; false if not.
+ */
+inline bool GcnMcFileDbPrivate::DescMatches(const QRegularExpression &regex,
+	bool isLiteral, const QString &literal, const QString &desc)
+{
+	if (isLiteral) {
+		// NOTE: '$' also matches before a trailing newline.
+		const int len = literal.size();
+		return (desc.size() == len ||
+			(desc.size() == len + 1 && desc.at(len) == QChar(L'\n'))) &&
+			desc.startsWith(literal);
+	}
+
+	return regex.match(desc).hasMatch();
+}
+
 /**
  * Clear the GCN Memory Card File database.
  * This clears addr_file_defs.
@@ -182,6 +267,23 @@ void GcnMcFileDbPrivate::clear(void)
 	}
 
 	addr_file_defs.clear();
+	id6_file_defs.clear();
+}
+
+/**
+ * Build the ID6 index from addr_file_defs.
+ */
+void GcnMcFileDbPrivate::buildId6Index(void)
+{
+	// NOTE: addr_file_defs is sorted by address, so the
+	// candidates are checked in the same order as before.
+	id6_file_defs.clear();
+	foreach (const QVector<GcnMcFileDef*> *vec, addr_file_defs) {
+		foreach (GcnMcFileDef *gcnMcFileDef, *vec) {
+			const QString id6 = QLatin1String(gcnMcFileDef->id6, sizeof(gcnMcFileDef->id6));
+			id6_file_defs[id6].append(gcnMcFileDef);
+		}
+	}
 }
 
 
@@ -234,6 +336,7 @@ int GcnMcFileDbPrivate::load(const QString &filename)
 	}
 
 	// Database parsed successfully.
+	buildId6Index();
 	errorString = QString();
 	return 0;
 }
@@ -452,6 +555,12 @@ void GcnMcFileDbPrivate::parseXml_file_search(QXmlStreamReader &xml, GcnMcFileDe
 	gcnMcFileDef->search.gameDesc_regex.optimize();
 	gcnMcFileDef->search.fileDesc_regex.optimize();
 #endif /* QT_VERSION >= QT_VERSION_CHECK(5,4,0) */
+
+	// Check for plain descriptions.
+	gcnMcFileDef->search.gameDesc_isLiteral = IsLiteralPattern(
+		gcnMcFileDef->search.gameDesc, &gcnMcFileDef->search.gameDesc_literal);
+	gcnMcFileDef->search.fileDesc_isLiteral = IsLiteralPattern(
+		gcnMcFileDef->search.fileDesc, &gcnMcFileDef->search.fileDesc_literal);
 }
 
 
@@ -576,6 +685,10 @@ void GcnMcFileDbPrivate::parseXml_file_checksum(QXmlStreamReader &xml, GcnMcFile
 			break;
 	}
 
+	// Bind the checksum kernel now so it doesn't
+	// have to be looked up for every file.
+	Checksum::BindKernel(&checksumDef);
+
 	// Clamp instances to an upper limit of 2043.
 	// (Maximum number of blocks in a memory card.)
 	if (instances > 2043)
@@ -1125,38 +1238,37 @@ bool GcnMcFileDb::addChecksumDefs(GcnFile *file) const
 	const QString &gameDesc = desc[0];
 	const QString &fileDesc = desc[1];
 
-	// TODO: QHash<> with the game ID?
-	const QString gameID = file->gameID();
+	// Only check file definitions with the same game ID.
 	Q_D(const GcnMcFileDb);
-	foreach (QVector<GcnMcFileDef*>* vec, d->addr_file_defs) {
-		foreach (GcnMcFileDef* gcnMcFileDef, *vec) {
-			// Check if this file matches.
-			if (gameID != QLatin1String(gcnMcFileDef->id6, sizeof(gcnMcFileDef->id6))) {
-				// No match.
-				continue;
-			}
-
-			// Make sure the GameDesc matches.
-			QRegularExpressionMatch gameDescMatch =
-				gcnMcFileDef->search.gameDesc_regex.match(gameDesc);
-			if (!gameDescMatch.hasMatch()) {
-				// Not a match.
-				continue;
-			}
+	auto iter = d->id6_file_defs.constFind(file->gameID());
+	if (iter == d->id6_file_defs.cend()) {
+		// No file definitions for this game ID.
+		return false;
+	}
 
-			// Make sure the FileDesc matches.
-			QRegularExpressionMatch fileDescMatch =
-				gcnMcFileDef->search.fileDesc_regex.match(fileDesc);
-			if (!fileDescMatch.hasMatch()) {
-				// Not a match.
-				continue;
-			}
+	foreach (const GcnMcFileDef *gcnMcFileDef, *iter) {
+		// Make sure the GameDesc matches.
+		if (!GcnMcFileDbPrivate::DescMatches(gcnMcFileDef->search.gameDesc_regex,
+		    gcnMcFileDef->search.gameDesc_isLiteral,
+		    gcnMcFileDef->search.gameDesc_literal, gameDesc))
+		{
+			// Not a match.
+			continue;
+		}
 
-			// File matches.
-			// Copy the checksum definitions.
-			file->setChecksumDefs(gcnMcFileDef->checksumDefs);
-			return true;
+		// Make sure the FileDesc matches.
+		if (!GcnMcFileDbPrivate::DescMatches(gcnMcFileDef->search.fileDesc_regex,
+		    gcnMcFileDef->search.fileDesc_isLiteral,
+		    gcnMcFileDef->search.fileDesc_literal, fileDesc))
+		{
+			// Not a match.
+			continue;
 		}
+
+		// File matches.
+		// Copy the checksum definitions.
+		file->setChecksumDefs(gcnMcFileDef->checksumDefs);
+		return true;
 	}
 
 	// File information not found.
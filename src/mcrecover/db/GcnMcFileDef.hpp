@@ -67,6 +67,14 @@ class GcnMcFileDef {
 			// Regular expressions.
 			QRegularExpression gameDesc_regex;
 			QRegularExpression fileDesc_regex;
+
+			// Literal descriptions.
+			// Set if the regex is a plain "^text$" pattern,
+			// so it can be matched without the regex engine.
+			bool gameDesc_isLiteral;
+			bool fileDesc_isLiteral;
+			QString gameDesc_literal;
+			QString fileDesc_literal;
 		} search;
 
 		/**
@@ -102,6 +110,8 @@ class GcnMcFileDef {
 			memset(id6, 0, sizeof(id6));
 
 			search.address = 0;
+			search.gameDesc_isLiteral = false;
+			search.fileDesc_isLiteral = false;
 
 			dirEntry.bannerFormat = 0;
 			dirEntry.iconAddress = 0;
@@ -16,11 +16,13 @@
 
 // Checksum algorithm class.
 #include "Checksum.hpp"
+#include "BlockHealth.hpp"
 
 // C includes. (C++ namespace)
 #include <cstdio>
 
 // C++ includes.
+#include <algorithm>
 #include <limits>
 #include <memory>
 using std::list;
@@ -266,27 +268,29 @@ int GcnSearchWorker::searchMemCard(void)
 	QVector<uint16_t> blockSearchList;
 	const int totalPhysBlocks = d->card->totalPhysBlocks();
 
-	// Used block map.
-	QVector<uint8_t> usedBlockMap;
+	// Block allocation map.
+	// NOTE: This is implicitly shared with the card.
+	// It's only detached when blocks are marked as used.
+	BlockMap blockMap;
 	if (!d->searchUsedBlocks) {
 		// Only search empty blocks.
-		usedBlockMap = d->card->usedBlockMap();
+		blockMap = d->card->blockMap();
 
 		// Put together a block search list.
-		blockSearchList.reserve(totalPhysBlocks - d->card->freeBlocks() - 5);
-		for (int i = (usedBlockMap.size() - 1); i >= 5; i--) {
-			if (usedBlockMap[i] == 0) {
-				blockSearchList.append((uint16_t)i);
-			}
+		// Blocks are searched from the end of the card.
+		blockSearchList.reserve(blockMap.freeCount());
+		for (int i = blockMap.nextFree(5); i >= 0; i = blockMap.nextFree(i + 1)) {
+			blockSearchList.append((uint16_t)i);
 		}
+		std::reverse(blockSearchList.begin(), blockSearchList.end());
 	} else {
 		// Search through all blocks.
 		// TODO: Mark system blocks as used?
-		usedBlockMap = QVector<uint8_t>(totalPhysBlocks, 0);
+		blockMap.reset(totalPhysBlocks);
 
 		// Put together a block search list.
 		blockSearchList.reserve(totalPhysBlocks - 5);
-		for (int i = (usedBlockMap.size() - 1); i >= 5; i--) {
+		for (int i = (totalPhysBlocks - 1); i >= 5; i--) {
 			blockSearchList.append((uint16_t)i);
 		}
 	}
@@ -324,6 +328,13 @@ int GcnSearchWorker::searchMemCard(void)
 			continue;
 		}
 
+		// Skip blocks that are filled with a single byte.
+		// These are usually erased blocks, which won't match a database entry.
+		// (GcnMcFileDbTest checks this for the included databases.)
+		if (BlockHealth::IsUniform(buf.get(), blockSize)) {
+			continue;
+		}
+
 		// Check the block in the databases.
 		QVector<GcnSearchData> searchDataEntries;
 		foreach (GcnMcFileDb *db, d->databases) {
@@ -385,39 +396,36 @@ int GcnSearchWorker::searchMemCard(void)
 
 			// First block is always valid.
 			searchData.fatEntries.append(searchData.dirEntry.block);
-			if (usedBlockMap[searchData.dirEntry.block] < std::numeric_limits<uint8_t>::max())
-				usedBlockMap[searchData.dirEntry.block]++;
+			blockMap.markUsed(searchData.dirEntry.block);
 
 			uint16_t blocksRemaining = (searchData.dirEntry.length - 1);
-			uint16_t block = (searchData.dirEntry.block + 1);
+			int block = (searchData.dirEntry.block + 1);
 			bool wasWrapped = false;
 
 			// Skip used blocks and go after empty blocks only.
 			while (blocksRemaining > 0) {
-				if (block >= totalPhysBlocks) {
+				const int nextFree = blockMap.nextFree(block);
+				if (wasWrapped && (nextFree < 0 || nextFree >= searchData.dirEntry.block)) {
+					// ERROR: We wrapped around!
+					// Use the "naive" algorithm after the last valid block.
+					break;
+				} else if (nextFree < 0) {
 					// Wraparound.
 					// Do NOT mark the wrapped blocks as used,
 					// since they might be used by actual files.
 					block = 5;
 					wasWrapped = true;
 					continue;
-				} else if (block == searchData.dirEntry.block) {
-					// ERROR: We wrapped around!
-					// Use the "naive" algorithm after the last valid block.
-					break;
 				}
 
-				// Check if this block is used.
-				if (usedBlockMap[block] == 0) {
-					// Block is not used.
-					searchData.fatEntries.append(block);
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-					blocksRemaining--;
-				}
+				// Block is not used.
+				searchData.fatEntries.append((uint16_t)nextFree);
+				if (!wasWrapped)
+					blockMap.markUsed(nextFree);
+				blocksRemaining--;
 
 				// Next block.
-				block++;
+				block = nextFree + 1;
 			}
 
 			// Naive block algorithm for the remaining blocks.
@@ -433,11 +441,9 @@ int GcnSearchWorker::searchMemCard(void)
 				}
 
 				// Add this block.
-				searchData.fatEntries.append(block);
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max()) {
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-				}
+				searchData.fatEntries.append((uint16_t)block);
+				if (!wasWrapped)
+					blockMap.markUsed(block);
 				block++;
 				blocksRemaining--;
 			}
@@ -9,6 +9,7 @@
 #include "mcrecover.hpp"
 
 #include "windows/McRecoverWindow.hpp"
+#include "SnapshotCli.hpp"
 
 // C includes.
 #include <stdio.h>
@@ -26,6 +27,11 @@
  */
 int mcrecover_main(int argc, char *argv[])
 {
+	// Snapshot commands don't use the GUI.
+	if (SnapshotCli::isSnapshotCommand(argc, argv)) {
+		return SnapshotCli::exec(argc, argv);
+	}
+
 	// Enable High DPI.
 	McRecoverQApplication::setAttribute(Qt::AA_UseHighDpiPixmaps, true);
 #if QT_VERSION >= 0x050600
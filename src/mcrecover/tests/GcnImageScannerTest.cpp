@@ -0,0 +1,220 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [mcrecover/tests]                 *
+ * GcnImageScannerTest.cpp: GcnImageScanner tests.                         *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "db/GcnImageScanner.hpp"
+
+// libgctools
+#include "card.h"
+#include "util/byteswap.h"
+#include "Checksum.hpp"
+
+// C includes.
+#include <string.h>
+
+// Qt includes.
+#include <QtCore/QBuffer>
+#include <QtCore/QByteArray>
+
+namespace McRecover { namespace Tests {
+
+class GcnImageScannerTest : public ::testing::Test
+{
+	protected:
+		GcnImageScannerTest() { }
+
+	public:
+		/**
+		 * Write a GCN memory card header.
+		 * @param image Image.
+		 * @param offset Offset of the header.
+		 * @param sizeMbit Card size, in megabits.
+		 */
+		static void writeCardHeader(QByteArray &image, int offset, uint16_t sizeMbit);
+
+		/**
+		 * Write a GCI directory entry.
+		 * @param image Image.
+		 * @param offset Offset of the directory entry.
+		 * @param length File length, in blocks.
+		 */
+		static void writeGciDirEntry(QByteArray &image, int offset, uint16_t length);
+
+		/**
+		 * Scan an image.
+		 * @param image Image.
+		 * @param hits Hits.
+		 * @return Number of hits on success; negative on error.
+		 */
+		static int scan(const QByteArray &image, QVector<GcnScanHit> &hits);
+
+		// GCN block size.
+		static const int BLOCK_SIZE = 8192;
+		// Scan alignment and chunk size.
+		// The image is read (CHUNK_SIZE + BLOCK_SIZE) bytes at a time.
+		static const int ALIGNMENT = 64;
+		static const int CHUNK_SIZE = BLOCK_SIZE * 2;
+		static const int FIRST_READ = CHUNK_SIZE + BLOCK_SIZE;
+		// Image size. (several chunks)
+		static const int IMAGE_SIZE = BLOCK_SIZE * 12;
+};
+
+/**
+ * Write a GCN memory card header.
+ * @param image Image.
+ * @param offset Offset of the header.
+ * @param sizeMbit Card size, in megabits.
+ */
+void GcnImageScannerTest::writeCardHeader(QByteArray &image, int offset, uint16_t sizeMbit)
+{
+	card_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.serial, "mcrecovertst", sizeof(hdr.serial));
+	hdr.size = cpu_to_be16(sizeMbit);
+
+	const uint32_t chk = Checksum::AddInvDual16(
+		reinterpret_cast<const uint16_t*>(&hdr), 0x1FC, Checksum::CHKENDIAN_BIG);
+	hdr.chksum1 = cpu_to_be16((uint16_t)(chk >> 16));
+	hdr.chksum2 = cpu_to_be16((uint16_t)(chk & 0xFFFF));
+	memcpy(image.data() + offset, &hdr, sizeof(hdr));
+}
+
+/**
+ * Write a GCI directory entry.
+ * @param image Image.
+ * @param offset Offset of the directory entry.
+ * @param length File length, in blocks.
+ */
+void GcnImageScannerTest::writeGciDirEntry(QByteArray &image, int offset, uint16_t length)
+{
+	card_direntry dirEntry;
+	memset(&dirEntry, 0, sizeof(dirEntry));
+	memcpy(dirEntry.gamecode, "GMCE", sizeof(dirEntry.gamecode));
+	memcpy(dirEntry.company, "01", sizeof(dirEntry.company));
+	dirEntry.pad_00 = 0xFF;
+	strcpy(dirEntry.filename, "mcrecover-test");
+	dirEntry.lastmodified = cpu_to_be32(0x12345678);
+	dirEntry.iconaddr = cpu_to_be32(0xFFFFFFFF);
+	dirEntry.block = cpu_to_be16(5);
+	dirEntry.length = cpu_to_be16(length);
+	dirEntry.pad_01 = 0xFFFF;
+	dirEntry.commentaddr = cpu_to_be32(0x40);
+	memcpy(image.data() + offset, &dirEntry, sizeof(dirEntry));
+}
+
+/**
+ * Scan an image.
+ * @param image Image.
+ * @param hits Hits.
+ * @return Number of hits on success; negative on error.
+ */
+int GcnImageScannerTest::scan(const QByteArray &image, QVector<GcnScanHit> &hits)
+{
+	GcnImageScanner scanner;
+	scanner.setAlignment(ALIGNMENT);
+	scanner.setChunkSize(CHUNK_SIZE);
+
+	QBuffer buffer;
+	buffer.setData(image);
+	if (!buffer.open(QIODevice::ReadOnly))
+		return -1;
+
+	const int ret = scanner.scan(&buffer);
+	hits = scanner.hits();
+	return ret;
+}
+
+/**
+ * Card headers at sub-block offsets, including
+ * headers that span the end of the first read.
+ */
+TEST_F(GcnImageScannerTest, cardHeaderOffsets)
+{
+	for (int offset = FIRST_READ - BLOCK_SIZE - ALIGNMENT;
+	     offset <= FIRST_READ + ALIGNMENT; offset += ALIGNMENT)
+	{
+		QByteArray image(IMAGE_SIZE, 0);
+		writeCardHeader(image, offset, 16);
+
+		QVector<GcnScanHit> hits;
+		ASSERT_EQ(1, scan(image, hits)) << "offset == " << offset;
+		EXPECT_EQ(GcnScanHit::Type::CardHeader, hits[0].type) << "offset == " << offset;
+		EXPECT_EQ(offset, hits[0].offset);
+		EXPECT_EQ(16 * 16, hits[0].cardBlocks) << "offset == " << offset;
+		EXPECT_EQ((qint64)16 * 16 * BLOCK_SIZE, hits[0].length) << "offset == " << offset;
+	}
+}
+
+/**
+ * GCI directory entries at sub-block offsets, including
+ * entries whose data spans the end of the first read.
+ */
+TEST_F(GcnImageScannerTest, gciDirEntryOffsets)
+{
+	for (int offset = FIRST_READ - BLOCK_SIZE - ALIGNMENT;
+	     offset <= FIRST_READ + ALIGNMENT; offset += ALIGNMENT)
+	{
+		QByteArray image(IMAGE_SIZE, 0);
+		writeGciDirEntry(image, offset, 2);
+
+		QVector<GcnScanHit> hits;
+		ASSERT_EQ(1, scan(image, hits)) << "offset == " << offset;
+		EXPECT_EQ(GcnScanHit::Type::GciFile, hits[0].type) << "offset == " << offset;
+		EXPECT_EQ(offset, hits[0].offset);
+		EXPECT_EQ((qint64)sizeof(card_direntry) + (2 * BLOCK_SIZE), hits[0].length)
+			<< "offset == " << offset;
+
+		// The directory entry is returned in host-endian.
+		const card_direntry &dirEntry = hits[0].searchData.dirEntry;
+		EXPECT_EQ(0, memcmp(dirEntry.gamecode, "GMCE", 4));
+		EXPECT_EQ(0, memcmp(dirEntry.company, "01", 2));
+		EXPECT_STREQ("mcrecover-test", dirEntry.filename);
+		EXPECT_EQ(0x12345678U, dirEntry.lastmodified);
+		EXPECT_EQ(5, dirEntry.block);
+		EXPECT_EQ(2, dirEntry.length);
+		EXPECT_EQ(0x40U, dirEntry.commentaddr);
+	}
+}
+
+/**
+ * A card header and GCI files in one image, in several chunks.
+ * Hits are sorted by offset.
+ */
+TEST_F(GcnImageScannerTest, mixedImage)
+{
+	// Card header in the first block, at a non-zero offset.
+	// GCI file spanning the end of the first read.
+	// GCI file near the end of the image, whose data doesn't fit. (ignored)
+	// GCI file in the last chunk that does fit.
+	static const int hdrOffset = 0x0C0;
+	static const int gci1Offset = FIRST_READ - 0x100;
+	static const int gci2Offset = IMAGE_SIZE - BLOCK_SIZE;
+	static const int gci3Offset = IMAGE_SIZE - (BLOCK_SIZE * 3) + 0x1C0;
+
+	QByteArray image(IMAGE_SIZE, 0);
+	writeCardHeader(image, hdrOffset, 4);
+	writeGciDirEntry(image, gci1Offset, 1);
+	writeGciDirEntry(image, gci2Offset, 1);
+	writeGciDirEntry(image, gci3Offset, 1);
+
+	QVector<GcnScanHit> hits;
+	ASSERT_EQ(3, scan(image, hits));
+
+	EXPECT_EQ(GcnScanHit::Type::CardHeader, hits[0].type);
+	EXPECT_EQ(hdrOffset, hits[0].offset);
+	EXPECT_EQ(4 * 16, hits[0].cardBlocks);
+
+	EXPECT_EQ(GcnScanHit::Type::GciFile, hits[1].type);
+	EXPECT_EQ(gci1Offset, hits[1].offset);
+	EXPECT_EQ(GcnScanHit::Type::GciFile, hits[2].type);
+	EXPECT_EQ(gci3Offset, hits[2].offset);
+}
+
+} }
@@ -0,0 +1,63 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [mcrecover/tests]                 *
+ * GcnMcFileDbTest.cpp: GcnMcFileDb tests.                                 *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+// Google Test
+#include "gtest/gtest.h"
+
+#include "db/GcnMcFileDb.hpp"
+
+// C includes.
+#include <string.h>
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QDir>
+#include <QtCore/QStringList>
+
+namespace McRecover { namespace Tests {
+
+class GcnMcFileDbTest : public ::testing::Test
+{
+	protected:
+		GcnMcFileDbTest() { }
+
+	public:
+		// GCN block size.
+		static const int BLOCK_SIZE = 8192;
+};
+
+/**
+ * No database entry can match a block that's filled with
+ * a single byte value.
+ *
+ * GcnSearchWorker skips uniform blocks without checking them
+ * in the databases, so this must hold for every shipped database.
+ */
+TEST_F(GcnMcFileDbTest, uniformBlocksDontMatch)
+{
+	const QDir dataDir(QLatin1String(MCRECOVER_TESTS_DATA_DIR));
+	const QStringList filenames = dataDir.entryList(
+		QStringList(QLatin1String("GcnMcFileDb.*.xml")), QDir::Files, QDir::Name);
+	ASSERT_FALSE(filenames.isEmpty()) << "No databases in " MCRECOVER_TESTS_DATA_DIR;
+
+	QByteArray block(BLOCK_SIZE, 0);
+	foreach (const QString &filename, filenames) {
+		GcnMcFileDb db;
+		ASSERT_EQ(0, db.load(dataDir.filePath(filename)))
+			<< filename.toUtf8().constData() << ": "
+			<< db.errorString().toUtf8().constData();
+
+		for (int fill = 0; fill <= 0xFF; fill++) {
+			memset(block.data(), fill, block.size());
+			EXPECT_TRUE(db.checkBlock(block.constData(), block.size()).isEmpty())
+				<< filename.toUtf8().constData() << ": fill == " << fill;
+		}
+	}
+}
+
+} }
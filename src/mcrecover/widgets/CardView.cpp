@@ -23,6 +23,7 @@ using std::string;
 using std::vector;
 
 // Qt includes.
+#include <QtGui/QImage>
 #include <QtGui/QPainter>
 
 /** CardViewPrivate **/
@@ -61,6 +62,24 @@ class CardViewPrivate
 		 * Update the block count display.
 		 */
 		void updateBlockCountDisplay(void);
+
+		/**
+		 * Update the block health summary.
+		 * The blocks are analyzed in the background, so this
+		 * is called again when the card's block health changes.
+		 */
+		void updateBlockHealthDisplay(void);
+
+		// Damage map layout.
+		static const int DAMAGE_MAP_COLUMNS = 64;
+		static const int DAMAGE_MAP_CELL_SIZE = 2;
+
+		/**
+		 * Get the damage map color for a block.
+		 * @param flags Block health flags.
+		 * @return Damage map color.
+		 */
+		static QRgb damageMapColor(uint32_t flags);
 };
 
 CardViewPrivate::CardViewPrivate(CardView *q)
@@ -83,6 +102,9 @@ void CardViewPrivate::updateBlockCountDisplay(void)
 			.arg(totalUserBlocks)
 			.arg(card->freeBlocks()));
 
+	// Block health summary.
+	updateBlockHealthDisplay();
+
 	// Free Block count status.
 	// TODO: Check if the card supports this.
 	if (card->isFreeBlockCountValid(card->activeBatIdx())) {
@@ -99,6 +121,90 @@ void CardViewPrivate::updateBlockCountDisplay(void)
 	}
 }
 
+/**
+ * Get the damage map color for a block.
+ * @param flags Block health flags.
+ * @return Damage map color.
+ */
+QRgb CardViewPrivate::damageMapColor(uint32_t flags)
+{
+	if (flags & BlockHealth::BHF_UNREADABLE)
+		return qRgb(0xFF, 0x00, 0x00);	// Red
+	else if (flags & BlockHealth::BHF_CHECKSUM_BAD)
+		return qRgb(0xFF, 0xA0, 0x00);	// Orange
+	else if (flags & BlockHealth::BHF_CHECKSUM_GOOD)
+		return qRgb(0x00, 0xC0, 0x00);	// Green
+	else if (flags & BlockHealth::BHF_USED)
+		return qRgb(0x40, 0x80, 0xFF);	// Blue
+	else if (flags & BlockHealth::BHF_UNIFORM)
+		return qRgb(0xD0, 0xD0, 0xD0);	// Light gray
+
+	// Free block with data.
+	// This may be a deleted file.
+	return qRgb(0x60, 0x60, 0x60);		// Dark gray
+}
+
+/**
+ * Update the block health summary.
+ * The blocks are analyzed in the background, so this
+ * is called again when the card's block health changes.
+ */
+void CardViewPrivate::updateBlockHealthDisplay(void)
+{
+	const QVector<BlockHealth::Info> health = card->blockHealth();
+	if (health.isEmpty()) {
+		// Not analyzed yet.
+		ui.lblBlockCount->setToolTip(QString());
+		ui.lblDamageMap->clear();
+		ui.lblDamageMap->setToolTip(QString());
+		ui.lblDamageMap->setVisible(false);
+		return;
+	}
+
+	// Damage map: one cell per block, in rows of DAMAGE_MAP_COLUMNS.
+	// Blocks past the end of the card are left transparent.
+	const int rows = (health.size() + DAMAGE_MAP_COLUMNS - 1) / DAMAGE_MAP_COLUMNS;
+	QImage img(DAMAGE_MAP_COLUMNS, rows, QImage::Format_ARGB32);
+	img.fill(Qt::transparent);
+	for (int i = 0; i < health.size(); i++) {
+		img.setPixel(i % DAMAGE_MAP_COLUMNS, i / DAMAGE_MAP_COLUMNS,
+			damageMapColor(health[i].flags));
+	}
+	ui.lblDamageMap->setPixmap(QPixmap::fromImage(
+		img.scaled(DAMAGE_MAP_COLUMNS * DAMAGE_MAP_CELL_SIZE,
+			   rows * DAMAGE_MAP_CELL_SIZE,
+			   Qt::IgnoreAspectRatio, Qt::FastTransformation)));
+	ui.lblDamageMap->setVisible(true);
+
+	int blankBlocks = 0, badBlocks = 0, unreadableBlocks = 0;
+	foreach (const BlockHealth::Info &info, health) {
+		if (info.flags & BlockHealth::BHF_UNIFORM)
+			blankBlocks++;
+		if (info.flags & BlockHealth::BHF_CHECKSUM_BAD)
+			badBlocks++;
+		if (info.flags & BlockHealth::BHF_UNREADABLE)
+			unreadableBlocks++;
+	}
+
+	QString toolTip = CardView::tr("%Ln blank block(s)", "", blankBlocks) + QChar(L'\n') +
+		CardView::tr("%Ln block(s) in files with invalid checksums", "", badBlocks);
+	if (unreadableBlocks > 0) {
+		toolTip += QChar(L'\n') +
+			CardView::tr("%Ln unreadable block(s)", "", unreadableBlocks);
+	}
+	ui.lblBlockCount->setToolTip(toolTip);
+
+	ui.lblDamageMap->setToolTip(
+		CardView::tr("Damage map:") + QChar(L'\n') +
+		CardView::tr("Red: unreadable") + QChar(L'\n') +
+		CardView::tr("Orange: file with an invalid checksum") + QChar(L'\n') +
+		CardView::tr("Green: file with a valid checksum") + QChar(L'\n') +
+		CardView::tr("Blue: file without a checksum") + QChar(L'\n') +
+		CardView::tr("Dark gray: free block with data") + QChar(L'\n') +
+		CardView::tr("Light gray: blank") + QChar(L'\n') + QChar(L'\n') +
+		toolTip);
+}
+
 /**
  * Update the widget display.
  */
@@ -115,6 +221,8 @@ void CardViewPrivate::updateWidgetDisplay(void)
 		ui.lblCardHeaderStatus->setVisible(false);
 		ui.lblBlockCount->setVisible(false);
 		ui.lblFreeBlockStatus->setVisible(false);
+		ui.lblDamageMap->clear();
+		ui.lblDamageMap->setVisible(false);
 		ui.lblFormatTimeTitle->setVisible(false);
 		ui.lblFormatTime->setVisible(false);
 		ui.lblEncodingTitle->setVisible(false);
@@ -336,6 +444,8 @@ void CardView::setCard(Card *card)
 			   this, &CardView::card_destroyed_slot);
 		disconnect(d->card, &Card::blockCountChanged,
 			   this, &CardView::card_blockCountChanged_slot);
+		disconnect(d->card, &Card::blockHealthChanged,
+			   this, &CardView::card_blockHealthChanged_slot);
 		disconnect(d->card, &Card::colorChanged,
 			   this, &CardView::card_colorChanged_slot);
 	}
@@ -348,6 +458,8 @@ void CardView::setCard(Card *card)
 			this, &CardView::card_destroyed_slot);
 		connect(d->card, &Card::blockCountChanged,
 			this, &CardView::card_blockCountChanged_slot);
+		connect(d->card, &Card::blockHealthChanged,
+			this, &CardView::card_blockHealthChanged_slot);
 		connect(d->card, &Card::colorChanged,
 			this, &CardView::card_colorChanged_slot);
 	}
@@ -444,6 +556,17 @@ void CardView::card_blockCountChanged_slot(void)
 	d->updateBlockCountDisplay();
 }
 
+/**
+ * Card's block health has changed.
+ */
+void CardView::card_blockHealthChanged_slot(void)
+{
+	Q_D(CardView);
+	if (d->card) {
+		d->updateBlockHealthDisplay();
+	}
+}
+
 /**
  * Card's color has changed.
  * @param color New color.
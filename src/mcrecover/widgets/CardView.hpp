@@ -63,6 +63,11 @@ class CardView : public QWidget
 		 */
 		void card_blockCountChanged_slot(void);
 
+		/**
+		 * Card's block health has changed.
+		 */
+		void card_blockHealthChanged_slot(void);
+
 		/**
 		 * Card's color has changed.
 		 * @param color New color.
@@ -58,6 +58,12 @@ class FileViewPrivate
 		 */
 		void updateWidgetDisplay(void);
 
+		/**
+		 * Update the checksum display.
+		 * NOTE: file must not be nullptr.
+		 */
+		void updateChecksumDisplay(void);
+
 		/**
 		 * Update the animation timer state.
 		 * Starts the timer if animated icons are present; stops the timer if not.
@@ -155,6 +161,16 @@ void FileViewPrivate::updateWidgetDisplay(void)
 	ui.lblMode->setText(file->modeAsString());
 	ui.lblMode->setVisible(true);
 
+	// Checksum.
+	updateChecksumDisplay();
+}
+
+/**
+ * Update the checksum display.
+ * NOTE: file must not be nullptr.
+ */
+void FileViewPrivate::updateChecksumDisplay(void)
+{
 	// Checksum algorithm is always visible.
 	ui.lblChecksumAlgorithmTitle->setVisible(true);
 	ui.lblChecksumAlgorithm->setVisible(true);
@@ -279,6 +295,8 @@ void FileView::setFile(const File *file)
 	if (d->file) {
 		disconnect(d->file, &QObject::destroyed,
 			   this, &FileView::file_destroyed_slot);
+		disconnect(d->file, &File::checksumChanged,
+			   this, &FileView::file_checksumChanged_slot);
 	}
 
 	d->file = file;
@@ -287,6 +305,8 @@ void FileView::setFile(const File *file)
 	if (d->file) {
 		connect(d->file, &QObject::destroyed,
 			this, &FileView::file_destroyed_slot);
+		connect(d->file, &File::checksumChanged,
+			this, &FileView::file_checksumChanged_slot);
 	}
 
 	// Update the widget display.
@@ -364,6 +384,16 @@ void FileView::file_destroyed_slot(QObject *obj)
 	}
 }
 
+/**
+ * The File's checksum values have changed.
+ */
+void FileView::file_checksumChanged_slot(void)
+{
+	Q_D(FileView);
+	if (d->file) {
+		d->updateChecksumDisplay();
+	}
+}
 
 /**
  * Animation timer slot.
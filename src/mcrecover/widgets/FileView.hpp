@@ -72,6 +72,11 @@ class FileView : public QWidget
 		 */
 		void file_destroyed_slot(QObject *obj = 0);
 
+		/**
+		 * The File's checksum values have changed.
+		 */
+		void file_checksumChanged_slot(void);
+
 		/**
 		 * Animation timer slot.
 		 */
@@ -377,6 +377,26 @@ void StatusBarManager::opened(const QString &filename, const QString &productNam
 	d->tmrHideProgressBar.stop();
 }
 
+/**
+ * A memory card image is being opened asynchronously.
+ * @param current Current step.
+ * @param total Total number of steps.
+ */
+void StatusBarManager::openProgress(int current, int total)
+{
+	Q_D(StatusBarManager);
+	d->scanning = false;
+	d->currentSearchBlock = current;
+	d->totalSearchBlocks = total;
+	d->lastStatusMessage = tr("Loading memory card image...");
+	if (d->progressBar)
+		d->progressBar->setVisible(true);
+	d->updateStatusBar();
+
+	// Stop the Hide Progress Bar timer.
+	d->tmrHideProgressBar.stop();
+}
+
 /**
  * The current memory card image was closed.
  * @param productName Product name of the memory card.
@@ -411,6 +431,24 @@ void StatusBarManager::filesSaved(int n, const QString &path)
 	d->tmrHideProgressBar.stop();
 }
 
+/**
+ * A memory card image was rebuilt.
+ * @param n Number of files written.
+ * @param filename Filename of the new image.
+ */
+void StatusBarManager::cardRebuilt(int n, const QString &filename)
+{
+	Q_D(StatusBarManager);
+	d->scanning = false;
+	d->progressBar->setVisible(false);
+	d->lastStatusMessage = tr("%Ln file(s) written to %1.", "", n)
+				.arg(QDir::toNativeSeparators(filename));
+	d->updateStatusBar();
+
+	// Stop the Hide Progress Bar timer.
+	d->tmrHideProgressBar.stop();
+}
+
 /** Private Slots. **/
 
 /**
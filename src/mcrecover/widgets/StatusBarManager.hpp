@@ -84,6 +84,13 @@ class StatusBarManager : public QObject
 		 */
 		void opened(const QString &filename, const QString &productName);
 
+		/**
+		 * A memory card image is being opened asynchronously.
+		 * @param current Current step.
+		 * @param total Total number of steps.
+		 */
+		void openProgress(int current, int total);
+
 		/**
 		 * The current memory card image was closed.
 		 * @param productName Product name of the memory card.
@@ -97,6 +104,13 @@ class StatusBarManager : public QObject
 		 */
 		void filesSaved(int n, const QString &path);
 
+		/**
+		 * A memory card image was rebuilt.
+		 * @param n Number of files written.
+		 * @param filename Filename of the new image.
+		 */
+		void cardRebuilt(int n, const QString &filename);
+
 	private slots:
 		/**
 		 * An object has been destroyed.
@@ -27,12 +27,19 @@
 // VmuCard
 #include "libmemcard/VmuCard.hpp"
 
+// Compressed card images.
+#include "libmemcard/CardDiff.hpp"
+#include "libmemcard/CompressedFile.hpp"
+#include "libmemcard/DumpConsensus.hpp"
+#include "libmemcard/SnapshotStore.hpp"
+
 // File database.
 #include "db/GcnMcFileDb.hpp"
 #include "db/GcnCheckFiles.hpp"
 
 // Search classes.
 #include "db/GcnSearchThread.hpp"
+#include "db/GcnImageScanner.hpp"
 #include "widgets/StatusBarManager.hpp"
 
 // Taskbar Button Manager.
@@ -43,6 +50,8 @@
 #endif /* Q_OS_WIN */
 
 // C includes. (C++ namespace)
+#include <cerrno>
+#include <climits>
 #include <cstdio>
 #include <cassert>
 
@@ -56,18 +65,24 @@ using std::vector;
 #include <QtCore/QStack>
 #include <QtCore/QVector>
 #include <QtCore/QFile>
+#include <QtCore/QScopedPointer>
 #include <QtCore/QSignalMapper>
 #include <QtCore/QLocale>
 #include <QtCore/QTextCodec>
 #include <QtCore/QMimeData>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
 #include <QtGui/QDragEnterEvent>
 #include <QtGui/QDropEvent>
 #include <QAction>
 #include <QActionGroup>
 #include <QCheckBox>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QLabel>
+#include <QLineEdit>
 #include <QMessageBox>
+#include <QProgressDialog>
 #include <QToolBar>
 
 // GcImageWriter.
@@ -80,6 +95,39 @@ using std::vector;
 // Shh... it's a secret to everybody.
 #include "sekrit/HerpDerpEggListener.hpp"
 
+/**
+ * Worker thread for building a consensus image.
+ * Progress is polled with DumpConsensus::blocksDone().
+ */
+class DumpConsensusThread : public QThread
+{
+	typedef QThread super;
+
+	public:
+		DumpConsensusThread(const QStringList &dumps, const QString &outFilename, QObject *parent)
+			: super(parent)
+			, dumps(dumps)
+			, outFilename(outFilename)
+			, ret(0)
+		{
+			consensus.setGcnChecksums(true);
+		}
+
+	protected:
+		void run(void) final
+		{
+			ret = consensus.build(dumps, outFilename);
+		}
+
+	public:
+		const QStringList dumps;
+		const QString outFilename;
+		DumpConsensus consensus;
+		int ret;	// build() return value; valid once finished.
+	private:
+		Q_DISABLE_COPY(DumpConsensusThread)
+};
+
 /** McRecoverWindowPrivate **/
 
 #include "ui_McRecoverWindow.h"
@@ -125,6 +173,39 @@ class McRecoverWindowPrivate
 		// Search thread.
 		GcnSearchThread *searchThread;
 
+		// Raw image scanner.
+		// Only valid while a raw image is being scanned.
+		GcnImageScanner *imageScanner;
+		QString imageScanFilename;
+
+		/**
+		 * Get a display name for a directory entry found by the raw image scanner.
+		 * @param dirEntry Directory entry.
+		 * @return Display name, e.g. "GALE01/SuperSmashBros0110290334".
+		 */
+		static QString scanHitName(const card_direntry &dirEntry);
+
+		// Progress dialog for long-running tasks.
+		// Only valid while a task is running.
+		QProgressDialog *progressDialog;
+
+		/**
+		 * Show the progress dialog for a long-running task.
+		 * The dialog's Cancel button calls progressDialog_canceled_slot().
+		 * @param labelText Label text.
+		 */
+		void showProgressDialog(const QString &labelText);
+
+		/**
+		 * Close the progress dialog.
+		 */
+		void closeProgressDialog(void);
+
+		// Consensus thread.
+		// Only valid while a consensus image is being built.
+		DumpConsensusThread *consensusThread;
+		QTimer *consensusTimer;	// Updates the progress dialog.
+
 		/**
 		 * Initialize the toolbar.
 		 */
@@ -140,6 +221,20 @@ class McRecoverWindowPrivate
 		 */
 		void updateActionEnableStatus(void);
 
+		/**
+		 * Finish opening the memory card image.
+		 * This checks file checksums, shows card errors,
+		 * and updates the UI.
+		 */
+		void cardOpened(void);
+
+		/**
+		 * Show an error message for a card that couldn't be opened.
+		 * @param filename Memory Card image filename.
+		 * @param className Card class name, used if the card has no error string.
+		 */
+		void showOpenError(const QString &filename, const QString &className);
+
 		// Status Bar Manager.
 		StatusBarManager *statusBarManager;
 
@@ -197,6 +292,28 @@ class McRecoverWindowPrivate
 		 */
 		void setLastPath(const QString &path);
 
+		/**
+		 * Open the snapshot store.
+		 * The user is prompted for the store directory.
+		 * @return Snapshot store, or nullptr if cancelled or on error. (caller must delete it)
+		 */
+		SnapshotStore *openSnapshotStore(void);
+
+		/**
+		 * Prompt the user to select a snapshot.
+		 * @param store Snapshot store.
+		 * @param title Dialog title.
+		 * @return Snapshot ID, or empty string if cancelled.
+		 */
+		QString selectSnapshot(const SnapshotStore *store, const QString &title);
+
+		/**
+		 * Show a snapshot store error.
+		 * @param store Snapshot store.
+		 * @param ret Error code. (negative POSIX error code)
+		 */
+		void showSnapshotError(const SnapshotStore *store, int ret);
+
 		/**
 		 * Get the animated icon format to use.
 		 * @return Animated icon format to use.
@@ -235,6 +352,10 @@ McRecoverWindowPrivate::McRecoverWindowPrivate(McRecoverWindow *q)
 	, proxyModel(new MemCardSortFilterProxyModel(q))
 	, cols_init(false)
 	, searchThread(new GcnSearchThread(q))
+	, imageScanner(nullptr)
+	, progressDialog(nullptr)
+	, consensusThread(nullptr)
+	, consensusTimer(nullptr)
 	, statusBarManager(nullptr)
 	, uiBusyCounter(0)
 	, preferredRegion(0)
@@ -298,6 +419,13 @@ McRecoverWindowPrivate::~McRecoverWindowPrivate()
 
 	// TODO: Wait for searchThread to finish?
 	delete searchThread;
+
+	if (consensusThread) {
+		// Stop the consensus thread.
+		consensusThread->consensus.cancel();
+		consensusThread->wait();
+		delete consensusThread;
+	}
 	delete taskbarButtonManager;
 }
 
@@ -325,6 +453,59 @@ QString McRecoverWindowPrivate::formatFileSize(quint64 size)
 		return McRecoverWindow::tr("%L1 EiB").arg(size >> 60);
 }
 
+/**
+ * Get a display name for a directory entry found by the raw image scanner.
+ * @param dirEntry Directory entry.
+ * @return Display name, e.g. "GALE01/SuperSmashBros0110290334".
+ */
+QString McRecoverWindowPrivate::scanHitName(const card_direntry &dirEntry)
+{
+	QString name = QString::fromLatin1(dirEntry.gamecode, sizeof(dirEntry.gamecode)) +
+		QString::fromLatin1(dirEntry.company, sizeof(dirEntry.company)) + QChar(L'/');
+	name += QString::fromLatin1(dirEntry.filename,
+		(int)qstrnlen(dirEntry.filename, sizeof(dirEntry.filename)));
+	return name;
+}
+
+/**
+ * Show the progress dialog for a long-running task.
+ * The dialog's Cancel button calls progressDialog_canceled_slot().
+ * @param labelText Label text.
+ */
+void McRecoverWindowPrivate::showProgressDialog(const QString &labelText)
+{
+	Q_Q(McRecoverWindow);
+	if (!progressDialog) {
+		progressDialog = new QProgressDialog(q);
+		progressDialog->setWindowModality(Qt::WindowModal);
+		progressDialog->setMinimumDuration(0);
+		progressDialog->setAutoClose(false);
+		progressDialog->setAutoReset(false);
+		QObject::connect(progressDialog, &QProgressDialog::canceled,
+				 q, &McRecoverWindow::progressDialog_canceled_slot);
+	}
+
+	progressDialog->setLabelText(labelText);
+	progressDialog->setRange(0, 0);
+	progressDialog->setValue(0);
+	progressDialog->show();
+}
+
+/**
+ * Close the progress dialog.
+ */
+void McRecoverWindowPrivate::closeProgressDialog(void)
+{
+	if (!progressDialog)
+		return;
+
+	// NOTE: Use deleteLater() in case this is
+	// called from one of the dialog's signals.
+	progressDialog->hide();
+	progressDialog->deleteLater();
+	progressDialog = nullptr;
+}
+
 /**
  * Update the memory card's QTreeView.
  */
@@ -359,6 +540,10 @@ void McRecoverWindowPrivate::initToolbar(void)
 	// Disable save actions by default.
 	ui.actionSave->setEnabled(false);
 	ui.actionSaveAll->setEnabled(false);
+	ui.actionRebuild->setEnabled(false);
+	ui.actionCompare->setEnabled(false);
+	ui.actionSnapshotSave->setEnabled(false);
+	ui.actionSnapshotExport->setEnabled(false);
 
 	// Add a label for the "Preferred region" buttons.
 	lblPreferredRegion = new QLabel();
@@ -461,15 +646,214 @@ void McRecoverWindowPrivate::updateActionEnableStatus(void)
 		ui.actionScan->setEnabled(false);
 		ui.actionSave->setEnabled(false);
 		ui.actionSaveAll->setEnabled(false);
+		ui.actionRebuild->setEnabled(false);
+		ui.actionSnapshotSave->setEnabled(false);
+		ui.actionSnapshotExport->setEnabled(false);
 	} else {
 		// Memory card image is loaded.
 		// TODO: Disable open, scan, and save (all) if we're scanning.
+		// Scan and save are disabled until an asynchronous open finishes.
+		const GcnCard *const gcnCard = qobject_cast<const GcnCard*>(card);
+		const bool loading = (gcnCard && gcnCard->isLoading());
 		ui.actionClose->setEnabled(true);
-		ui.actionScan->setEnabled(true);
-		ui.actionSave->setEnabled(
+		ui.actionScan->setEnabled(!loading);
+		ui.actionSave->setEnabled(!loading &&
 			ui.lstFileList->selectionModel()->hasSelection());
-		ui.actionSaveAll->setEnabled(card->fileCount() > 0);
+		ui.actionSaveAll->setEnabled(!loading && card->fileCount() > 0);
+		ui.actionRebuild->setEnabled(!loading && gcnCard && card->fileCount() > 0);
+		ui.actionCompare->setEnabled(!loading);
+		ui.actionSnapshotSave->setEnabled(!loading);
+		ui.actionSnapshotExport->setEnabled(!loading);
+	}
+}
+
+/**
+ * Finish opening the memory card image.
+ * This checks file checksums, shows card errors,
+ * and updates the UI.
+ */
+void McRecoverWindowPrivate::cardOpened(void)
+{
+	// If GCN, check file checksums.
+	// TODO: Run this in a separate thread after loading?
+	GcnCard *const gcnCard = qobject_cast<GcnCard*>(card);
+	if (gcnCard) {
+		// TODO: Singleton database management class.
+		// Get the database filenames.
+		QVector<QString> dbFilenames = GcnMcFileDb::GetDbFilenames();
+		if (!dbFilenames.isEmpty()) {
+			// Load the databases.
+			GcnCheckFiles checkFiles;
+			int ret = checkFiles.loadGcnMcFileDbs(dbFilenames);
+			if (ret == 0) {
+				// Check the files.
+				checkFiles.addChecksumDefs(gcnCard);
+
+				// Files may already be visible if the
+				// card was opened asynchronously.
+				ui.lstFileList->viewport()->update();
+			}
+		}
+	}
+
+	// Set the CardView's Card to the
+	// selected card in the QTreeView.
+	ui.mcCardView->setCard(card);
+
+	// Check for other card errors.
+	// NOTE: These aren't retranslated if the UI is retranslated.
+	QStringList sl_cardErrors;
+	QFlags<GcnCard::Error> cardErrors = card->errors();
+	QString cardSz = formatFileSize(card->filesize());
+	if (cardErrors & GcnCard::MCE_HEADER_GARBAGE) {
+		uint8_t bad_byte; int count; int total;
+		if (!card->garbageInfo(&bad_byte, &count, &total)) {
+			float pct = (float)count / (float)total * 100.0f;
+			char hex_byte[8];
+			snprintf(hex_byte, sizeof(hex_byte), "%02X", bad_byte);
+			//: %1 is a percentage; %2 is a formatted size, e.g. "100 bytes" or "2 MB"; %3 is a two-digit hexadecimal number.
+			sl_cardErrors += McRecoverWindow::tr("The header appears to contain garbage. "
+					"%1% of the %2 header is the same byte, 0x%3.")
+				.arg(pct, 0, 'f', 2)
+				.arg(formatFileSize(total), QLatin1String(hex_byte));
+		}
+	}
+	if (cardErrors & GcnCard::MCE_SZ_TOO_SMALL) {
+		QString minSz = formatFileSize(card->minBlocks() * card->blockSize());
+		//: %1 and %2 are both formatted sizes, e.g. "100 bytes" or "2 MB".
+		sl_cardErrors +=
+			McRecoverWindow::tr("The card image is too small. (Card image is %1; should be at least %2.)")
+			.arg(cardSz).arg(minSz);
+	}
+	if (cardErrors & GcnCard::MCE_SZ_TOO_BIG) {
+		QString maxSz = formatFileSize(card->maxBlocks() * card->blockSize());
+		//: %1 and %2 are both formatted sizes, e.g. "100 bytes" or "2 MB".
+		sl_cardErrors +=
+			McRecoverWindow::tr("The card image is too big. (Card image is %1; should be %2 or less.)")
+			.arg(cardSz).arg(maxSz);
+	}
+	if (cardErrors & GcnCard::MCE_SZ_NON_POW2) {
+		// TODO: Convert filesize to KB/MB/GB?
+		//: %1 is a formatted size, e.g. "100 bytes" or "2 MB".
+		sl_cardErrors +=
+			McRecoverWindow::tr("The card image size is not a power of two. (Card image is %1.)")
+			.arg(cardSz);
+	}
+	if (cardErrors & GcnCard::MCE_INVALID_HEADER) {
+		sl_cardErrors += McRecoverWindow::tr("The header checksum is invalid.");
+	}
+	if (cardErrors & GcnCard::MCE_INVALID_DATS) {
+		sl_cardErrors += McRecoverWindow::tr("Both directory tables are invalid.");
+	}
+	if (cardErrors & GcnCard::MCE_INVALID_BATS) {
+		sl_cardErrors += McRecoverWindow::tr("Both block tables are invalid.");
+	}
+	if (gcnCard && !(cardErrors & (GcnCard::MCE_INVALID_DATS | GcnCard::MCE_INVALID_BATS))) {
+		// Check the file system consistency of the active block table.
+		const GcnFsck fsck = gcnCard->fsck();
+		const int batIdx = (card->activeBatIdx() >= 0 ? card->activeBatIdx() : 0);
+		int crossLinked = 0, orphaned = 0, broken = 0;
+		bool brokenFiles[CARD_MAXFILES] = { };
+		foreach (const GcnFsck::Issue &issue, fsck.issues()) {
+			if (issue.batIdx != batIdx)
+				continue;
+			switch (issue.type) {
+				case GcnFsck::FSCK_CROSS_LINK:
+					crossLinked++;
+					break;
+				case GcnFsck::FSCK_ORPHANED_BLOCK:
+					orphaned++;
+					break;
+				case GcnFsck::FSCK_INVALID_START:
+				case GcnFsck::FSCK_INVALID_LINK:
+				case GcnFsck::FSCK_LOOP:
+				case GcnFsck::FSCK_LENGTH_MISMATCH:
+					if (issue.dirIdx >= 0 && !brokenFiles[issue.dirIdx]) {
+						brokenFiles[issue.dirIdx] = true;
+						broken++;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+		if (crossLinked > 0) {
+			sl_cardErrors += McRecoverWindow::tr("%Ln block(s) are used by more than one file.", "", crossLinked);
+		}
+		if (broken > 0) {
+			sl_cardErrors += McRecoverWindow::tr("%Ln file(s) have a damaged block chain.", "", broken);
+		}
+		if (orphaned > 0) {
+			sl_cardErrors += McRecoverWindow::tr("%Ln block(s) are allocated but not used by any file.", "", orphaned);
+		}
+	}
+
+	if (!sl_cardErrors.isEmpty()) {
+		// Errors detected.
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString msg;
+		msg.reserve(2048);
+		msg += McRecoverWindow::tr("Error(s) have been detected in this %1 image:", "",
+			sl_cardErrors.size()).arg(card->productName());
+		foreach (const QString &str, sl_cardErrors) {
+			msg += QChar(L'\n') + chrBullet + QChar(L' ') + str;
+		}
+
+		// Show a warning message.
+		ui.msgWidget->showMessage(msg, MessageWidget::ICON_WARNING, 0, card);
+	}
+
+	// Can we allow writing to this memory card?
+	// NOTE: Currently disabled in Release builds.
+#ifndef NDEBUG
+	if (!cardErrors && card->canMakeWritable()) {
+		// No errors, and card can be made writable.
+		chkAllowWrite->setChecked(!card->isReadOnly());
+		chkAllowWrite->setEnabled(true);
+	} else
+#endif /* !NDEBUG */
+	{
+		// Card has errors or cannot be made writable.
+		chkAllowWrite->setEnabled(false);
+		chkAllowWrite->setChecked(false);
+	}
+
+	// Update the UI.
+	updateLstFileList();
+	statusBarManager->opened(filename, card->productName());
+	updateWindowTitle();
+}
+
+/**
+ * Show an error message for a card that couldn't be opened.
+ * @param filename Memory Card image filename.
+ * @param className Card class name, used if the card has no error string.
+ */
+void McRecoverWindowPrivate::showOpenError(const QString &filename, const QString &className)
+{
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	QString filename_noPath = QFileInfo(filename).fileName();
+
+	QString errorString;
+	if (card) {
+		errorString = card->errorString();
+		if (!errorString.isEmpty()) {
+			// Qt error strings don't have a trailing '.'
+			// TODO: Move this to Card's error string functions?
+			errorString += QChar(L'.');
+		}
 	}
+
+	QString errMsg = McRecoverWindow::tr("An error occurred while opening %1:")
+				.arg(filename_noPath) +
+			QChar(L'\n') + chrBullet + QChar(L' ');
+	if (!errorString.isEmpty()) {
+		errMsg += errorString;
+	} else {
+		//: Failure message when opening a card. (%1 == class name)
+		errMsg += McRecoverWindow::tr("%1 failed.").arg(className);
+	}
+	ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
 }
 
 /**
@@ -736,6 +1120,87 @@ void McRecoverWindowPrivate::setLastPath(const QString &path)
 		 QDir::toNativeSeparators(lastPath));
 }
 
+/**
+ * Open the snapshot store.
+ * The user is prompted for the store directory.
+ * @return Snapshot store, or nullptr if cancelled or on error. (caller must delete it)
+ */
+SnapshotStore *McRecoverWindowPrivate::openSnapshotStore(void)
+{
+	Q_Q(McRecoverWindow);
+
+	// NOTE: Path is stored using native separators.
+	const QString storeKey = QLatin1String("snapshotStore");
+	QString path = QDir::fromNativeSeparators(cfg->get(storeKey).toString());
+	if (path.isEmpty()) {
+		path = lastPath();
+	}
+
+	path = QFileDialog::getExistingDirectory(q,
+			McRecoverWindow::tr("Select Snapshot Store"),	// Dialog title
+			path);
+	if (path.isEmpty())
+		return nullptr;
+	cfg->set(storeKey, QDir::toNativeSeparators(path));
+
+	SnapshotStore *const store = new SnapshotStore(path);
+	int ret = store->open();
+	if (ret != 0) {
+		showSnapshotError(store, ret);
+		delete store;
+		return nullptr;
+	}
+	return store;
+}
+
+/**
+ * Prompt the user to select a snapshot.
+ * @param store Snapshot store.
+ * @param title Dialog title.
+ * @return Snapshot ID, or empty string if cancelled.
+ */
+QString McRecoverWindowPrivate::selectSnapshot(const SnapshotStore *store, const QString &title)
+{
+	Q_Q(McRecoverWindow);
+
+	const QStringList ids = store->snapshots();
+	if (ids.isEmpty()) {
+		ui.msgWidget->showMessage(
+			McRecoverWindow::tr("The snapshot store doesn't have any snapshots."),
+			MessageWidget::ICON_WARNING);
+		return QString();
+	}
+
+	// Select the newest snapshot by default.
+	// NOTE: snapshots() is sorted by creation time.
+	bool ok = false;
+	const QString id = QInputDialog::getItem(q, title,
+			McRecoverWindow::tr("Snapshot:"),
+			ids, ids.size() - 1, false, &ok);
+	return (ok ? id : QString());
+}
+
+/**
+ * Show a snapshot store error.
+ * @param store Snapshot store.
+ * @param ret Error code. (negative POSIX error code)
+ */
+void McRecoverWindowPrivate::showSnapshotError(const SnapshotStore *store, int ret)
+{
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	QString errMsg = McRecoverWindow::tr("An error occurred while accessing the snapshot store:");
+	errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+
+	const QString errorString = store->errorString();
+	if (!errorString.isEmpty()) {
+		// Qt error strings don't have a trailing '.'
+		errMsg += errorString + QChar(L'.');
+	} else {
+		errMsg += QLatin1String(strerror(-ret)) + QChar(L'.');
+	}
+	ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+}
+
 /**
  * Get the animated icon format to use.
  * @return Animated icon format to use.
@@ -783,9 +1248,20 @@ GcImageWriter::AnimImageFormat McRecoverWindowPrivate::animIconFormat(void) cons
  */
 McRecoverWindow::FileType McRecoverWindowPrivate::checkCardType(const QString &filename)
 {
+	// Compressed images are checked using the uncompressed data.
+	// NOTE: The image isn't opened as a CompressedFile here, since
+	// that would build the seek index just to check the type.
+	const bool isCompressed = CompressedFile::isCompressed(filename);
 	QFile file(filename);
+	qint64 filesize;
+	if (isCompressed) {
+		filesize = CompressedFile::uncompressedSize(filename);
+	} else {
+		filesize = (file.open(QIODevice::ReadOnly) ? file.size() : -1);
+	}
+	if (filesize < 0)
+		return McRecoverWindow::FileType::Unknown;
 
-	const qint64 filesize = file.size();
 	if (filesize == 131072) {
 		// Possibly a Dreamcast VMU.
 		// TODO: Support for 4x cards, though
@@ -793,13 +1269,15 @@ McRecoverWindow::FileType McRecoverWindowPrivate::checkCardType(const QString &f
 
 		// Check if 0x1FE00 - 0x1FE0F is all 0x55.
 		// If it is, then this is probably a VMU.
-		if (!file.open(QIODevice::ReadOnly))
-			goto not_vmu;
-		if (!file.seek(0x1FE00))
-			goto not_vmu;
-
-		// Read the data.
-		QByteArray ba = file.read(16);
+		QByteArray ba;
+		if (isCompressed) {
+			// Decompress up to the end of the VMU signature.
+			ba = CompressedFile::readHead(filename, 0x1FE10).mid(0x1FE00);
+		} else {
+			if (!file.seek(0x1FE00))
+				goto not_vmu;
+			ba = file.read(16);
+		}
 		if (ba.size() != 16)
 			goto not_vmu;
 
@@ -966,7 +1444,7 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 		default:
 		case FileType::GCN:
 			className = QLatin1String("GcnCard");
-			d->card = GcnCard::open(filename, this);
+			d->card = GcnCard::openAsync(filename, this);
 			break;
 		case FileType::GCI:
 			className = QLatin1String("GciCard");
@@ -980,52 +1458,12 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 
 	if (!d->card || !d->card->isOpen()) {
 		// Could not open the card.
-		static const QChar chrBullet(0x2022);  // U+2022: BULLET
-		QString filename_noPath = QFileInfo(filename).fileName();
-
-		QString errorString;
-		if (d->card) {
-			errorString = d->card->errorString();
-			if (!errorString.isEmpty()) {
-				// Qt error strings don't have a trailing '.'
-				// TODO: Move this to Card's error string functions?
-				errorString += QChar(L'.');
-			}
-		}
-
-		QString errMsg = tr("An error occurred while opening %1:")
-					.arg(filename_noPath) +
-				QChar(L'\n') + chrBullet + QChar(L' ');
-		if (!errorString.isEmpty()) {
-			errMsg += errorString;
-		} else {
-			//: Failure message when opening a card. (%1 == class name)
-			errMsg += tr("%1 failed.").arg(className);
-		}
-		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		d->showOpenError(filename, className);
 		closeCard(true);
 		return;
 	}
 
 	d->filename = filename;
-
-	// If GCN, check file checksums.
-	// TODO: Run this in a separate thread after loading?
-	if (type == FileType::GCN) {
-		// TODO: Singleton database management class.
-		// Get the database filenames.
-		QVector<QString> dbFilenames = GcnMcFileDb::GetDbFilenames();
-		if (!dbFilenames.isEmpty()) {
-			// Load the databases.
-			GcnCheckFiles checkFiles;
-			int ret = checkFiles.loadGcnMcFileDbs(dbFilenames);
-			if (ret == 0) {
-				// Check the files.
-				checkFiles.addChecksumDefs(qobject_cast<GcnCard*>(d->card));
-			}
-		}
-	}
-
 	d->model->setCard(d->card);
 
 	// Extract the filename from the path.
@@ -1034,93 +1472,20 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 	if (lastSlash >= 0)
 		d->displayFilename.remove(0, lastSlash + 1);
 
-	// Set the CardView's Card to the
-	// selected card in the QTreeView.
-	d->ui.mcCardView->setCard(d->card);
-
-	// Check for other card errors.
-	// NOTE: These aren't retranslated if the UI is retranslated.
-	QStringList sl_cardErrors;
-	QFlags<GcnCard::Error> cardErrors = d->card->errors();
-	QString cardSz = d->formatFileSize(d->card->filesize());
-	if (cardErrors & GcnCard::MCE_HEADER_GARBAGE) {
-		uint8_t bad_byte; int count; int total;
-		if (!d->card->garbageInfo(&bad_byte, &count, &total)) {
-			float pct = (float)count / (float)total * 100.0f;
-			char hex_byte[8];
-			snprintf(hex_byte, sizeof(hex_byte), "%02X", bad_byte);
-			//: %1 is a percentage; %2 is a formatted size, e.g. "100 bytes" or "2 MB"; %3 is a two-digit hexadecimal number.
-			sl_cardErrors += tr("The header appears to contain garbage. "
-					"%1% of the %2 header is the same byte, 0x%3.")
-				.arg(pct, 0, 'f', 2)
-				.arg(d->formatFileSize(total), QLatin1String(hex_byte));
-		}
-	}
-	if (cardErrors & GcnCard::MCE_SZ_TOO_SMALL) {
-		QString minSz = d->formatFileSize(d->card->minBlocks() * d->card->blockSize());
-		//: %1 and %2 are both formatted sizes, e.g. "100 bytes" or "2 MB".
-		sl_cardErrors +=
-			tr("The card image is too small. (Card image is %1; should be at least %2.)")
-			.arg(cardSz).arg(minSz);
+	GcnCard *const gcnCard = qobject_cast<GcnCard*>(d->card);
+	if (gcnCard && gcnCard->isLoading()) {
+		// Files are still being loaded.
+		// The rest is handled by gcnCard_openFinished_slot().
+		connect(gcnCard, &GcnCard::openProgress,
+			d->statusBarManager, &StatusBarManager::openProgress);
+		connect(gcnCard, &GcnCard::openFinished,
+			this, &McRecoverWindow::gcnCard_openFinished_slot);
+		d->updateActionEnableStatus();
+		d->updateWindowTitle();
+		return;
 	}
-	if (cardErrors & GcnCard::MCE_SZ_TOO_BIG) {
-		QString maxSz = d->formatFileSize(d->card->maxBlocks() * d->card->blockSize());
-		//: %1 and %2 are both formatted sizes, e.g. "100 bytes" or "2 MB".
-		sl_cardErrors +=
-			tr("The card image is too big. (Card image is %1; should be %2 or less.)")
-			.arg(cardSz).arg(maxSz);
-	}
-	if (cardErrors & GcnCard::MCE_SZ_NON_POW2) {
-		// TODO: Convert filesize to KB/MB/GB?
-		//: %1 is a formatted size, e.g. "100 bytes" or "2 MB".
-		sl_cardErrors +=
-			tr("The card image size is not a power of two. (Card image is %1.)")
-			.arg(cardSz);
-	}
-	if (cardErrors & GcnCard::MCE_INVALID_HEADER) {
-		sl_cardErrors += tr("The header checksum is invalid.");
-	}
-	if (cardErrors & GcnCard::MCE_INVALID_DATS) {
-		sl_cardErrors += tr("Both directory tables are invalid.");
-	}
-	if (cardErrors & GcnCard::MCE_INVALID_BATS) {
-		sl_cardErrors += tr("Both block tables are invalid.");
-	}
-
-	if (!sl_cardErrors.isEmpty()) {
-		// Errors detected.
-		static const QChar chrBullet(0x2022);  // U+2022: BULLET
-		QString msg;
-		msg.reserve(2048);
-		msg += tr("Error(s) have been detected in this %1 image:", "",
-			sl_cardErrors.size()).arg(d->card->productName());
-		foreach (const QString &str, sl_cardErrors) {
-			msg += QChar(L'\n') + chrBullet + QChar(L' ') + str;
-		}
 
-		// Show a warning message.
-		d->ui.msgWidget->showMessage(msg, MessageWidget::ICON_WARNING, 0, d->card);
-	}
-
-	// Can we allow writing to this memory card?
-	// NOTE: Currently disabled in Release builds.
-#ifndef NDEBUG
-	if (!cardErrors && d->card->canMakeWritable()) {
-		// No errors, and card can be made writable.
-		d->chkAllowWrite->setChecked(!d->card->isReadOnly());
-		d->chkAllowWrite->setEnabled(true);
-	} else
-#endif /* !NDEBUG */
-	{
-		// Card has errors or cannot be made writable.
-		d->chkAllowWrite->setEnabled(false);
-		d->chkAllowWrite->setChecked(false);
-	}
-
-	// Update the UI.
-	d->updateLstFileList();
-	d->statusBarManager->opened(filename, d->card->productName());
-	d->updateWindowTitle();
+	d->cardOpened();
 
 	// FIXME: If a file is opened from the command line,
 	// QTreeView sort-of selects the first file.
@@ -1161,6 +1526,30 @@ void McRecoverWindow::closeCard(bool noMsg)
 	d->updateWindowTitle();
 }
 
+/**
+ * Asynchronous GcnCard open has finished.
+ * @param ret 0 on success; negative POSIX error code on error.
+ */
+void McRecoverWindow::gcnCard_openFinished_slot(int ret)
+{
+	Q_D(McRecoverWindow);
+	if (!d->card || sender() != d->card)
+		return;
+
+	if (ret == -ECANCELED) {
+		// Open was cancelled.
+		closeCard(true);
+		return;
+	} else if (ret != 0) {
+		// Open failed.
+		d->showOpenError(d->filename, QLatin1String("GcnCard"));
+		closeCard(true);
+		return;
+	}
+
+	d->cardOpened();
+}
+
 /**
  * Widget state has changed.
  * @param event State change event.
@@ -1395,7 +1784,7 @@ void McRecoverWindow::on_actionOpen_triggered(void)
 	// TODO: Remove the space before the "*.raw"?
 	// On Linux, Qt shows an extra space after the filter name, since
 	// it doesn't show the extension. Not sure about Windows...
-	const QString gcnFilter = tr("GameCube Memory Card Image") + QLatin1String(" (*.raw)");
+	const QString gcnFilter = tr("GameCube Memory Card Image") + QLatin1String(" (*.raw *.raw.gz *.zip)");
 	const QString gciFilter = tr("GameCube Save File") + QLatin1String(" (*.gci)");
 	const QString vmuFilter = tr("Dreamcast VMU Image") + QLatin1String(" (*.bin)");
 	const QString allFilter = tr("All Files") + QLatin1String(" (*)");
@@ -1465,6 +1854,266 @@ void McRecoverWindow::on_actionOpen_triggered(void)
 	}
 }
 
+/**
+ * Build a consensus image from multiple dumps of a memory card.
+ * Each block is chosen by majority vote across the dumps,
+ * and the consensus image is opened afterwards.
+ */
+void McRecoverWindow::on_actionConsensus_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (d->consensusThread) {
+		// A consensus image is already being built.
+		return;
+	}
+
+	const QString gcnFilter = tr("GameCube Memory Card Image") + QLatin1String(" (*.raw)");
+	const QString allFilter = tr("All Files") + QLatin1String(" (*)");
+	const QString filters = gcnFilter + QLatin1String(";;") + allFilter;
+
+	// Get the dump filenames.
+	const QStringList dumps = QFileDialog::getOpenFileNames(this,
+			tr("Open Multiple GameCube Memory Card Dumps"),	// Dialog title
+			d->lastPath(),					// Default filename
+			filters);					// Filters
+	if (dumps.isEmpty())
+		return;
+	d->setLastPath(dumps.at(0));
+	if (dumps.size() < 2 || dumps.size() > DumpConsensus::MAX_DUMPS) {
+		d->ui.msgWidget->showMessage(
+			tr("Select between 2 and %1 dumps of the same memory card.")
+				.arg(DumpConsensus::MAX_DUMPS),
+			MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	// Get the consensus image filename.
+	const QString filename = QFileDialog::getSaveFileName(this,
+			tr("Save Consensus Memory Card Image"),	// Dialog title
+			d->lastPath(),				// Default filename
+			filters);				// Filters
+	if (filename.isEmpty())
+		return;
+	foreach (const QString &dump, dumps) {
+		if (QFileInfo(dump) == QFileInfo(filename)) {
+			d->ui.msgWidget->showMessage(
+				tr("The consensus image cannot overwrite one of the dumps."),
+				MessageWidget::ICON_WARNING);
+			return;
+		}
+	}
+
+	// Build the consensus image in a worker thread.
+	// consensusThread_finished_slot() opens the image afterwards.
+	d->consensusThread = new DumpConsensusThread(dumps, filename, this);
+	connect(d->consensusThread, &QThread::finished,
+		this, &McRecoverWindow::consensusThread_finished_slot);
+
+	markUiBusy();
+	d->showProgressDialog(tr("Combining %Ln memory card dump(s)...", "", dumps.size()));
+	d->consensusTimer = new QTimer(this);
+	connect(d->consensusTimer, &QTimer::timeout,
+		this, &McRecoverWindow::consensusTimer_timeout_slot);
+	d->consensusTimer->start(100);
+	d->consensusThread->start();
+}
+
+/**
+ * Update the consensus progress.
+ */
+void McRecoverWindow::consensusTimer_timeout_slot(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->consensusThread || !d->progressDialog)
+		return;
+
+	const DumpConsensus &consensus = d->consensusThread->consensus;
+	const int blockCount = consensus.blockCount();
+	if (blockCount > 0) {
+		if (d->progressDialog->maximum() != blockCount) {
+			d->progressDialog->setRange(0, blockCount);
+		}
+		d->progressDialog->setValue(qMin(consensus.blocksDone(), blockCount));
+	}
+}
+
+/**
+ * The consensus thread has finished.
+ * The consensus image is opened if it was built successfully.
+ */
+void McRecoverWindow::consensusThread_finished_slot(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->consensusThread)
+		return;
+
+	// Take ownership of the thread.
+	// NOTE: finished() may be delivered before run() has fully
+	// returned, so wait for the thread before deleting it.
+	QScopedPointer<DumpConsensusThread> thread(d->consensusThread);
+	d->consensusThread = nullptr;
+	thread->wait();
+	delete d->consensusTimer;
+	d->consensusTimer = nullptr;
+	d->closeProgressDialog();
+	markUiNotBusy();
+
+	const DumpConsensus &consensus = thread->consensus;
+	const QString &filename = thread->outFilename;
+	const int ret = thread->ret;
+	if (ret == -ECANCELED) {
+		// Cancelled by the user.
+		return;
+	} else if (ret != 0) {
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString errMsg = tr("An error occurred while combining the memory card dumps:");
+		errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+		const QString errorString = consensus.errorString();
+		if (!errorString.isEmpty()) {
+			// Qt error strings don't have a trailing '.'
+			errMsg += errorString + QChar(L'.');
+		} else {
+			errMsg += QLatin1String(strerror(-ret)) + QChar(L'.');
+		}
+		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	// Open the consensus image.
+	openCard(filename, FileType::GCN);
+
+	const int lowConfidence = consensus.lowConfidenceCount();
+	if (lowConfidence > 0 && d->card) {
+		// List the first few blocks that didn't match.
+		static const int maxBlocksListed = 16;
+		const QVector<DumpConsensus::BlockResult> results = consensus.results();
+		QStringList blocks;
+		for (int i = 0; i < results.size() && blocks.size() < maxBlocksListed; i++) {
+			const DumpConsensus::BlockResult &result = results.at(i);
+			if ((result.flags & DumpConsensus::BRF_MISSING) || result.versions > 1) {
+				blocks.append(QString::number(i));
+			}
+		}
+		QString blockList = blocks.join(QLatin1String(", "));
+		if (lowConfidence > maxBlocksListed) {
+			blockList += QLatin1String(", ...");
+		}
+
+		d->ui.msgWidget->showMessage(
+			tr("%Ln block(s) did not match in all dumps: %1", "", lowConfidence)
+				.arg(blockList),
+			MessageWidget::ICON_WARNING, 0, d->card);
+	}
+}
+
+/**
+ * Compare the memory card image with another image.
+ * Added, removed, and modified files are listed,
+ * along with the blocks that changed in each file.
+ */
+void McRecoverWindow::on_actionCompare_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->card)
+		return;
+
+	// TODO: Other card types.
+	const QString gcnFilter = tr("GameCube Memory Card Image") + QLatin1String(" (*.raw)");
+	const QString allFilter = tr("All Files") + QLatin1String(" (*)");
+	const QString filters = gcnFilter + QLatin1String(";;") + allFilter;
+
+	const QString filename = QFileDialog::getOpenFileName(this,
+			tr("Compare With GameCube Memory Card Image"),	// Dialog title
+			d->lastPath(),					// Default filename
+			filters);					// Filters
+	if (filename.isEmpty())
+		return;
+	d->setLastPath(filename);
+
+	QScopedPointer<GcnCard> other(GcnCard::open(filename, nullptr));
+	if (!other || !other->isOpen()) {
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString errMsg = tr("An error occurred while opening the memory card image:");
+		errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+		const QString errorString = (other ? other->errorString() : QString());
+		if (!errorString.isEmpty()) {
+			// Qt error strings don't have a trailing '.'
+			errMsg += errorString + QChar(L'.');
+		} else {
+			errMsg += QLatin1String(strerror(EIO)) + QChar(L'.');
+		}
+		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	CardDiff diff;
+	markUiBusy();
+	int ret = diff.compare(d->card, other.data());
+	markUiNotBusy();
+	if (ret != 0) {
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString errMsg = tr("An error occurred while comparing the memory card images:");
+		errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+		if (ret == -EINVAL) {
+			errMsg += tr("The memory card images have different block sizes.");
+		} else {
+			errMsg += QLatin1String(strerror(-ret)) + QChar(L'.');
+		}
+		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	const QVector<CardDiff::FileDiff> files = diff.files();
+	if (files.isEmpty()) {
+		d->ui.msgWidget->showMessage(
+			tr("No files differ from %1.").arg(QFileInfo(filename).fileName()),
+			MessageWidget::ICON_INFORMATION, 10000, d->card);
+		return;
+	}
+
+	// List the differences.
+	// NOTE: The other card is closed after this function returns,
+	// so only names and block numbers are shown.
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	static const int maxFilesListed = 16;
+	QString msg = tr("%Ln file(s) differ from %1:", "", files.size())
+		.arg(QFileInfo(filename).fileName());
+	for (int i = 0; i < files.size() && i < maxFilesListed; i++) {
+		const CardDiff::FileDiff &file = files.at(i);
+		const QString name = file.gameID + QChar(L'/') + file.filename;
+		msg += QChar(L'\n') + chrBullet + QChar(L' ');
+		switch (file.type) {
+			case CardDiff::DIFF_ADDED:
+				msg += tr("Added: %1").arg(name);
+				break;
+			case CardDiff::DIFF_REMOVED:
+				msg += tr("Removed: %1").arg(name);
+				break;
+			case CardDiff::DIFF_MODIFIED:
+			default: {
+				QStringList blocks;
+				blocks.reserve(file.changedBlocks.size());
+				foreach (int block, file.changedBlocks) {
+					blocks.append(QString::number(block));
+				}
+				if (!blocks.isEmpty()) {
+					msg += tr("Modified: %1 (block(s) %2)")
+						.arg(name, blocks.join(QLatin1String(", ")));
+				} else {
+					msg += tr("Modified: %1 (timestamp only)").arg(name);
+				}
+				break;
+			}
+		}
+	}
+	if (files.size() > maxFilesListed) {
+		msg += QChar(L'\n') + chrBullet + QChar(L' ') +
+			tr("%Ln more file(s)", "", files.size() - maxFilesListed);
+	}
+
+	d->ui.msgWidget->showMessage(msg, MessageWidget::ICON_INFORMATION, 0, d->card);
+}
+
 /**
  * Close the currently-opened memory card image.
  */
@@ -1546,6 +2195,93 @@ void McRecoverWindow::on_actionScan_triggered(void)
 	}
 }
 
+/**
+ * Scan a raw image of any size for memory card images,
+ * GCI files, and lost files.
+ */
+void McRecoverWindow::on_actionScanImage_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (d->imageScanner)
+		return;
+
+	const QString rawFilter = tr("Raw Image") + QLatin1String(" (*.raw *.bin *.img *.raw.gz *.zip)");
+	const QString allFilter = tr("All Files") + QLatin1String(" (*)");
+	const QString filters = rawFilter + QLatin1String(";;") + allFilter;
+
+	const QString filename = QFileDialog::getOpenFileName(this,
+			tr("Scan Raw Image"),	// Dialog title
+			d->lastPath(),		// Default filename
+			filters);		// Filters
+	if (filename.isEmpty())
+		return;
+	d->setLastPath(filename);
+
+	// Open the image.
+	// NOTE: The device is owned by the scanner once the scan starts.
+	QIODevice *device;
+	if (CompressedFile::isCompressed(filename)) {
+		device = new CompressedFile(filename);
+	} else {
+		device = new QFile(filename);
+	}
+	if (!device->open(QIODevice::ReadOnly)) {
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString errMsg = tr("An error occurred while opening the raw image:");
+		errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+		errMsg += device->errorString() + QChar(L'.');
+		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		delete device;
+		return;
+	}
+
+	// Load the databases.
+	// If none can be loaded, only memory card images
+	// and GCI files will be found.
+	// TODO: Singleton database management class.
+	d->imageScanner = new GcnImageScanner(this);
+	d->imageScanFilename = filename;
+	QVector<GcnMcFileDb*> dbs;
+	foreach (const QString &dbFilename, GcnMcFileDb::GetDbFilenames()) {
+		GcnMcFileDb *db = new GcnMcFileDb(d->imageScanner);
+		if (db->load(dbFilename) == 0) {
+			dbs.append(db);
+		} else {
+			delete db;
+		}
+	}
+	d->imageScanner->setDatabases(dbs);
+
+	connect(d->imageScanner, &GcnImageScanner::scanUpdate,
+		this, &McRecoverWindow::imageScanner_scanUpdate_slot);
+	connect(d->imageScanner, &GcnImageScanner::scanFinished,
+		this, &McRecoverWindow::imageScanner_scanFinished_slot);
+	connect(d->imageScanner, &GcnImageScanner::scanCancelled,
+		this, &McRecoverWindow::imageScanner_scanCancelled_slot);
+	connect(d->imageScanner, &GcnImageScanner::scanError,
+		this, &McRecoverWindow::imageScanner_scanError_slot);
+
+	markUiBusy();
+	d->showProgressDialog(tr("Scanning %1...").arg(QFileInfo(filename).fileName()));
+	if (device->isSequential()) {
+		// Size is unknown. Show a busy indicator.
+		d->progressDialog->setRange(0, 0);
+	} else {
+		// Progress is shown in KiB, since the image may be larger than 2 GiB.
+		d->progressDialog->setRange(0, (int)qMin(device->size() >> 10, (qint64)INT_MAX));
+	}
+
+	int ret = d->imageScanner->scan_async(device);
+	if (ret != 0) {
+		// Couldn't start the scan thread.
+		// scan_async() has already deleted the device.
+		d->closeProgressDialog();
+		d->imageScanner->deleteLater();
+		d->imageScanner = nullptr;
+		markUiNotBusy();
+	}
+}
+
 /**
  * Exit the program.
  * TODO: Separate close/exit for Mac OS X?
@@ -1617,6 +2353,178 @@ void McRecoverWindow::on_actionSaveAll_triggered(void)
 	d->saveFiles(files);
 }
 
+/**
+ * Rebuild the memory card image.
+ * All files, including lost files, are written to a new image.
+ */
+void McRecoverWindow::on_actionRebuild_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (!qobject_cast<GcnCard*>(d->card))
+		return;
+
+	const QVector<File*> files = d->card->getFiles(Card::FTYPE_ALL);
+	if (files.isEmpty())
+		return;
+
+	// Prompt the user for a save location.
+	const QString gcnFilter = tr("GameCube Memory Card Image") + QLatin1String(" (*.raw)");
+	const QString allFilter = tr("All Files") + QLatin1String(" (*)");
+	QString filename = QFileDialog::getSaveFileName(this,
+			tr("Rebuild Memory Card Image"),	// Dialog title
+			d->lastPath(),				// Default filename
+			gcnFilter + QLatin1String(";;") + allFilter);
+	if (filename.isEmpty())
+		return;
+
+	// The source image can't be overwritten, since
+	// the file data is read from it.
+	if (QFileInfo(filename) == QFileInfo(d->card->filename())) {
+		d->ui.msgWidget->showMessage(
+			tr("The memory card image cannot be rebuilt over itself."),
+			MessageWidget::ICON_WARNING);
+		return;
+	}
+	d->setLastPath(filename);
+
+	int filesWritten = 0;
+	// The new image has the same size as the source card.
+	int ret = GcnCard::rebuild(filename, files, d->card->totalPhysBlocks(), &filesWritten);
+	if (ret != 0) {
+		static const QChar chrBullet(0x2022);  // U+2022: BULLET
+		QString errMsg = tr("An error occurred while rebuilding the memory card image:");
+		errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+		if (ret == -ENOSPC) {
+			errMsg += tr("The files do not fit on a single memory card.");
+		} else {
+			errMsg += QLatin1String(strerror(-ret)) + QChar(L'.');
+		}
+		d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	d->statusBarManager->cardRebuilt(filesWritten, filename);
+}
+
+/** Snapshot actions. **/
+
+/**
+ * Save a snapshot of the memory card image.
+ */
+void McRecoverWindow::on_actionSnapshotSave_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->card)
+		return;
+
+	QScopedPointer<SnapshotStore> store(d->openSnapshotStore());
+	if (!store)
+		return;
+
+	bool ok = false;
+	const QString id = QInputDialog::getText(this,
+			tr("Save Snapshot"),		// Dialog title
+			tr("Snapshot ID:"),
+			QLineEdit::Normal,
+			SnapshotStore::defaultId(d->card->filename()), &ok);
+	if (!ok || id.isEmpty())
+		return;
+	if (!SnapshotStore::isValidId(id)) {
+		d->ui.msgWidget->showMessage(
+			tr("Snapshot IDs may only contain letters, digits, '-', '_', and '.'."),
+			MessageWidget::ICON_WARNING);
+		return;
+	}
+
+	int newBlocks = 0;
+	markUiBusy();
+	int ret = store->addSnapshot(d->card, id, &newBlocks);
+	markUiNotBusy();
+	if (ret != 0) {
+		d->showSnapshotError(store.data(), ret);
+		return;
+	}
+
+	d->ui.msgWidget->showMessage(
+		tr("Snapshot %1 saved. %Ln new block(s) were stored.", "", newBlocks).arg(id),
+		MessageWidget::ICON_INFORMATION, 10000);
+}
+
+/**
+ * Restore a memory card image from a snapshot.
+ */
+void McRecoverWindow::on_actionSnapshotRestore_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	QScopedPointer<SnapshotStore> store(d->openSnapshotStore());
+	if (!store)
+		return;
+
+	const QString id = d->selectSnapshot(store.data(), tr("Restore Snapshot"));
+	if (id.isEmpty())
+		return;
+
+	const QString filename = QFileDialog::getSaveFileName(this,
+			tr("Restore Snapshot %1").arg(id),	// Dialog title
+			d->lastPath() + QChar(L'/') + id + QLatin1String(".raw"),	// Default filename
+			tr("GameCube Memory Card Image") + QLatin1String(" (*.raw);;") +
+			tr("All Files") + QLatin1String(" (*)"));
+	if (filename.isEmpty())
+		return;
+	if (d->card && QFileInfo(filename) == QFileInfo(d->card->filename())) {
+		// Close the current image first.
+		closeCard();
+	}
+	d->setLastPath(filename);
+
+	markUiBusy();
+	int ret = store->restore(id, filename);
+	markUiNotBusy();
+	if (ret != 0) {
+		d->showSnapshotError(store.data(), ret);
+		return;
+	}
+
+	// Open the restored image.
+	openCard(filename);
+}
+
+/**
+ * Save the files that changed since a snapshot.
+ */
+void McRecoverWindow::on_actionSnapshotExport_triggered(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->card)
+		return;
+
+	QScopedPointer<SnapshotStore> store(d->openSnapshotStore());
+	if (!store)
+		return;
+
+	const QString id = d->selectSnapshot(store.data(), tr("Export Changes Since Snapshot"));
+	if (id.isEmpty())
+		return;
+
+	const QString path = QFileDialog::getExistingDirectory(this,
+			tr("Save Files Changed Since %1").arg(id),
+			d->lastPath());
+	if (path.isEmpty())
+		return;
+	d->setLastPath(path);
+
+	int filesExported = 0;
+	markUiBusy();
+	int ret = store->exportChanged(id, d->card, path, &filesExported);
+	markUiNotBusy();
+	if (ret != 0) {
+		d->showSnapshotError(store.data(), ret);
+		return;
+	}
+
+	d->statusBarManager->filesSaved(filesExported, path);
+}
+
 /**
  * Set the preferred region.
  * This slot is triggered by a QSignalMapper that
@@ -1724,6 +2632,138 @@ void McRecoverWindow::searchThread_searchFinished_slot(int lostFilesFound)
 	QList<GcnFile*> files = gcnCard->addLostFiles(filesFoundList);
 }
 
+/**
+ * Raw image scan status was updated.
+ * @param position Current position, in bytes.
+ * @param hitCount Number of hits so far.
+ */
+void McRecoverWindow::imageScanner_scanUpdate_slot(qint64 position, int hitCount)
+{
+	Q_D(McRecoverWindow);
+	if (!d->progressDialog)
+		return;
+
+	if (d->progressDialog->maximum() > 0) {
+		d->progressDialog->setValue((int)qMin(position >> 10,
+			(qint64)d->progressDialog->maximum()));
+	}
+	d->progressDialog->setLabelText(
+		tr("Scanning %1... (%Ln item(s) found)", "", hitCount)
+			.arg(QFileInfo(d->imageScanFilename).fileName()));
+}
+
+/**
+ * Raw image scan has completed.
+ * @param hitCount Number of hits.
+ */
+void McRecoverWindow::imageScanner_scanFinished_slot(int hitCount)
+{
+	Q_D(McRecoverWindow);
+	if (!d->imageScanner)
+		return;
+
+	const QVector<GcnScanHit> hits = d->imageScanner->hits();
+	const QString displayName = QFileInfo(d->imageScanFilename).fileName();
+	d->closeProgressDialog();
+	// NOTE: deleteLater() waits for the scan thread to finish.
+	d->imageScanner->deleteLater();
+	d->imageScanner = nullptr;
+	markUiNotBusy();
+
+	if (hitCount <= 0 || hits.isEmpty()) {
+		d->ui.msgWidget->showMessage(
+			tr("No memory card images, GCI files, or lost files were found in %1.")
+				.arg(displayName),
+			MessageWidget::ICON_INFORMATION, 10000);
+		return;
+	}
+
+	// List the hits.
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	static const int maxHitsListed = 16;
+	QString msg = tr("%Ln item(s) found in %1:", "", hits.size()).arg(displayName);
+	for (int i = 0; i < hits.size() && i < maxHitsListed; i++) {
+		const GcnScanHit &hit = hits.at(i);
+		const QString offset = QLatin1String("0x") +
+			QString::number(hit.offset, 16).toUpper();
+		msg += QChar(L'\n') + chrBullet + QChar(L' ');
+		switch (hit.type) {
+			case GcnScanHit::Type::CardHeader:
+				msg += tr("Memory card image (%Ln block(s)) at offset %1", "", hit.cardBlocks)
+					.arg(offset);
+				break;
+			case GcnScanHit::Type::GciFile:
+				msg += tr("GCI file %1 at offset %2")
+					.arg(d->scanHitName(hit.searchData.dirEntry), offset);
+				break;
+			case GcnScanHit::Type::LostFile:
+			default:
+				msg += tr("Lost file %1 at offset %2")
+					.arg(d->scanHitName(hit.searchData.dirEntry), offset);
+				break;
+		}
+	}
+	if (hits.size() > maxHitsListed) {
+		msg += QChar(L'\n') + chrBullet + QChar(L' ') +
+			tr("%Ln more item(s)", "", hits.size() - maxHitsListed);
+	}
+
+	d->ui.msgWidget->showMessage(msg, MessageWidget::ICON_INFORMATION);
+}
+
+/**
+ * Raw image scan has been cancelled.
+ */
+void McRecoverWindow::imageScanner_scanCancelled_slot(void)
+{
+	Q_D(McRecoverWindow);
+	if (!d->imageScanner)
+		return;
+
+	d->closeProgressDialog();
+	d->imageScanner->deleteLater();
+	d->imageScanner = nullptr;
+	markUiNotBusy();
+}
+
+/**
+ * An error occurred while scanning a raw image.
+ * @param errorString Error string.
+ */
+void McRecoverWindow::imageScanner_scanError_slot(const QString &errorString)
+{
+	Q_D(McRecoverWindow);
+	if (!d->imageScanner)
+		return;
+
+	d->closeProgressDialog();
+	d->imageScanner->deleteLater();
+	d->imageScanner = nullptr;
+	markUiNotBusy();
+
+	static const QChar chrBullet(0x2022);  // U+2022: BULLET
+	QString errMsg = tr("An error occurred while scanning the raw image:");
+	errMsg += QChar(L'\n') + chrBullet + QChar(L' ');
+	errMsg += errorString + QChar(L'.');
+	d->ui.msgWidget->showMessage(errMsg, MessageWidget::ICON_WARNING);
+}
+
+/**
+ * The progress dialog's Cancel button was clicked.
+ */
+void McRecoverWindow::progressDialog_canceled_slot(void)
+{
+	Q_D(McRecoverWindow);
+	if (d->imageScanner) {
+		// The scanner will emit scanCancelled().
+		d->imageScanner->cancel();
+	}
+	if (d->consensusThread) {
+		// The thread will finish with -ECANCELED.
+		d->consensusThread->consensus.cancel();
+	}
+}
+
 /**
  * lstFileList selectionModel: Current row selection has changed.
  * @param selected Selected index.
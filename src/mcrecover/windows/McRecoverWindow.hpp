@@ -85,14 +85,23 @@ class McRecoverWindow : public QMainWindow
 	protected slots:
 		// Actions.
 		void on_actionOpen_triggered(void);
+		void on_actionConsensus_triggered(void);
+		void on_actionCompare_triggered(void);
 		void on_actionClose_triggered(void);
 		void on_actionScan_triggered(void);
+		void on_actionScanImage_triggered(void);
 		void on_actionExit_triggered(void);
 		void on_actionAbout_triggered(void);
 
 		// Save actions.
 		void on_actionSave_triggered(void);
 		void on_actionSaveAll_triggered(void);
+		void on_actionRebuild_triggered(void);
+
+		// Snapshot actions.
+		void on_actionSnapshotSave_triggered(void);
+		void on_actionSnapshotRestore_triggered(void);
+		void on_actionSnapshotExport_triggered(void);
 
 		/**
 		 * Set the preferred region.
@@ -116,6 +125,25 @@ class McRecoverWindow : public QMainWindow
 		// SearchThread has finished.
 		void searchThread_searchFinished_slot(int lostFilesFound);
 
+		// GcnImageScanner slots.
+		void imageScanner_scanUpdate_slot(qint64 position, int hitCount);
+		void imageScanner_scanFinished_slot(int hitCount);
+		void imageScanner_scanCancelled_slot(void);
+		void imageScanner_scanError_slot(const QString &errorString);
+
+		// Progress dialog's Cancel button was clicked.
+		void progressDialog_canceled_slot(void);
+
+		// Consensus thread slots.
+		void consensusTimer_timeout_slot(void);
+		void consensusThread_finished_slot(void);
+
+		/**
+		 * Asynchronous GcnCard open has finished.
+		 * @param ret 0 on success; negative POSIX error code on error.
+		 */
+		void gcnCard_openFinished_slot(int ret);
+
 		// lstFileList slots.
 		void lstFileList_selectionModel_selectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
 